@@ -0,0 +1,70 @@
+/*
+*   cmdtab.h  --  HCI command table, with help text
+*
+*   One CMD() entry per command:  the 2-letter name, the command function and the
+*   line listed by 'LS' (the newline is added).  Commands which share a help line
+*   have "" for all but the first.  cmnd.c includes this file to build the command
+*   table;  host/mkstrtab.py reads it to build the compressed help text in strtab.c,
+*   so after changing an entry, re-run:   python host/mkstrtab.py avrmon/src
+*
+*   Maximum number of commands is 250.
+*   (Application-specific command functions should go at the top)
+*/
+CMD( 'D','P',  default_params_cmd,  "DP        | Default Params" )
+CMD( 'L','S',  list_cmd,            "LS        | List Command Set" )
+CMD( 'I','M',  interactive_cmd,     "IM x      | Interactive Mode" )
+CMD( 'V','N',  version_cmd,         "VN        | Show Version" )
+CMD( 'N','A',  node_address_cmd,    "NA [nn]   | Node Address (00 = none)" )
+CMD( 'S','E',  show_errors_cmd,     "SE        | Show Errors" )
+CMD( 'S','F',  show_flags_cmd,      "SF        | Show Flags" )
+CMD( 'R','S',  reset_MCU_cmd,       "RS        | Reset System" )
+CMD( 'W','D',  watch_data_cmd,      "WD        | Watch Data" )
+CMD( 'L','V',  live_view_cmd,       "LV aaaa [nn [tt]] | Live View data mem" )
+CMD( 'W','S',  wdog_status_cmd,     "WS        | Watchdog Status" )
+CMD( 'C','M',  crash_mailbox_cmd,   "CM [C]    | Crash Mailbox [Clear]" )
+CMD( 'D','C',  dump_memory_cmd,     "DC [aaaa] | Dump Code mem" )
+CMD( 'D','D',  dump_memory_cmd,     "DD [aaaa] | Dump Data mem" )
+CMD( 'D','E',  dump_memory_cmd,     "DE pp     | Dump EEPROM page" )
+CMD( 'E','E',  erase_eeprom_cmd,    "EE pp     | Erase EEPROM page" )
+CMD( 'R','M',  read_data_mem_cmd,   "RM aaa    | Read Memory byte" )
+CMD( 'W','M',  write_data_mem_cmd,  "WM aaa bb | Write Memory byte" )
+CMD( 'R','V',  read_variable_cmd,   "RV t aaa  | Read Variable (t = B|W|L|F)" )
+CMD( 'W','V',  write_variable_cmd,  "WV t aaa vvvvvvvv | Write Variable" )
+CMD( 'V','L',  var_list_cmd,        "VL        | Variable registry List" )
+CMD( 'V','R',  var_read_cmd,        "VR ii     | Variable Read (by ID)" )
+CMD( 'V','W',  var_write_cmd,       "VW ii vvvvvvvv | Variable Write (by ID)" )
+CMD( 'V','B',  var_batch_cmd,       "VB ii [ii..] | Variable Batch read" )
+CMD( 'W','T',  wait_condition_cmd,  "WT aaa mm vv [E|N|C [tttt [pp]]] | Wait for condition" )
+CMD( 'S','N',  snapshot_cmd,        "SN aaa nn [aaa nn..] | Snapshot data mem regions" )
+CMD( 'W','P',  watchpt_cmd,         "WP [n aaa s mmmmmmmm x] | Watchpoint set/clear/list" )
+CMD( 'W','L',  watch_log_cmd,       "WL        | Watchpoint Log" )
+CMD( 'I','P',  input_IOreg_cmd,     "IP rr     | Input I/O reg" )
+CMD( 'O','P',  output_IOreg_cmd,    "OP rr bb  | Output I/O reg" )
+CMD( 'T','S',  twi_scan_cmd,        "TS        | TWI bus Scan" )
+CMD( 'T','R',  twi_read_cmd,        "TR aa rr [nn] | TWI Read register(s)" )
+CMD( 'T','W',  twi_write_cmd,       "TW aa rr [bb..] | TWI Write register(s)" )
+CMD( 'S','X',  spi_transfer_cmd,    "SX c bb [bb..] | SPI transfer (chip c)" )
+CMD( 'F','I',  flash_id_cmd,        "FI        | SPI Flash ID" )
+CMD( 'F','R',  flash_read_cmd,      "FR aaaaaa [nnnn] | SPI Flash Read" )
+CMD( 'F','P',  flash_program_cmd,   "FP aaaaaa bb [bb..] | SPI Flash Program" )
+CMD( 'F','E',  flash_erase_cmd,     "FE aaaaaa [kk] | SPI Flash Erase (kk = 04|20|40)" )
+CMD( 'E','C',  evrec_ctrl_cmd,      "EC [S mm e|F] | Event recorder Start/Freeze" )
+CMD( 'E','D',  evrec_dump_cmd,      "ED        | Event recorder Dump" )
+CMD( 'E','S',  evrec_summary_cmd,   "ES        | Event recorder Summary (freq, duty)" )
+CMD( 'P','B',  pattern_buffer_cmd,  "PB [ii vv tttt [vv tttt..]] | Pattern Buffer load/list" )
+CMD( 'P','P',  pattern_play_cmd,    "PP [O|L p mm [nn [uu]]|X] | Pattern Play once/loop/stop" )
+CMD( 'I','S',  isr_stats_cmd,       "IS [C]    | ISR Stats [Clear]" )
+CMD( 'Q','S',  queue_stats_cmd,     "QS [C]    | Event Queue Stats [Clear]" )
+CMD( 'T','L',  task_list_cmd,       "TL        | Task List" )
+CMD( 'P','F',  profile_cmd,         "PF [S aaaa s|X|C|D] | Profiler Start/Stop/Clear/Dump" )
+CMD( 'F','T',  trace_cmd,           "FT [S d llll hhhh|F|D] | Function Trace Start/Freeze/Dump" )
+CMD( 'X','C',  ihex_dump_cmd,       "Xs aaaa nnnn | Intel HEX dump (s = C|D|E)" )
+CMD( 'X','D',  ihex_dump_cmd,       "" )
+CMD( 'X','E',  ihex_dump_cmd,       "" )
+CMD( 'X','L',  ihex_load_cmd,       "XL s      | Intel HEX load (s = D|E|F)" )
+CMD( 'Z','C',  packed_dump_cmd,     "Zs aaaa nnnn | Packed dump (s = C|D|E)" )
+CMD( 'Z','D',  packed_dump_cmd,     "" )
+CMD( 'Z','E',  packed_dump_cmd,     "" )
+CMD( 'G','D',  gdb_cmd,             "GD        | GDB remote stub mode" )
+
+// end
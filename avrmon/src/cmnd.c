@@ -25,6 +25,11 @@
 |  While interactive mode is enabled, the "response char" (prompt) is '=';
 |  otherwise it is '-' (hyphen).
 |
+|  Several boards may share one host serial link (RS-485 multi-drop bus):
+|  a board with a node address (command 'NA') executes only command lines
+|  prefixed "@nn " where nn is its address (hex), and broadcasts, "@FF ";
+|  it responds to the former only.  See hci_exec_command().
+|
 |  Refer to "list" command strings for command syntax details.
 |
 |  [Ref:  www.mjbauer.biz]
@@ -33,6 +38,25 @@
 #include  "system.h"
 #include  "periph.h"
 #include  "cmnd.h"
+#include  "pack.h"
+#include  "wdog.h"
+#include  "isrstat.h"
+#include  "watchpt.h"
+#include  "kernel.h"
+#include  "evq.h"
+#include  "swtimer.h"
+#include  "liveview.h"
+#include  "snapshot.h"
+#include  "profile.h"
+#include  "trace.h"
+#include  "twi.h"
+#include  "spi.h"
+#include  "evrec.h"
+#include  "patgen.h"
+#include  "crash.h"
+#include  "gdbstub.h"
+#include  "varreg.h"
+#include  "strtab.h"
 
 
 // Command table entry looks like this
@@ -48,33 +72,24 @@ static  char    gacCmdMsg[CMD_MSG_SIZE+1];      // Command message buffer
 static  char  * pcCmdPtr;               // Pointer into gacCmdMsg[]
 static  char    cRespCode;              // Response termination code
 static  bool    yInteractive;
+static  uint8   ubNodeAddr;             // HCI node address, 0 => point-to-point link
+static  pfnthread  pfnCmdThread;        // Command protothread, while running, else NULL
+static  pt_t    sCmdThread;             // Command protothread control
 
 
 /*****
-|   Command table -- maximum number of commands is 250.
-|   (Application-specific command functions should go at the top)
-*/
-const  struct  CmndTableEntry_t  asCommand[] =
-{
-	{ 'D','P',    default_params_cmd },
-	{ 'L','S',    list_cmd           },
-	{ 'I','M',    interactive_cmd    },
-	{ 'V','N',    version_cmd        },
-	{ 'W','D',    watch_data_cmd     },
-	{ 'S','E',    show_errors_cmd    },
-	{ 'S','F',    show_flags_cmd     },
-	{ 'R','S',    reset_MCU_cmd      },
-	{ 'D','C',    dump_memory_cmd    },
-	{ 'D','D',    dump_memory_cmd    },
-	{ 'D','E',    dump_memory_cmd    },
-	{ 'R','M',    read_data_mem_cmd  },
-	{ 'W','M',    write_data_mem_cmd },
-	{ 'I','P',    input_IOreg_cmd    },
-	{ 'O','P',    output_IOreg_cmd   },
-	{ 'E','E',    erase_eeprom_cmd   },
+|   Command table -- built from cmdtab.h, which also holds the help text.  In flash.
+*/
+#define  CMD( c1, c2, fn, help )    { c1, c2, fn },
+
+const  struct  CmndTableEntry_t  asCommand[] PROGMEM =
+{
+#include  "cmdtab.h"
 	{ '$','$',    null_cmd           }      // Last entry in cmd table
 } ;
 
+#undef   CMD
+
 
 /*
 |   Initialise the Host Command Interface
@@ -87,6 +102,9 @@ void  hci_init(void)
 #else
 	yInteractive = FALSE;
 #endif
+	ubNodeAddr = eeprom_read_byte( HCI_NODE_ADDR_EEPROM );
+	if ( ubNodeAddr == HCI_BROADCAST )  ubNodeAddr = 0;     // erased EEPROM
+	if ( ubNodeAddr != 0 )  yInteractive = FALSE;           // no echo on shared bus
 	hci_clear_command();
 }
 
@@ -96,15 +114,27 @@ void  hci_init(void)
 |   Purpose:    Host command interface (HCI) service routine.
 |
 |   This function is called *frequently* from the main "background" loop.
-|   The function checks for RX data from the HCI input port; it returns
-|   immediately if there's no new input data available from the input stream.
-|   If there is data available, it is processed.
+|   If a command protothread is running (see hci_spawn), it is resumed, and
+|   when it finishes, the response terminator is output;  further input is held
+|   in the RX FIFO buffer until then.  Otherwise, the function checks for RX data
+|   from the HCI input port; it returns immediately if there's no new input data
+|   available from the input stream.  If there is data available, it is processed.
 */
 void  hci_service( void )
 {
 	char   c;
 
-	if ( serialRxDataAvail() )
+	if ( pfnCmdThread != NULL )
+	{
+		if ( !PT_SCHEDULE( (*pfnCmdThread)( &sCmdThread ) ) )   // finished
+		{
+			pfnCmdThread = NULL;
+			hci_put_resp_term();
+			hci_clear_command();
+			serialTxMute( FALSE );      // in case of broadcast command
+		}
+	}
+	else if ( serialRxDataAvail() )
 	{
 		c = getch();                // Fetch char; no echo yet
 		hci_process_input( c );
@@ -118,6 +148,8 @@ void  hci_service( void )
 |   When a command terminator (CR) is received, the command message is interpreted;
 |   if the command name is identified, the respective command function is executed.
 |   Command functions may generate response data to be transmitted back to the host PC.
+|   On a point-to-point link, a line starting with '$' is a GDB packet:  the HCI is
+|   handed over to the GDB stub (gdbstub.h);  GDB acks ('+') before it are ignored.
 */
 void  hci_process_input( char c )
 {
@@ -127,8 +159,14 @@ void  hci_process_input( char c )
 		{
 			hci_exec_command();         // ... interpret the command.
 		}
-		else  hci_put_resp_term();
+		else if ( ubNodeAddr == 0 )  hci_put_resp_term();
+	}
+#if GDBSTUB_SUPPORTED
+	else if ( pcCmdPtr == gacCmdMsg && ubNodeAddr == 0 && (c == '$' || c == '+') )
+	{
+		if ( c == '$' )  gdb_attach();      // GDB packet:  enter GDB mode (gdbstub.h)
 	}
+#endif
 	else if ( isprint(c) )      // if printable, append c to command buffer
 	{
 		if ( pcCmdPtr < (gacCmdMsg + CMD_MSG_SIZE) )  *pcCmdPtr++ = c;
@@ -137,7 +175,7 @@ void  hci_process_input( char c )
 	else if ( c == ESC || c == CAN )    // Expected from "interactive" user only
 	{
 		hci_clear_command();    // Trash cmd message
-		hci_put_resp_term();
+		if ( ubNodeAddr == 0 )  hci_put_resp_term();
 	}
 }
 
@@ -145,6 +183,14 @@ void  hci_process_input( char c )
 /*
 |   Function looks for command name (mnemonic, 2 chars) in command table;
 |   if found, executes respective command function.
+|
+|   A command line may be prefixed with a node address, "@nn " (hex), which is
+|   removed before the command is interpreted.  The command is executed if nn is
+|   this node's address (00 if none is set), or HCI_BROADCAST (FF).  A broadcast
+|   command gets no response:  its output, including the terminator, is discarded.
+|   If the node has an address (multi-drop bus), lines not prefixed, or addressed
+|   to other nodes, are ignored, and empty lines get no response, so that only
+|   the addressed node ever drives the bus.
 */
 void  hci_exec_command( void )
 {
@@ -152,16 +198,45 @@ void  hci_exec_command( void )
 	uint8  n;
 	bool   yFoundCndName = FALSE;
 
+	if ( gacCmdMsg[0] == '@' && isHexDigit( gacCmdMsg[1] ) && isHexDigit( gacCmdMsg[2] )
+	&&   gacCmdMsg[3] == SPACE )    // Addressed command
+	{
+		n = (uint8) hexatoi( &gacCmdMsg[1] );
+		if ( n != ubNodeAddr && n != HCI_BROADCAST )
+		{
+			hci_clear_command();
+			return;
+		}
+		if ( n == HCI_BROADCAST )  serialTxMute( TRUE );
+		for ( n = 0;  n <= (CMD_MSG_SIZE - 4);  n++ )    // remove prefix
+			gacCmdMsg[n] = gacCmdMsg[n + 4];
+	}
+	else if ( ubNodeAddr != 0 )     // Not addressed, on a multi-drop bus
+	{
+		hci_clear_command();
+		return;
+	}
+
 	c1 = toupper( gacCmdMsg[0] );
 	c2 = toupper( gacCmdMsg[1] );
 
+	if ( c1 == ':' )        // Intel HEX record (see ihex_load_cmd)
+	{
+		ihex_record_cmd();
+		if ( pfnCmdThread != NULL )  return;    // Completed by hci_service()
+		hci_put_resp_term();
+		hci_clear_command();
+		serialTxMute( FALSE );
+		return;
+	}
+
 	for ( n = 0;  n < 250;  n++ )
 	{
-		if ( asCommand[n].cName1 == '$' )       // end of table
+		if ( pgm_read_byte( &asCommand[n].cName1 ) == '$' )     // end of table
 			break;
-		if ( asCommand[n].cName1 == c1 )
+		if ( pgm_read_byte( &asCommand[n].cName1 ) == c1 )
 		{
-			if ( asCommand[n].cName2 == c2 )    // found match
+			if ( pgm_read_byte( &asCommand[n].cName2 ) == c2 )  // found match
 			{
 				yFoundCndName = TRUE;
 				break;
@@ -171,12 +246,14 @@ void  hci_exec_command( void )
 	if ( yFoundCndName )
 	{
 		if ( yInteractive )  NEW_LINE;
-		(*asCommand[n].Function)();     // Do command function
+		((pfnvoid) pgm_read_word( &asCommand[n].Function ))();     // Do command function
+		if ( pfnCmdThread != NULL )  return;    // Completed by hci_service()
 	}
 	else  hci_put_cmd_error();          // Unrecognised command
 
 	hci_put_resp_term();        // Output the response terminator codes
 	hci_clear_command();        // Prepare for new command
+	serialTxMute( FALSE );      // in case of broadcast command
 }
 
 
@@ -200,6 +277,52 @@ void  hci_clear_command( void )
 }
 
 
+/*
+|  Function returns a pointer to the n'th argument in the command message,
+|  where n = 1 is the first argument following the 2-letter command name.
+|  Arguments are separated by one or more spaces.
+|  If the argument is not present, the pointer returned is to the terminating NUL,
+|  so the caller may test the first char with isHexDigit(), etc.
+*/
+char * hci_arg( uint8 n )
+{
+	char  * pc = gacCmdMsg;
+
+	while ( n-- != 0 )
+	{
+		while ( *pc != NUL && *pc != SPACE )  pc++ ;   // skip over cmd name or arg
+		while ( *pc == SPACE )  pc++ ;                  // skip separator(s)
+	}
+	return  pc;
+}
+
+
+/*
+|  Function returns TRUE if the HCI is in "interactive" (human user) mode.
+|  Command functions in other modules use this to decide on verbose output.
+*/
+bool  hci_interactive( void )
+{
+	return  yInteractive;
+}
+
+
+/*
+|  Function:   hci_spawn
+|  Called by a command function to continue the command in a protothread.
+|  The thread is run by hci_service(), from the main loop, until it ends;
+|  then the response terminator is output.  The command message (arguments)
+|  remains in the buffer while the thread runs.  Long-running commands, or
+|  commands producing more output than fits in the serial TX FIFO buffer,
+|  should be implemented this way, so that they never block the main loop.
+*/
+void  hci_spawn( pfnthread pfnThread )
+{
+	PT_INIT( &sCmdThread );
+	pfnCmdThread = pfnThread;
+}
+
+
 /*
 |  Send response termination sequence to the HCI serial output stream.
 |  In "interactive user mode", this is a prompt for new command.
@@ -219,7 +342,7 @@ void  hci_put_resp_term( void )
 void  hci_put_cmd_error()
 {
 	cRespCode = '!';   
-	if ( yInteractive ) putstr("\n! Command Error");
+	if ( yInteractive ) putmsg( STR_CMD_ERROR );
 }
 
 
@@ -232,22 +355,18 @@ void  null_cmd( void )
 
 /********************************  HOST COMMAND FUNCTIONS  ******************************/
 
-const  char  acHelpStrDP[] PROGMEM = "DP        | Default Params\n";
-const  char  acHelpStrLS[] PROGMEM = "LS        | List Command Set\n";
-const  char  acHelpStrIM[] PROGMEM = "IM x      | Interactive Mode\n";
-const  char  acHelpStrVN[] PROGMEM = "VN        | Show Version\n";
-const  char  acHelpStrSE[] PROGMEM = "SE        | Show Errors\n";
-const  char  acHelpStrSF[] PROGMEM = "SF        | Show Flags\n";
-const  char  acHelpStrRS[] PROGMEM = "RS        | Reset System\n";
-const  char  acHelpStrWD[] PROGMEM = "WD        | Watch Data\n";
-const  char  acHelpStrDC[] PROGMEM = "DC [aaaa] | Dump Code mem\n";
-const  char  acHelpStrDD[] PROGMEM = "DD [aaaa] | Dump Data mem\n";
-const  char  acHelpStrDE[] PROGMEM = "DE pp     | Dump EEPROM page\n";
-const  char  acHelpStrEE[] PROGMEM = "EE pp     | Erase EEPROM page\n";
-const  char  acHelpStrRM[] PROGMEM = "RM aaa    | Read Memory byte\n";
-const  char  acHelpStrWM[] PROGMEM = "WM aaa bb | Write Memory byte\n";
-const  char  acHelpStrIR[] PROGMEM = "IP rr     | Input I/O reg\n";
-const  char  acHelpStrOR[] PROGMEM = "OP rr bb  | Output I/O reg\n";
+static  PT_THREAD( list_thread( pt_t *pt ) )
+{
+	static  uint8  ubLine;
+
+	PT_BEGIN( pt );
+	for ( ubLine = STR_HELP_FIRST;  ubLine <= STR_HELP_LAST;  ubLine++ )
+	{
+		PT_WAIT_TX( pt, STRTAB_HELP_MAX_LEN );
+		putmsg( ubLine );
+	}
+	PT_END( pt );
+}
 
 /*
 |  Command function 'LS' :  Lists a command set Summary.
@@ -255,22 +374,7 @@ const  char  acHelpStrOR[] PROGMEM = "OP rr bb  | Output I/O reg\n";
 */
 void  list_cmd( void )
 {
-	putstr_P( acHelpStrDP );
-	putstr_P( acHelpStrLS );
-	putstr_P( acHelpStrIM );
-	putstr_P( acHelpStrVN );
-	putstr_P( acHelpStrSE );
-	putstr_P( acHelpStrSF );
-	putstr_P( acHelpStrRS );
-	putstr_P( acHelpStrWD );
-	putstr_P( acHelpStrDC );
-	putstr_P( acHelpStrDD );
-	putstr_P( acHelpStrDE );
-	putstr_P( acHelpStrEE );
-	putstr_P( acHelpStrRM );
-	putstr_P( acHelpStrWM );
-	putstr_P( acHelpStrIR );
-	putstr_P( acHelpStrOR );
+	hci_spawn( list_thread );
 }
 
 
@@ -283,43 +387,97 @@ void  interactive_cmd( void )
 {
 	char   c = gacCmdMsg[3];   // get the argument char
 
-	if ( c == '1' || c == 'Y' || c == 'y' )  yInteractive = TRUE;
+	if ( c == '1' || c == 'Y' || c == 'y' )
+	{
+		if ( ubNodeAddr != 0 )  { hci_put_cmd_error();  return; }    // not on a bus
+		yInteractive = TRUE;
+	}
 	else  yInteractive = FALSE;
 	hci_clear_command();
 }
 
 
 /*
-|  Command function 'WD':  Watch data memory variables, etc, in real-time.
-|  Scheduled background tasks are kept alive while the Watch function executes.
-|  This function is intended to be customized to suit the user application.
+|  Command function 'NA':  Show or set the HCI node address (multi-drop bus).
+|  Cmd format: "NA [nn]"  ... where nn is the new address (hex, 01..FE),
+|  or 00 for none (point-to-point link).  The address is saved in EEPROM and
+|  takes effect from the next command;  the response to this command is sent.
+|  Setting an address turns off interactive mode.
+|
+|  Response:  "nn" (current address) if no argument is given.
 */
-void  watch_data_cmd( void )
+void  node_address_cmd( void )
 {
-	uint16   wStartTime = millisec_timer();
-	uint16   wDelayStartTime;
-	uint16   wElapsedTime;
+	char  * pcArg = hci_arg( 1 );
+	uint8   ubAddr;
 
-	putstr( "Hit <Esc> to quit...\n" );
+	if ( !isHexDigit( *pcArg ) )
+	{
+		if ( yInteractive ) putch( SPACE );
+		putHexByte( ubNodeAddr );
+		return;
+	}
+	ubAddr = (uint8) hexatoi( pcArg );
+	if ( ubAddr == HCI_BROADCAST )  { hci_put_cmd_error();  return; }
 
-	while ( 1 )    // Loop until any key hit
+	ubNodeAddr = ubAddr;
+	eeprom_write_byte( HCI_NODE_ADDR_EEPROM, ubAddr );
+	if ( ubAddr != 0 )
 	{
-		wElapsedTime = millisec_timer() - wStartTime;
+		yInteractive = FALSE;
+		cRespCode = '-';
+	}
+}
+
+
+static  swtimer_t  sWatchTimer;         // 'WD' refresh timer
+static  bool    yWatchRefresh;          // Set by sWatchTimer expiry
+
+static  void  watch_timer_expired( swtimer_t *psTimer )
+{
+	*(bool *) psTimer->pvArg = TRUE;        // yWatchRefresh
+}
+
+static  PT_THREAD( watch_data_thread( pt_t *pt ) )
+{
+	static  uint32   ulStartTime;
+
+	PT_BEGIN( pt );
+	ulStartTime = millisec_timer();
+	putmsg( STR_ESC_TO_QUIT );
+	swtimer_init( &sWatchTimer, watch_timer_expired, &yWatchRefresh );
+	swtimer_start( &sWatchTimer, 0, 100 );      // Refresh every 100ms
+	yWatchRefresh = FALSE;
+
+	while ( 1 )    // Loop until <Esc> hit
+	{
+		PT_WAIT_UNTIL( pt, yWatchRefresh || serialRxDataAvail() );
+		if ( serialRxDataAvail() && getch() == ESC )  break;
+		if ( !yWatchRefresh || serialTxSpace() < 16 )  continue;
+		yWatchRefresh = FALSE;
+
+		putch( '\r' );      // return cursor to start of line
 		// Output here data to be watched, all on a single line -------------
 		// May be extended to multiple lines using terminal emulator ESC sequences.
-		putDecWord( (wElapsedTime / 100), 5 );  // Output time unit = 0.1 sec
+		putDecWord( (millisec_timer() - ulStartTime) / 100, 5 );  // Time unit = 0.1 sec
 		//
 		//
 		putch( SPACE );     // cursor now at end of line
-
-		wDelayStartTime = millisec_timer();     // Start 100ms delay
-		while ( millisec_timer() - wDelayStartTime < 100 )
-		{
-			doBackgroundTasks();
-		}
-		putch( '\r' );      // return cursor to start of line
-		if ( serialRxDataAvail() && getch() == ESC )  break;
 	}
+	swtimer_stop( &sWatchTimer );
+	PT_END( pt );
+}
+
+/*
+|  Command function 'WD':  Watch data memory variables, etc, in real-time.
+|  The watch runs as a protothread, so the main loop (HCI service and scheduled
+|  background tasks) keeps running while the Watch function executes;
+|  the display is refreshed every 100ms by a periodic software timer.
+|  This function is intended to be customized to suit the user application.
+*/
+void  watch_data_cmd( void )
+{
+	hci_spawn( watch_data_thread );
 }
 
 /*
@@ -370,7 +528,7 @@ void  version_cmd( void )
 	putDecWord( BUILD_VER_DEBUG, 3 );
 	if ( yInteractive ) 
 	{
-		putstr( " MJB " );
+		putmsg( STR_VERSION_TAG );
 		putstr( (char *) __DATE__ );   
 		if ( yInteractive ) NEW_LINE;
 	}
@@ -384,11 +542,10 @@ void  version_cmd( void )
 */
 void  reset_MCU_cmd( void )
 {
-	DISABLE_GLOBAL_IRQ;
-
-#ifdef  WATCHDOG_SUPPORTED
-	while ( 1 )  continue;
+#if WATCHDOG_SUPPORTED
+	wdog_force_reset();
 #else
+	DISABLE_GLOBAL_IRQ;
 	asm(" JMP 0x0000 ");
 #endif
 }
@@ -399,7 +556,7 @@ void  reset_MCU_cmd( void )
 |
 |  The command mnemonic may be 'DC', 'DD' or 'DE'.
 |  If it is 'DC', the program code (flash) memory space is accessed;
-|  if it is 'DE', the EEPROM space is mapped in; the dump block size is ??? bytes;
+|  if it is 'DE', the EEPROM space is mapped in; the dump block size is 128 bytes;
 |  if it is 'DD', the SRAM data space is accessed.
 |
 |  In the case of 'DE', the command argument is an EEPROM page number (00..FF);
@@ -409,60 +566,63 @@ void  reset_MCU_cmd( void )
 |
 |  Arg1 @ CmdMsg[3] is start addr (0..FFFF) (optional), or EEPROM page (00..FF)
 */
-void  dump_memory_cmd( void )
-{
-	static  uint16  uwStartAddr;    // remembered for next time command used
-	uint16  uwAddr, uwArgValue;
-	uint8   ubRow, ubCol, ubDat;
-	char    c2;
-	uint8   ubPageRows = 16;
-
-	c2 = toupper( gacCmdMsg[1] );
-	uwArgValue = hexatoi( &gacCmdMsg[3] );      // defaults to 0 if invalid arg.
+static  char    cDumpSpace;             // Memory space of dump in progress
+static  uint16  uwDumpAddr;             // Next address to dump
+static  uint16  uwDumpCount;            // Number of bytes (or records) to go
 
-	if ( c2 == 'E' )     // Assume EEPROM page # given
-	{
-		uwAddr = (uwArgValue & 7) * 128;
-		ubPageRows = 8;
-		hci_put_cmd_error();    // TEMP: until eeprom_read_byte() is implemented
-		return;
-	}
-	else if ( isHexDigit( gacCmdMsg[3] ) )      // Start address given...
-	{
-		uwStartAddr = uwArgValue & 0xFFF0;       // ... save it for next time
-		uwAddr = uwStartAddr;
-	}
-	else  uwAddr = uwStartAddr;    // No arg given -- use last value
+static  PT_THREAD( dump_memory_thread( pt_t *pt ) )
+{
+	uint8   ubCol, ubDat;
 
-	for ( ubRow = 0;  ubRow < ubPageRows;  ubRow++ )
+	PT_BEGIN( pt );
+	while ( uwDumpCount != 0 )
 	{
-		putHexWord( uwAddr );
+		PT_WAIT_TX( pt, 80 );       // one row, 77 chars
+		putHexWord( uwDumpAddr );
 		putch( SPACE );
 		for ( ubCol = 0;  ubCol < 16;  ubCol++ )
 		{
 			putch( SPACE );
 			if ( ubCol == 8 )  putch( SPACE );
-			if ( c2 == 'E' )  ubDat = eeprom_read_byte( uwAddr );
-			else if ( c2 == 'C' )  ubDat = pgm_read_byte( uwAddr );
-			else  ubDat = *(uint8 *)( uwAddr );
-			putHexByte( ubDat );
-			uwAddr++ ;
+			putHexByte( mem_read_byte( cDumpSpace, uwDumpAddr + ubCol ) );
 		}
 		putch( SPACE );
 		putch( SPACE );
-		uwAddr -= 16;
 		for ( ubCol = 0;  ubCol < 16;  ubCol++ )
 		{
-			if ( c2 == 'E' )  ubDat = eeprom_read_byte( uwAddr );
-			else if ( c2 == 'C' )  ubDat = pgm_read_byte( uwAddr );
-			else  ubDat = *(uint8 *)( uwAddr );
+			ubDat = mem_read_byte( cDumpSpace, uwDumpAddr++ );
 			if ( ubDat >= 32 && ubDat < 127 )  putch( ubDat );
 			else  putch( SPACE );
-			uwAddr++ ;
 		}
 		NEW_LINE;
+		uwDumpCount -= 16;
+	}
+	PT_END( pt );
+}
+
+void  dump_memory_cmd( void )
+{
+	static  uint16  uwStartAddr;    // remembered for next time command used
+	uint16  uwArgValue;
+
+	cDumpSpace = toupper( gacCmdMsg[1] );
+	uwArgValue = hexatoi( &gacCmdMsg[3] );      // defaults to 0 if invalid arg.
+	uwDumpCount = 256;
+
+	if ( cDumpSpace == 'E' )     // Assume EEPROM page # given
+	{
+		uwDumpAddr = (uwArgValue & 7) * EEPROM_PAGE_SIZE;
+		uwDumpCount = EEPROM_PAGE_SIZE;
+	}
+	else if ( isHexDigit( gacCmdMsg[3] ) )      // Start address given...
+	{
+		uwStartAddr = uwArgValue & 0xFFF0;       // ... save it for next time
+		uwDumpAddr = uwStartAddr;
 	}
-	if ( c2 != 'E' )  uwStartAddr += 256;    // Show next 256-byte block next time
+	else  uwDumpAddr = uwStartAddr;    // No arg given -- use last value
+
+	if ( cDumpSpace != 'E' )  uwStartAddr += 256;    // Show next 256-byte block next time
+	hci_spawn( dump_memory_thread );
 }
 
 
@@ -505,6 +665,218 @@ void  write_data_mem_cmd( void )
 }
 
 
+/*
+|  Size (bytes) of a typed variable:  B = uint8, W = uint16, L = uint32, F = float.
+|  Returns 0 if the type code is invalid.
+*/
+uint8  var_size( char cType )
+{
+	switch ( toupper( cType ) )
+	{
+	case 'B':  return  1;
+	case 'W':  return  2;
+	case 'L':
+	case 'F':  return  4;
+	}
+	return  0;
+}
+
+#if LITTLE_ENDIAN
+#define  VAR_BYTE(n, size)   (n)                  // Offset of n'th byte from LS end
+#else
+#define  VAR_BYTE(n, size)   ((size) - 1 - (n))
+#endif
+
+
+/*
+|  Copy ubSize bytes of a variable into a buffer, with interrupts disabled,
+|  so a variable updated by an ISR is never torn.
+*/
+void  var_read( const uint8 *pubVar, uint8 *pubValue, uint8 ubSize )
+{
+	uint8   bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	while ( ubSize-- != 0 )  *pubValue++ = *pubVar++;
+	SREG = bSREG;
+}
+
+
+/*
+|  Output a value of ubSize bytes (as copied by var_read) in hex, MS digit first.
+*/
+void  var_put_value( const uint8 *pubValue, uint8 ubSize )
+{
+	uint8   ubx;
+
+	for ( ubx = ubSize;  ubx-- != 0; )  putHexByte( pubValue[VAR_BYTE( ubx, ubSize )] );
+}
+
+
+/*
+|  Write a variable of ubSize bytes, with interrupts disabled, from a hex string
+|  (MS digit first, up to 2 * ubSize digits).  Returns FALSE, without writing,
+|  if the string is not a valid value.  The bytes are written from the highest
+|  address down, so a 16-bit timer register (TCNT1, OCR1A/B, ICR1) gets its high
+|  byte first, into TEMP, as it must (var_read reads low byte first).
+*/
+bool  var_write( uint8 *pubVar, uint8 ubSize, char *pcValue )
+{
+	uint32  ulValue = hexatol( pcValue );
+	uint8   aubValue[4];
+	uint8   bSREG;
+	uint8   ubx;
+
+	for ( ubx = 0;  isHexDigit( pcValue[ubx] );  ubx++ )  ;    // count value digits
+	if ( ubx == 0 || ubx > ubSize * 2 || ubSize > 4 )  return  FALSE;
+
+	for ( ubx = 0;  ubx < ubSize;  ubx++ )
+	{
+		aubValue[VAR_BYTE( ubx, ubSize )] = (uint8) ulValue;
+		ulValue >>= 8;
+	}
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	for ( ubx = ubSize;  ubx-- != 0; )  pubVar[ubx] = aubValue[ubx];     // high address first
+	SREG = bSREG;
+	return  TRUE;
+}
+
+
+/*
+|  Command function 'RV':  Read a typed variable from data memory, atomically.
+|  Cmd format:  "RV t aaa"  where t = B|W|L|F (uint8, uint16, uint32, float) and
+|  aaa = address in data memory space (hex).
+|
+|  The bytes are copied with interrupts disabled, so a variable updated by an ISR
+|  is never torn.  Response:  the value in hex, MS digit first (2, 4 or 8 digits);
+|  a float is output as its IEEE-754 bit pattern (8 digits).
+*/
+void  read_variable_cmd( void )
+{
+	uint8   ubSize = var_size( *hci_arg( 1 ) );
+	uint8   aubValue[4];
+
+	if ( ubSize == 0 || !isHexDigit( *hci_arg( 2 ) ) )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	var_read( (uint8 *) hexatoi( hci_arg( 2 ) ), aubValue, ubSize );
+
+	if ( yInteractive ) putch( SPACE );
+	var_put_value( aubValue, ubSize );
+}
+
+
+/*
+|  Command function 'WV':  Write a typed variable in data memory, atomically.
+|  Cmd format:  "WV t aaa vvvvvvvv"  where t = B|W|L|F and aaa as for 'RV';
+|  v = value (hex, up to 2, 4 or 8 digits;  IEEE-754 bit pattern for a float).
+|  The bytes are written with interrupts disabled, highest address first (so 16-bit
+|  I/O registers are written high byte first).  The write is not verified.
+*/
+void  write_variable_cmd( void )
+{
+	uint8   ubSize = var_size( *hci_arg( 1 ) );
+
+	if ( ubSize == 0 || !isHexDigit( *hci_arg( 2 ) )
+	||   !var_write( (uint8 *) hexatoi( hci_arg( 2 ) ), ubSize, hci_arg( 3 ) ) )
+	{
+		hci_put_cmd_error();
+	}
+}
+
+
+// 'WT' wait state, kept while the command thread runs
+static  volatile uint8  *pubWaitAddr;
+static  uint8   ubWaitMask;
+static  uint8   ubWaitValue;            // masked value compared with
+static  uint8   ubWaitLast;             // masked value at last poll
+static  bool    yWaitEqual;             // wait for equal (else not equal)
+static  uint32  ulWaitStart;            // microsec timer at start
+static  uint32  ulWaitTimeout;          // usec
+static  uint32  ulWaitPeriod;           // poll period, usec
+static  uint32  ulWaitElapsed;          // usec, at last poll
+
+/*
+|  Poll the 'WT' location;  return TRUE if the condition is met.
+*/
+static  bool  wait_test( void )
+{
+	ulWaitElapsed = microsec_timer() - ulWaitStart;
+	ubWaitLast = *pubWaitAddr & ubWaitMask;
+	return  ( (ubWaitLast == ubWaitValue) == yWaitEqual );
+}
+
+static  PT_THREAD( wait_thread( pt_t *pt ) )
+{
+	static  uint32  ulNextPoll;
+	static  bool    yMet;
+
+	PT_BEGIN( pt );
+	while ( !(yMet = wait_test()) && ulWaitElapsed < ulWaitTimeout )
+	{
+		if ( yInteractive && serialRxDataAvail() && getch() == ESC )  break;
+		ulNextPoll = ulWaitElapsed + ulWaitPeriod;
+		PT_YIELD( pt );         // let the main loop run at least once
+		PT_WAIT_UNTIL( pt, (microsec_timer() - ulWaitStart) >= ulNextPoll );
+	}
+	PT_WAIT_TX( pt, 12 );
+	if ( yInteractive ) putch( SPACE );
+	putHexWord( (uint16) (ulWaitElapsed >> 16) );
+	putHexWord( (uint16) ulWaitElapsed );
+	putch( SPACE );
+	putHexByte( ubWaitLast );
+	if ( !yMet )  hci_put_cmd_error();     // timed out (or <Esc>)
+	PT_END( pt );
+}
+
+/*
+|  Command function 'WT':  Wait until a data memory byte meets a condition.
+|  Cmd format:  "WT aaa mm vv [c [tttt [pp]]]"
+|
+|    aaa  = address in data memory space (hex);  I/O register rr is at rr + 20
+|    mm   = mask, vv = value (hex)
+|    c    = condition:  E = wait until (byte & mm) == vv  (default),
+|                       N = until (byte & mm) != vv,
+|                       C = until (byte & mm) changes  (vv is ignored)
+|    tttt = timeout, msec (hex, default 3E8 = 1 sec)
+|    pp   = poll period, msec (hex, default 0 = every pass of the main loop)
+|
+|  The wait runs as a protothread, so background tasks keep running, and the byte
+|  is polled at the main loop rate (or every pp msec).  Response:  "eeeeeeee vv",
+|  the elapsed time in microseconds at the poll that ended the wait, and the masked
+|  value then (hex).  If the timeout expires first (or <Esc> is hit, in interactive
+|  mode), the same response is followed by the command error.
+*/
+void  wait_condition_cmd( void )
+{
+	char   cCond = toupper( *hci_arg( 4 ) );
+	char  *pcTimeout = hci_arg( 5 );
+	char  *pcPeriod = hci_arg( 6 );
+
+	if ( !isHexDigit( *hci_arg( 1 ) ) || !isHexDigit( *hci_arg( 2 ) )
+	||   !isHexDigit( *hci_arg( 3 ) )
+	||   !(cCond == NUL || cCond == 'E' || cCond == 'N' || cCond == 'C') )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	pubWaitAddr = (volatile uint8 *) hexatoi( hci_arg( 1 ) );
+	ubWaitMask = (uint8) hexatoi( hci_arg( 2 ) );
+	ubWaitValue = (uint8) hexatoi( hci_arg( 3 ) ) & ubWaitMask;
+	yWaitEqual = ( cCond == NUL || cCond == 'E' );
+	if ( cCond == 'C' )  ubWaitValue = *pubWaitAddr & ubWaitMask;   // initial value
+	ulWaitTimeout = isHexDigit( *pcTimeout ) ? hexatoi( pcTimeout ) : 1000;
+	ulWaitTimeout *= 1000;
+	ulWaitPeriod = isHexDigit( *pcPeriod ) ? hexatoi( pcPeriod ) : 0;
+	ulWaitPeriod *= 1000;
+	ulWaitStart = microsec_timer();
+	hci_spawn( wait_thread );
+}
+
+
 /*
 |   Command function 'IP':  Input and show byte value (hex) of an I/O register.
 |   The specified address is assumed to be in the I/O register space (00..3F).
@@ -546,57 +918,302 @@ void  output_IOreg_cmd( void )
 }
 
 
+static  uint16  uwEepAddr;              // Next EEPROM address to write
+static  uint16  uwEepCount;             // Bytes to go
+static  char  * pcEepData;              // Next data byte (hex pair) in gacCmdMsg[], NULL to erase
+
 /*
-|  TODO: Command function 'EE':  Erase specified EEPROM page.
+|  Write EEPROM bytes one per pass of the main loop, so that background tasks keep
+|  running while each byte is written (3.4ms).  Bytes which already hold the value
+|  are skipped.  The data is taken from the command message (an 'XL E' record),
+|  which is kept until the thread ends, since input is held off while it runs;
+|  if pcEepData is NULL, the bytes are erased (0xFF).
+*/
+static  PT_THREAD( eeprom_write_thread( pt_t *pt ) )
+{
+	uint8   ubDat = 0xFF;
+
+	PT_BEGIN( pt );
+	while ( uwEepCount != 0 )
+	{
+		PT_WAIT_WHILE( pt, EEPROM_WRITE_BUSY );
+		if ( pcEepData != NULL )
+		{
+			ubDat = (hexctobin( pcEepData[0] ) << 4) | hexctobin( pcEepData[1] );
+			pcEepData += 2;
+		}
+		if ( eeprom_read_byte( uwEepAddr ) != ubDat )  eeprom_write_byte( uwEepAddr, ubDat );
+		uwEepAddr++ ;
+		uwEepCount-- ;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'EE':  Erase specified EEPROM page.
+|  Cmd format:  "EE pp"  where pp = page number (hex), as for 'DE'.
 |
-|  The specified EEPROM page (??? bytes) is filled with 0xFF.
-|  Background tasks are delayed until the command is finished.
+|  The EEPROM page (EEPROM_PAGE_SIZE bytes) is filled with 0xFF.  The bytes are
+|  written in a command thread, so background tasks keep running;  the response
+|  terminator follows when the page is erased (up to 0.5 sec).
 */
 void  erase_eeprom_cmd( void )
 {
-	cRespCode = '!';
+	if ( !isHexDigit( *hci_arg( 1 ) ) )  { hci_put_cmd_error();  return; }
+
+	uwEepAddr = (hexatoi( hci_arg( 1 ) ) & 7) * EEPROM_PAGE_SIZE;
+	uwEepCount = EEPROM_PAGE_SIZE;
+	pcEepData = NULL;
+	hci_spawn( eeprom_write_thread );
 }
 
 
-/******************************  HCI "I/O LIBRARY" FUNCTIONS  ***************************/
+/*
+|  Command function 'Xs':  Dump a block of memory as Intel HEX records.
+|
+|  The command mnemonic may be 'XC', 'XD' or 'XE', selecting the program code (flash),
+|  data (SRAM) or EEPROM space respectively, as for the 'Dx' commands.
+|  Records of up to 16 data bytes are output, one per line, each with its checksum,
+|  followed by an end-of-file record.  The output may be captured by the host and
+|  passed directly to avrdude, avr-objcopy, etc.
+|
+|  Arg1 is the start address (hex, 0..FFFF);
+|  Arg2 is the number of bytes to dump (hex, optional, default 100 = 256 bytes).
+*/
+static  PT_THREAD( ihex_dump_thread( pt_t *pt ) )
+{
+	uint8   ubLen, ubDat, ubSum;
+
+	PT_BEGIN( pt );
+	while ( uwDumpCount != 0 )
+	{
+		PT_WAIT_TX( pt, 48 );       // one record, 45 chars max.
+		ubLen = ( uwDumpCount < 16 ) ? uwDumpCount : 16;
+		putch( ':' );
+		putHexByte( ubLen );
+		putHexWord( uwDumpAddr );
+		putHexByte( IHEX_REC_DATA );
+		ubSum = ubLen + HI_BYTE( uwDumpAddr ) + LO_BYTE( uwDumpAddr ) + IHEX_REC_DATA;
+		uwDumpCount -= ubLen;
+		while ( ubLen-- != 0 )
+		{
+			ubDat = mem_read_byte( cDumpSpace, uwDumpAddr++ );
+			putHexByte( ubDat );
+			ubSum += ubDat;
+		}
+		putHexByte( -ubSum );   // two's complement checksum
+		NEW_LINE;
+	}
+	PT_WAIT_TX( pt, 12 );
+	putmsg( STR_IHEX_EOF_REC );    // end-of-file record
+	PT_END( pt );
+}
+
+void  ihex_dump_cmd( void )
+{
+	char  * pcArg = hci_arg( 2 );
+
+	if ( !isHexDigit( *hci_arg( 1 ) ) )  { hci_put_cmd_error();  return; }
+	cDumpSpace = toupper( gacCmdMsg[1] );
+	uwDumpAddr = hexatoi( hci_arg( 1 ) );
+	uwDumpCount = 256;
+	if ( isHexDigit( *pcArg ) )  uwDumpCount = hexatoi( pcArg );
+
+	hci_spawn( ihex_dump_thread );
+}
+
+
+static  char    cLoadSpace;             // Target space of 'XL' load ('D', 'E' or 'F'), else NUL
+static  uint32  ulLoadBase;             // Extended address of 'XL F' load (record types 2, 4)
+static  uint16  uwLoadRecords;          // Number of records received by 'XL' load
+static  uint16  uwLoadErrors;           // Number of bad records received by 'XL' load
 
 /*
-|   getchar() - Input next available character from serial RX FIFO buffer.
+|  Command function 'XL':  Prepare to load Intel HEX records into SRAM or EEPROM,
+|  or SPI serial flash (SPI_SUPPORTED).
+|
+|  Cmd format: "XL s"  ... where 's' is 'D' (data SRAM), 'E' (EEPROM) or 'F' (SPI
+|  flash, which must have been erased;  extended address records are supported).
+|  Once the load is set up, the host streams the records, one per command line,
+|  waiting for the response terminator after each.  A record having a bad checksum,
+|  length or address (beyond RAMEND or E2END) is not written and is answered with
+|  the error code ('!').  EEPROM records are written by a command thread (see
+|  eeprom_write_thread), so the terminator follows when the bytes are written.
+|  The end-of-file record terminates the load; the response to it is the number of
+|  records received and the number of bad records (decimal).
 |
-|   Unlike getch(),  getchar() waits for data available in the RX FIFO buffer,
-|   then reads the next unread char, echoes it back to the serial output stream,
-|   and returns with it.
+|  Record length is limited by the command buffer size (CMD_MSG_SIZE) to 26 data
+|  bytes; the usual 16 byte records (avr-objcopy) are fine.
+*/
+void  ihex_load_cmd( void )
+{
+	char   c = toupper( *hci_arg( 1 ) );
+
+	if ( c == 'D' || c == 'E' || (c == 'F' && SPI_SUPPORTED) )
+	{
+		cLoadSpace = c;
+		ulLoadBase = 0;
+		uwLoadRecords = 0;
+		uwLoadErrors = 0;
+	}
+	else  hci_put_cmd_error();
+}
+
+
+/*
+|  Intel HEX record handler, called by hci_exec_command() when a command message
+|  begins with ':' (record mark).  Record format (hex ASCII pairs after the mark):
 |
-|   While waiting for input, the background task dispatcher is called,
-|   so as not to delay any pending or currently executing task.
-|   To avoid the possibility of infinite recursion, this function cannot be
-|   called from any scheduled background task.
+|      :LLAAAATTDD....DDCC    LL = data length, AAAA = address, TT = record type,
+|                             DD = data bytes, CC = checksum (two's complement)
 |
-|   Returns:  (uchar) byte from serial RX buffer.
+|  Data records are written to the space selected by the 'XL' command.
+|  Extended address records (types 02 and 04) set the upper address (ulLoadBase) of
+|  an SPI flash load;  SRAM and EEPROM are within 64K, so for these the upper address
+|  must be zero.  Start address records are ignored.
 */
-uchar  getchar( void )
+void  ihex_record_cmd( void )
 {
-	char   c;
+	char   * pc = &gacCmdMsg[1];
+	uint8    aubRec[(CMD_MSG_SIZE - 1) / 2];
+	uint8    ubNum = 0;
+	uint8    ubSum = 0;
+	uint8    ubx;
+	uint16   uwAddr;
+	bool     yBad = FALSE;
+
+	if ( cLoadSpace == NUL )  { hci_put_cmd_error();  return; }
+
+	uwLoadRecords++ ;
+	while ( *pc != NUL )       // Convert hex pairs to binary, accumulate checksum
+	{
+		if ( !isHexDigit( pc[0] ) || !isHexDigit( pc[1] ) )  { yBad = TRUE;  break; }
+		aubRec[ubNum] = (hexctobin( pc[0] ) << 4) | hexctobin( pc[1] );
+		ubSum += aubRec[ubNum++];
+		pc += 2;
+	}
+	if ( ubNum < 5 || ubNum != aubRec[0] + 5 || ubSum != 0 )  yBad = TRUE;
 
-	while ( !serialRxDataAvail() )
+	if ( !yBad )
 	{
-		doBackgroundTasks();
+		uwAddr = ((uint16) aubRec[1] << 8) | aubRec[2];
+
+		switch ( aubRec[3] )
+		{
+		case IHEX_REC_DATA:
+			if ( (cLoadSpace == 'E' && (uint32) uwAddr + aubRec[0] > E2END + 1)
+			||   (cLoadSpace == 'D' && (uint32) uwAddr + aubRec[0] > RAMEND + 1) )
+			{
+				yBad = TRUE;
+				break;
+			}
+#if SPI_SUPPORTED
+			if ( cLoadSpace == 'F' )
+			{
+				yBad = !spi_flash_program( ulLoadBase + uwAddr, &aubRec[4], aubRec[0] );
+				break;
+			}
+#endif
+			if ( cLoadSpace == 'E' )
+			{
+				uwEepAddr = uwAddr;
+				uwEepCount = aubRec[0];
+				pcEepData = &gacCmdMsg[9];      // data pairs follow ":LLAAAATT"
+				hci_spawn( eeprom_write_thread );
+				break;
+			}
+			for ( ubx = 0;  ubx < aubRec[0];  ubx++ )
+			{
+				mem_write_byte( cLoadSpace, uwAddr++, aubRec[4 + ubx] );
+			}
+			break;
+
+		case IHEX_REC_EOF:
+			if ( yInteractive )  putmsg( STR_LOAD_RECORDS );
+			putDecWord( uwLoadRecords, 5 );
+			putch( SPACE );
+			if ( yInteractive )  putmsg( STR_LOAD_ERRORS );
+			putDecWord( uwLoadErrors, 5 );
+			cLoadSpace = NUL;         // Load finished
+			break;
+
+		case IHEX_REC_EXT_SEG:
+		case IHEX_REC_EXT_LIN:
+			if ( aubRec[0] != 2 )  yBad = TRUE;
+			else if ( cLoadSpace == 'F' )
+			{
+				ulLoadBase = ((uint32) aubRec[4] << 8) | aubRec[5];
+				ulLoadBase <<= ( aubRec[3] == IHEX_REC_EXT_LIN ) ? 16 : 4;
+			}
+			else if ( aubRec[4] != 0 || aubRec[5] != 0 )  yBad = TRUE;
+			break;
+
+		case IHEX_REC_START_SEG:
+		case IHEX_REC_START_LIN:
+			break;
+
+		default:
+			yBad = TRUE;
+			break;
+		}
+	}
+	if ( yBad )
+	{
+		uwLoadErrors++ ;
+		hci_put_cmd_error();
 	}
-	putch ( c = getch() );
-	return ( c );
 }
 
+
+/******************************  MEMORY SPACE ACCESS FUNCTIONS  **************************/
+
+/*
+|  Read a byte from the specified memory space.
+|
+|  Entry args: cSpace = 'C' (program code, flash), 'E' (EEPROM), or
+|                       'D' (data space: SRAM, MCU and I/O registers)
+|              uwAddr = byte address within the space
+|  Returns:    (uint8) byte value read
+*/
+uint8  mem_read_byte( char cSpace, uint16 uwAddr )
+{
+	if ( cSpace == 'C' )  return  pgm_read_byte( uwAddr );
+	else if ( cSpace == 'E' )  return  eeprom_read_byte( uwAddr );
+	else  return  *(uint8 *) uwAddr;
+}
+
+
+/*
+|  Write a byte to the specified memory space.
+|  Program code (flash) cannot be written by the monitor.
+|
+|  Entry args: cSpace = 'D' (data space) or 'E' (EEPROM)
+|              uwAddr = byte address within the space
+|              ubDat  = byte value to be written
+|  Returns:    FALSE if the space is not writable, else TRUE
+*/
+bool  mem_write_byte( char cSpace, uint16 uwAddr, uint8 ubDat )
+{
+	if ( cSpace == 'E' )  eeprom_write_byte( uwAddr, ubDat );
+	else if ( cSpace == 'D' )  *(uint8 *) uwAddr = ubDat;
+	else  return  FALSE;
+
+	return  TRUE;
+}
+
+
+/******************************  HCI "I/O LIBRARY" FUNCTIONS  ***************************/
+
 /*
 |  Output a NUL-terminated string to the HCI serial port.
 |  The string is expected to be in the data memory (SRAM) space.
 |  Newline (0x0A) is expanded to CR + LF (0x0D + 0x0A).
 |
-|  After outputting the string, the background task dispatcher is called,
-|  so as to minimize the delay of any pending or currently executing task.
-|  To avoid the possibility of infinite recursion, this function cannot be
-|  called from any scheduled background task.
+|  The string is put into the serial TX FIFO buffer;  the function waits only
+|  if the buffer fills up, so protothreads should first use PT_WAIT_TX() to
+|  wait for space for the whole string.
 |
-|  Called by:   HCI command functions only (NOT scheduled B/G tasks!)
 |  Entry args:  pstr = address of NUL-terminated string in SRAM.
 */
 void  putstr( char * pstr )
@@ -612,7 +1229,6 @@ void  putstr( char * pstr )
 		}
 		else   putch( c );
 	}
-	doBackgroundTasks();
 }
 
 /*
@@ -620,12 +1236,8 @@ void  putstr( char * pstr )
 |  The string is expected to be in the program code (flash) memory space.
 |  Newline (0x0A) is expanded to CR + LF (0x0D + 0x0A).
 |
-|  After outputting the string, the background task dispatcher is called,
-|  so as to minimize the delay of any pending or currently executing task.
-|  To avoid the possibility of infinite recursion, this function cannot be
-|  called from any scheduled background task.
+|  See also putstr() above.
 |
-|  Called by:   HCI command functions only (NOT scheduled B/G tasks!)
 |  Entry args:  pksz = address of NUL-terminated string in PROGMEM.
 */
 void  putstr_P( PGM_P pksz )
@@ -642,7 +1254,40 @@ void  putstr_P( PGM_P pksz )
 		else   putch( c );
 		pksz++ ;
 	}
-	doBackgroundTasks();
+}
+
+/*
+|  Output a message from the compressed string table (strtab.c).
+|  Bytes of the encoded string from STRTAB_TOKEN up are dictionary tokens, each
+|  standing for a pair of bytes which may be tokens in turn:  the second of the
+|  pair is stacked while the first is expanded, so the stack depth is limited to
+|  the token nesting depth.  Newline is expanded to CR + LF, as by putstr_P().
+|
+|  Entry args:  ubStrID = string ID, STR_xxx (see strtab.h, strtab.txt).
+*/
+void  putmsg( uint8 ubStrID )
+{
+	PGM_P  pkData = (PGM_P) &aubStrData[pgm_read_word( &auwStrIndex[ubStrID] )];
+	uint8  aubStack[STRTAB_MAX_DEPTH];
+	uint8  ubDepth = 0;
+	uint8  ubSym;
+
+	while ( (ubSym = pgm_read_byte( pkData )) != NUL )
+	{
+		pkData++ ;
+		while ( TRUE )
+		{
+			while ( ubSym >= STRTAB_TOKEN )     // expand token, first of pair
+			{
+				aubStack[ubDepth++] = pgm_read_byte( &aubStrDict[ubSym - STRTAB_TOKEN][1] );
+				ubSym = pgm_read_byte( &aubStrDict[ubSym - STRTAB_TOKEN][0] );
+			}
+			if ( ubSym == '\n' )  putch( '\r' );
+			putch( ubSym );
+			if ( ubDepth == 0 )  break;
+			ubSym = aubStack[--ubDepth];       // then second
+		}
+	}
 }
 
 /*
@@ -842,6 +1487,28 @@ uint16  hexatoi( char * s )
 }
 
 
+/*
+|  Convert Hexadecimal ASCII string, up to 8 digits, to 32-bit unsigned long.
+|  As for hexatoi(), conversion is terminated when a non-Hex char is found.
+|
+|  Entry args: (char *) s = pointer to first char of hex string.
+|  Returns:    Unsigned 32bit long ( 0 to 0xffffffff ).
+*/
+uint32  hexatol( char * s )
+{
+	uint8   ubDigit, ubCount;
+	uint32  ulResult = 0;
+
+	for ( ubCount = 0;  ubCount < 8;  ubCount++ )
+	{
+		if ( (ubDigit = hexctobin( *s++ )) == 0xFF )
+			break;
+		ulResult = 16 * ulResult + ubDigit;
+	}
+	return  ulResult;
+}
+
+
 /*
 |  Function returns TRUE if char is hex ASCII digit ('0'..'F')
 */
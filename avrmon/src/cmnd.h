@@ -14,10 +14,23 @@
 #ifndef  FNPROTO_H_
 #define  FNPROTO_H_
 
+#include "pt.h"
+
 #define  CMD_MSG_SIZE      (63)     // Maximum command string length
 
+#define  HCI_BROADCAST      0xFF     // Node address of broadcast commands ("@FF ")
+#define  HCI_NODE_ADDR_EEPROM  0x3FF  // EEPROM location of node address ('NA')
+#define  EEPROM_PAGE_SIZE    128     // 'DE' and 'EE' page size (bytes)
+
 #define  NEW_LINE          { putch('\r'); putch('\n'); }
 
+#define  IHEX_REC_DATA          0   // Intel HEX record types
+#define  IHEX_REC_EOF           1
+#define  IHEX_REC_EXT_SEG       2
+#define  IHEX_REC_START_SEG     3
+#define  IHEX_REC_EXT_LIN       4
+#define  IHEX_REC_START_LIN     5
+
 
 /*_______________________  F U N C T I O N   P R O T O T Y P E S  ______________________*/
 
@@ -28,6 +41,9 @@ void   hci_exec_command( void );                // executes host command
 void   hci_clear_command( void );               // clears command msg buffer; resets pointer
 void   hci_put_resp_term( void );               // Outputs the termination (prompt) chars
 void   hci_put_cmd_error(void);                     // Outputs "! Command Error" (interactive only)
+char * hci_arg( uint8 n );                      // returns pointer to n'th command argument
+bool   hci_interactive( void );                 // returns TRUE if in interactive mode
+void   hci_spawn( pfnthread pfnThread );        // continue command in a protothread
 
 void   null_cmd( void );                        // Command functions
 void   list_cmd( void );                        
@@ -35,6 +51,7 @@ void   interactive_cmd( void );
 void   set_date_cmd( void );
 void   set_time_cmd( void );
 void   version_cmd( void );
+void   node_address_cmd( void );
 void   watch_data_cmd( void );
 void   default_params_cmd( void );
 void   show_errors_cmd( void );
@@ -43,13 +60,27 @@ void   reset_MCU_cmd( void );
 void   dump_memory_cmd( void );
 void   read_data_mem_cmd( void );
 void   write_data_mem_cmd( void );
+void   read_variable_cmd( void );
+void   write_variable_cmd( void );
+void   wait_condition_cmd( void );
 void   input_IOreg_cmd( void );
 void   output_IOreg_cmd( void );
 void   erase_eeprom_cmd( void );
+void   ihex_dump_cmd( void );
+void   ihex_load_cmd( void );
+void   ihex_record_cmd( void );
+
+uint8  var_size( char cType );                  // size of typed variable, B|W|L|F
+void   var_read( const uint8 *pubVar, uint8 *pubValue, uint8 ubSize );     // atomic copy
+void   var_put_value( const uint8 *pubValue, uint8 ubSize );    // output value, MS digit first
+bool   var_write( uint8 *pubVar, uint8 ubSize, char *pcValue ); // atomic write, hex value
+
+uint8  mem_read_byte( char cSpace, uint16 uwAddr );                 // read byte from C, D or E space
+bool   mem_write_byte( char cSpace, uint16 uwAddr, uint8 ubDat );   // write byte to D or E space
 
-uchar  getchar( void );
 void   putstr( char * );                        // output string, NUL terminated
 void   putstr_P( PGM_P pks );                   // output PROGMEM string, NUL term.
+void   putmsg( uint8 ubStrID );                 // output string from table, STR_xxx (strtab.h)
 void   putBoolean( bool );                      // output Boolean value as '0' or '1'
 void   putHexDigit( uint8 );                    // output LS nybble as hex ASCII char
 void   putHexByte( uint8 );                     // output byte as 2 Hex ASCII chars
@@ -61,6 +92,7 @@ uint8  dectobin( char c );                      // convert dec ASCII digit to bi
 uint16 decatoi( char * pnac, int8 bNdigs );     // convert dec ASCII string to integer
 uint8  hexctobin( char c );                     // convert hex ASCII digit to binary
 uint16 hexatoi( char * s );                     // convert hex ASCII string to integer
+uint32 hexatol( char * s );                     // convert hex ASCII string to long
 bool   isHexDigit( char c );                    // Rtn TRUE if char is hex ASCII digit
 
 #endif  // FNPROTO_H_
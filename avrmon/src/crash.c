@@ -0,0 +1,237 @@
+/*____________________________________________________________________________*\
+|
+|  File:        crash.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Crash mailbox (optional, CRASH_MAILBOX_SUPPORTED).  A record of the state
+|  of the MCU at a watchdog timeout or HALT() is kept in .noinit memory over
+|  the reset that follows, and reported by the 'CM' command.
+|  The watchdog ISR is "naked":  it reads the return address (the interrupted PC)
+|  and SP before anything is pushed, and never returns.  See crash.h.
+\*____________________________________________________________________________*/
+
+#include  <avr/wdt.h>
+#include  <util/crc16.h>
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "wdog.h"
+#include  "kernel.h"
+#include  "crash.h"
+
+#if CRASH_MAILBOX_SUPPORTED
+
+void    crash_wdt_entry( uint16 uwPC, uint16 uwSP ) __attribute__ ((used, noreturn));
+
+// Crash record -- all but uwCRC (last) are covered by the CRC
+struct  CrashRecord_t
+{
+	uint16   uwMagic;               // CRASH_MAGIC if valid
+	uint8    ubCause;               // CRASH_xxx
+	uint8    ubCode;                // HALT code, or overdue task ID
+	uint8    bResetFlags;           // MCUSR at the following boot (0 until then)
+	uint8    ubTask;                // Kernel task running, or 0xFF
+	uint16   uwSP;                  // Stack pointer
+	uint16   uwPC;                  // Program counter (byte address)
+	uint32   ulTime;                // msec timer
+	uint16   uwSystemError;
+	uint16   uwDebugFlags;
+	uint16   auwUser[CRASH_USER_VARS];
+	uint16   uwCRC;
+};
+
+static  struct  CrashRecord_t  sCrash  __attribute__ ((section (".noinit")));
+
+static  const uint16  *apuwWatch[CRASH_USER_VARS];     // crash_watch() addresses
+
+
+/*
+|   Compute the CRC of the crash record.
+*/
+static  uint16  crash_crc( void )
+{
+	uint8  *pub = (uint8 *) &sCrash;
+	uint16  uwCRC = 0xFFFF;
+	uint8   ubx;
+
+	for ( ubx = 0;  ubx < sizeof(sCrash) - sizeof(uint16);  ubx++ )
+		uwCRC = _crc16_update( uwCRC, *pub++ );
+
+	return  uwCRC;
+}
+
+
+/*
+|   Write the crash record, unless one is already held (the first crash is kept).
+|   Called with interrupts disabled;  uwPC is a word address, as pushed by the MCU.
+*/
+static  void  crash_record( uint8 ubCause, uint8 ubCode, uint16 uwPC, uint16 uwSP )
+{
+	uint8  ubx;
+
+	if ( sCrash.uwMagic == CRASH_MAGIC )  return;
+
+	sCrash.ubCause = ubCause;
+	sCrash.ubCode = ubCode;
+	sCrash.bResetFlags = 0;
+#if KERNEL_SUPPORTED
+	sCrash.ubTask = task_self();
+#else
+	sCrash.ubTask = 0xFF;
+#endif
+	sCrash.uwSP = uwSP;
+	sCrash.uwPC = uwPC << 1;
+	sCrash.ulTime = millisec_timer();
+	sCrash.uwSystemError = gwSystemError;
+	sCrash.uwDebugFlags = gwDebugFlags;
+	for ( ubx = 0;  ubx < CRASH_USER_VARS;  ubx++ )
+		sCrash.auwUser[ubx] = ( apuwWatch[ubx] != NULL ) ? *apuwWatch[ubx] : 0;
+	sCrash.uwMagic = CRASH_MAGIC;
+	sCrash.uwCRC = crash_crc();
+}
+
+
+/*
+|   Check the crash record at boot -- called from main() after wdog_init().
+|   A valid record is stamped with the reset flags, the first time it is seen;
+|   an invalid one (e.g. after power-on) is discarded.
+*/
+void  crash_init( void )
+{
+	if ( sCrash.uwMagic != CRASH_MAGIC || sCrash.uwCRC != crash_crc() )
+	{
+		sCrash.uwMagic = 0;
+		return;
+	}
+	if ( sCrash.bResetFlags == 0 )
+	{
+		sCrash.bResetFlags = gbResetCause;
+		sCrash.uwCRC = crash_crc();
+	}
+	gwSystemError |= SYS_ERR_CRASH_RECORD;
+}
+
+
+/*
+|   Select a 16-bit variable to be recorded in the crash record (slot 0..1).
+|   A NULL address frees the slot.
+*/
+void  crash_watch( uint8 ubSlot, const void *pvAddr )
+{
+	if ( ubSlot < CRASH_USER_VARS )  apuwWatch[ubSlot] = (const uint16 *) pvAddr;
+}
+
+
+/*
+|   Record a HALT(n) -- called by the HALT() macro with interrupts disabled.
+|   The watchdog is returned to reset-only mode, so it resets the MCU on the
+|   next timeout, as it would have without the record.
+*/
+void  __attribute__ ((noinline))  crash_halt( uint8 ubCode )
+{
+	crash_record( CRASH_HALT, ubCode, (uint16) __builtin_return_address( 0 ), SP );
+#if WATCHDOG_SUPPORTED
+	WDTCSR &= ~(1<<WDIE);
+#endif
+}
+
+
+/*
+|   Watchdog timeout -- entered from the WDT ISR with the interrupted PC and SP.
+|   After the record is written the reset is forced at once.  Does not return.
+*/
+void  crash_wdt_entry( uint16 uwPC, uint16 uwSP )
+{
+	crash_record( CRASH_WDT, wdog_late_task(), uwPC, uwSP );
+	wdt_enable( WDTO_15MS );
+	while ( 1 )  continue;
+}
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- Watchdog Timeout
+|   The return address is at SP+1 (MS byte) and SP+2 (LS byte);  SP before the
+|   interrupt was SP+2.  Registers need not be saved, as the ISR never returns.
+*/
+ISR ( WDT_vect, ISR_NAKED )
+{
+	asm volatile (
+		"clr   r1                \n\t"
+		"in    r22, __SP_L__     \n\t"
+		"in    r23, __SP_H__     \n\t"
+		"movw  r30, r22          \n\t"
+		"ldd   r25, Z+1          \n\t"
+		"ldd   r24, Z+2          \n\t"
+		"subi  r22, lo8(-2)      \n\t"
+		"sbci  r23, hi8(-2)      \n\t"
+		"jmp   crash_wdt_entry   \n\t"
+	);
+}
+
+
+/*
+|  Command function 'CM':  Crash Mailbox report / clear.
+|  Cmd format:  "CM [C]"
+|
+|    CM    ... Show the crash record (format in crash.h), or "00" if none.
+|    CM C  ... Clear the record;  the next crash will be recorded.
+*/
+void  crash_mailbox_cmd( void )
+{
+	uint8  ubx;
+
+	switch ( toupper( *hci_arg( 1 ) ) )
+	{
+	case 'C':
+		sCrash.uwMagic = 0;
+		break;
+
+	case NUL:
+		if ( sCrash.uwMagic != CRASH_MAGIC )
+		{
+			putHexByte( CRASH_NONE );
+			break;
+		}
+		putHexByte( sCrash.ubCause );
+		putch( SPACE );
+		putHexByte( sCrash.ubCode );
+		putch( SPACE );
+		putHexByte( sCrash.bResetFlags );
+		putch( SPACE );
+		putHexByte( sCrash.ubTask );
+		putch( SPACE );
+		putHexWord( sCrash.uwSP );
+		putch( SPACE );
+		putHexWord( sCrash.uwPC );
+		putch( SPACE );
+		putHexWord( (uint16) (sCrash.ulTime >> 16) );
+		putHexWord( (uint16) sCrash.ulTime );
+		putch( SPACE );
+		putHexWord( sCrash.uwSystemError );
+		putch( SPACE );
+		putHexWord( sCrash.uwDebugFlags );
+		for ( ubx = 0;  ubx < CRASH_USER_VARS;  ubx++ )
+		{
+			putch( SPACE );
+			putHexWord( sCrash.auwUser[ubx] );
+		}
+		break;
+
+	default:
+		hci_put_cmd_error();
+		break;
+	}
+}
+
+#else
+
+void  crash_mailbox_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // CRASH_MAILBOX_SUPPORTED
+
+// end
@@ -0,0 +1,50 @@
+/*
+*   crash.h  --  Crash mailbox:  post-mortem state kept over a reset
+*
+*   The crash record is in section .noinit, which the C start-up code does not
+*   clear, so it survives any reset but power-on.  It is written on the way down
+*   by one of two paths:
+*
+*     -  Watchdog:  the hardware watchdog runs in "interrupt and system reset"
+*        mode, so a timeout first runs the WDT ISR, which records the interrupted
+*        PC and SP and the first overdue supervised task (see wdog.h), then forces
+*        the reset at once.  If interrupts are disabled (the ISR cannot run), the
+*        next timeout resets the MCU without a record.
+*     -  HALT(n) (periph.h):  the caller's return address and SP and the code n
+*        are recorded;  the watchdog then resets the MCU, as before.
+*
+*   Both also record the kernel task running (if KERNEL_SUPPORTED), the msec
+*   timer, gwSystemError, gwDebugFlags and up to CRASH_USER_VARS 16-bit words
+*   selected by the application with crash_watch().  The record is protected by
+*   a magic number and a CRC-16;  at boot a valid record is kept, stamped with
+*   the MCU reset flags, and flagged by SYS_ERR_CRASH_RECORD.  Further records
+*   are not written until 'CM C' clears it, so the first crash is the one kept.
+*
+*   'CM' response:  "cc nn rr tt ssss pppp llllllll eeee ffff uuuu.."  (all hex)
+*      cc = cause (00 = no record), nn = code (HALT code or overdue task ID),
+*      rr = reset flags (MCUSR), tt = kernel task ID (FF = no kernel),
+*      ssss = SP, pppp = PC (byte address), llllllll = msec timer,
+*      eeee = gwSystemError, ffff = gwDebugFlags, uuuu = application words.
+*/
+#ifndef  _CRASH_H_
+#define  _CRASH_H_
+
+#include "system.h"
+
+#define  CRASH_MAGIC        0xC4A5    // Record valid (with CRC)
+#define  CRASH_USER_VARS         2    // Application words recorded
+
+// Crash cause codes
+enum  CrashCause_t
+{
+	CRASH_NONE = 0,
+	CRASH_WDT,                      // Watchdog timeout (code = overdue task, or FF)
+	CRASH_HALT                      // HALT(n) (code = n)
+};
+
+void   crash_init( void );
+void   crash_watch( uint8 ubSlot, const void *pvAddr );
+void   crash_halt( uint8 ubCode );
+void   crash_mailbox_cmd( void );
+
+#endif  /* _CRASH_H_ */
@@ -0,0 +1,163 @@
+/*____________________________________________________________________________*\
+|
+|  File:        evq.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Lock-free single-producer, single-consumer event queues, used to pass events
+|  with data from ISR's to background tasks without losing events under burst
+|  load (unlike a boolean request flag).  See evq.h for usage.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "evq.h"
+
+evq_t   gsTickEventQ;
+evq_t   gsSerialEventQ;
+
+static  event_t  asTickEvents[EVQ_SYS_SIZE];
+static  event_t  asSerialEvents[EVQ_SYS_SIZE];
+static  evq_t  * apsQueue[EVQ_MAX_QUEUES];     // Queues listed by 'QS'
+
+const  char  acTickQueueName[] PROGMEM = "TICK";
+const  char  acSerialQueueName[] PROGMEM = "UART";
+
+
+/*
+|   Initialise the system event queues.
+|   Called from main() before interrupts are enabled.
+*/
+void  evq_sys_init( void )
+{
+	evq_init( &gsTickEventQ, asTickEvents, EVQ_SYS_SIZE, acTickQueueName );
+	evq_init( &gsSerialEventQ, asSerialEvents, EVQ_SYS_SIZE, acSerialQueueName );
+}
+
+
+/*
+|   Initialise an event queue and add it to the list shown by 'QS'
+|   (if there is room).  Must be called before the producer is enabled.
+|
+|   Entry args:  asBuf = event buffer, ubSize = number of events (power of 2, max 128)
+|                pkName = queue name, PROGMEM string
+*/
+void  evq_init( evq_t *psQ, event_t *asBuf, uint8 ubSize, PGM_P pkName )
+{
+	uint8  ubx;
+
+	psQ->asEvent = asBuf;
+	psQ->ubSize = ubSize;
+	psQ->ubHead = 0;
+	psQ->ubTail = 0;
+	psQ->ubPeak = 0;
+	psQ->uwOverflows = 0;
+	psQ->pkName = pkName;
+
+	for ( ubx = 0;  ubx < EVQ_MAX_QUEUES;  ubx++ )
+	{
+		if ( apsQueue[ubx] == psQ )  break;
+		if ( apsQueue[ubx] == NULL )  { apsQueue[ubx] = psQ;  break; }
+	}
+}
+
+
+/*
+|   Post an event to the queue -- called by the producer only.
+|   The event is written before the head count is advanced, so the consumer
+|   never sees a partly written event.
+|
+|   Returns:  TRUE if the event was queued;  FALSE if the queue was full,
+|             in which case the event is discarded and counted as an overflow.
+*/
+bool  evq_put( evq_t *psQ, uint8 ubCode, uint16 uwData )
+{
+	uint8    ubHead = psQ->ubHead;
+	uint8    ubDepth = ubHead - psQ->ubTail;
+	event_t *psEvent;
+
+	if ( ubDepth >= psQ->ubSize )
+	{
+		if ( psQ->uwOverflows != 0xFFFF )  psQ->uwOverflows++ ;
+		return  FALSE;
+	}
+	psEvent = &psQ->asEvent[ubHead & (psQ->ubSize - 1)];
+	psEvent->ubCode = ubCode;
+	psEvent->uwData = uwData;
+	psQ->ubHead = ubHead + 1;
+	if ( ++ubDepth > psQ->ubPeak )  psQ->ubPeak = ubDepth;
+
+	return  TRUE;
+}
+
+
+/*
+|   Fetch the oldest event from the queue -- called by the consumer only.
+|
+|   Returns:  TRUE if an event was fetched into *psEvent;  FALSE if the queue was empty.
+*/
+bool  evq_get( evq_t *psQ, event_t *psEvent )
+{
+	uint8  ubTail = psQ->ubTail;
+
+	if ( ubTail == psQ->ubHead )  return  FALSE;
+
+	*psEvent = psQ->asEvent[ubTail & (psQ->ubSize - 1)];
+	psQ->ubTail = ubTail + 1;
+
+	return  TRUE;
+}
+
+
+/*
+|   Return the number of events waiting in the queue.
+*/
+uint8  evq_depth( evq_t *psQ )
+{
+	return  (uint8) (psQ->ubHead - psQ->ubTail);
+}
+
+
+/*
+|  Command function 'QS':  Show event queue statistics.
+|  Cmd format: "QS [C]"  ... option 'C' clears the peak depth and overflow counts.
+|
+|  Response:  One line per queue:  "n ss dd pp ooooo name"
+|  where n = queue #, s = size, d = current depth, p = peak depth (hex),
+|  o = number of events lost by overflow (decimal).
+*/
+void  queue_stats_cmd( void )
+{
+	bool    yClear = ( toupper( *hci_arg( 1 ) ) == 'C' );
+	evq_t  *psQ;
+	uint8   ubx;
+
+	for ( ubx = 0;  ubx < EVQ_MAX_QUEUES;  ubx++ )
+	{
+		if ( (psQ = apsQueue[ubx]) == NULL )  break;
+		if ( yClear )
+		{
+			DISABLE_GLOBAL_IRQ;
+			psQ->ubPeak = evq_depth( psQ );
+			psQ->uwOverflows = 0;
+			ENABLE_GLOBAL_IRQ;
+			continue;
+		}
+		putHexDigit( ubx );
+		putch( SPACE );
+		putHexByte( psQ->ubSize );
+		putch( SPACE );
+		putHexByte( evq_depth( psQ ) );
+		putch( SPACE );
+		putHexByte( psQ->ubPeak );
+		putch( SPACE );
+		putDecWord( psQ->uwOverflows, 5 );
+		putch( SPACE );
+		putstr_P( psQ->pkName );
+		NEW_LINE;
+	}
+}
+
+// end
@@ -0,0 +1,77 @@
+/*
+*   evq.h  --  Lock-free ISR-to-task event queues
+*
+*   An event queue is a fixed-size ring of events (code + 16-bit payload) with a
+*   single producer and a single consumer (SPSC), e.g. one ISR posting and one
+*   background task (or kernel task) reading.  Neither side disables interrupts:
+*   the producer only writes the head count, the consumer only writes the tail
+*   count, and each count is a single byte, so it is updated atomically.
+*   The counts are free-running (0..255);  the queue size must be a power of 2.
+*
+*   A queue having more than one producer is still safe if all of its producers
+*   are ISR's (AVR interrupts do not nest), but not if a task posts to it.
+*
+*       static  event_t  asMyEvents[8];
+*       evq_t   sMyQueue;
+*       const  char  acMyQueueName[] PROGMEM = "MYQ";
+*
+*       evq_init( &sMyQueue, asMyEvents, 8, acMyQueueName );   // before IRQ's enabled
+*       ...
+*       evq_put( &sMyQueue, EV_APP, uwData );       // in ISR
+*       ...
+*       while ( evq_get( &sMyQueue, &sEvent ) )     // in task
+*           ...
+*
+*   A full queue rejects new events;  overflows and peak depth are counted per queue
+*   and shown, with the current depth, by the 'QS' command.
+*/
+#ifndef  _EVQ_H_
+#define  _EVQ_H_
+
+#include "system.h"
+
+#define  EVQ_MAX_QUEUES          4      // Queues listed by 'QS'
+#define  EVQ_SYS_SIZE            8      // System queue sizes (events)
+
+// Event codes -- application events use codes from EV_APP upward
+enum  EventCode_t
+{
+	EV_NONE = 0,
+	EV_TICK_5MS,                        // Periodic task slots (data = tick count, LS word)
+	EV_TICK_50MS,
+	EV_TICK_500MS,
+	EV_UART_RX_ERROR,                   // Framing/overrun/parity error (data = UCSR0A:UDR0)
+	EV_UART_RX_LOST,                    // RX FIFO full, byte dropped (data = byte)
+	EV_APP = 0x20                       // First application event code
+};
+
+typedef  struct  Event_t
+{
+	uint8    ubCode;
+	uint16   uwData;
+}
+event_t;
+
+typedef  struct  EventQueue_t
+{
+	event_t  *asEvent;                  // Event buffer
+	uint8     ubSize;                   // Number of events, power of 2, max 128
+	volatile  uint8  ubHead;            // Events put (written by producer only)
+	volatile  uint8  ubTail;            // Events got (written by consumer only)
+	uint8     ubPeak;                   // Peak depth (written by producer)
+	uint16    uwOverflows;              // Events rejected (written by producer)
+	PGM_P     pkName;                   // Name shown by 'QS' (PROGMEM string)
+}
+evq_t;
+
+extern  evq_t   gsTickEventQ;           // Posted by tick ISR, read by doBackgroundTasks()
+extern  evq_t   gsSerialEventQ;         // Posted by UART ISR, read by doBackgroundTasks()
+
+void   evq_sys_init( void );
+void   evq_init( evq_t *psQ, event_t *asBuf, uint8 ubSize, PGM_P pkName );
+bool   evq_put( evq_t *psQ, uint8 ubCode, uint16 uwData );     // producer
+bool   evq_get( evq_t *psQ, event_t *psEvent );                // consumer
+uint8  evq_depth( evq_t *psQ );
+void   queue_stats_cmd( void );
+
+#endif  /* _EVQ_H_ */
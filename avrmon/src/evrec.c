@@ -0,0 +1,416 @@
+/*____________________________________________________________________________*\
+|
+|  File:        evrec.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Timestamped input-capture and pin-change event recorder (optional,
+|  EVREC_SUPPORTED), with the commands 'EC', 'ED' and 'ES'.  The ISR's only
+|  log records;  the frequency and duty cycle are worked out from the buffer
+|  when 'ES' is run.  See evrec.h for the channels and record format.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "strtab.h"
+#include  "isrstat.h"
+#include  "evrec.h"
+
+#if EVREC_SUPPORTED
+
+#define  EVREC_MASK   (EVREC_BUF_SIZE - 1)
+
+// Event record -- channel (with EVREC_LEVEL flag) and timestamp, 24 bits
+struct  EvRec_t
+{
+	uint8    ubChan;            // channel number, EVREC_LEVEL if high after edge
+	uint8    ubStampHi;         // timestamp, bits 23..16
+	uint16   uwStamp;           // timestamp, bits 15..0
+};
+
+static  struct  EvRec_t  asEvRec[EVREC_BUF_SIZE];
+static  volatile  uint8  ubEvHead;      // Records logged (free-running)
+static  volatile  bool   yEvFull;       // Buffer full (oldest records being overwritten)
+static  bool    yEvOn;                  // Recording enabled
+static  bool    yBothEdges;             // ICP1 captures both edges
+static  uint8   ubEvChans;              // Channels enabled (mask)
+static  uint8   ubPinLast;              // Pin-change inputs, levels at last interrupt
+static  uint8   ubDumpIndex;            // Next record to output ('ED')
+static  uint8   ubSumChan;              // Next channel to summarise ('ES')
+
+
+/*
+|   Log an event record -- called from the ISR's (interrupts disabled).
+*/
+static  void  evrec_log( uint8 ubChan, uint32 ulStamp )
+{
+	struct  EvRec_t  *psRec = &asEvRec[ubEvHead & EVREC_MASK];
+
+	psRec->ubChan = ubChan;
+	psRec->ubStampHi = (uint8) (ulStamp >> 16);
+	psRec->uwStamp = (uint16) ulStamp;
+	if ( ++ubEvHead == EVREC_BUF_SIZE )  yEvFull = TRUE;
+}
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- Timer/Counter1 Input Capture (ICP1 edge)
+|   The captured edge is the one selected by ICES1 when the event occurred;  in
+|   both-edges mode, the other edge is selected for the next capture.
+*/
+ISR ( TIMER1_CAPT_vect )
+{
+	uint16  uwCount = ICR1;
+	uint8   ubChan = EVREC_ICP_CHAN;
+
+	ISRSTAT_ENTER( ISRSTAT_EVREC );
+
+	if ( TCCR1B & (1<<ICES1) )  ubChan |= EVREC_LEVEL;
+	if ( yBothEdges )
+	{
+		TCCR1B ^= (1<<ICES1);
+		TIFR1 = (1<<ICF1);          // edge change may set the flag
+	}
+	evrec_log( ubChan, tstamp_extend( uwCount ) );
+
+	ISRSTAT_EXIT( ISRSTAT_EVREC );
+}
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- Pin Change Interrupt 2 (PD4..PD7)
+|   Logs a record for each enabled pin whose level has changed.
+*/
+ISR ( PCINT2_vect )
+{
+	uint16  uwCount = TSTAMP_COUNT;
+	uint8   ubPins = PIND & ubEvChans & EVREC_PC_MASK;
+	uint8   ubChanged = ubPins ^ ubPinLast;
+	uint32  ulStamp;
+	uint8   ubChan;
+
+	ISRSTAT_ENTER( ISRSTAT_EVREC );
+
+	ubPinLast = ubPins;
+	ulStamp = tstamp_extend( uwCount );
+	for ( ubChan = 4;  ubChan < 8;  ubChan++ )
+	{
+		if ( ubChanged & (1 << ubChan) )
+			evrec_log( (ubPins & (1 << ubChan)) ? (ubChan | EVREC_LEVEL) : ubChan, ulStamp );
+	}
+
+	ISRSTAT_EXIT( ISRSTAT_EVREC );
+}
+
+
+/*
+|   Stop recording -- the buffer is kept.
+*/
+static  void  evrec_stop( void )
+{
+	TIMSK1 &= ~(1<<ICIE1);
+	PCICR &= ~(1<<PCIE2);
+	yEvOn = FALSE;
+}
+
+
+/*
+|   Clear the buffer and start recording on the channels in ubChans.
+|   cEdge is the ICP1 capture edge:  'R' (rising), 'F' (falling) or 'B' (both).
+*/
+static  void  evrec_start( uint8 ubChans, char cEdge )
+{
+	evrec_stop();
+	ubEvHead = 0;
+	yEvFull = FALSE;
+	ubEvChans = ubChans;
+	yBothEdges = (cEdge == 'B');
+
+	DDRB &= ~BIT_0;                         // ICP1 and pin-change inputs
+	DDRD &= ~(ubChans & EVREC_PC_MASK);
+
+	if ( ubChans & (1 << EVREC_ICP_CHAN) )
+	{
+		TCCR1B |= (1<<ICNC1);               // Noise canceler on
+		// In both-edges mode, wait for the edge away from the present level
+		if ( cEdge == 'R' || (yBothEdges && !(PINB & BIT_0)) )  TCCR1B |= (1<<ICES1);
+		else  TCCR1B &= ~(1<<ICES1);
+		TIFR1 = (1<<ICF1);
+		TIMSK1 |= (1<<ICIE1);
+	}
+	if ( ubChans & EVREC_PC_MASK )
+	{
+		ubPinLast = PIND & ubChans & EVREC_PC_MASK;
+		PCMSK2 = ubChans & EVREC_PC_MASK;
+		PCIFR = (1<<PCIF2);
+		PCICR |= (1<<PCIE2);
+	}
+	yEvOn = TRUE;
+}
+
+
+/*
+|   Number of records in the buffer.
+*/
+static  uint8  evrec_count( void )
+{
+	return  yEvFull ? EVREC_BUF_SIZE : ubEvHead;
+}
+
+
+/*
+|   Timestamp of a record (24 bits).
+*/
+static  uint32  evrec_stamp( struct EvRec_t *psRec )
+{
+	return  ((uint32) psRec->ubStampHi << 16) | psRec->uwStamp;
+}
+
+
+/*
+|   Output a 32-bit value in decimal, scaled by 1/1000 (with the second unit) if
+|   it is too big for a word.
+*/
+static  void  evrec_put_dec( uint32 ulValue, uint8 ubUnit, uint8 ubUnitK )
+{
+	if ( ulValue > 0xFFFF )
+	{
+		ulValue /= 1000;
+		ubUnit = ubUnitK;
+	}
+	putDecWord( (uint16) ulValue, 5 );
+	putmsg( ubUnit );
+}
+
+
+static  PT_THREAD( evrec_dump_thread( pt_t *pt ) )
+{
+	struct  EvRec_t  *psRec;
+
+	PT_BEGIN( pt );
+	PT_WAIT_TX( pt, 10 );
+	putch( '#' );
+	putHexByte( evrec_count() );
+	putch( SPACE );
+	putHexByte( TSTAMP_COUNTS_PER_USEC );
+	NEW_LINE;
+
+	for ( ubDumpIndex = ubEvHead - evrec_count();  ubDumpIndex != ubEvHead;  ubDumpIndex++ )
+	{
+		PT_WAIT_TX( pt, 12 );
+		psRec = &asEvRec[ubDumpIndex & EVREC_MASK];
+		putHexDigit( psRec->ubChan );
+		putBoolean( psRec->ubChan & EVREC_LEVEL );
+		putch( SPACE );
+		putHexByte( psRec->ubStampHi );
+		putHexWord( psRec->uwStamp );
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|   Work out the mean period and high time of the signal on channel ubChan from the
+|   records in the buffer.  Periods are measured between edges of the same kind, so
+|   both edges count if both were recorded;  high times from a rising edge to the
+|   next falling edge.  Returns the number of periods measured.
+*/
+static  uint8  evrec_measure( uint8 ubChan, uint32 *pulPeriod, uint32 *pulHigh )
+{
+	struct  EvRec_t  *psRec;
+	uint32  aulLast[2];             // Last falling [0] and rising [1] edge times
+	bool    ayHave[2] = { FALSE, FALSE };
+	bool    yHigh = FALSE;          // Rising edge seen, falling edge not yet
+	uint32  ulSumPeriod = 0;
+	uint32  ulSumHigh = 0;
+	uint32  ulStamp;
+	uint8   ubPeriods = 0;
+	uint8   ubHighs = 0;
+	uint8   ubIndex;
+	uint8   ubLevel;
+
+	for ( ubIndex = ubEvHead - evrec_count();  ubIndex != ubEvHead;  ubIndex++ )
+	{
+		psRec = &asEvRec[ubIndex & EVREC_MASK];
+		if ( (psRec->ubChan & ~EVREC_LEVEL) != ubChan )  continue;
+		ulStamp = evrec_stamp( psRec );
+		ubLevel = (psRec->ubChan & EVREC_LEVEL) ? 1 : 0;
+		if ( ayHave[ubLevel] )
+		{
+			ulSumPeriod += (ulStamp - aulLast[ubLevel]) & EVREC_STAMP_MASK;
+			ubPeriods++ ;
+		}
+		if ( ubLevel == 0 && yHigh )
+		{
+			ulSumHigh += (ulStamp - aulLast[1]) & EVREC_STAMP_MASK;
+			ubHighs++ ;
+		}
+		yHigh = ubLevel;
+		aulLast[ubLevel] = ulStamp;
+		ayHave[ubLevel] = TRUE;
+	}
+	*pulPeriod = ubPeriods ? ulSumPeriod / ubPeriods : 0;
+	*pulHigh = ubHighs ? ulSumHigh / ubHighs : 0;
+	return  ubPeriods;
+}
+
+
+static  PT_THREAD( evrec_summary_thread( pt_t *pt ) )
+{
+	uint32  ulPeriod;
+	uint32  ulHigh;
+	uint16  uwDuty;
+	uint8   ubPeriods;
+
+	PT_BEGIN( pt );
+	for ( ubSumChan = 0;  ubSumChan < 8;  ubSumChan++ )
+	{
+		if ( (ubEvChans & (1 << ubSumChan)) == 0 )  continue;
+		PT_WAIT_TX( pt, 80 );
+		ubPeriods = evrec_measure( ubSumChan, &ulPeriod, &ulHigh );
+		if ( !hci_interactive() )
+		{
+			putHexDigit( ubSumChan );
+			putch( SPACE );
+			putHexByte( ubPeriods );
+			putch( SPACE );
+			putHexWord( (uint16) (ulPeriod >> 16) );
+			putHexWord( (uint16) ulPeriod );
+			putch( SPACE );
+			putHexWord( (uint16) (ulHigh >> 16) );
+			putHexWord( (uint16) ulHigh );
+			NEW_LINE;
+			continue;
+		}
+		putmsg( STR_EVREC_CHAN );
+		putHexDigit( ubSumChan );
+		putmsg( STR_EVREC_COLON );
+		putDecWord( ubPeriods, 3 );
+		putmsg( STR_EVREC_PERIODS );
+		if ( ubPeriods != 0 )
+		{
+			putmsg( STR_EVREC_PERIOD );
+			evrec_put_dec( ulPeriod / TSTAMP_COUNTS_PER_USEC, STR_UNIT_US, STR_UNIT_MS );
+			putmsg( STR_EVREC_FREQ );
+			evrec_put_dec( (CLOCK_FREQ / TSTAMP_PRESCALE + ulPeriod / 2) / ulPeriod, STR_UNIT_HZ, STR_UNIT_KHZ );
+		}
+		if ( ubPeriods != 0 && ulHigh != 0 )
+		{
+			while ( ulPeriod >= 0x400000 )  { ulPeriod >>= 1;  ulHigh >>= 1; }
+			uwDuty = (uint16) ((ulHigh * 1000) / ulPeriod);
+			putmsg( STR_EVREC_DUTY );
+			putDecWord( uwDuty / 10, 3 );
+			putch( '.' );
+			putHexDigit( uwDuty % 10 );
+			putmsg( STR_EVREC_PERCENT );
+		}
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'EC':  Event recorder control.
+|  Cmd format:  "EC [S [mm [e]] | F]"
+|
+|    EC S mm e  ... Start (clears the buffer);  mm = channel mask (hex, default F1:
+|                   bit 0 = ICP1, bits 4..7 = PD4..PD7);  e = ICP1 capture edge,
+|                   R (rising), F (falling) or B (both, default).
+|    EC F       ... Freeze:  stop recording, keeping the buffer.
+|    EC         ... Show status:  "r nn mm" -- r = 1 if recording, nn = records,
+|                   mm = channel mask.
+*/
+void  evrec_ctrl_cmd( void )
+{
+	char  * pcArg;
+	uint8   ubChans = EVREC_CHAN_MASK;
+	char    cEdge = 'B';
+
+	switch ( toupper( *hci_arg( 1 ) ) )
+	{
+	case 'S':
+		pcArg = hci_arg( 2 );
+		if ( isHexDigit( *pcArg ) )  ubChans = (uint8) hexatoi( pcArg );
+		pcArg = hci_arg( 3 );
+		if ( *pcArg != NUL )  cEdge = toupper( *pcArg );
+		if ( (ubChans & ~EVREC_CHAN_MASK) || ubChans == 0
+		||   (cEdge != 'R' && cEdge != 'F' && cEdge != 'B') )
+		{
+			hci_put_cmd_error();
+			break;
+		}
+		evrec_start( ubChans, cEdge );
+		break;
+
+	case 'F':
+		evrec_stop();
+		break;
+
+	case NUL:
+		putBoolean( yEvOn );
+		putch( SPACE );
+		putHexByte( evrec_count() );
+		putch( SPACE );
+		putHexByte( ubEvChans );
+		break;
+
+	default:
+		hci_put_cmd_error();
+		break;
+	}
+}
+
+
+/*
+|  Command function 'ED':  Event recorder dump (stops recording).
+|
+|  Response:  A header line "#nn cc", then one line per record, oldest first:
+|      "cl tttttt"  where c = channel, l = input level after the edge (0|1) and
+|  tttttt = timestamp timer count, 24 bits.  nn = number of records,
+|  cc = timer counts per usec (all hex).
+*/
+void  evrec_dump_cmd( void )
+{
+	evrec_stop();
+	hci_spawn( evrec_dump_thread );
+}
+
+
+/*
+|  Command function 'ES':  Event recorder summary (stops recording).
+|
+|  Response:  One line for each enabled channel:  "c nn pppppppp hhhhhhhh",
+|  where c = channel, nn = number of periods measured, p = mean period and
+|  h = mean high time (0 if unknown), in timestamp timer counts (all hex).
+|  In interactive mode, the period, frequency and duty cycle are shown.
+*/
+void  evrec_summary_cmd( void )
+{
+	evrec_stop();
+	hci_spawn( evrec_summary_thread );
+}
+
+#else
+
+void  evrec_ctrl_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  evrec_dump_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  evrec_summary_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // EVREC_SUPPORTED
+
+// end
@@ -0,0 +1,45 @@
+/*
+*   evrec.h  --  Timestamped input-capture and pin-change event recorder
+*
+*   Edges on the ICP1 input and pin-change interrupts on selected port D pins are
+*   logged into a ring buffer in SRAM, each with the timestamp timer count (Timer1,
+*   see periph.h) at which it occurred:  0.5us resolution, or 62.5ns at 16MHz if
+*   TSTAMP_PRESCALE is 1.  Input capture latches the count in hardware, so ICP1
+*   timestamps are exact to within the noise canceler delay (4 cycles);  pin-change
+*   timestamps are taken on entry to the ISR, so they include its latency.
+*
+*   Channels are numbered so that the channel mask matches the pin masks:
+*       channel 0     ICP1 input, PB0 (Arduino D8)
+*       channels 4-7  pin-change inputs PD4..PD7 (PCINT20..23, Arduino D4..D7)
+*   With EVREC_SUPPORTED, the heartbeat LED moves from PB0 to PD3.
+*
+*   ICP1 captures rising or falling edges, or both by switching the capture edge in
+*   the ISR;  a pulse shorter than the ISR (about 5us) is then missed, and later
+*   records of that channel show the edge actually captured.  A pin-change interrupt
+*   logs one record for each selected pin whose level changed since the last one.
+*
+*   Each record is 4 bytes:  the channel (with EVREC_LEVEL set if the input is high
+*   after the edge) and the low 24 bits of the timestamp, so periods up to 8.4 sec
+*   (1 sec at 62.5ns) can be measured.  When the buffer is full, the oldest records
+*   are overwritten.  'EC' starts and stops recording;  'ED' downloads the buffer
+*   and 'ES' summarises the frequency and duty cycle of each channel.
+*/
+#ifndef  _EVREC_H_
+#define  _EVREC_H_
+
+#include "system.h"
+
+#ifndef  EVREC_BUF_SIZE                // May be set in system.h (SRAM budget)
+#define  EVREC_BUF_SIZE        16     // Event records (4 bytes each), power of 2
+#endif
+#define  EVREC_ICP_CHAN         0     // Channel number of ICP1 input
+#define  EVREC_PC_MASK       0xF0     // Pin-change channels:  PD4..PD7
+#define  EVREC_CHAN_MASK     0xF1     // All channels
+#define  EVREC_LEVEL         0x80     // Record channel flag:  input high after edge
+#define  EVREC_STAMP_MASK  0x00FFFFFFUL   // Record timestamp, 24 bits
+
+void   evrec_ctrl_cmd( void );
+void   evrec_dump_cmd( void );
+void   evrec_summary_cmd( void );
+
+#endif  /* _EVREC_H_ */
@@ -0,0 +1,451 @@
+/*____________________________________________________________________________*\
+|
+|  File:        gdbstub.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  GDB remote serial protocol stub (optional, GDBSTUB_SUPPORTED).  Runs as the
+|  HCI command protothread:  packets are received a char at a time from the RX
+|  FIFO, and each reply is sent when there is room for it in the TX FIFO, so the
+|  main loop is never blocked.  Memory access is shared with the HCI commands
+|  (mem_read_byte, mem_write_byte).  See gdbstub.h.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "gdbstub.h"
+
+#if GDBSTUB_SUPPORTED
+
+// Packet receiver states
+enum  GdbRxState_t
+{
+	GDB_IDLE = 0,                   // Between packets
+	GDB_DATA,                       // After '$'
+	GDB_CSUM1,                      // After '#'
+	GDB_CSUM2
+};
+
+#define  GDB_REG_SREG       32      // Register numbers (avr-gdb)
+#define  GDB_REG_SP         33
+#define  GDB_REG_PC         34
+#define  GDB_NUM_REGS       35
+
+#define  GDB_ESCAPE       '}'       // Binary data escape char (next char XOR 0x20)
+#define  GDB_CTRL_C       0x03      // Interrupt request
+
+static  char    acGdbPkt[GDB_PKT_SIZE+1];       // Packet data, unescaped, NUL-terminated
+static  uint8   ubGdbLen;               // Packet data length
+static  uint8   ubGdbState;             // GDB_xxx receiver state
+static  uint8   ubGdbSum;               // Checksum computed
+static  uint8   ubGdbRxSum;             // Checksum received
+static  uint8   ubGdbTxSum;             // Checksum of reply being sent
+static  bool    yGdbEscape;             // Next data char is escaped
+static  bool    yGdbOverflow;           // Packet too long (discarded)
+static  bool    yGdbBreak;              // Ctrl-C received
+static  bool    yGdbRunning;            // After 'c', until Ctrl-C
+static  bool    yGdbExit;               // Detach, return to HCI
+
+const  char  acGdbHexDigit[] PROGMEM = "0123456789abcdef";
+
+static  PT_THREAD( gdb_thread( pt_t *pt ) );
+
+
+/*
+|   Reply output:  start the packet, add data chars (summed), end with checksum.
+*/
+static  void  gdb_put_start( void )
+{
+	putch( '$' );
+	ubGdbTxSum = 0;
+}
+
+static  void  gdb_put_char( char c )
+{
+	putch( c );
+	ubGdbTxSum += c;
+}
+
+static  void  gdb_put_hex( uint8 ubDat )
+{
+	gdb_put_char( pgm_read_byte( &acGdbHexDigit[ubDat >> 4] ) );
+	gdb_put_char( pgm_read_byte( &acGdbHexDigit[ubDat & 0xF] ) );
+}
+
+static  void  gdb_put_end( void )
+{
+	putch( '#' );
+	putch( pgm_read_byte( &acGdbHexDigit[ubGdbTxSum >> 4] ) );
+	putch( pgm_read_byte( &acGdbHexDigit[ubGdbTxSum & 0xF] ) );
+}
+
+// Reply with a PROGMEM string (e.g. "OK", "E01", "S05"), or the empty reply if "".
+static  void  gdb_put_reply( PGM_P pksz )
+{
+	char   c;
+
+	gdb_put_start();
+	while ( (c = pgm_read_byte( pksz++ )) != NUL )  gdb_put_char( c );
+	gdb_put_end();
+}
+
+
+/*
+|   Return TRUE if the packet data at pc starts with the PROGMEM string pksz.
+*/
+static  bool  gdb_match( const char *pc, PGM_P pksz )
+{
+	char   c;
+
+	while ( (c = pgm_read_byte( pksz++ )) != NUL )
+	{
+		if ( *pc++ != c )  return  FALSE;
+	}
+	return  TRUE;
+}
+
+
+/*
+|   Parse a hex number in the packet, advancing *ppc to the char following it.
+*/
+static  uint32  gdb_get_hex( char **ppc )
+{
+	uint32  ulResult = 0;
+	uint8   ubDigit;
+
+	while ( (ubDigit = hexctobin( **ppc )) != 0xFF )
+	{
+		ulResult = 16 * ulResult + ubDigit;
+		(*ppc)++;
+	}
+	return  ulResult;
+}
+
+
+/*
+|   Map an avr-gdb address to a memory space ('C', 'D' or 'E') and offset.
+*/
+static  char  gdb_mem_space( uint32 *pulAddr )
+{
+	if ( *pulAddr >= GDB_ADDR_EEPROM )
+	{
+		*pulAddr -= GDB_ADDR_EEPROM;
+		return  'E';
+	}
+	if ( *pulAddr >= GDB_ADDR_DATA )
+	{
+		*pulAddr -= GDB_ADDR_DATA;
+		return  'D';
+	}
+	return  'C';
+}
+
+
+/*
+|   Output the value of register n (hex, LS byte first).
+|   r0..r31, SREG and SP are read live from data space;  PC is the stub thread's.
+*/
+static  void  gdb_put_reg( uint8 ubReg )
+{
+	uint16  uwPC = (uint16) gdb_thread << 1;      // byte address
+
+	if ( ubReg < 32 )
+		gdb_put_hex( mem_read_byte( 'D', ubReg ) );
+	else if ( ubReg == GDB_REG_SREG )
+		gdb_put_hex( SREG );
+	else if ( ubReg == GDB_REG_SP )
+	{
+		gdb_put_hex( SPL );
+		gdb_put_hex( SPH );
+	}
+	else if ( ubReg == GDB_REG_PC )
+	{
+		gdb_put_hex( LO_BYTE( uwPC ) );
+		gdb_put_hex( HI_BYTE( uwPC ) );
+		gdb_put_hex( 0 );
+		gdb_put_hex( 0 );
+	}
+}
+
+
+/*
+|   'm addr,len' -- read memory, up to GDB_MEM_MAX bytes.
+*/
+static  void  gdb_read_mem( char *pc )
+{
+	uint32  ulAddr = gdb_get_hex( &pc );
+	uint16  uwLen;
+	char    cSpace;
+
+	if ( *pc++ != ',' )  { gdb_put_reply( PSTR( "E01" ) );  return; }
+	uwLen = (uint16) gdb_get_hex( &pc );
+	if ( uwLen > GDB_MEM_MAX )  uwLen = GDB_MEM_MAX;
+	cSpace = gdb_mem_space( &ulAddr );
+
+	gdb_put_start();
+	while ( uwLen-- != 0 )
+		gdb_put_hex( mem_read_byte( cSpace, (uint16) ulAddr++ ) );
+	gdb_put_end();
+}
+
+
+/*
+|   'M addr,len:hex..' or 'X addr,len:bin..' -- write memory (data or EEPROM).
+|   Flash cannot be written, so software breakpoints fail with E03.
+*/
+static  void  gdb_write_mem( char *pc, bool yBinary )
+{
+	uint32  ulAddr = gdb_get_hex( &pc );
+	uint16  uwLen;
+	uint8   ubDat;
+	char    cSpace;
+
+	if ( *pc++ != ',' )  { gdb_put_reply( PSTR( "E01" ) );  return; }
+	uwLen = (uint16) gdb_get_hex( &pc );
+	if ( *pc++ != ':' )  { gdb_put_reply( PSTR( "E01" ) );  return; }
+	if ( uwLen > (uint16) (acGdbPkt + ubGdbLen - pc) / (yBinary ? 1 : 2) )
+	{
+		gdb_put_reply( PSTR( "E02" ) );     // data short
+		return;
+	}
+	cSpace = gdb_mem_space( &ulAddr );
+
+	while ( uwLen-- != 0 )
+	{
+		if ( yBinary )  ubDat = *pc++;
+		else
+		{
+			ubDat = (hexctobin( pc[0] ) << 4) | hexctobin( pc[1] );
+			pc += 2;
+		}
+		if ( !mem_write_byte( cSpace, (uint16) ulAddr++, ubDat ) )
+		{
+			gdb_put_reply( PSTR( "E03" ) );
+			return;
+		}
+	}
+	gdb_put_reply( PSTR( "OK" ) );
+}
+
+
+/*
+|   Acknowledge and act on a received packet (or Ctrl-C).
+|   Called with at least GDB_REPLY_MAX chars free in the TX FIFO.
+*/
+static  void  gdb_execute( void )
+{
+	char   *pc = &acGdbPkt[1];
+	uint8   ubReg;
+
+	if ( yGdbBreak )
+	{
+		yGdbBreak = FALSE;
+		if ( yGdbRunning )  gdb_put_reply( PSTR( "S02" ) );     // SIGINT
+		yGdbRunning = FALSE;
+		return;
+	}
+	if ( yGdbOverflow || ubGdbRxSum != ubGdbSum )
+	{
+		putch( '-' );               // request retransmission
+		return;
+	}
+	putch( '+' );
+
+	switch ( acGdbPkt[0] )
+	{
+	case '?':                       // Stop reason
+	case 's':                       // Step (not supported:  stops at once)
+		gdb_put_reply( PSTR( "S05" ) );     // SIGTRAP
+		break;
+
+	case 'c':                       // Continue, until Ctrl-C
+		yGdbRunning = TRUE;
+		break;
+
+	case 'g':                       // Read all registers
+		gdb_put_start();
+		for ( ubReg = 0;  ubReg < GDB_NUM_REGS;  ubReg++ )
+			gdb_put_reg( ubReg );
+		gdb_put_end();
+		break;
+
+	case 'p':                       // Read register n
+		ubReg = (uint8) gdb_get_hex( &pc );
+		if ( ubReg < GDB_NUM_REGS )
+		{
+			gdb_put_start();
+			gdb_put_reg( ubReg );
+			gdb_put_end();
+		}
+		else  gdb_put_reply( PSTR( "E01" ) );
+		break;
+
+	case 'G':                       // Write registers (not supported)
+	case 'P':
+		gdb_put_reply( PSTR( "E01" ) );
+		break;
+
+	case 'm':
+		gdb_read_mem( pc );
+		break;
+
+	case 'M':
+		gdb_write_mem( pc, FALSE );
+		break;
+
+	case 'X':
+		gdb_write_mem( pc, TRUE );
+		break;
+
+	case 'H':                       // Set thread (only one)
+		gdb_put_reply( PSTR( "OK" ) );
+		break;
+
+	case 'q':
+		if ( gdb_match( pc, PSTR( "Supported" ) ) )
+			gdb_put_reply( PSTR( "PacketSize=40" ) );       // hex, = GDB_PKT_SIZE
+		else if ( gdb_match( pc, PSTR( "Attached" ) ) )
+			gdb_put_reply( PSTR( "1" ) );
+		else  gdb_put_reply( PSTR( "" ) );
+		break;
+
+	case 'D':                       // Detach
+		gdb_put_reply( PSTR( "OK" ) );
+		yGdbExit = TRUE;
+		break;
+
+	case 'k':                       // Kill:  no reply
+		yGdbExit = TRUE;
+		break;
+
+	default:                        // Not supported
+		gdb_put_reply( PSTR( "" ) );
+		break;
+	}
+}
+
+
+/*
+|   Start receiving a packet ('$' received).
+*/
+static  void  gdb_start_packet( void )
+{
+	ubGdbState = GDB_DATA;
+	ubGdbLen = 0;
+	ubGdbSum = 0;
+	yGdbEscape = FALSE;
+	yGdbOverflow = FALSE;
+}
+
+
+/*
+|   Packet receiver:  process one char from the serial port.
+|   Returns TRUE when a packet (or Ctrl-C) has been received, to be executed.
+|   Acks ('+' and '-') from GDB are ignored;  Esc between packets exits.
+*/
+static  bool  gdb_receive( char c )
+{
+	switch ( ubGdbState )
+	{
+	case GDB_IDLE:
+		if ( c == '$' )  gdb_start_packet();
+		else if ( c == GDB_CTRL_C )
+		{
+			yGdbBreak = TRUE;
+			return  TRUE;
+		}
+		else if ( c == ESC )  yGdbExit = TRUE;
+		break;
+
+	case GDB_DATA:
+		if ( c == '$' )  { gdb_start_packet();  break; }    // resync
+		if ( c == '#' )  { ubGdbState = GDB_CSUM1;  break; }
+		ubGdbSum += c;
+		if ( c == GDB_ESCAPE && !yGdbEscape )  { yGdbEscape = TRUE;  break; }
+		if ( yGdbEscape )  c ^= 0x20;
+		yGdbEscape = FALSE;
+		if ( ubGdbLen < GDB_PKT_SIZE )  acGdbPkt[ubGdbLen++] = c;
+		else  yGdbOverflow = TRUE;
+		break;
+
+	case GDB_CSUM1:
+		ubGdbRxSum = hexctobin( c ) << 4;
+		ubGdbState = GDB_CSUM2;
+		break;
+
+	case GDB_CSUM2:
+		ubGdbRxSum |= hexctobin( c );
+		ubGdbState = GDB_IDLE;
+		acGdbPkt[ubGdbLen] = NUL;
+		return  TRUE;
+	}
+	return  FALSE;
+}
+
+
+/*
+|   Stub protothread -- runs until detached.
+*/
+static  PT_THREAD( gdb_thread( pt_t *pt ) )
+{
+	PT_BEGIN( pt );
+
+	while ( !yGdbExit )
+	{
+		PT_WAIT_RX( pt );
+		if ( !gdb_receive( getch() ) )  continue;
+		PT_WAIT_TX( pt, GDB_REPLY_MAX );
+		gdb_execute();
+	}
+	PT_END( pt );
+}
+
+
+/*
+|   Start the stub protothread, in place of the HCI.
+*/
+static  void  gdb_start( void )
+{
+	ubGdbState = GDB_IDLE;
+	yGdbRunning = FALSE;
+	yGdbBreak = FALSE;
+	yGdbExit = FALSE;
+	hci_spawn( gdb_thread );
+}
+
+
+/*
+|   Enter GDB mode with a packet under way -- called by the HCI when a command
+|   line starts with '$' (on a point-to-point link), the '$' having been read.
+*/
+void  gdb_attach( void )
+{
+	gdb_start();
+	gdb_start_packet();
+}
+
+
+/*
+|  Command function 'GD':  Enter GDB remote stub mode.
+|  Cmd format:  "GD"
+|
+|  The HCI is given over to the stub until GDB detaches, or Esc is received
+|  between packets.
+*/
+void  gdb_cmd( void )
+{
+	gdb_start();
+}
+
+#else
+
+void  gdb_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // GDBSTUB_SUPPORTED
+
+// end
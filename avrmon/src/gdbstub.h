@@ -0,0 +1,40 @@
+/*
+*   gdbstub.h  --  GDB remote serial protocol (RSP) stub on the HCI serial port
+*
+*   'GD' switches the HCI into GDB mode;  so does a GDB packet ('$') at the start
+*   of a command line, so avr-gdb can attach directly to the monitor's port:
+*
+*       (gdb) set serial baud 19200
+*       (gdb) target remote /dev/ttyACM0
+*
+*   The stub runs as the command protothread, so the application (background tasks
+*   and ISR's) keeps running:  memory and I/O reads are live, and "stopped" is a
+*   state of the stub only.  Ctrl-C (0x03) after 'c' answers "stopped, SIGINT",
+*   and 's' answers at once without stepping.  Registers (r0..r31, SREG, SP) are
+*   those of the monitor at the time of the request, and PC is the stub's own
+*   address.  Register writes, breakpoints and flash writes are not supported.
+*
+*   avr-gdb addresses:  flash from 0, data space (registers, I/O, SRAM) from
+*   0x800000, EEPROM from 0x810000;  e.g. "x/8xb 0x800100" or "p/x *(char *)0x800025"
+*   (PORTB).  Memory is accessed with mem_read_byte() and mem_write_byte() (cmnd.c).
+*
+*   Packets supported:  ?, g, p, m, M, X, c, s, D, k, H, qSupported, qAttached;
+*   others get the empty (unsupported) reply.  'D' (detach), 'k' (kill) or Esc
+*   between packets return to the HCI, which then outputs the response terminator.
+*/
+#ifndef  _GDBSTUB_H_
+#define  _GDBSTUB_H_
+
+#include "system.h"
+
+#define  GDB_PKT_SIZE        64     // Longest packet accepted (PacketSize)
+#define  GDB_MEM_MAX         32     // Bytes per 'm' reply
+#define  GDB_REPLY_MAX       84     // TX FIFO space for the longest reply ('g'), with ack
+
+#define  GDB_ADDR_DATA   0x800000   // avr-gdb address of data space
+#define  GDB_ADDR_EEPROM 0x810000   // avr-gdb address of EEPROM
+
+void   gdb_attach( void );
+void   gdb_cmd( void );
+
+#endif  /* _GDBSTUB_H_ */
@@ -0,0 +1,169 @@
+/*____________________________________________________________________________*\
+|
+|  File:        isrstat.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Interrupt latency and ISR duration statistics (optional, ISR_STATS_SUPPORTED).
+|  For each instrumented vector, the call count, min/max entry latency (tick ISR
+|  only), min/max duration and a duration histogram are kept.  Histogram bucket
+|  n counts durations below 2^(n+1) usec; the last bucket counts the remainder.
+|  See isrstat.h for usage.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "strtab.h"
+#include  "isrstat.h"
+
+#if ISR_STATS_SUPPORTED
+
+// Per-vector statistics record
+struct  IsrStat_t
+{
+	uint16   uwCount;           // number of calls (saturates at FFFF)
+	uint16   uwMinLatency;      // entry latency, timestamp counts (tick ISR only)
+	uint16   uwMaxLatency;
+	uint16   uwMinDuration;     // entry-to-exit time, timestamp counts
+	uint16   uwMaxDuration;
+	uint16   auwHist[ISRSTAT_NUM_BUCKETS];
+};
+
+static  struct  IsrStat_t  asIsrStat[ISRSTAT_MAX_VECTORS];
+
+// Timestamp count of the next tick compare match;  the first is at tick count TOP
+static  uint16  uwTickDue = TSTAMP_COUNTS_PER_TICK - TSTAMP_COUNTS_PER_TICK / TICK_TIMER_PERIOD;
+
+
+/*
+|   Record an ISR execution -- called at the end of an instrumented ISR
+|   (interrupts disabled).  The timestamp counts are 16 bits, free-running.
+*/
+void  isrstat_record( uint8 ubVect, uint16 uwEntry, uint16 uwExit )
+{
+	struct  IsrStat_t  *psStat = &asIsrStat[ubVect];
+	uint16  uwDuration = uwExit - uwEntry;
+	uint16  uwLatency;
+	uint16  uwLimit;
+	uint8   ubBucket;
+
+	if ( psStat->uwCount == 0 )
+	{
+		psStat->uwMinDuration = 0xFFFF;
+		psStat->uwMinLatency = 0xFFFF;
+	}
+	if ( psStat->uwCount != 0xFFFF )  psStat->uwCount++ ;
+	if ( uwDuration < psStat->uwMinDuration )  psStat->uwMinDuration = uwDuration;
+	if ( uwDuration > psStat->uwMaxDuration )  psStat->uwMaxDuration = uwDuration;
+
+	if ( ubVect == ISRSTAT_TICK )
+	{
+		uwLatency = uwEntry - uwTickDue;
+		if ( uwLatency >= TSTAMP_COUNTS_PER_TICK )      // tick(s) missed -- resync
+		{
+			uwLatency %= TSTAMP_COUNTS_PER_TICK;
+			uwTickDue = uwEntry - uwLatency;
+		}
+		uwTickDue += TSTAMP_COUNTS_PER_TICK;
+		if ( uwLatency < psStat->uwMinLatency )  psStat->uwMinLatency = uwLatency;
+		if ( uwLatency > psStat->uwMaxLatency )  psStat->uwMaxLatency = uwLatency;
+	}
+
+	uwLimit = 2 * TSTAMP_COUNTS_PER_USEC;
+	for ( ubBucket = 0;  ubBucket < ISRSTAT_NUM_BUCKETS - 1;  ubBucket++ )
+	{
+		if ( uwDuration < uwLimit )  break;
+		uwLimit <<= 1;
+	}
+	if ( psStat->auwHist[ubBucket] != 0xFFFF )  psStat->auwHist[ubBucket]++ ;
+}
+
+
+/*
+|   Clear all ISR statistics.
+*/
+void  isrstat_clear( void )
+{
+	uint8   *pub = (uint8 *) asIsrStat;
+	uint16   uwx;
+
+	DISABLE_GLOBAL_IRQ;
+	for ( uwx = 0;  uwx < sizeof(asIsrStat);  uwx++ )  *pub++ = 0;
+	ENABLE_GLOBAL_IRQ;
+}
+
+
+static  PT_THREAD( isr_stats_thread( pt_t *pt ) )
+{
+	static  uint8   ubVect;
+	struct  IsrStat_t  sStat;
+	uint8   ubx;
+
+	PT_BEGIN( pt );
+	for ( ubVect = 0;  ubVect < ISRSTAT_MAX_VECTORS;  ubVect++ )
+	{
+		PT_WAIT_TX( pt, 80 );       // one line, 78 chars
+		DISABLE_GLOBAL_IRQ;         // Take a consistent copy
+		sStat = asIsrStat[ubVect];
+		ENABLE_GLOBAL_IRQ;
+
+		if ( sStat.uwCount == 0 )  continue;
+		putHexDigit( ubVect );
+		putch( SPACE );
+		putDecWord( sStat.uwCount, 5 );
+		putch( SPACE );
+		putHexWord( sStat.uwMinLatency );
+		putch( SPACE );
+		putHexWord( sStat.uwMaxLatency );
+		putch( SPACE );
+		putHexWord( sStat.uwMinDuration );
+		putch( SPACE );
+		putHexWord( sStat.uwMaxDuration );
+		for ( ubx = 0;  ubx < ISRSTAT_NUM_BUCKETS;  ubx++ )
+		{
+			putch( SPACE );
+			putDecWord( sStat.auwHist[ubx], 5 );
+		}
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+/*
+|  Command function 'IS':  Show interrupt statistics.
+|  Cmd format: "IS [C]"  ... option 'C' clears the statistics (no output).
+|
+|  Response:  One line for each vector that has been called:
+|      v nnnnn lmin lmax dmin dmax h0 h1 h2 h3 h4 h5 h6 h7
+|  where v = vector ID, n = call count, l = entry latency (tick ISR only),
+|  d = duration, h = histogram bucket counts (<2, <4, <8 .. <128, >=128 usec).
+|  Latency and duration are in timestamp timer counts (hex); other values decimal.
+*/
+void  isr_stats_cmd( void )
+{
+	if ( toupper( *hci_arg( 1 ) ) == 'C' )
+	{
+		isrstat_clear();
+		return;
+	}
+	if ( hci_interactive() )
+	{
+		putmsg( STR_ISR_TIMER_RES );
+		putDecWord( 1000 / TSTAMP_COUNTS_PER_USEC, 4 );
+		putmsg( STR_UNIT_NS_NL );
+	}
+	hci_spawn( isr_stats_thread );
+}
+
+#else
+
+void  isr_stats_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // ISR_STATS_SUPPORTED
+
+// end
@@ -0,0 +1,64 @@
+/*
+*   isrstat.h  --  Interrupt latency and ISR duration statistics
+*
+*   Instrumented ISR's take a timestamp from the timestamp timer count register
+*   (Timer1) on entry and exit.  Durations are in timestamp timer counts
+*   (TSTAMP_COUNTS_PER_USEC per usec).  The tick timer (Timer2) is started together
+*   with the timestamp timer, so each tick compare match is at a known count, and
+*   the entry latency of the tick ISR is the time since then.
+*
+*   Application ISR's may be instrumented with the wrapper macro, e.g.
+*
+*       ISR_TIMED( INT0_vect, ISRSTAT_APP )
+*       {
+*           ... ISR body ...
+*       }
+*
+*   or with ISRSTAT_ENTER(id) / ISRSTAT_EXIT(id) at the start and end of the body.
+*   Note that the timestamp is taken after the ISR prologue (register saves),
+*   which is therefore included in the latency but not in the duration.
+*/
+#ifndef  _ISRSTAT_H_
+#define  _ISRSTAT_H_
+
+#include "system.h"
+#include "periph.h"
+
+#define  ISRSTAT_NUM_BUCKETS     8      // Duration histogram buckets (log2 scale)
+
+// Instrumented vector ID's -- application ISR's may use the remaining slots
+enum  IsrStatID_t
+{
+	ISRSTAT_TICK = 0,                   // Tick timer (RTI) ISR
+	ISRSTAT_UART_RX,                    // UART receiver ISR
+	ISRSTAT_UART_TX,                    // UART transmitter (data register empty) ISR
+	ISRSTAT_TWI,                        // TWI (I2C) master ISR
+	ISRSTAT_EVREC,                      // Event recorder (input capture, pin change) ISR's
+	ISRSTAT_PATGEN,                     // Pattern playback (Timer1 compare A) ISR
+	ISRSTAT_APP,                        // First application ISR ID
+	ISRSTAT_MAX_VECTORS = ISRSTAT_APP + 4
+};
+
+#if ISR_STATS_SUPPORTED
+
+#define  ISRSTAT_ENTER(id)   uint16 _uwIsrEntry = TSTAMP_COUNT
+#define  ISRSTAT_EXIT(id)    isrstat_record( (id), _uwIsrEntry, TSTAMP_COUNT )
+
+#define  ISR_TIMED(vect, id) \
+	static inline void vect##_body( void ) __attribute__ ((always_inline)); \
+	ISR ( vect ) { ISRSTAT_ENTER(id); vect##_body(); ISRSTAT_EXIT(id); } \
+	static inline void vect##_body( void )
+
+#else
+
+#define  ISRSTAT_ENTER(id)
+#define  ISRSTAT_EXIT(id)
+#define  ISR_TIMED(vect, id)   ISR ( vect )
+
+#endif
+
+void   isrstat_record( uint8 ubVect, uint16 uwEntry, uint16 uwExit );
+void   isrstat_clear( void );
+void   isr_stats_cmd( void );
+
+#endif  /* _ISRSTAT_H_ */
@@ -0,0 +1,604 @@
+/*____________________________________________________________________________*\
+|
+|  File:        kernel.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Optional preemptive, priority-based multitasking kernel (KERNEL_SUPPORTED).
+|  Each task has its own stack;  a task's context (32 registers + SREG) is
+|  pushed onto its stack and the stack pointer is saved in its task record.
+|  The context switch is done in the RTI tick ISR (preemption) and in
+|  kernel_switch() (when a task yields, delays or blocks).  Both paths leave
+|  the same stack frame, so a task may be resumed by either:  a task switched
+|  out by the tick returns into the tick ISR stub, which executes RETI.
+|
+|  The main loop (monitor) is task 0, the lowest priority task.  Application
+|  tasks have priority 1..255 (higher value = higher priority);  the highest
+|  priority ready task always runs, and tasks of equal priority share the CPU
+|  round-robin, one tick at a time.  See kernel.h for usage.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "kernel.h"
+
+#if KERNEL_SUPPORTED
+
+// Task record -- uwSP must be the first member (accessed by context switch code)
+struct  KTask_t
+{
+	uint16   uwSP;              // saved stack pointer
+	uint8  * pubStack;          // stack base (lowest address)
+	uint16   uwStackSize;       // stack size, bytes
+	PGM_P    pkName;            // task name (PROGMEM string)
+	uint8    ubState;           // TASK_xxx
+	uint8    ubPrio;            // current priority (may be raised by a mutex)
+	uint8    ubBasePrio;        // assigned priority
+	void   * pvWaitObj;         // semaphore or mutex blocked on (TASK_BLOCKED)
+	uint16   uwDelay;           // ticks to go (TASK_DELAYED)
+	uint32   ulRunTicks;        // ticks spent running since last 'TL'
+};
+
+struct  KTask_t  * volatile  gpsKernelTask;     // Running task (used in asm code)
+
+static  struct  KTask_t  asTask[KERNEL_MAX_TASKS];
+static  uint8   ubCurrentTask;          // Running task ID (index into asTask[])
+static  uint32  ulTotalTicks;           // Ticks since last 'TL'
+
+extern  uint8   __heap_start;           // End of static data, after .bss and .noinit (linker symbol)
+
+const  char  acMonitorName[] PROGMEM = "MON";
+
+void  kernel_switch( void )  __attribute__ ((naked, noinline, used));
+void  kernel_tick_switch( void )  __attribute__ ((naked, noinline, used));
+void  kernel_select( void )  __attribute__ ((used));
+void  kernel_tick( void )  __attribute__ ((used));
+
+
+/*
+|   Context save/restore -- the order of the saved registers must match the
+|   initial stack frame built by task_create().
+*/
+#define  SAVE_CONTEXT()  asm volatile ( \
+	"push  r0                \n\t" \
+	"in    r0, __SREG__      \n\t" \
+	"cli                     \n\t" \
+	"push  r0                \n\t" \
+	"push  r1                \n\t" \
+	"clr   r1                \n\t" \
+	"push  r2                \n\t" \
+	"push  r3                \n\t" \
+	"push  r4                \n\t" \
+	"push  r5                \n\t" \
+	"push  r6                \n\t" \
+	"push  r7                \n\t" \
+	"push  r8                \n\t" \
+	"push  r9                \n\t" \
+	"push  r10               \n\t" \
+	"push  r11               \n\t" \
+	"push  r12               \n\t" \
+	"push  r13               \n\t" \
+	"push  r14               \n\t" \
+	"push  r15               \n\t" \
+	"push  r16               \n\t" \
+	"push  r17               \n\t" \
+	"push  r18               \n\t" \
+	"push  r19               \n\t" \
+	"push  r20               \n\t" \
+	"push  r21               \n\t" \
+	"push  r22               \n\t" \
+	"push  r23               \n\t" \
+	"push  r24               \n\t" \
+	"push  r25               \n\t" \
+	"push  r26               \n\t" \
+	"push  r27               \n\t" \
+	"push  r28               \n\t" \
+	"push  r29               \n\t" \
+	"push  r30               \n\t" \
+	"push  r31               \n\t" \
+	"lds   r26, gpsKernelTask     \n\t" \
+	"lds   r27, gpsKernelTask+1   \n\t" \
+	"in    r0, __SP_L__      \n\t" \
+	"st    x+, r0            \n\t" \
+	"in    r0, __SP_H__      \n\t" \
+	"st    x+, r0            \n\t" )
+
+#define  RESTORE_CONTEXT()  asm volatile ( \
+	"lds   r26, gpsKernelTask     \n\t" \
+	"lds   r27, gpsKernelTask+1   \n\t" \
+	"ld    r28, x+           \n\t" \
+	"out   __SP_L__, r28     \n\t" \
+	"ld    r29, x+           \n\t" \
+	"out   __SP_H__, r29     \n\t" \
+	"pop   r31               \n\t" \
+	"pop   r30               \n\t" \
+	"pop   r29               \n\t" \
+	"pop   r28               \n\t" \
+	"pop   r27               \n\t" \
+	"pop   r26               \n\t" \
+	"pop   r25               \n\t" \
+	"pop   r24               \n\t" \
+	"pop   r23               \n\t" \
+	"pop   r22               \n\t" \
+	"pop   r21               \n\t" \
+	"pop   r20               \n\t" \
+	"pop   r19               \n\t" \
+	"pop   r18               \n\t" \
+	"pop   r17               \n\t" \
+	"pop   r16               \n\t" \
+	"pop   r15               \n\t" \
+	"pop   r14               \n\t" \
+	"pop   r13               \n\t" \
+	"pop   r12               \n\t" \
+	"pop   r11               \n\t" \
+	"pop   r10               \n\t" \
+	"pop   r9                \n\t" \
+	"pop   r8                \n\t" \
+	"pop   r7                \n\t" \
+	"pop   r6                \n\t" \
+	"pop   r5                \n\t" \
+	"pop   r4                \n\t" \
+	"pop   r3                \n\t" \
+	"pop   r2                \n\t" \
+	"pop   r1                \n\t" \
+	"pop   r0                \n\t" \
+	"out   __SREG__, r0      \n\t" \
+	"pop   r0                \n\t" )
+
+
+/*
+|   Initialise the kernel.  The caller (main) becomes task 0, the monitor task.
+|   The unused part of the main stack is filled with a pattern for 'TL'.  It starts
+|   at __heap_start, not __bss_end:  .noinit (reset cause, crash record) follows .bss.
+|   Called from main() with interrupts disabled, before creating tasks.
+*/
+void  kernel_init( void )
+{
+	uint8  *pub;
+
+	for ( pub = &__heap_start;  pub < (uint8 *) SP;  pub++ )  *pub = KERNEL_STACK_FILL;
+
+	asTask[0].pubStack = &__heap_start;
+	asTask[0].uwStackSize = (RAMEND + 1) - (uint16) &__heap_start;
+	asTask[0].pkName = acMonitorName;
+	asTask[0].ubState = TASK_READY;
+	asTask[0].ubPrio = KERNEL_PRIO_IDLE;
+	asTask[0].ubBasePrio = KERNEL_PRIO_IDLE;
+	ubCurrentTask = 0;
+	gpsKernelTask = &asTask[0];
+}
+
+
+/*
+|   A task function which returns comes here (see task_create);
+|   the task becomes dormant and its slot may be re-used.
+*/
+static  void  task_exit( void )
+{
+	DISABLE_GLOBAL_IRQ;
+	asTask[ubCurrentTask].ubState = TASK_DORMANT;
+	kernel_switch();            // never returns
+}
+
+
+/*
+|   Create a task and make it ready to run.
+|
+|   Entry args:  pfnTask = task function (normally never returns)
+|                pubStack = stack memory (static array), uwSize = its size (bytes)
+|                ubPrio = priority, 1..255 (higher value = higher priority)
+|                pkName = task name, PROGMEM string (shown by 'TL')
+|   Returns:     task ID, 1..KERNEL_MAX_TASKS-1, or 0xFF if there is no free slot
+|                or the arguments are invalid.
+*/
+uint8  task_create( pfnvoid pfnTask, uint8 *pubStack, uint16 uwSize, uint8 ubPrio, PGM_P pkName )
+{
+	struct  KTask_t  *psTask;
+	uint8  *pub;
+	uint8   ubTask, ubReg;
+	uint8   bSREG;
+
+	if ( ubPrio == KERNEL_PRIO_IDLE || uwSize < KERNEL_CONTEXT_SIZE + 16 )  return  0xFF;
+
+	for ( ubTask = 1;  ubTask < KERNEL_MAX_TASKS;  ubTask++ )
+	{
+		if ( asTask[ubTask].ubState == TASK_DORMANT )  break;
+	}
+	if ( ubTask == KERNEL_MAX_TASKS )  return  0xFF;
+
+	for ( pub = pubStack;  pub < pubStack + uwSize;  pub++ )  *pub = KERNEL_STACK_FILL;
+
+	// Build the initial stack frame, as if the task had been switched out
+	pub = pubStack + uwSize - 1;
+	*pub-- = LO_BYTE( (uint16) task_exit );     // return address of task function
+	*pub-- = HI_BYTE( (uint16) task_exit );
+	*pub-- = LO_BYTE( (uint16) pfnTask );       // "return" address of context switch
+	*pub-- = HI_BYTE( (uint16) pfnTask );
+	*pub-- = 0;                                 // r0
+	*pub-- = 0x80;                              // SREG, global interrupts enabled
+	for ( ubReg = 1;  ubReg < 32;  ubReg++ )    // r1 (must be 0) .. r31
+		*pub-- = 0;
+
+	psTask = &asTask[ubTask];
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	psTask->uwSP = (uint16) pub;
+	psTask->pubStack = pubStack;
+	psTask->uwStackSize = uwSize;
+	psTask->pkName = pkName;
+	psTask->ubPrio = ubPrio;
+	psTask->ubBasePrio = ubPrio;
+	psTask->pvWaitObj = NULL;
+	psTask->ulRunTicks = 0;
+	psTask->ubState = TASK_READY;
+	if ( ubPrio > asTask[ubCurrentTask].ubPrio && (bSREG & (1<<SREG_I)) )  kernel_switch();
+	SREG = bSREG;
+
+	return  ubTask;
+}
+
+
+/*
+|   Return the ID of the running task (0 = monitor).
+*/
+uint8  task_self( void )
+{
+	return  ubCurrentTask;
+}
+
+
+/*
+|   Select the task to run next:  the highest priority ready task;  among tasks
+|   of equal priority, the first one after the running task (round-robin).
+|   Called with interrupts disabled, from the context switch code only.
+*/
+void  kernel_select( void )
+{
+	uint8  ubIdx = ubCurrentTask;
+	uint8  ubNext = 0;
+	uint8  n;
+
+	for ( n = 0;  n < KERNEL_MAX_TASKS;  n++ )
+	{
+		if ( ++ubIdx == KERNEL_MAX_TASKS )  ubIdx = 0;
+		if ( asTask[ubIdx].ubState == TASK_READY && asTask[ubIdx].ubPrio > asTask[ubNext].ubPrio )
+			ubNext = ubIdx;
+	}
+	ubCurrentTask = ubNext;
+	gpsKernelTask = &asTask[ubNext];
+}
+
+
+/*
+|   Kernel tick -- account CPU time to the running task and expire delays.
+|   Called from the tick ISR context switch code.
+*/
+void  kernel_tick( void )
+{
+	uint8  ubTask;
+
+	ulTotalTicks++ ;
+	asTask[ubCurrentTask].ulRunTicks++ ;
+
+	for ( ubTask = 1;  ubTask < KERNEL_MAX_TASKS;  ubTask++ )
+	{
+		if ( asTask[ubTask].ubState == TASK_DELAYED && --asTask[ubTask].uwDelay == 0 )
+			asTask[ubTask].ubState = TASK_READY;
+	}
+}
+
+
+/*
+|   Switch to the next task to run (the running task may be re-selected).
+|   Used by task_yield() and by blocking functions.  May be called with
+|   interrupts enabled or disabled;  SREG is restored when the task resumes.
+*/
+void  kernel_switch( void )
+{
+	SAVE_CONTEXT();
+	asm volatile ( "call  kernel_select" );
+	RESTORE_CONTEXT();
+	asm volatile ( "ret" );
+}
+
+
+/*
+|   Tick context switch -- the RTI tick handler (periph.c) and the kernel tick
+|   run on the stack of the interrupted task, after its context has been saved.
+*/
+void  kernel_tick_switch( void )
+{
+	SAVE_CONTEXT();
+	asm volatile ( "call  rti_tick_handler" );
+	asm volatile ( "call  kernel_tick" );
+	asm volatile ( "call  kernel_select" );
+	RESTORE_CONTEXT();
+	asm volatile ( "ret" );
+}
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- Timer/Counter2 Compare channel-A (RTI tick)
+|   Replaces the tick ISR in periph.c when the kernel is enabled.
+*/
+ISR ( TIMER2_COMPA_vect, ISR_NAKED )
+{
+	asm volatile ( "call  kernel_tick_switch" );
+	reti();
+}
+
+
+/*
+|   Give way to any other ready task of the same (or higher) priority.
+*/
+void  task_yield( void )
+{
+	kernel_switch();
+}
+
+
+/*
+|   Suspend the running task for uwTicks RTI ticks (msec).
+|   The monitor task (0) must not block;  in the monitor this does nothing.
+*/
+void  task_delay( uint16 uwTicks )
+{
+	uint8  bSREG = SREG;
+
+	if ( ubCurrentTask == 0 || uwTicks == 0 )  return;
+
+	DISABLE_GLOBAL_IRQ;
+	asTask[ubCurrentTask].uwDelay = uwTicks;
+	asTask[ubCurrentTask].ubState = TASK_DELAYED;
+	kernel_switch();
+	SREG = bSREG;
+}
+
+
+/*
+|   Block the running task on a semaphore or mutex.
+|   Called with interrupts disabled, never by the monitor task.
+*/
+static  void  block_on( void *pvObj )
+{
+	asTask[ubCurrentTask].pvWaitObj = pvObj;
+	asTask[ubCurrentTask].ubState = TASK_BLOCKED;
+	kernel_switch();
+}
+
+
+/*
+|   Find the highest priority task blocked on a semaphore or mutex, make it
+|   ready and return its ID;  return 0 if there is no task waiting.
+|   Called with interrupts disabled.
+*/
+static  uint8  wake_waiter( void *pvObj )
+{
+	uint8  ubTask, ubWake = 0;
+
+	for ( ubTask = 1;  ubTask < KERNEL_MAX_TASKS;  ubTask++ )
+	{
+		if ( asTask[ubTask].ubState == TASK_BLOCKED && asTask[ubTask].pvWaitObj == pvObj )
+		{
+			if ( ubWake == 0 || asTask[ubTask].ubPrio > asTask[ubWake].ubPrio )  ubWake = ubTask;
+		}
+	}
+	if ( ubWake != 0 )
+	{
+		asTask[ubWake].pvWaitObj = NULL;
+		asTask[ubWake].ubState = TASK_READY;
+	}
+	return  ubWake;
+}
+
+
+/*
+|   Counting semaphores.
+|   sem_wait() blocks while the count is zero;  sem_post() gives the count directly
+|   to the highest priority waiting task, if any, else increments the count.
+|   sem_post() may be called from an ISR; the woken task then runs from the next tick.
+|   In the monitor task (which must not block), sem_wait() busy-waits.
+*/
+void  sem_init( ksem_t *psSem, uint8 ubCount )
+{
+	psSem->ubCount = ubCount;
+}
+
+
+void  sem_wait( ksem_t *psSem )
+{
+	uint8  bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	if ( psSem->ubCount != 0 )  psSem->ubCount-- ;
+	else if ( ubCurrentTask != 0 )  block_on( psSem );     // count handed over by sem_post
+	else
+	{
+		while ( psSem->ubCount == 0 )
+		{
+			ENABLE_GLOBAL_IRQ;
+			asm volatile ( "nop" );
+			DISABLE_GLOBAL_IRQ;
+		}
+		psSem->ubCount-- ;
+	}
+	SREG = bSREG;
+}
+
+
+bool  sem_trywait( ksem_t *psSem )
+{
+	bool   yTaken = FALSE;
+	uint8  bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	if ( psSem->ubCount != 0 )
+	{
+		psSem->ubCount-- ;
+		yTaken = TRUE;
+	}
+	SREG = bSREG;
+	return  yTaken;
+}
+
+
+void  sem_post( ksem_t *psSem )
+{
+	uint8  bSREG = SREG;
+	uint8  ubTask;
+
+	DISABLE_GLOBAL_IRQ;
+	ubTask = wake_waiter( psSem );
+	if ( ubTask == 0 )
+	{
+		if ( psSem->ubCount != 0xFF )  psSem->ubCount++ ;
+	}
+	else if ( asTask[ubTask].ubPrio > asTask[ubCurrentTask].ubPrio && (bSREG & (1<<SREG_I)) )
+		kernel_switch();
+	SREG = bSREG;
+}
+
+
+/*
+|   Mutexes -- the owner may lock a mutex recursively.  While a higher priority
+|   task is waiting, the owner runs at the waiter's priority (priority inheritance),
+|   until it unlocks the mutex.  (A task holding more than one mutex returns to
+|   its base priority when it releases any of them.)  Not for use in ISR's.
+*/
+void  mutex_init( kmutex_t *psMutex )
+{
+	psMutex->ubOwner = 0xFF;
+	psMutex->ubDepth = 0;
+}
+
+
+void  mutex_lock( kmutex_t *psMutex )
+{
+	struct  KTask_t  *psOwner;
+	uint8  bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	while ( psMutex->ubOwner != 0xFF && psMutex->ubOwner != ubCurrentTask )
+	{
+		psOwner = &asTask[psMutex->ubOwner];
+		if ( psOwner->ubPrio < asTask[ubCurrentTask].ubPrio )
+			psOwner->ubPrio = asTask[ubCurrentTask].ubPrio;     // inherit
+		if ( ubCurrentTask != 0 )  block_on( psMutex );
+		else
+		{
+			ENABLE_GLOBAL_IRQ;
+			asm volatile ( "nop" );
+			DISABLE_GLOBAL_IRQ;
+		}
+	}
+	psMutex->ubOwner = ubCurrentTask;
+	psMutex->ubDepth++ ;
+	SREG = bSREG;
+}
+
+
+void  mutex_unlock( kmutex_t *psMutex )
+{
+	uint8  bSREG = SREG;
+	uint8  ubTask;
+
+	DISABLE_GLOBAL_IRQ;
+	if ( psMutex->ubOwner == ubCurrentTask && --psMutex->ubDepth == 0 )
+	{
+		psMutex->ubOwner = 0xFF;
+		asTask[ubCurrentTask].ubPrio = asTask[ubCurrentTask].ubBasePrio;
+		ubTask = wake_waiter( psMutex );
+		if ( ubTask != 0 && asTask[ubTask].ubPrio > asTask[ubCurrentTask].ubPrio )
+			kernel_switch();
+	}
+	SREG = bSREG;
+}
+
+
+/*
+|   Return the number of bytes of a task stack used so far (high-water mark),
+|   found by scanning up from the stack base for the fill pattern.
+*/
+static  uint16  stack_used( struct KTask_t *psTask )
+{
+	uint8  *pub = psTask->pubStack;
+	uint16  uwFree = 0;
+
+	while ( uwFree < psTask->uwStackSize && *pub++ == KERNEL_STACK_FILL )  uwFree++ ;
+
+	return  psTask->uwStackSize - uwFree;
+}
+
+
+const  char  acTaskStateCodes[] PROGMEM = "-RDB";   // TASK_DORMANT .. TASK_BLOCKED
+
+static  uint32  ulListTotal;            // Total ticks for 'TL' CPU share
+
+static  PT_THREAD( task_list_thread( pt_t *pt ) )
+{
+	static  uint8   ubTask;
+	struct  KTask_t  *psTask;
+	uint32  ulRun;
+
+	PT_BEGIN( pt );
+	for ( ubTask = 0;  ubTask < KERNEL_MAX_TASKS;  ubTask++ )
+	{
+		PT_WAIT_TX( pt, 40 );
+		psTask = &asTask[ubTask];
+		if ( psTask->pkName == NULL )  continue;
+
+		DISABLE_GLOBAL_IRQ;
+		ulRun = psTask->ulRunTicks;
+		psTask->ulRunTicks = 0;
+		ENABLE_GLOBAL_IRQ;
+
+		putHexDigit( ubTask );
+		putch( SPACE );
+		putch( pgm_read_byte( &acTaskStateCodes[psTask->ubState] ) );
+		putch( SPACE );
+		putHexByte( psTask->ubPrio );
+		putch( SPACE );
+		putHexWord( stack_used( psTask ) );
+		putch( SPACE );
+		putHexWord( psTask->uwStackSize );
+		putch( SPACE );
+		putDecWord( ulListTotal ? (uint16) ((ulRun * 100) / ulListTotal) : 0, 3 );
+		putch( '%' );
+		putch( SPACE );
+		putstr_P( psTask->pkName );
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+/*
+|  Command function 'TL':  List tasks.
+|
+|  Response:  One line per task:  "n s pp uuuu ssss ccc% name"
+|  where n = task ID, s = state (R = ready, D = delayed, B = blocked, - = dormant),
+|  pp = priority (hex), uuuu = stack used (high-water mark), ssss = stack size (hex),
+|  ccc = CPU share since the last 'TL' (per cent, decimal).
+|  Task names are limited to 8 chars.
+*/
+void  task_list_cmd( void )
+{
+	DISABLE_GLOBAL_IRQ;
+	ulListTotal = ulTotalTicks;
+	ulTotalTicks = 0;
+	ENABLE_GLOBAL_IRQ;
+
+	hci_spawn( task_list_thread );
+}
+
+#else
+
+void  task_list_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // KERNEL_SUPPORTED
+
+// end
@@ -0,0 +1,89 @@
+/*
+*   kernel.h  --  Optional preemptive priority-based multitasking kernel
+*
+*   When KERNEL_SUPPORTED is TRUE (system.h), the RTI tick ISR saves the full
+*   context of the running task and switches to the highest priority task that is
+*   ready to run (round-robin between tasks of equal priority, on each tick).
+*   The monitor (main loop: HCI service and background tasks) becomes task 0,
+*   which runs at the lowest priority, KERNEL_PRIO_IDLE, on the main stack.
+*   It must never block;  application tasks block in task_delay(), sem_wait() or
+*   mutex_lock(), which lets lower priority tasks (eventually the monitor) run.
+*
+*   Application tasks are created in main(), after kernel_init(), e.g.
+*
+*       static  uint8  aubCtrlStack[96];
+*       const  char  acCtrlName[] PROGMEM = "CTRL";
+*
+*       void  control_task( void )
+*       {
+*           while ( 1 )
+*           {
+*               ... control loop ...
+*               task_delay( 10 );       // every 10 ticks (msec)
+*           }
+*       }
+*
+*       task_create( control_task, aubCtrlStack, sizeof(aubCtrlStack), 5, acCtrlName );
+*
+*   A task stack must hold the task's own call frames plus one full context
+*   (KERNEL_CONTEXT_SIZE bytes) plus the deepest ISR frame.  Stack usage
+*   (high-water mark) and CPU share are shown by the 'TL' command.
+*/
+#ifndef  _KERNEL_H_
+#define  _KERNEL_H_
+
+#include "system.h"
+
+#define  KERNEL_MAX_TASKS        4      // Including the monitor (task 0)
+#define  KERNEL_PRIO_IDLE        0      // Monitor task priority (lowest)
+#define  KERNEL_CONTEXT_SIZE    37      // 32 regs + SREG + 2 return addresses
+#define  KERNEL_STACK_FILL    0xA5      // Pattern for stack usage measurement
+
+// Task states
+enum  KTaskState_t
+{
+	TASK_DORMANT = 0,                   // Slot unused, or task function returned
+	TASK_READY,                         // Running or ready to run
+	TASK_DELAYED,                       // In task_delay()
+	TASK_BLOCKED                        // Waiting for a semaphore or mutex
+};
+
+// Counting semaphore
+typedef  struct  KSemaphore_t
+{
+	uint8    ubCount;
+}
+ksem_t;
+
+// Mutex (with priority inheritance)
+typedef  struct  KMutex_t
+{
+	uint8    ubOwner;                   // Task ID of owner, or 0xFF if free
+	uint8    ubDepth;                   // Lock count (owner may lock recursively)
+}
+kmutex_t;
+
+#define  KMUTEX_INIT        { 0xFF, 0 }
+
+#if KERNEL_SUPPORTED
+
+void   kernel_init( void );
+uint8  task_create( pfnvoid pfnTask, uint8 *pubStack, uint16 uwSize, uint8 ubPrio, PGM_P pkName );
+uint8  task_self( void );
+void   task_yield( void );
+void   task_delay( uint16 uwTicks );
+
+void   sem_init( ksem_t *psSem, uint8 ubCount );
+void   sem_wait( ksem_t *psSem );
+bool   sem_trywait( ksem_t *psSem );
+void   sem_post( ksem_t *psSem );             // may also be called from an ISR
+
+void   mutex_init( kmutex_t *psMutex );
+void   mutex_lock( kmutex_t *psMutex );
+void   mutex_unlock( kmutex_t *psMutex );
+
+#endif
+
+void   task_list_cmd( void );
+
+#endif  /* _KERNEL_H_ */
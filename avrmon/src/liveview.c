@@ -0,0 +1,188 @@
+/*____________________________________________________________________________*\
+|
+|  File:        liveview.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  This module implements the live memory view command, 'LV'.
+|  Watching memory with repeated 'DD' commands resends the whole block every time,
+|  even if only one byte has changed.  'LV' keeps a snapshot of the region as last
+|  sent to the host, and on each refresh sends only the bytes which differ from it,
+|  so a much faster refresh rate can be sustained over the serial link.
+|  See liveview.h for the output formats.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "strtab.h"
+#include  "swtimer.h"
+#include  "liveview.h"
+
+#define  LIVE_TOP_ROW       3       // Screen row of first dump row (interactive)
+#define  LIVE_TX_SPACE     12       // Longest update record, incl. line break
+
+static  uint8   aubSnapshot[LIVE_VIEW_MAX];     // Region as last sent to host
+static  uint16  uwLiveAddr;             // Start address (data space)
+static  uint8   ubLiveCount;            // Region size (bytes)
+static  uint16  uwLivePeriod;           // Refresh period (msec)
+static  uint8   ubOffset;               // Offset of next byte to compare
+static  uint8   ubCursor;               // Offset last output (interactive), or 0xFF
+static  uint8   ubLineRecs;             // Records output on current line (machine)
+static  bool    yFirstScan;             // Send all bytes on first refresh
+static  bool    yLiveRefresh;           // Set by sLiveTimer expiry
+static  swtimer_t  sLiveTimer;          // Refresh timer
+
+
+static  void  live_timer_expired( swtimer_t *psTimer )
+{
+	*(bool *) psTimer->pvArg = TRUE;        // yLiveRefresh
+}
+
+
+/*
+|  Output an ANSI cursor position sequence, "<Esc>[rr;ccH".
+*/
+static  void  put_cursor_posn( uint8 ubRow, uint8 ubCol )
+{
+	putch( ESC );
+	putch( '[' );
+	putDecWord( ubRow, 2 );
+	putch( ';' );
+	putDecWord( ubCol, 2 );
+	putch( 'H' );
+}
+
+
+/*
+|  Output the new value of the byte at ubOffset in the region.
+|
+|  In interactive mode, the cursor is moved to the byte's place in the dump, unless
+|  it is already there, i.e. just after the previous byte output on the same row.
+|  Dump columns are as 'DD':  "aaaa  xx xx xx xx xx xx xx xx  xx xx ..."
+*/
+static  void  live_put_update( uint8 ubOffset, uint8 ubValue )
+{
+	uint8  ubCol = ubOffset & 15;
+
+	if ( hci_interactive() )
+	{
+		if ( ubOffset == ubCursor + 1 && ubCol != 0 )
+		{
+			putch( SPACE );
+			if ( ubCol == 8 )  putch( SPACE );
+		}
+		else  put_cursor_posn( LIVE_TOP_ROW + (ubOffset >> 4), 7 + ubCol * 3 + (ubCol >= 8) );
+		ubCursor = ubOffset;
+	}
+	else
+	{
+		if ( ubLineRecs == LIVE_RECS_PER_LINE )
+		{
+			NEW_LINE;
+			ubLineRecs = 0;
+		}
+		if ( ubLineRecs == 0 )  putch( '+' );
+		putHexByte( ubOffset );
+		ubLineRecs++ ;
+	}
+	putHexByte( ubValue );
+}
+
+
+static  PT_THREAD( live_view_thread( pt_t *pt ) )
+{
+	uint8  ubValue;
+
+	PT_BEGIN( pt );
+	if ( hci_interactive() )    // Clear screen and draw dump frame (addresses)
+	{
+		PT_WAIT_TX( pt, 40 );
+		putmsg( STR_LIVE_CLS );
+		putmsg( STR_LIVE_TITLE );
+		for ( ubOffset = 0;  ubOffset < ubLiveCount;  ubOffset += 16 )
+		{
+			PT_WAIT_TX( pt, 12 );
+			put_cursor_posn( LIVE_TOP_ROW + (ubOffset >> 4), 1 );
+			putHexWord( uwLiveAddr + ubOffset );
+		}
+	}
+	swtimer_init( &sLiveTimer, live_timer_expired, &yLiveRefresh );
+	swtimer_start( &sLiveTimer, 0, uwLivePeriod );
+	yLiveRefresh = FALSE;
+
+	while ( 1 )    // Loop until <Esc> hit
+	{
+		PT_WAIT_UNTIL( pt, yLiveRefresh || serialRxDataAvail() );
+		if ( serialRxDataAvail() )
+		{
+			if ( getch() == ESC )  break;
+			continue;
+		}
+		yLiveRefresh = FALSE;
+		ubCursor = 0xFF;
+		ubLineRecs = 0;
+
+		for ( ubOffset = 0;  ubOffset < ubLiveCount;  ubOffset++ )
+		{
+			PT_WAIT_TX( pt, LIVE_TX_SPACE );
+			ubValue = mem_read_byte( 'D', uwLiveAddr + ubOffset );
+			if ( ubValue != aubSnapshot[ubOffset] || yFirstScan )
+			{
+				aubSnapshot[ubOffset] = ubValue;
+				live_put_update( ubOffset, ubValue );
+			}
+		}
+		yFirstScan = FALSE;
+		if ( ubLineRecs != 0 )  NEW_LINE;       // End of machine mode frame
+	}
+	swtimer_stop( &sLiveTimer );
+
+	if ( hci_interactive() )    // Leave cursor below the dump
+	{
+		PT_WAIT_TX( pt, 8 );
+		put_cursor_posn( LIVE_TOP_ROW + ((ubLiveCount + 15) >> 4), 1 );
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'LV':  Live view of a data memory (SRAM) region.
+|  Cmd format: "LV aaaa [nn [tt]]"
+|
+|  Arg1 is the start address (hex) in data space, which includes the I/O registers;
+|  note that reading some registers (e.g. UDR0) has side-effects.
+|  Arg2 is the number of bytes to view (hex, optional, default 40, max LIVE_VIEW_MAX);
+|  Arg3 is the refresh period, msec (hex, optional, default 64 = 100ms).
+|
+|  The region is compared with the snapshot every refresh period, and the changed
+|  bytes are sent (see liveview.h).  If the link is too slow to send all changes
+|  within the period, the next refresh starts as soon as the previous one is done.
+|  The view runs as a protothread, so the main loop keeps running until <Esc> is hit.
+*/
+void  live_view_cmd( void )
+{
+	char  * pcArg;
+	uint16  uwArg;
+
+	if ( !isHexDigit( *hci_arg( 1 ) ) )  { hci_put_cmd_error();  return; }
+	uwLiveAddr = hexatoi( hci_arg( 1 ) );
+
+	uwArg = 0x40;
+	pcArg = hci_arg( 2 );
+	if ( isHexDigit( *pcArg ) )  uwArg = hexatoi( pcArg );
+	if ( uwArg == 0 || uwArg > LIVE_VIEW_MAX )  { hci_put_cmd_error();  return; }
+	ubLiveCount = (uint8) uwArg;
+
+	uwLivePeriod = 100;
+	pcArg = hci_arg( 3 );
+	if ( isHexDigit( *pcArg ) )  uwLivePeriod = hexatoi( pcArg );
+	if ( uwLivePeriod < LIVE_MIN_PERIOD )  uwLivePeriod = LIVE_MIN_PERIOD;
+
+	yFirstScan = TRUE;
+	hci_spawn( live_view_thread );
+}
+
+// end
@@ -0,0 +1,31 @@
+/*
+*   liveview.h  --  Live memory view ('LV'), delta encoded
+*
+*   The first refresh sends the whole region;  after that, each refresh sends only
+*   the bytes which have changed since they were last sent, so the serial bandwidth
+*   used depends on the rate of change, not on the region size or refresh rate.
+*
+*   Interactive mode:  the region is drawn as a dump (16 bytes per row, as 'DD') on
+*   a cleared ANSI/VT100 terminal screen;  changed bytes are overwritten in place,
+*   using cursor positioning sequences.
+*
+*   Machine mode:  each refresh with changes outputs one or more lines of records,
+*
+*       +oovvoovv...
+*
+*   where oo = byte offset from the start address and vv = new value (both hex),
+*   up to LIVE_RECS_PER_LINE records per line.  No output means no change.
+*   The host stops the view by sending <Esc>;  the response terminator follows.
+*/
+#ifndef  _LIVEVIEW_H_
+#define  _LIVEVIEW_H_
+
+#include "system.h"
+
+#define  LIVE_VIEW_MAX        128     // Largest region (bytes) = snapshot buffer size
+#define  LIVE_RECS_PER_LINE    16     // Machine mode records per line
+#define  LIVE_MIN_PERIOD       10     // Shortest refresh period (msec)
+
+void   live_view_cmd( void );
+
+#endif  /* _LIVEVIEW_H_ */
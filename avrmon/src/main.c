@@ -19,34 +19,59 @@
 #include  "system.h"
 #include  "periph.h"
 #include  "cmnd.h"
+#include  "strtab.h"
+#include  "wdog.h"
+#include  "kernel.h"
+#include  "evq.h"
+#include  "swtimer.h"
+#include  "twi.h"
+#include  "spi.h"
+#include  "patgen.h"
+#include  "crash.h"
 
 
 // Functions in main module...
 void  doBackgroundTasks( void );
-void  update_LED_chaser( void );
+void  LED_chaser_start( void );
 
 
 // Globals...
 uint16  gwDebugFlags;
 uint16  gwSystemError;
 
-// Welcome message
-const  char  psWelcome[]  PROGMEM = "\nAVROS : Arduino Debug Monitor : ";
-
 
 int  main( void )
 {
 	initMCUports();             // do initialisation
+	evq_sys_init();
 	initMCUtimers();
+	wdog_init();
+#if CRASH_MAILBOX_SUPPORTED
+	crash_init();               // keep crash record from before reset
+#endif
 	init_UART();
+#if TWI_SUPPORTED
+	twi_init();
+#endif
+#if SPI_SUPPORTED
+	spi_init();
+#endif
 	hci_init();
+	LED_chaser_start();         // demo pattern (optional)
+#if KERNEL_SUPPORTED
+	kernel_init();              // main loop becomes the monitor task
+	// Create application tasks here (see kernel.h)
+#endif
 
 	HEARTBEAT_LED_TOGL;         // light heartbeat LED
 
 #if INTERACTIVE_ON_STARTUP     
-	putstr_P( psWelcome );      // output msg to serial port
-	version_cmd();
-	hci_put_resp_term();        // prompt
+	if ( hci_interactive() )    // not if node address set (multi-drop bus)
+	{
+		putmsg( STR_WELCOME );      // output msg to serial port
+		version_cmd();
+		hci_put_resp_term();        // prompt
+	}
 #endif
 
 	ENABLE_GLOBAL_IRQ;          // launch kernel loop
@@ -56,54 +81,72 @@ int  main( void )
 	{
 		hci_service();
 		doBackgroundTasks();
+		wdog_loop_mark();
 	}
     return ( 1 );               // main() should not return!
 }
 
 
+/*
+|   Background task dispatcher, called from the main loop.
+|   Periodic tasks are called in the time slots below.  Protothread tasks are
+|   resumed on every call;  they yield while waiting (for a delay, TX space, etc),
+|   so no task ever blocks the loop.  Tasks must not call doBackgroundTasks().
+*/
 void  doBackgroundTasks( void )
 {
-	if ( b5msecTaskReq )
-	{
-		// Place calls to 5mSec periodic tasks here
-		//
-//		wdt_reset();                // TODO: Watchdog handler
-		b5msecTaskReq = 0;
-	}
-	if ( b50mSecTaskReq )
+	event_t  sEvent;
+
+	swtimer_service();                      // Software timer callbacks
+
+	while ( evq_get( &gsTickEventQ, &sEvent ) )
 	{
-		// Place calls to 50mSec periodic tasks here
-		//
-		update_LED_chaser();        // demo routine (optional)
-		b50mSecTaskReq = 0;
+		switch ( sEvent.ubCode )
+		{
+		case EV_TICK_5MS:
+			// Place calls to 5mSec periodic tasks here
+			//
+			wdog_checkin( WDOG_TASK_5MS );
+			wdog_service();             // Kick watchdog if all tasks on time
+			break;
+
+		case EV_TICK_50MS:
+			// Place calls to 50mSec periodic tasks here
+			//
+			wdog_checkin( WDOG_TASK_50MS );
+			break;
+
+		case EV_TICK_500MS:
+			// Place calls to 500mSec periodic tasks here
+			//
+			HEARTBEAT_LED_TOGL;
+			wdog_checkin( WDOG_TASK_500MS );
+			break;
+		}
 	}
-	if ( b500msecTaskReq )
+
+	while ( evq_get( &gsSerialEventQ, &sEvent ) )
 	{
-		// Place calls to 500mSec periodic tasks here
-		//
-		HEARTBEAT_LED_TOGL;
-		b500msecTaskReq = 0;
+		// EV_UART_RX_ERROR or EV_UART_RX_LOST -- input lost or corrupted
+		gwSystemError |= SYS_ERR_SERIAL_RX;
 	}
 }
 
 
 /*
-|   Demo background task --
-|   LED chaser routine for diagnostic 7-segment LED display.
-|   The function is called every 50ms, but the actual task is executed
-|   on every alternate call, to get the desired chaser speed.
+|   Demo pattern --
+|   LED chaser for diagnostic 7-segment LED display:  one segment on at a time,
+|   stepped every 100ms, played in a loop by the pattern generator (patgen.c).
 */
-
-void  update_LED_chaser( void )
+void  LED_chaser_start( void )
 {
-	static  uint8   bLedChaser = 0x01;  // Segment pattern (1 segs on)
-	static  uint8   bAlt;
-
-	if ( (bAlt++ & 1) == 0 ) return;    // True on alternate calls
+#if PATGEN_SUPPORTED
+	uint8   bLedChaser;         // Segment pattern (1 seg on)
+	uint8   ubStep = 0;
 
-	LED_7SEG_PORT = (LED_7SEG_PORT & 0xC0) | (bLedChaser & 0x3F);
-	bLedChaser = (bLedChaser << 1);
-	if ( bLedChaser == 0x40) bLedChaser = 0x1;
-	
+	for ( bLedChaser = 0x01;  bLedChaser & LED_7SEG_MASK;  bLedChaser <<= 1 )
+		patgen_set_entry( ubStep++, bLedChaser, 1000 );      // 1000 x 100us
+	patgen_start( 'C', LED_7SEG_MASK, ubStep, 100, TRUE );
+#endif
 }
 // end
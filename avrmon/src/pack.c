@@ -0,0 +1,227 @@
+/*____________________________________________________________________________*\
+|
+|  File:        pack.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  This module implements the packed (compressed) memory dump command, 'Zs'.
+|  Bulk memory images are mostly runs (erased flash = FF, cleared SRAM = 00)
+|  and repeated code sequences, so a simple run-length + LZ scheme cuts the
+|  transfer time of a full flash read several-fold compared with 'DC'.
+|
+|  The encoder keeps only a small ring of recently sent bytes (the "window")
+|  in SRAM; match candidates are compared against the window, so the unpacked
+|  output is always exactly what the host reconstructs, even if SRAM changes
+|  during the dump.  See pack.h for the stream format.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "pack.h"
+
+#define  WINDOW_MASK   (PACK_WINDOW_SIZE - 1)
+
+// Longest literal block output by the encoder -- keeps the output of one pass of
+// the encoder loop (pending literals, a run token, line breaks) within the TX FIFO
+// space the thread waits for.
+#define  LITERAL_LIMIT     32
+#define  TOKEN_TX_SPACE   (((LITERAL_LIMIT + 1) + 4) * 2 + 6)
+
+static  uint8   aubWindow[PACK_WINDOW_SIZE];    // Ring of recently sent bytes
+static  uint8   ubWinHead;              // Index of next free place in window
+static  uint16  uwWinCount;             // Number of bytes in window (saturates)
+static  uint8   ubLineCount;            // Packed bytes output on current line
+static  uint32  ulPackedCount;          // Packed bytes output in total
+static  char    cSpace;                 // Memory space being dumped
+static  uint16  uwAddr;                 // Next address to encode
+static  uint16  uwCount;                // Bytes to go
+static  uint16  uwRawCount;             // Bytes requested
+static  uint8   ubLiterals;             // Literal bytes held in window, not yet output
+
+
+/*
+|  Output one packed byte as hex, starting a new line when the line is full.
+*/
+static  void  pack_put_byte( uint8 b )
+{
+	if ( ubLineCount == PACK_BYTES_PER_LINE )
+	{
+		NEW_LINE;
+		ubLineCount = 0;
+	}
+	putHexByte( b );
+	ubLineCount++ ;
+	ulPackedCount++ ;
+}
+
+
+/*
+|  Append a byte to the history window.
+*/
+static  void  window_push( uint8 b )
+{
+	aubWindow[ubWinHead] = b;
+	ubWinHead = (ubWinHead + 1) & WINDOW_MASK;
+	if ( uwWinCount < PACK_WINDOW_SIZE )  uwWinCount++ ;
+}
+
+
+/*
+|  Output a literal block comprising the last ubCount bytes pushed into the window.
+*/
+static  void  flush_literals( uint8 ubCount )
+{
+	uint8  ubIdx = (ubWinHead - ubCount) & WINDOW_MASK;
+
+	if ( ubCount == 0 )  return;
+
+	pack_put_byte( ubCount - 1 );
+	while ( ubCount-- != 0 )
+	{
+		pack_put_byte( aubWindow[ubIdx] );
+		ubIdx = (ubIdx + 1) & WINDOW_MASK;
+	}
+}
+
+
+/*
+|  Encoder protothread -- one token is output per resumption, when there is
+|  enough space in the serial TX FIFO buffer for the longest token.
+*/
+static  PT_THREAD( packed_dump_thread( pt_t *pt ) )
+{
+	uint16  uwRun, uwLen, uwBestLen;
+	uint8   ubDist, ubBestDist;
+	uint8   ubDat, ubRef;
+
+	PT_BEGIN( pt );
+	while ( uwCount != 0 )
+	{
+		PT_WAIT_TX( pt, TOKEN_TX_SPACE );
+
+		// Measure run of identical bytes at current address
+		ubDat = mem_read_byte( cSpace, uwAddr );
+		for ( uwRun = 1;  uwRun < uwCount;  uwRun++ )
+		{
+			if ( mem_read_byte( cSpace, uwAddr + uwRun ) != ubDat )  break;
+		}
+
+		// Search window for longest match (copy source may overlap the lookahead)
+		uwBestLen = 0;
+		ubBestDist = 0;
+		for ( ubDist = 1;  ubDist <= uwWinCount && uwRun < PACK_MIN_MATCH;  ubDist++ )
+		{
+			for ( uwLen = 0;  uwLen < PACK_MAX_COPY && uwLen < uwCount;  uwLen++ )
+			{
+				if ( uwLen < ubDist )
+					ubRef = aubWindow[(ubWinHead - ubDist + uwLen) & WINDOW_MASK];
+				else  ubRef = mem_read_byte( cSpace, uwAddr + uwLen - ubDist );
+				if ( mem_read_byte( cSpace, uwAddr + uwLen ) != ubRef )  break;
+			}
+			if ( uwLen > uwBestLen )
+			{
+				uwBestLen = uwLen;
+				ubBestDist = ubDist;
+			}
+			if ( ubDist == PACK_WINDOW_SIZE )  break;
+		}
+
+		if ( uwRun >= PACK_MIN_MATCH )          // Emit run
+		{
+			flush_literals( ubLiterals );
+			ubLiterals = 0;
+			if ( uwRun <= PACK_MAX_RUN )
+				pack_put_byte( PACK_T_RUN + uwRun - PACK_MIN_MATCH );
+			else
+			{
+				pack_put_byte( PACK_T_LONG_RUN );
+				pack_put_byte( HI_BYTE( uwRun ) );
+				pack_put_byte( LO_BYTE( uwRun ) );
+			}
+			pack_put_byte( ubDat );
+			for ( uwLen = 0;  uwLen < uwRun && uwLen < PACK_WINDOW_SIZE;  uwLen++ )
+				window_push( ubDat );
+			uwAddr += uwRun;
+			uwCount -= uwRun;
+		}
+		else if ( uwBestLen >= PACK_MIN_MATCH )     // Emit copy
+		{
+			flush_literals( ubLiterals );
+			ubLiterals = 0;
+			pack_put_byte( PACK_T_COPY + uwBestLen - PACK_MIN_MATCH );
+			pack_put_byte( ubBestDist - 1 );
+			for ( uwLen = 0;  uwLen < uwBestLen;  uwLen++ )     // Replicate unpacker
+				window_push( aubWindow[(ubWinHead - ubBestDist) & WINDOW_MASK] );
+			uwAddr += uwBestLen;
+			uwCount -= uwBestLen;
+		}
+		else    // Literal -- held in window until block is output
+		{
+			window_push( ubDat );
+			uwAddr++ ;
+			uwCount-- ;
+			if ( ++ubLiterals == LITERAL_LIMIT )
+			{
+				flush_literals( ubLiterals );
+				ubLiterals = 0;
+			}
+		}
+	}
+	flush_literals( ubLiterals );
+
+	PT_WAIT_TX( pt, 24 );
+	NEW_LINE;
+	putch( '#' );
+	putHexWord( uwRawCount );
+	putch( SPACE );
+	putHexDigit( (uint8) (ulPackedCount >> 16) );
+	putHexWord( (uint16) ulPackedCount );
+	putch( SPACE );
+	if ( uwRawCount != 0 )
+		putDecWord( (uint16) ((ulPackedCount * 100) / uwRawCount), 3 );
+	else  putDecWord( 0, 3 );
+	putch( '%' );
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'Zs':  Dump a block of memory in packed (compressed) format.
+|
+|  The command mnemonic may be 'ZC', 'ZD' or 'ZE', selecting the program code (flash),
+|  data (SRAM) or EEPROM space respectively, as for the 'Dx' commands.
+|
+|  Arg1 is the start address (hex, 0..FFFF);
+|  Arg2 is the number of bytes to dump (hex, optional, default 100 = 256 bytes).
+|
+|  Response:  The packed stream as hex ASCII, PACK_BYTES_PER_LINE bytes per line,
+|  then a statistics line "#rrrr ppppp nnn%" where rrrr is the raw byte count, ppppp
+|  is the packed byte count (both hex) and nnn is the packed size as a percentage of raw.
+|
+|  The dump runs as a protothread (see hci_spawn), so the main loop is not blocked.
+|  Literal blocks are limited to LITERAL_LIMIT bytes (less than the window size,
+|  since the literal bytes are held in the window until the block is output).
+*/
+void  packed_dump_cmd( void )
+{
+	char  * pcArg = hci_arg( 2 );
+
+	if ( !isHexDigit( *hci_arg( 1 ) ) )  { hci_put_cmd_error();  return; }
+	cSpace = toupper( hci_arg( 0 )[1] );
+	uwAddr = hexatoi( hci_arg( 1 ) );
+	uwCount = 256;
+	if ( isHexDigit( *pcArg ) )  uwCount = hexatoi( pcArg );
+
+	uwRawCount = uwCount;
+	ubLiterals = 0;
+	ubWinHead = 0;
+	uwWinCount = 0;
+	ubLineCount = 0;
+	ulPackedCount = 0;
+
+	hci_spawn( packed_dump_thread );
+}
+
+// end
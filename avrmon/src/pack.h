@@ -0,0 +1,34 @@
+/*
+*   pack.h  --  Compressed (packed) memory block transfer
+*
+*   Packed stream format -- each token begins with a control byte, T:
+*
+*     T = 00..7F :  Literal block;  (T + 1) literal bytes follow.
+*     T = 80..BE :  Run;  the following byte is repeated (T - 0x80 + 3) times.
+*     T = BF     :  Long run;  a 16-bit count (MSB first) follows, then the byte.
+*     T = C0..FF :  Copy;  a distance byte D follows; (T - 0xC0 + 3) bytes are
+*                   copied from (D + 1) bytes back in the unpacked output.
+*
+*   The copy distance never exceeds PACK_WINDOW_SIZE, so the unpacker needs no more
+*   history than that.  The host-side unpacker is in host/unpack.c; keep in step!
+*/
+#ifndef  _PACK_H_
+#define  _PACK_H_
+
+#include "system.h"
+
+#define  PACK_WINDOW_SIZE      64     // History window size (bytes), power of 2, max 256
+#define  PACK_MIN_MATCH         3     // Shortest run or copy worth encoding
+#define  PACK_MAX_LITERAL     128     // Longest literal block
+#define  PACK_MAX_RUN          65     // Longest short run (T = 80..BE)
+#define  PACK_MAX_COPY         66     // Longest copy
+#define  PACK_BYTES_PER_LINE   32     // Packed bytes output per line (as hex)
+
+#define  PACK_T_RUN          0x80     // Control byte base values
+#define  PACK_T_LONG_RUN     0xBF
+#define  PACK_T_COPY         0xC0
+
+
+void   packed_dump_cmd( void );
+
+#endif  /* _PACK_H_ */
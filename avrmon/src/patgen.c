@@ -0,0 +1,301 @@
+/*____________________________________________________________________________*\
+|
+|  File:        patgen.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Timed pattern playback on an output port (optional, PATGEN_SUPPORTED),
+|  with the commands 'PB' and 'PP'.  The Timer1 compare A ISR outputs each
+|  entry and schedules the next change on the free-running timestamp timer;
+|  holds longer than PATGEN_MAX_STEP counts take several compare steps.
+|  See patgen.h.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "isrstat.h"
+#include  "patgen.h"
+
+#if PATGEN_SUPPORTED
+
+// I/O registers of the selected port:  PINx, DDRx and PORTx are consecutive
+#define  PAT_PIN    (*pubPatPin)
+#define  PAT_DDR    (*(pubPatPin + 1))
+#define  PAT_PORT   (*(pubPatPin + 2))
+
+// Pattern entry -- output value and hold time (units)
+struct  PatEntry_t
+{
+	uint8    ubValue;
+	uint16   uwTime;
+};
+
+static  struct  PatEntry_t  asPattern[PATGEN_BUF_SIZE];
+static  volatile uint8  *pubPatPin;     // PINx of the output port
+static  uint8   ubPatMask;              // Port bits driven
+static  uint8   ubPatCount;             // Entries in the pattern being played
+static  uint8   ubPatLoaded;            // Entries loaded ('PB'), highest index + 1
+static  uint16  uwPatUnit;              // Timestamp counts per hold time unit
+static  bool    yPatLoop;               // Loop, else play once
+static  volatile  bool    yPatRunning;
+static  volatile  uint8   ubPatIndex;   // Next entry to output
+static  volatile  uint32  ulPatRemain;  // Counts of the current hold not yet scheduled
+static  volatile  uint16  uwPatLoops;   // Times round the loop
+static  volatile  uint16  uwPatLate;    // Changes made late (hold too short)
+static  uint8   ubListIndex;            // Next entry to output ('PB')
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- Timer/Counter1 Compare Match A
+|   At the end of a hold, the next entry is output;  then the next compare is set,
+|   at most PATGEN_MAX_STEP counts on, relative to the last (not to the ISR entry
+|   time), so latency does not accumulate.  If that time has already passed, the
+|   change is made PATGEN_MIN_STEP counts from now, and counted as late.
+*/
+ISR ( TIMER1_COMPA_vect )
+{
+	struct  PatEntry_t  *psEnt;
+	uint16  uwStep;
+	uint16  uwNext;
+
+	ISRSTAT_ENTER( ISRSTAT_PATGEN );
+
+	if ( ulPatRemain == 0 && ubPatIndex >= ubPatCount )     // end of pattern
+	{
+		if ( yPatLoop )
+		{
+			ubPatIndex = 0;
+			uwPatLoops++ ;
+		}
+		else
+		{
+			TIMSK1 &= ~(1<<OCIE1A);     // last value stays on the port
+			yPatRunning = FALSE;
+		}
+	}
+	if ( yPatRunning )
+	{
+		if ( ulPatRemain == 0 )
+		{
+			psEnt = &asPattern[ubPatIndex++];
+			PAT_PIN = (PAT_PORT ^ psEnt->ubValue) & ubPatMask;     // toggle bits to change
+			ulPatRemain = (uint32) psEnt->uwTime * uwPatUnit;
+		}
+		uwStep = ( ulPatRemain > PATGEN_MAX_STEP ) ? PATGEN_MAX_STEP : (uint16) ulPatRemain;
+		ulPatRemain -= uwStep;
+		uwNext = OCR1A + uwStep;
+		OCR1A = uwNext;
+		if ( (int16) (uwNext - TSTAMP_COUNT) <= 0 )
+		{
+			OCR1A = TSTAMP_COUNT + PATGEN_MIN_STEP;
+			uwPatLate++ ;
+		}
+	}
+
+	ISRSTAT_EXIT( ISRSTAT_PATGEN );
+}
+
+
+/*
+|   Set a pattern entry:  output value and hold time (units, 1..65535).
+|   May be called during playback;  the entry is written with interrupts disabled.
+*/
+void  patgen_set_entry( uint8 ubIndex, uint8 ubValue, uint16 uwTime )
+{
+	uint8  bSREG;
+
+	if ( ubIndex >= PATGEN_BUF_SIZE )  return;
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	asPattern[ubIndex].ubValue = ubValue;
+	asPattern[ubIndex].uwTime = uwTime;
+	SREG = bSREG;
+	if ( ubIndex >= ubPatLoaded )  ubPatLoaded = ubIndex + 1;
+}
+
+
+/*
+|   Stop playback -- the port keeps its present value.
+*/
+void  patgen_stop( void )
+{
+	TIMSK1 &= ~(1<<OCIE1A);
+	yPatRunning = FALSE;
+}
+
+
+/*
+|   Start playing the first ubCount entries on port cPort ('B', 'C' or 'D'),
+|   bits ubMask (made outputs), with hold times in units of ubUnit usec;  the
+|   first entry is output PATGEN_MIN_STEP counts from now.
+|   Returns FALSE (and does nothing) if an argument is invalid, or if ubMask
+|   includes a bit used by another driver (PATGEN_PORTx_RESERVED).
+*/
+bool  patgen_start( char cPort, uint8 ubMask, uint8 ubCount, uint8 ubUnit, bool yLoop )
+{
+	volatile uint8  *pubPin;
+	uint8   ubReserved;
+	uint8   bSREG;
+
+	switch ( cPort )
+	{
+	case 'B':  pubPin = &PINB;  ubReserved = PATGEN_PORTB_RESERVED;  break;
+	case 'C':  pubPin = &PINC;  ubReserved = PATGEN_PORTC_RESERVED;  break;
+	case 'D':  pubPin = &PIND;  ubReserved = PATGEN_PORTD_RESERVED;  break;
+	default:   return  FALSE;
+	}
+	if ( ubMask == 0 || (ubMask & ubReserved)
+	||   ubCount == 0 || ubCount > PATGEN_BUF_SIZE || ubUnit == 0 )
+		return  FALSE;
+
+	patgen_stop();
+	pubPatPin = pubPin;
+	ubPatMask = ubMask;
+	ubPatCount = ubCount;
+	uwPatUnit = (uint16) ubUnit * TSTAMP_COUNTS_PER_USEC;
+	yPatLoop = yLoop;
+	ubPatIndex = 0;
+	ulPatRemain = 0;
+	uwPatLoops = 0;
+	uwPatLate = 0;
+	PAT_DDR |= ubMask;
+
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	OCR1A = TSTAMP_COUNT + PATGEN_MIN_STEP;
+	TIFR1 = (1<<OCF1A);
+	yPatRunning = TRUE;
+	TIMSK1 |= (1<<OCIE1A);
+	SREG = bSREG;
+
+	return  TRUE;
+}
+
+
+static  PT_THREAD( pattern_list_thread( pt_t *pt ) )
+{
+	PT_BEGIN( pt );
+	for ( ubListIndex = 0;  ubListIndex < ubPatLoaded;  ubListIndex++ )
+	{
+		PT_WAIT_TX( pt, 14 );
+		putHexByte( ubListIndex );
+		putch( SPACE );
+		putHexByte( asPattern[ubListIndex].ubValue );
+		putch( SPACE );
+		putHexWord( asPattern[ubListIndex].uwTime );
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'PB':  Pattern buffer load / list.
+|  Cmd format:  "PB [ii vv tttt [vv tttt..]]"
+|
+|    PB ii vv tttt ..  ... Load entries from index ii:  vv = output value,
+|                          tttt = hold time, units (1..FFFF);  all hex.
+|                          Several commands load a long pattern, e.g. 6 per line.
+|    PB                ... List the entries loaded:  "ii vv tttt" lines.
+*/
+void  pattern_buffer_cmd( void )
+{
+	uint8   ubIndex = (uint8) hexatoi( hci_arg( 1 ) );
+	uint8   ubArg;
+
+	if ( *hci_arg( 1 ) == NUL )
+	{
+		hci_spawn( pattern_list_thread );
+		return;
+	}
+	// Check the whole line before changing the buffer
+	for ( ubArg = 2;  *hci_arg( ubArg ) != NUL;  ubArg += 2 )
+	{
+		if ( !isHexDigit( *hci_arg( ubArg ) ) || !isHexDigit( *hci_arg( ubArg + 1 ) )
+		||   hexatoi( hci_arg( ubArg + 1 ) ) == 0 )  break;
+	}
+	if ( !isHexDigit( *hci_arg( 1 ) ) || ubArg == 2 || *hci_arg( ubArg ) != NUL
+	||   (uint16) ubIndex + (ubArg - 2) / 2 > PATGEN_BUF_SIZE )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	for ( ubArg = 2;  *hci_arg( ubArg ) != NUL;  ubArg += 2 )
+	{
+		patgen_set_entry( ubIndex++, (uint8) hexatoi( hci_arg( ubArg ) ),
+		                  hexatoi( hci_arg( ubArg + 1 ) ) );
+	}
+}
+
+
+/*
+|  Command function 'PP':  Pattern playback control.
+|  Cmd format:  "PP [O|L p mm [nn [uu]] | X]"
+|
+|    PP O p mm nn uu  ... Play once (O) or loop (L) on port p (B|C|D), bits mm
+|                         (hex;  not the UART, heartbeat LED, SPI, TWI or other
+|                         pins in use, see patgen.h);  nn = number of entries
+|                         (hex, default all loaded), uu = hold time unit, usec
+|                         (hex, 1..FF, default 1).
+|    PP X             ... Stop;  the port keeps its present value.
+|    PP               ... Show status:  "r ii llll eeee" -- r = 1 if playing,
+|                         ii = next entry, llll = loops, eeee = late changes.
+*/
+void  pattern_play_cmd( void )
+{
+	char  * pcArg;
+	char    cMode = toupper( *hci_arg( 1 ) );
+	uint8   ubCount = ubPatLoaded;
+	uint8   ubUnit = 1;
+
+	switch ( cMode )
+	{
+	case 'O':
+	case 'L':
+		pcArg = hci_arg( 4 );
+		if ( isHexDigit( *pcArg ) )  ubCount = (uint8) hexatoi( pcArg );
+		pcArg = hci_arg( 5 );
+		if ( isHexDigit( *pcArg ) )  ubUnit = (uint8) hexatoi( pcArg );
+		if ( !isHexDigit( *hci_arg( 3 ) )
+		||   !patgen_start( toupper( *hci_arg( 2 ) ), (uint8) hexatoi( hci_arg( 3 ) ),
+		                    ubCount, ubUnit, (cMode == 'L') ) )
+			hci_put_cmd_error();
+		break;
+
+	case 'X':
+		patgen_stop();
+		break;
+
+	case NUL:
+		putBoolean( yPatRunning );
+		putch( SPACE );
+		putHexByte( ubPatIndex );
+		putch( SPACE );
+		putHexWord( uwPatLoops );
+		putch( SPACE );
+		putHexWord( uwPatLate );
+		break;
+
+	default:
+		hci_put_cmd_error();
+		break;
+	}
+}
+
+#else
+
+void  pattern_buffer_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  pattern_play_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // PATGEN_SUPPORTED
+
+// end
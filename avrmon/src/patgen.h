@@ -0,0 +1,62 @@
+/*
+*   patgen.h  --  Timed pattern playback on an output port
+*
+*   A pattern is a buffer of entries, each an output value and a hold time.  The
+*   entries are written to the selected bits (mask) of port B, C or D by the
+*   Timer1 compare A ISR, so every change is scheduled on the timestamp timer
+*   (see periph.h):  edges are placed to 0.5us, plus the ISR entry latency, which
+*   only varies with other interrupts in progress.  A pattern plays once, leaving
+*   the port at the last value, or loops until stopped.
+*
+*   Hold times are in units of 1..255 usec, set when the pattern is started, so a
+*   hold can be up to 16.7 sec.  A hold much shorter than the ISR (about 10us)
+*   is stretched:  the next change is then made as soon as possible, and counted
+*   as late.  The port bits are changed by writing the PINx register, which
+*   toggles them without a read-modify-write of PORTx, so other bits of the port
+*   may be driven by background code (with atomic bit writes) during playback.
+*
+*   'PB' loads and lists the buffer;  'PP' starts and stops playback.  The demo
+*   LED chaser in main.c is a looping pattern on the LED bits of port C.
+*/
+#ifndef  _PATGEN_H_
+#define  _PATGEN_H_
+
+#include "system.h"
+
+#define  PATGEN_BUF_SIZE       32     // Pattern entries (3 bytes each)
+#define  PATGEN_MAX_STEP   0x4000     // Longest compare step, timestamp counts
+#define  PATGEN_MIN_STEP   (8 * TSTAMP_COUNTS_PER_USEC)    // Step after a late change (8us)
+
+// Port bits used by other drivers in this build, which a pattern may not drive
+#if SPI_SUPPORTED
+#define  PATGEN_SPI_BITS    (BIT_1 | BIT_2 | BIT_3 | BIT_4 | BIT_5)  // PB1..5:  CS1, CS0, MOSI, MISO, SCK
+#else
+#define  PATGEN_SPI_BITS     0
+#endif
+#if TWI_SUPPORTED
+#define  PATGEN_TWI_BITS    (BIT_4 | BIT_5)                 // PC4, PC5:  SDA, SCL
+#else
+#define  PATGEN_TWI_BITS     0
+#endif
+#if RS485_SUPPORTED
+#define  PATGEN_RS485_BITS   BIT_2                          // PD2:  RS-485 DE
+#else
+#define  PATGEN_RS485_BITS   0
+#endif
+#if EVREC_SUPPORTED
+#define  PATGEN_EVREC_BITS  (BIT_3 | BIT_4 | BIT_5 | BIT_6 | BIT_7)  // PD3 heartbeat LED, PD4..7 inputs
+#else
+#define  PATGEN_EVREC_BITS   0
+#endif
+#define  PATGEN_PORTB_RESERVED  (BIT_0 | PATGEN_SPI_BITS)   // PB0 heartbeat LED, or ICP1 (EVREC)
+#define  PATGEN_PORTC_RESERVED  (PATGEN_TWI_BITS)
+#define  PATGEN_PORTD_RESERVED  (BIT_0 | BIT_1 | PATGEN_RS485_BITS | PATGEN_EVREC_BITS)  // PD0, PD1 UART
+
+void   patgen_set_entry( uint8 ubIndex, uint8 ubValue, uint16 uwTime );
+bool   patgen_start( char cPort, uint8 ubMask, uint8 ubCount, uint8 ubUnit, bool yLoop );
+void   patgen_stop( void );
+
+void   pattern_buffer_cmd( void );
+void   pattern_play_cmd( void );
+
+#endif  /* _PATGEN_H_ */
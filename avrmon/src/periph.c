@@ -12,23 +12,27 @@
 
 #include  "system.h"
 #include  "periph.h"
+#include  "isrstat.h"
+#include  "watchpt.h"
+#include  "evq.h"
 
 /*____________________________________________________________________________*\
 |
 |   MCU device initialisation and on-chip peripheral driver functions
 \*____________________________________________________________________________*/
 
-bool    b5msecTaskReq;
-bool    b50mSecTaskReq;
-bool    b500msecTaskReq;
+static  volatile  uint32  ulClockTicks;     // General-purpose "tick" counter
+static  volatile  uint16  uwTstampOvf;      // Timestamp timer overflow count
 
-static  uint32  ulClockTicks;     // General-purpose "tick" counter
+#if RS485_SUPPORTED
+static  void  rs485_tick_service( void );
+#endif
 
 
 void  initMCUports( void )
 {
 //	DDRA  = 0xFF;             // Port A pins are outputs (LCD data port)
-	DDRB  = 0x01;             // Port B pins PB0 is output  are outputs (keypad rows)
+	HEARTBEAT_LED_INIT;       // Heartbeat LED pin is output (PB0, or PD3 with EVREC)
 	DDRC  = 0xFF;             // Port C pins are outputs ( 6 leds display)
 //	DDRD  = 0xBF;             // Port D pins are outputs, except PD6 (DEBUG button)
 //	PORTD = BIT_6;            // Enable pullup on PD6 (DEBUG button input)
@@ -38,63 +42,93 @@ void  initMCUports( void )
 
 /*
 |   MCU timer/counter configuration --
-|   Timer/counter #1 is set up to generate a 1ms periodic "tick" interrupt.
+|   Timer/counter #2 is set up to generate a 1ms periodic "tick" interrupt.
+|   Timer/counter #1 runs free as the timestamp timer, leaving its input capture
+|   unit free (see evrec.h);  compare channel B is used by the profiler.
+|   Both are started from zero together, so tick compare matches are at known
+|   timestamp counts (see isrstat.c).
 |   MCU clock frequency is defined by symbol CLOCK_FREQ (Hz) in system.h.
 |   Acceptable values are 4000000 (4MHz), 8000000 (8MHz) or 16000000 (16MHz).
+|   The watchdog timer is set up by wdog_init() (see wdog.c).
 */
 void  initMCUtimers( void )
 {
-//	WDTCR = 0x0C;                       // TODO: Enable watchdog timer
-	TCCR1B = 0x0A;                      // Mode = CTC; Prescale f/8 (Tc=1us @ 8MHz)
-
-#if (CLOCK_FREQ == 4000000)
-	OCR1AH = HI_BYTE( 500 );            // Load TOP register for 1ms Top count
-	OCR1AL = LO_BYTE( 500 );
-#elif  (CLOCK_FREQ == 8000000)
-	OCR1AH = HI_BYTE( 1000 );           // Load TOP register for 1ms Top count
-	OCR1AL = LO_BYTE( 1000 );
-#else // Assume CLOCK_FREQ == 16000000
-	OCR1AH = HI_BYTE( 2000 );           // Load TOP register for 1ms Top count
-	OCR1AL = LO_BYTE( 2000 );
+	GTCCR = (1<<TSM) | (1<<PSRASY) | (1<<PSRSYNC);    // Hold prescalers in reset
+
+	TCCR2A = 0x02;                      // Timer2 mode = CTC
+#if (CLOCK_FREQ == 16000000)
+	TCCR2B = 0x04;                      // Prescale f/64 (Tc = 4us)
+#else
+	TCCR2B = 0x03;                      // Prescale f/32 (Tc = 4us @ 8MHz, 8us @ 4MHz)
 #endif
+	OCR2A = TICK_TIMER_PERIOD - 1;      // Load TOP register for 1ms Top count
+	TCNT2 = 0;
+
+	TCCR1A = 0x00;                      // Timer1 mode = normal (free-running)
+#if (TSTAMP_PRESCALE == 1)
+	TCCR1B = 0x01;                      // Prescale f/1 (Tc = 62.5ns @ 16MHz, 0.25us @ 4MHz)
+#else
+	TCCR1B = 0x02;                      // Prescale f/8 (Tc = 0.5us @ 16MHz)
+#endif
+	TCNT1 = 0;
 
-	ENABLE_TICK_TIMER;                  // Interrupt on Timer1 output compare
+	GTCCR = 0;                          // Start both timers
+	TIMSK1 |= (1<<TOIE1);               // Timestamp timer overflow interrupt
+	ENABLE_TICK_TIMER;                  // Interrupt on Timer2 output compare
 }
 
 
 /*
 |   INTERRUPT SERVICE ROUTINE ---  
-|   Timer/Counter1 Compare channel-A.
+|   Timer/Counter2 Compare channel-A.
 |   RTI "Tick Handler" / task scheduler.
 |   Short time-critical periodic tasks may be called within this ISR;
-|   other periodic tasks are scheduled for execution in "background".
+|   other periodic tasks are scheduled for execution in "background",
+|   by posting events to the tick event queue.
 |   (See doBackgroundTasks() in main.c)
+|   When the kernel is enabled, the ISR is in kernel.c, which calls this
+|   handler after saving the context of the interrupted task.
 */
-ISR ( TIMER1_COMPA_vect )
+#if KERNEL_SUPPORTED
+void  rti_tick_handler( void )
+#else
+ISR ( TIMER2_COMPA_vect )
+#endif
 {
 	static  uint8   b500msecTimer = 0;
 	static  uint8   b50mSecTimer = 0;
 	static  uint8   b5mSecTimer = 0;
 
+	ISRSTAT_ENTER( ISRSTAT_TICK );
+
 	ulClockTicks++;
+#if RS485_SUPPORTED
+	rs485_tick_service();
+#endif
 
 	if ( ++b5mSecTimer >= 5 )
 	{
-		b5msecTaskReq = 1;
+		evq_put( &gsTickEventQ, EV_TICK_5MS, (uint16) ulClockTicks );
 		b5mSecTimer = 0;
 		b50mSecTimer++ ;
 	}
 	if ( b50mSecTimer >= 10 )
 	{
-		b50mSecTaskReq = 1;
+		evq_put( &gsTickEventQ, EV_TICK_50MS, (uint16) ulClockTicks );
 		b50mSecTimer = 0;
 		b500msecTimer++ ;
 	}
 	if ( b500msecTimer >= 10 )
 	{
-		b500msecTaskReq = 1;
+		evq_put( &gsTickEventQ, EV_TICK_500MS, (uint16) ulClockTicks );
 		b500msecTimer = 0;
 	}
+
+#if WATCHPOINTS_SUPPORTED
+	if ( gyWatchActive )  watchpt_check();
+#endif
+
+	ISRSTAT_EXIT( ISRSTAT_TICK );
 }
 
 
@@ -114,19 +148,96 @@ uint32  millisec_timer( void )
 }
 
 
+/*
+|   Return the time since startup in microseconds (wraps after 71 minutes),
+|   derived from ulClockTicks and the tick timer count;  resolution is
+|   TICK_USEC_PER_COUNT usec.  For finer timing use the timestamp timer.
+|   May be called from any context, including ISR's; if a tick interrupt is
+|   pending but not yet serviced, the tick count is adjusted accordingly.
+*/
+uint32  microsec_timer( void )
+{
+	uint32  ulTicks;
+	uint8   ubCount;
+	uint8   bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	ulTicks = ulClockTicks;
+	ubCount = TICK_TIMER_COUNT;
+	if ( TICK_TIMER_PENDING && ubCount < (TICK_TIMER_PERIOD / 2) )  ulTicks++ ;
+	SREG = bSREG;
+
+	return  (ulTicks * 1000 * MSEC_PER_TICK) + ((uint16) ubCount * TICK_USEC_PER_COUNT);
+}
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- Timer/Counter1 Overflow.
+|   Extends the timestamp timer count to 32 bits.
+*/
+ISR ( TIMER1_OVF_vect )
+{
+	uwTstampOvf++ ;
+}
+
+
+/*
+|   Extend a timestamp timer count, read (or captured) just now, to 32 bits.
+|   Call with interrupts disabled (e.g. from an ISR);  if an overflow interrupt
+|   is pending but not yet serviced, the overflow count is adjusted accordingly.
+*/
+uint32  tstamp_extend( uint16 uwCount )
+{
+	uint16  uwOvf = uwTstampOvf;
+
+	if ( TSTAMP_OVF_PENDING && uwCount < 0x8000 )  uwOvf++ ;
+
+	return  ((uint32) uwOvf << 16) | uwCount;
+}
+
+
+/*
+|   Return the 32-bit timestamp timer count (TSTAMP_COUNTS_PER_USEC per usec;
+|   wraps after 35 minutes at 0.5us resolution).  May be called from any context.
+*/
+uint32  tstamp_read( void )
+{
+	uint32  ulStamp;
+	uint8   bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	ulStamp = tstamp_extend( TSTAMP_COUNT );
+	SREG = bSREG;
+
+	return  ulStamp;
+}
+
+
 /*____________________________________________________________________________*\
 |
 |   UART support functions for serial port I/O.
 |   See also UART I/O macros defined in periph.h
 \*____________________________________________________________________________*/
 
+// The RX FIFO is lock-free (single producer: the RX ISR, single consumer: getch);
+// the head and tail are free-running counts, so SERIAL_RX_BUF_SIZE must be a power of 2.
 static  uint8   acRx0buffer[SERIAL_RX_BUF_SIZE];
-static  uint8  *pcRx0Head;          // Pointer to next available unread char
-static  uint8  *pcRx0Tail;          // Pointer to next free place for writing
-static  uint8   bRx0Count;          // Number of unread chars in RX buffer
+static  volatile  uint8  bRx0Head;  // Chars read from RX buffer (written by getch only)
+static  volatile  uint8  bRx0Tail;  // Chars written to RX buffer (written by ISR only)
+
+static  uint8   acTx0buffer[SERIAL_TX_BUF_SIZE];
+static  uint8   bTx0Head;           // Index of next char to transmit
+static  uint8   bTx0Tail;           // Index of next free place for writing
+static  volatile  uint8  bTx0Count; // Number of chars waiting in TX buffer
+static  bool    yTx0Mute;           // Output discarded (broadcast command)
+
+#if RS485_SUPPORTED
+static  volatile  bool   yTxDriverOn;   // RS-485 driver enabled (bus held by this node)
+static  volatile  uint8  bLastRxTick;   // Tick count (LS byte) when last char received
+#endif
 
 /*
-|   Initialise MCU UART and enable for polled I/O.
+|   Initialise MCU UART for interrupt-driven I/O (RX and TX FIFO buffers).
 |   Called from main() before using serial port.
 |   CLOCK_FREQ and UART_BAUDRATE are defined in system.h
 |
@@ -145,7 +256,14 @@ void  init_UART( void )
 	
 	UCSR0B = (1<<RXEN0)|(1<<TXEN0);        // Enable Receiver and Transmitter
 
+#if RS485_SUPPORTED
+	RS485_DE_OFF;                          // Release the bus (receive)
+	RS485_DE_PIN_INIT;
+	yTxDriverOn = FALSE;
+#endif
 	serialRxBufferFlush();                 // Flush the serial RX FIFO buffer
+	bTx0Head = bTx0Tail = bTx0Count = 0;   // Empty the serial TX FIFO buffer
+	UART_RX_IRQctrl( ENABLE );
 }
 
 
@@ -167,28 +285,40 @@ void  UART_RX_IRQctrl( bool yIRQenab )
 |	The IRQ signals that one or more bytes have been received by the UART;
 |	the byte(s) are read out of the UART RX data register(s) and stored
 |	in the serial input RX buffer in SRAM (circular FIFO).
+|	Receive errors, and bytes dropped because the buffer is full, are posted
+|	as events to the serial event queue.
 */
 ISR ( USART0_RX_vect ) 
 {
-    while ( UART_RX_DATA_AVAIL )
-    {
-		if ( bRx0Count < SERIAL_RX_BUF_SIZE )
+	uint8  bStatus, bData;
+
+	ISRSTAT_ENTER( ISRSTAT_UART_RX );
+
+	while ( UART_RX_DATA_AVAIL )
+	{
+		bStatus = UCSR0A & ((1<<FE0)|(1<<DOR0)|(1<<UPE0));   // read before data
+		bData = UART_RX_READ_BYTE;
+		if ( bStatus )  evq_put( &gsSerialEventQ, EV_UART_RX_ERROR, ((uint16) bStatus << 8) | bData );
+		if ( (uint8) (bRx0Tail - bRx0Head) < SERIAL_RX_BUF_SIZE )
 		{
-			*pcRx0Tail++ = UART_RX_READ_BYTE;
-			if ( pcRx0Tail >= (acRx0buffer + SERIAL_RX_BUF_SIZE) )   // Wrap
-				pcRx0Tail = acRx0buffer;
-			bRx0Count++;
+			acRx0buffer[bRx0Tail & (SERIAL_RX_BUF_SIZE - 1)] = bData;
+			bRx0Tail++ ;
 		}
-    }
+		else  evq_put( &gsSerialEventQ, EV_UART_RX_LOST, bData );
+	}
+#if RS485_SUPPORTED
+	bLastRxTick = (uint8) ulClockTicks;
+#endif
+
+	ISRSTAT_EXIT( ISRSTAT_UART_RX );
 }
 
+/*
+|   Discard any unread chars in the serial RX FIFO buffer.
+*/
 void  serialRxBufferFlush( void )
 {
-	UART_RX_IRQctrl( DISABLE );
-	pcRx0Tail = acRx0buffer;
-	pcRx0Head = acRx0buffer;
-	bRx0Count = 0;
-	UART_RX_IRQctrl( ENABLE );
+	bRx0Head = bRx0Tail;
 }
 
 
@@ -198,7 +328,7 @@ void  serialRxBufferFlush( void )
 */
 bool  serialRxDataAvail( void )
 {
-	return  ( bRx0Count != 0 );
+	return  ( bRx0Head != bRx0Tail );
 }
 
 /*
@@ -213,36 +343,165 @@ bool  serialRxDataAvail( void )
 */
 uchar  getch( void )
 {
-	char  b = 0;
+	uint8  b = 0;
+	uint8  bHead = bRx0Head;
 
-	if ( bRx0Count )
+	if ( bHead != bRx0Tail )
 	{
-		UART_RX_IRQctrl( DISABLE );
-		b = *pcRx0Head++;               // Fetch char from buffer
-		--bRx0Count;
-		if ( pcRx0Head >= (acRx0buffer + SERIAL_RX_BUF_SIZE) )
-			pcRx0Head = acRx0buffer;    // Wrap pointer
-		UART_RX_IRQctrl( ENABLE );
+		b = acRx0buffer[bHead & (SERIAL_RX_BUF_SIZE - 1)];   // Fetch char from buffer
+		bRx0Head = bHead + 1;
 	}
 	return  b;
 }
 
 
+/*
+|   INTERRUPT SERVICE ROUTINE --- UART Data Register Empty ---
+|   Moves the next char from the serial output TX buffer (circular FIFO) into the
+|   UART TX data register.  When the buffer is empty, the IRQ is masked (by the ISR)
+|   until putch() puts more data into the buffer.
+*/
+ISR ( USART0_UDRE_vect )
+{
+	ISRSTAT_ENTER( ISRSTAT_UART_TX );
+
+	if ( bTx0Count != 0 )
+	{
+		UART_TX_CLEAR_DONE;             // TXC flag is set again after this char
+		UART_TX_WRITE_BYTE( acTx0buffer[bTx0Head] );
+		if ( ++bTx0Head >= SERIAL_TX_BUF_SIZE )  bTx0Head = 0;   // Wrap
+		--bTx0Count;
+	}
+	if ( bTx0Count == 0 )
+	{
+		UART_TX_IRQ_DISABLE;
+#if RS485_SUPPORTED
+		UART_TXC_IRQ_ENABLE;            // Release the bus when the last char is out
+#endif
+	}
+
+	ISRSTAT_EXIT( ISRSTAT_UART_TX );
+}
+
+
+#if RS485_SUPPORTED
+/*
+|   INTERRUPT SERVICE ROUTINE --- UART Transmit Complete --- (RS-485 only)
+|   The last char in the TX buffer has been shifted out, including the stop bit;
+|   the transceiver driver is turned off and the receiver enabled again, unless
+|   more output has been put into the buffer meanwhile.
+*/
+ISR ( USART0_TX_vect )
+{
+	UART_TXC_IRQ_DISABLE;
+	if ( bTx0Count == 0 )
+	{
+		RS485_DE_OFF;
+		UART_RX_ENABLE;
+		yTxDriverOn = FALSE;
+	}
+}
+
+
+/*
+|   The bus may be taken to transmit when the turnaround time has elapsed since
+|   the last char was received, so that the host has turned its driver off.
+*/
+static  bool  rs485_turnaround_done( void )
+{
+	return  ( (uint8) ((uint8) ulClockTicks - bLastRxTick) >= RS485_TURNAROUND_TICKS );
+}
+
+
+/*
+|   Take the bus and start transmitting from the TX buffer;  the receiver is off
+|   while transmitting.  Called with IRQs disabled, or from an ISR.
+*/
+static  void  rs485_take_bus( void )
+{
+	UART_RX_DISABLE;
+	RS485_DE_ON;
+	yTxDriverOn = TRUE;
+	UART_TX_IRQ_ENABLE;
+}
+
+
+/*
+|   Called by the tick ISR:  take the bus for output left waiting in the TX buffer
+|   by putch() until the turnaround time has elapsed.
+*/
+static  void  rs485_tick_service( void )
+{
+	if ( bTx0Count != 0 && !yTxDriverOn && rs485_turnaround_done() )  rs485_take_bus();
+}
+#endif
+
+
+/*
+|   Output to the serial port is discarded while muted -- used by the HCI
+|   so that broadcast commands get no response (see hci_exec_command).
+*/
+void  serialTxMute( bool yMute )
+{
+	yTx0Mute = yMute;
+}
+
+
+/*
+|   Function returns the number of chars which may be written to the serial
+|   TX FIFO buffer by putch() without waiting for space to become free.
+|   Protothreads should use PT_WAIT_TX() to wait for space (see pt.h).
+*/
+uint8  serialTxSpace( void )
+{
+	return  ( SERIAL_TX_BUF_SIZE - bTx0Count );
+}
+
+
 /*
 |   putch(c) - Output single char to serial port.
 |
-|   Waits for UART transmitter ready, then writes the char to the TX data register.
-|   While waiting, any pending background tasks are delayed;
-|   any currently executing task is suspended.
+|   The char is put into the serial TX FIFO buffer, from which it is sent by the
+|   UDRE interrupt.  If the buffer is full, the function waits for space;
+|   if interrupts are disabled (e.g. at startup, or by HALT), the function
+|   transmits from the buffer itself, so that it never waits forever.
 |
 |   Entry args: (uint8) b = TX byte
 |   Returns:    (uint8) b = TX byte
 */
 uchar  putch( uchar b )
 {
-	do { /* wait */ } until ( UART_TX_READY );
+	uint8  bSREG;
 
-	UART_TX_WRITE_BYTE( b );
+	if ( yTx0Mute )  return  b;
+
+	while ( bTx0Count >= SERIAL_TX_BUF_SIZE )
+	{
+		if ( (SREG & (1<<SREG_I)) == 0 && UART_TX_READY )   // IRQs off -- poll
+		{
+#if RS485_SUPPORTED
+			if ( !yTxDriverOn )  rs485_take_bus();
+#endif
+			UART_TX_CLEAR_DONE;
+			UART_TX_WRITE_BYTE( acTx0buffer[bTx0Head] );
+			if ( ++bTx0Head >= SERIAL_TX_BUF_SIZE )  bTx0Head = 0;
+			--bTx0Count;
+		}
+	}
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	acTx0buffer[bTx0Tail] = b;
+	if ( ++bTx0Tail >= SERIAL_TX_BUF_SIZE )  bTx0Tail = 0;   // Wrap
+	bTx0Count++;
+#if RS485_SUPPORTED
+	if ( yTxDriverOn )  UART_TX_IRQ_ENABLE;
+	else if ( (bSREG & (1<<SREG_I)) == 0 )  rs485_take_bus();  // Tick count frozen
+	else if ( rs485_turnaround_done() )  rs485_take_bus();
+	// else the tick ISR takes the bus when the turnaround time has elapsed
+#else
+	UART_TX_IRQ_ENABLE;
+#endif
+	SREG = bSREG;
 
 	return  b;
 }
@@ -261,7 +520,37 @@ uchar  putch( uchar b )
 */
 uint8  eeprom_read_byte( uint16 uwAddr )
 {
-	return  0xFF;   // TODO: return byte from EEPROM at uwAddr
+	do { /* wait */ } while ( EECR & (1<<EEPE) );   // Previous write in progress
+
+	EEAR = uwAddr;
+	EECR |= (1<<EERE);
+
+	return  EEDR;
+}
+
+
+/*
+|   eeprom_write_byte() - Write byte to EEPROM at offset uwAddr.
+|
+|   Waits for any previous write to complete (up to 3.4ms), then starts the write.
+|   The EEMPE/EEPE sequence is timed, so interrupts are held off while it is issued.
+|
+|   Entry args: (uint16) uwAddr = EEPROM address (offset)
+|               (uint8) bDat = value of byte to write
+*/
+void  eeprom_write_byte( uint16 uwAddr, uint8 bDat )
+{
+	uint8  bSREG;
+
+	do { /* wait */ } while ( EECR & (1<<EEPE) );   // Previous write in progress
+
+	EEAR = uwAddr;
+	EEDR = bDat;
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	EECR |= (1<<EEMPE);
+	EECR |= (1<<EEPE);
+	SREG = bSREG;
 }
 
 // end
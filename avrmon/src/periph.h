@@ -5,45 +5,124 @@
 #define  _PERIPH_H_
 
 #include "system.h"
+#include "crash.h"
 
-#define  SERIAL_RX_BUF_SIZE        64     // Serial input FIFO buffer size
+#define  SERIAL_RX_BUF_SIZE        64     // Serial input FIFO buffer size (power of 2)
+#define  SERIAL_TX_BUF_SIZE        96     // Serial output FIFO buffer size (max 255)
 #define  MSEC_PER_TICK              1     // RTI Timer tick interval, msec
 #define  TICKS_PER_200MSEC        200     // RTI Timer ticks in 200ms
 
+#if CRASH_MAILBOX_SUPPORTED
+#define  HALT(n)   { DISABLE_GLOBAL_IRQ; crash_halt( n ); PORTC = n; while (1); }  // Debug aid
+#else
 #define  HALT(n)   { DISABLE_GLOBAL_IRQ; PORTC = n; while (1); }  // Debug aid
+#endif
 
-#define  ENABLE_TICK_TIMER   (TIMSK1 |= (1<<OCIE1A))
-#define  DISABLE_TICK_TIMER  (TIMSK1 &= ~(1<<OCIE1A))
-#define  HEARTBEAT_LED_TOGL  (PORTB ^= BIT_0)		// Arduino 
+// Tick timer -- Timer2 in CTC mode, TICK_USEC_PER_COUNT usec per count
+#define  ENABLE_TICK_TIMER   (TIMSK2 |= (1<<OCIE2A))
+#define  DISABLE_TICK_TIMER  (TIMSK2 &= ~(1<<OCIE2A))
+#define  TICK_TIMER_COUNT    (TCNT2)                // Tick timer count register (8 bits)
+#define  TICK_TIMER_TOP      (OCR2A)                // Tick timer TOP (CTC) value
+#if (CLOCK_FREQ == 4000000)
+#define  TICK_USEC_PER_COUNT    8                   // Tick timer prescale = f/32
+#else
+#define  TICK_USEC_PER_COUNT    4                   // Tick timer prescale = f/64 (f/32 @ 8MHz)
+#endif
+#define  TICK_TIMER_PERIOD   (1000 * MSEC_PER_TICK / TICK_USEC_PER_COUNT)   // counts per tick
+#define  TICK_TIMER_PENDING  (TIFR2 & (1<<OCF2A))   // Tick IRQ pending (not serviced)
+
+// Timestamp timer -- Timer1 free-running (input capture, ISR stats, trace, profiler)
+#if (CLOCK_FREQ >= 16000000)
+#define  TSTAMP_PRESCALE        8                   // Timer1 prescale, 1 or 8
+#else
+#define  TSTAMP_PRESCALE        1                   // Timer1 prescale = f/1 below 16MHz
+#endif
+#define  TSTAMP_COUNT        (TCNT1)                // Timestamp timer count register
+#define  TSTAMP_COUNTS_PER_USEC   (CLOCK_FREQ / 1000000UL / TSTAMP_PRESCALE)
+#define  TSTAMP_COUNTS_PER_TICK   (CLOCK_FREQ / 1000UL * MSEC_PER_TICK / TSTAMP_PRESCALE)
+#if (TSTAMP_COUNTS_PER_USEC == 0) || (TSTAMP_COUNTS_PER_TICK > 65535)
+#error "TSTAMP_PRESCALE does not suit CLOCK_FREQ (1 or more counts per usec, 16-bit tick)"
+#endif
+#define  TSTAMP_OVF_PENDING  (TIFR1 & (1<<TOV1))    // Overflow IRQ pending (not serviced)
+#define  ENABLE_PROF_TIMER   (TIMSK1 |= (1<<OCIE1B))    // Profiler sampling IRQ
+#define  DISABLE_PROF_TIMER  (TIMSK1 &= ~(1<<OCIE1B))
+#define  PROF_TIMER_COMPARE  (OCR1B)                // Next sample time (timestamp count)
+#define  PROF_TIMER_IRQ_CLEAR  (TIFR1 = (1<<OCF1B))
+#if EVREC_SUPPORTED
+#define  HEARTBEAT_LED_INIT  (DDRD |= BIT_3)        // PB0 is the ICP1 input
+#define  HEARTBEAT_LED_TOGL  (PIND = BIT_3)         // Write PINx to toggle (atomic)
+#else
+#define  HEARTBEAT_LED_INIT  (DDRB |= BIT_0)
+#define  HEARTBEAT_LED_TOGL  (PINB = BIT_0)         // Arduino D8
+#endif
 #define  LED_7SEG_PORT       (PORTC)                // 76 leds LED driven by PORTC
+#if TWI_SUPPORTED
+#define  LED_7SEG_MASK       (0x0F)                 // PC4, PC5 are TWI SDA, SCL
+#else
+#define  LED_7SEG_MASK       (0x3F)
+#endif
 //#define  CLEAR_RESET_FLAGS   (MCUCSR &= ~0x1F)      // Clear the MCU hardware reset flags
 
+// ATmega328PB has two TWI's;  TWI0 is the ATmega328P TWI (same pins and bits)
+#ifdef   TWCR0
+#define  TWBR       TWBR0
+#define  TWSR       TWSR0
+#define  TWAR       TWAR0
+#define  TWDR       TWDR0
+#define  TWCR       TWCR0
+#ifndef  TWI_vect
+#define  TWI_vect   TWI0_vect
+#endif
+#endif
+
+// ATmega328PB has two SPI's;  SPI0 is the ATmega328P SPI (same pins and bits)
+#ifdef   SPCR0
+#define  SPCR       SPCR0
+#define  SPSR       SPSR0
+#define  SPDR       SPDR0
+#endif
+
 #define  UART_RX_DATA_AVAIL      (UCSR0A & (1<<RXC0))
 #define  UART_RX_READ_BYTE       (UDR0)
 #define  UART_TX_READY           (UCSR0A & (1<<UDRE0))
 #define  UART_TX_WRITE_BYTE(b)   (UDR0 = (b))
+#define  UART_TX_IRQ_ENABLE      (UCSR0B |= (1<<UDRIE0))
+#define  UART_TX_IRQ_DISABLE     (UCSR0B &= ~(1<<UDRIE0))
+#define  UART_TXC_IRQ_ENABLE     (UCSR0B |= (1<<TXCIE0))     // TX complete (RS-485)
+#define  UART_TXC_IRQ_DISABLE    (UCSR0B &= ~(1<<TXCIE0))
+#define  UART_TX_CLEAR_DONE      (UCSR0A = (UCSR0A & (1<<U2X0)) | (1<<TXC0))
+#define  UART_RX_ENABLE          (UCSR0B |= (1<<RXEN0))
+#define  UART_RX_DISABLE         (UCSR0B &= ~(1<<RXEN0))
 
+#define  EEPROM_WRITE_BUSY       (EECR & (1<<EEPE))     // Write in progress (3.4ms per byte)
 
-// Globals...
-extern  bool    b5msecTaskReq;
-extern  bool    b50mSecTaskReq;
-extern  bool    b500msecTaskReq;
+#define  RS485_DE_PIN_INIT       (DDRD |= BIT_2)    // RS-485 driver enable (DE, /RE) on PD2
+#define  RS485_DE_ON             (PORTD |= BIT_2)
+#define  RS485_DE_OFF            (PORTD &= ~BIT_2)
+#define  RS485_TURNAROUND_TICKS     2     // Bus turnaround, ticks (1..2ms) from last RX char
 
 
 // Peripheral device driver functions
 
 void    initMCUports( void );
 void    initMCUtimers( void );
+void    rti_tick_handler( void );
 uint32  millisec_timer( void );
+uint32  microsec_timer( void );
+uint32  tstamp_read( void );
+uint32  tstamp_extend( uint16 uwCount );
 
 void    init_UART( void );
 void    UART_RX_IRQctrl( bool );
 void    serialRxBufferFlush( void );
 bool    serialRxDataAvail( void );
 uchar   getch( void );
+uint8   serialTxSpace( void );
+void    serialTxMute( bool yMute );
 uchar   putch( uchar b );
 
 uint8   eeprom_read_byte( uint16 uwAddr );
+void    eeprom_write_byte( uint16 uwAddr, uint8 bDat );
 
 
 #endif  /* _PERIPH_H_ */
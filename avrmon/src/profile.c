@@ -0,0 +1,269 @@
+/*____________________________________________________________________________*\
+|
+|  File:        profile.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Statistical PC-sampling profiler (optional, PROFILER_SUPPORTED).
+|  The sampling ISR is "naked":  it saves the registers which a C function may
+|  clobber, reads the return address (the interrupted PC) from the stack and
+|  passes it to profile_sample(), which bins it in the histogram.  The overhead
+|  is about 100 cycles per sample, i.e. under 1% of CPU time at 16MHz.
+|  See profile.h for the histogram and sampling scheme.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "profile.h"
+
+#if PROFILER_SUPPORTED
+
+void    profile_sample( uint16 uwPC ) __attribute__ ((used));
+
+static  uint16  auwHistogram[PROF_NUM_BUCKETS];
+static  uint16  uwProfBase;             // Byte address of bucket 0
+static  uint8   ubProfShift;            // log2( bucket size, bytes )
+static  uint32  ulProfSamples;          // Samples taken, total
+static  uint32  ulProfOutside;          // Samples outside histogram range
+static  uint16  uwRandom = 0xACE1;      // Sample point generator (xorshift)
+static  bool    yProfRunning;
+static  uint8   ubDumpBucket;           // Next bucket to output ('PF D')
+
+
+/*
+|   Bin one sample -- called from the sampling ISR, with the interrupted PC
+|   (word address, as pushed by the MCU).  The next sample is set a pseudo-random
+|   interval (0.5 to 1.5 ticks) later.
+*/
+void  profile_sample( uint16 uwPC )
+{
+	uint16  uwAddr = uwPC << 1;         // byte address
+	uint16  uwBucket = (uint16) (uwAddr - uwProfBase) >> ubProfShift;
+
+	uwRandom ^= uwRandom << 7;
+	uwRandom ^= uwRandom >> 9;
+	uwRandom ^= uwRandom << 8;
+	PROF_TIMER_COMPARE = TSTAMP_COUNT + (TSTAMP_COUNTS_PER_TICK / 2)
+	                   + (uint16) (((uint32) uwRandom * TSTAMP_COUNTS_PER_TICK) >> 16);
+
+	ulProfSamples++ ;
+	if ( uwAddr < uwProfBase || uwBucket >= PROF_NUM_BUCKETS )  ulProfOutside++ ;
+	else if ( auwHistogram[uwBucket] != 0xFFFF )  auwHistogram[uwBucket]++ ;
+}
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- Timer/Counter1 Compare channel-B (profiler)
+|   The return address is at SP+16 (MS byte) and SP+17 (LS byte) after the
+|   15 bytes of saved registers and SREG.
+*/
+ISR ( TIMER1_COMPB_vect, ISR_NAKED )
+{
+	asm volatile (
+		"push  r0                \n\t"
+		"in    r0, __SREG__      \n\t"
+		"push  r0                \n\t"
+		"push  r1                \n\t"
+		"clr   r1                \n\t"
+		"push  r18               \n\t"
+		"push  r19               \n\t"
+		"push  r20               \n\t"
+		"push  r21               \n\t"
+		"push  r22               \n\t"
+		"push  r23               \n\t"
+		"push  r24               \n\t"
+		"push  r25               \n\t"
+		"push  r26               \n\t"
+		"push  r27               \n\t"
+		"push  r30               \n\t"
+		"push  r31               \n\t"
+		"in    r30, __SP_L__     \n\t"
+		"in    r31, __SP_H__     \n\t"
+		"ldd   r25, Z+16         \n\t"
+		"ldd   r24, Z+17         \n\t"
+		"call  profile_sample    \n\t"
+		"pop   r31               \n\t"
+		"pop   r30               \n\t"
+		"pop   r27               \n\t"
+		"pop   r26               \n\t"
+		"pop   r25               \n\t"
+		"pop   r24               \n\t"
+		"pop   r23               \n\t"
+		"pop   r22               \n\t"
+		"pop   r21               \n\t"
+		"pop   r20               \n\t"
+		"pop   r19               \n\t"
+		"pop   r18               \n\t"
+		"pop   r1                \n\t"
+		"pop   r0                \n\t"
+		"out   __SREG__, r0      \n\t"
+		"pop   r0                \n\t"
+		"reti                    \n\t"
+	);
+}
+
+
+/*
+|   Clear the histogram and sample counts.
+*/
+static  void  profile_clear( void )
+{
+	uint8  ubx;
+
+	DISABLE_PROF_TIMER;
+	for ( ubx = 0;  ubx < PROF_NUM_BUCKETS;  ubx++ )  auwHistogram[ubx] = 0;
+	ulProfSamples = 0;
+	ulProfOutside = 0;
+	if ( yProfRunning )  ENABLE_PROF_TIMER;
+}
+
+
+/*
+|   Read a histogram count -- not torn by the sampling ISR.
+*/
+static  uint16  profile_count( uint8 ubBucket )
+{
+	uint16  uwCount;
+
+	DISABLE_PROF_TIMER;
+	uwCount = auwHistogram[ubBucket];
+	if ( yProfRunning )  ENABLE_PROF_TIMER;
+
+	return  uwCount;
+}
+
+
+/*
+|   Output "#bbbb s nn ssssssss oooooooo" :  base address, shift, number of buckets,
+|   total samples and samples outside the range (all hex).
+*/
+static  void  profile_put_header( void )
+{
+	uint32  ulSamples, ulOutside;
+
+	DISABLE_PROF_TIMER;
+	ulSamples = ulProfSamples;
+	ulOutside = ulProfOutside;
+	if ( yProfRunning )  ENABLE_PROF_TIMER;
+
+	putch( '#' );
+	putHexWord( uwProfBase );
+	putch( SPACE );
+	putHexDigit( ubProfShift );
+	putch( SPACE );
+	putHexByte( PROF_NUM_BUCKETS );
+	putch( SPACE );
+	putHexWord( (uint16) (ulSamples >> 16) );
+	putHexWord( (uint16) ulSamples );
+	putch( SPACE );
+	putHexWord( (uint16) (ulOutside >> 16) );
+	putHexWord( (uint16) ulOutside );
+}
+
+
+static  PT_THREAD( profile_dump_thread( pt_t *pt ) )
+{
+	uint8   ubx;
+	bool    yNonZero;
+
+	PT_BEGIN( pt );
+	PT_WAIT_TX( pt, 32 );
+	profile_put_header();
+	NEW_LINE;
+
+	for ( ubDumpBucket = 0;  ubDumpBucket < PROF_NUM_BUCKETS;  ubDumpBucket += PROF_BUCKETS_PER_LINE )
+	{
+		yNonZero = FALSE;
+		for ( ubx = 0;  ubx < PROF_BUCKETS_PER_LINE;  ubx++ )
+			if ( profile_count( ubDumpBucket + ubx ) != 0 )  yNonZero = TRUE;
+		if ( !yNonZero )  continue;
+
+		PT_WAIT_TX( pt, 8 + PROF_BUCKETS_PER_LINE * 5 );
+		putHexWord( uwProfBase + ((uint16) ubDumpBucket << ubProfShift) );
+		for ( ubx = 0;  ubx < PROF_BUCKETS_PER_LINE;  ubx++ )
+		{
+			putch( SPACE );
+			putHexWord( profile_count( ubDumpBucket + ubx ) );
+		}
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'PF':  PC-sampling profiler control.
+|  Cmd format:  "PF [S [aaaa [s]] | X | C | D]"
+|
+|    PF S aaaa s  ... Start profiling (clears the histogram);  aaaa = base address
+|                     (hex, byte address in flash, default 0), s = log2 of bucket size
+|                     (hex, 1..F, default PROF_DEFAULT_SHIFT).
+|    PF X         ... Stop profiling;  the histogram is kept.
+|    PF C         ... Clear the histogram and sample counts.
+|    PF D         ... Dump the histogram:  the header line (as "PF"), then one line
+|                     "aaaa cccc cccc ..." for each group of PROF_BUCKETS_PER_LINE
+|                     buckets with a non-zero count, where aaaa = byte address of the
+|                     first bucket in the line, cccc = sample counts (all hex).
+|    PF           ... Show status:  "#bbbb s nn ssssssss oooooooo r" (see above),
+|                     where r = 1 if profiling is running.
+*/
+void  profile_cmd( void )
+{
+	char  * pcArg;
+
+	switch ( toupper( *hci_arg( 1 ) ) )
+	{
+	case 'S':
+		DISABLE_PROF_TIMER;
+		yProfRunning = FALSE;
+		uwProfBase = 0;
+		ubProfShift = PROF_DEFAULT_SHIFT;
+		pcArg = hci_arg( 2 );
+		if ( isHexDigit( *pcArg ) )  uwProfBase = hexatoi( pcArg );
+		pcArg = hci_arg( 3 );
+		if ( isHexDigit( *pcArg ) )  ubProfShift = hexctobin( *pcArg );
+		if ( ubProfShift == 0 )  { hci_put_cmd_error();  break; }
+		profile_clear();
+		yProfRunning = TRUE;
+		PROF_TIMER_COMPARE = TSTAMP_COUNT + TSTAMP_COUNTS_PER_TICK;
+		PROF_TIMER_IRQ_CLEAR;
+		ENABLE_PROF_TIMER;
+		break;
+
+	case 'X':
+		DISABLE_PROF_TIMER;
+		yProfRunning = FALSE;
+		break;
+
+	case 'C':
+		profile_clear();
+		break;
+
+	case 'D':
+		hci_spawn( profile_dump_thread );
+		break;
+
+	case NUL:
+		profile_put_header();
+		putch( SPACE );
+		putBoolean( yProfRunning );
+		break;
+
+	default:
+		hci_put_cmd_error();
+		break;
+	}
+}
+
+#else
+
+void  profile_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // PROFILER_SUPPORTED
+
+// end
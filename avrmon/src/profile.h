@@ -0,0 +1,33 @@
+/*
+*   profile.h  --  Statistical PC-sampling profiler
+*
+*   When PROFILER_SUPPORTED is TRUE (system.h), the timestamp timer's compare
+*   channel B (Timer1 COMPB) interrupts the program about once per tick, at random
+*   intervals of 0.5 to 1.5 ticks, so that samples are not synchronised with work
+*   done by the tick ISR or the scheduled tasks.  The ISR reads the interrupted program
+*   counter from the stack and counts it in a histogram over flash memory:
+*
+*       bucket = (PC byte address - base) >> shift,   0 <= bucket < PROF_NUM_BUCKETS
+*
+*   so each bucket covers (1 << shift) bytes of code, from the base address up.
+*   Samples outside the histogram range are counted separately.  Counts saturate at
+*   FFFF.  Interrupts do not nest, so time spent in other ISR's is not sampled;
+*   a sample which is due during another ISR is taken as soon as it returns.
+*
+*   'PF' commands start/stop profiling and download the histogram;  the host script
+*   host/profmap.py maps the buckets to functions using the ELF symbol table.
+*/
+#ifndef  _PROFILE_H_
+#define  _PROFILE_H_
+
+#include "system.h"
+
+#ifndef  PROF_NUM_BUCKETS              // May be set in system.h (SRAM budget)
+#define  PROF_NUM_BUCKETS      32     // Histogram size (uint16 counts)
+#endif
+#define  PROF_DEFAULT_SHIFT    10     // 1K-byte buckets, covering 32K flash
+#define  PROF_BUCKETS_PER_LINE  8     // Histogram dump format
+
+void   profile_cmd( void );
+
+#endif  /* _PROFILE_H_ */
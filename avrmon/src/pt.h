@@ -0,0 +1,90 @@
+/*
+*   pt.h  --  Protothreads: lightweight stackless coroutines
+*
+*   A protothread is an ordinary function that may block (yield) at well-defined
+*   points and be resumed there on its next call.  There is no per-thread stack;
+*   the resume point is a 16-bit "local continuation" (a source line number) held
+*   in the thread's pt_t control variable, dispatched by a switch statement.
+*
+*       static  PT_THREAD( my_thread( pt_t *pt ) )
+*       {
+*           static  uint8  n;           // state kept across yields must be static!
+*
+*           PT_BEGIN( pt );
+*           for ( n = 0;  n < 10;  n++ )
+*           {
+*               PT_WAIT_TX( pt, 8 );    // yield until 8 chars free in TX FIFO
+*               putstr( "Hello\n" );
+*           }
+*           PT_END( pt );
+*       }
+*
+*   Restrictions:  Local (auto) variables are NOT preserved across a yield;
+*   a protothread may block only in its own body (not in a function it calls);
+*   and a switch statement may not span a blocking macro.
+*
+*   The thread function returns PT_WAITING or PT_YIELDED while it is blocked,
+*   or PT_EXITED or PT_ENDED when finished, after which it is re-initialised,
+*   i.e. the next call starts it again from PT_BEGIN.
+*/
+#ifndef  _PT_H_
+#define  _PT_H_
+
+#include "system.h"
+#include "periph.h"
+
+typedef  struct  ProtoThread_t
+{
+	uint16   lc;                        // Local continuation (resume line), 0 = start
+}
+pt_t;
+
+typedef  char (* pfnthread)( pt_t * );     // pointer to protothread function
+
+// Protothread function return values
+#define  PT_WAITING    0
+#define  PT_YIELDED    1
+#define  PT_EXITED     2
+#define  PT_ENDED      3
+
+#define  PT_THREAD(name_args)   char name_args
+
+#define  PT_INIT(pt)            ((pt)->lc = 0)
+
+#define  PT_BEGIN(pt)   { char PT_YIELD_FLAG = 1;  (void) PT_YIELD_FLAG;  \
+                          switch ( (pt)->lc ) { case 0:
+
+#define  PT_END(pt)     } PT_YIELD_FLAG = 0;  PT_INIT(pt);  return PT_ENDED; }
+
+// Block until the condition is true (returns at once if already true)
+#define  PT_WAIT_UNTIL(pt, cond)  \
+	do { (pt)->lc = __LINE__;  case __LINE__:  if ( !(cond) ) return PT_WAITING; } while (0)
+
+#define  PT_WAIT_WHILE(pt, cond)   PT_WAIT_UNTIL( (pt), !(cond) )
+
+// Block until a child protothread has finished
+#define  PT_WAIT_THREAD(pt, thread)   PT_WAIT_WHILE( (pt), PT_SCHEDULE(thread) )
+
+// Give way to other threads once, unconditionally
+#define  PT_YIELD(pt)  \
+	do { PT_YIELD_FLAG = 0;  (pt)->lc = __LINE__;  \
+	     case __LINE__:  if ( PT_YIELD_FLAG == 0 ) return PT_YIELDED; } while (0)
+
+#define  PT_EXIT(pt)        do { PT_INIT(pt);  return PT_EXITED; } while (0)
+#define  PT_RESTART(pt)     do { PT_INIT(pt);  return PT_WAITING; } while (0)
+
+// True while the thread (function call) has not finished
+#define  PT_SCHEDULE(f)     ((f) < PT_EXITED)
+
+// Block for a number of msec;  ulTimer is a static uint32 owned by the thread
+#define  PT_DELAY(pt, ulTimer, ms)  \
+	do { (ulTimer) = millisec_timer();  \
+	     PT_WAIT_UNTIL( (pt), (millisec_timer() - (ulTimer)) >= (ms) ); } while (0)
+
+// Block until there is space for n chars in the serial TX FIFO
+#define  PT_WAIT_TX(pt, n)       PT_WAIT_UNTIL( (pt), serialTxSpace() >= (n) )
+
+// Block until there is input available in the serial RX FIFO
+#define  PT_WAIT_RX(pt)          PT_WAIT_UNTIL( (pt), serialRxDataAvail() )
+
+#endif  /* _PT_H_ */
@@ -0,0 +1,145 @@
+/*____________________________________________________________________________*\
+|
+|  File:        snapshot.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Atomic multi-region data memory snapshot (optional, SNAPSHOT_SUPPORTED).
+|  The regions are copied in one critical section and streamed from the buffer
+|  by a command protothread.  See snapshot.h for the command format.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "snapshot.h"
+
+#if SNAPSHOT_SUPPORTED
+
+// Snapshot region -- data space address and byte count
+struct  SnapRegion_t
+{
+	uint16   uwAddr;
+	uint8    ubCount;
+};
+
+static  struct  SnapRegion_t  asSnapRegion[SNAP_MAX_REGIONS];
+static  uint8   aubSnapBuf[SNAP_BUF_SIZE];
+static  uint8   ubSnapRegions;          // Number of regions
+static  uint16  uwSnapTotal;            // Bytes in buffer
+static  uint32  ulSnapStamp;            // Timestamp of copy
+static  uint8   ubOutRegion;            // Next region to output
+static  uint8   ubOutOffset;            // Next byte to output, in region
+static  uint16  uwOutIndex;             // Next byte to output, in buffer
+
+
+/*
+|   Copy the regions into the buffer -- interrupts are disabled throughout.
+*/
+static  void  snapshot_copy( void )
+{
+	uint8  *pubDst = aubSnapBuf;
+	uint8  *pubSrc;
+	uint8   ubRegion;
+	uint8   ubCount;
+	uint8   bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	ulSnapStamp = tstamp_extend( TSTAMP_COUNT );
+	for ( ubRegion = 0;  ubRegion < ubSnapRegions;  ubRegion++ )
+	{
+		pubSrc = (uint8 *) asSnapRegion[ubRegion].uwAddr;
+		for ( ubCount = asSnapRegion[ubRegion].ubCount;  ubCount != 0;  ubCount-- )
+		{
+			*pubDst++ = ( pubSrc == &UDR0 ) ? 0 : *pubSrc;
+			pubSrc++ ;
+		}
+	}
+	SREG = bSREG;
+}
+
+
+static  PT_THREAD( snapshot_thread( pt_t *pt ) )
+{
+	uint8   ubCount;
+
+	PT_BEGIN( pt );
+	PT_WAIT_TX( pt, 16 );
+	putch( '#' );
+	putHexWord( (uint16) (ulSnapStamp >> 16) );
+	putHexWord( (uint16) ulSnapStamp );
+	putch( SPACE );
+	putHexWord( uwSnapTotal );
+	NEW_LINE;
+
+	uwOutIndex = 0;
+	for ( ubOutRegion = 0;  ubOutRegion < ubSnapRegions;  ubOutRegion++ )
+	{
+		for ( ubOutOffset = 0;  ubOutOffset < asSnapRegion[ubOutRegion].ubCount; )
+		{
+			PT_WAIT_TX( pt, 8 + SNAP_BYTES_PER_LINE * 2 );
+			putHexWord( asSnapRegion[ubOutRegion].uwAddr + ubOutOffset );
+			putch( SPACE );
+			for ( ubCount = 0;  ubCount < SNAP_BYTES_PER_LINE;  ubCount++ )
+			{
+				putHexByte( aubSnapBuf[uwOutIndex++] );
+				if ( ++ubOutOffset == asSnapRegion[ubOutRegion].ubCount )  break;
+			}
+			NEW_LINE;
+		}
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'SN':  Snapshot data memory regions.
+|  Cmd format:  "SN aaa nn [aaa nn ..]"  -- aaa = data space address, nn = byte
+|  count (hex, 01..FF), for up to SNAP_MAX_REGIONS regions of SNAP_BUF_SIZE bytes
+|  in total.  See snapshot.h for the response format.
+*/
+void  snapshot_cmd( void )
+{
+	char  * pcAddr;
+	char  * pcCount;
+	uint8   ubCount;
+
+	ubSnapRegions = 0;
+	uwSnapTotal = 0;
+	while ( TRUE )
+	{
+		pcAddr = hci_arg( ubSnapRegions * 2 + 1 );
+		pcCount = hci_arg( ubSnapRegions * 2 + 2 );
+		if ( *pcAddr == NUL )  break;
+		ubCount = (uint8) hexatoi( pcCount );
+		if ( ubSnapRegions == SNAP_MAX_REGIONS || !isHexDigit( *pcAddr ) || !isHexDigit( *pcCount )
+		||   hexatoi( pcCount ) > 0xFF || ubCount == 0 || uwSnapTotal + ubCount > SNAP_BUF_SIZE )
+		{
+			hci_put_cmd_error();
+			return;
+		}
+		asSnapRegion[ubSnapRegions].uwAddr = hexatoi( pcAddr );
+		asSnapRegion[ubSnapRegions].ubCount = ubCount;
+		uwSnapTotal += ubCount;
+		ubSnapRegions++ ;
+	}
+	if ( ubSnapRegions == 0 )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	snapshot_copy();
+	hci_spawn( snapshot_thread );
+}
+
+#else
+
+void  snapshot_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // SNAPSHOT_SUPPORTED
+
+// end
@@ -0,0 +1,35 @@
+/*
+*   snapshot.h  --  Atomic multi-region data memory snapshot ('SN')
+*
+*   'SN aaa nn [aaa nn ..]' copies up to SNAP_MAX_REGIONS regions of data space
+*   (registers, I/O registers, SRAM) into a buffer with interrupts disabled, so the
+*   regions are captured at the same instant and multi-byte variables updated by
+*   ISR's are consistent;  the buffer is then output in the background.  The copy
+*   takes about 6 cycles per byte, i.e. under 100us for the whole buffer at 16MHz.
+*   For example, the Timer1 registers and a 32-bit variable:
+*
+*       SN 080 0C 1A4 04
+*
+*   UDR0 is not read (reading it would remove a received character);  it shows as 00.
+*   Other registers are read in ascending address order, so 16-bit timer registers
+*   are read low byte first, as they must be.
+*
+*   Response:  a header line "#tttttttt nnnn", then for each region, lines of up to
+*   SNAP_BYTES_PER_LINE bytes:  "aaaa bbbbbb..." -- address of the first byte in the
+*   line, then the byte values, all hex.  tttttttt = timestamp timer count at the
+*   copy (see periph.h), nnnn = total number of bytes.
+*/
+#ifndef  _SNAPSHOT_H_
+#define  _SNAPSHOT_H_
+
+#include "system.h"
+
+#ifndef  SNAP_BUF_SIZE                 // May be set in system.h (SRAM budget)
+#define  SNAP_BUF_SIZE         64     // Snapshot buffer (bytes, all regions)
+#endif
+#define  SNAP_MAX_REGIONS       8     // Regions per command (fits command line)
+#define  SNAP_BYTES_PER_LINE   32     // Output format
+
+void   snapshot_cmd( void );
+
+#endif  /* _SNAPSHOT_H_ */
@@ -0,0 +1,459 @@
+/*____________________________________________________________________________*\
+|
+|  File:        spi.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  SPI master driver and JEDEC serial flash functions (optional, SPI_SUPPORTED),
+|  with the SPI transfer command 'SX' and the flash commands 'FI', 'FR', 'FP'
+|  and 'FE'.  Transfers are polled (see spi.h);  flash erase, which takes up to
+|  seconds, is waited for in a command protothread, so the main loop keeps running.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "strtab.h"
+#include  "spi.h"
+
+#if SPI_SUPPORTED
+
+#define  SPI_CS_MASK     (BIT_1 | BIT_2)        // Chip-select outputs on port B
+#define  SPI_OUT_MASK    (BIT_3 | BIT_5)        // MOSI, SCK
+#define  SPI_WAIT_DONE   while ( (SPSR & (1<<SPIF)) == 0 )
+
+#define  FLASH_BYTES_PER_LINE   32      // 'FR' output, machine mode
+#define  FLASH_DUMP_PER_LINE    16      // 'FR' output, interactive mode
+
+static  const  uint8  aubChipSelect[SPI_NUM_CS] = { BIT_2, BIT_1 };
+
+static  uint8   abSpiData[FLASH_BYTES_PER_LINE];   // Command data buffer
+
+
+void  spi_init( void )
+{
+	PORTB |= SPI_CS_MASK;                       // Deselect all
+	DDRB |= SPI_CS_MASK | SPI_OUT_MASK;
+	SPCR = (1<<SPE) | (1<<MSTR);                // Master, mode 0, MSB first
+	SPSR = (1<<SPI2X);                          // SCK = f/2
+}
+
+
+void  spi_select( uint8 ubCS )
+{
+	PORTB &= ~aubChipSelect[ubCS];
+}
+
+
+void  spi_deselect( void )
+{
+	PORTB |= SPI_CS_MASK;
+}
+
+
+uint8  spi_transfer_byte( uint8 ubData )
+{
+	SPDR = ubData;
+	SPI_WAIT_DONE;
+	return  SPDR;
+}
+
+
+/*
+|   Full-duplex transfer:  each byte of pbData[] is sent and replaced by the
+|   byte received.
+*/
+void  spi_transfer( uint8 *pbData, uint8 ubCount )
+{
+	while ( ubCount-- != 0 )
+	{
+		SPDR = *pbData;
+		SPI_WAIT_DONE;
+		*pbData++ = SPDR;
+	}
+}
+
+
+/*
+|   Read ubCount bytes into pbData[], sending 0xFF.
+*/
+void  spi_read( uint8 *pbData, uint8 ubCount )
+{
+	while ( ubCount-- != 0 )
+	{
+		SPDR = 0xFF;
+		SPI_WAIT_DONE;
+		*pbData++ = SPDR;
+	}
+}
+
+
+/*____________________________________________________________________________*\
+|
+|   JEDEC serial flash functions (flash on SPI_FLASH_CS)
+\*____________________________________________________________________________*/
+
+/*
+|   Select the flash and send a command with a 24-bit address.
+*/
+static  void  spi_flash_command( uint8 ubCmd, uint32 ulAddr )
+{
+	spi_select( SPI_FLASH_CS );
+	spi_transfer_byte( ubCmd );
+	spi_transfer_byte( (uint8) (ulAddr >> 16) );
+	spi_transfer_byte( (uint8) (ulAddr >> 8) );
+	spi_transfer_byte( (uint8) ulAddr );
+}
+
+
+static  void  spi_flash_write_enable( void )
+{
+	spi_select( SPI_FLASH_CS );
+	spi_transfer_byte( FLASH_CMD_WRITE_EN );
+	spi_deselect();
+}
+
+
+/*
+|   Returns TRUE while a program or erase operation is in progress.
+*/
+bool  spi_flash_busy( void )
+{
+	uint8  ubStatus;
+
+	spi_select( SPI_FLASH_CS );
+	spi_transfer_byte( FLASH_CMD_READ_SR );
+	ubStatus = spi_transfer_byte( 0xFF );
+	spi_deselect();
+
+	return  ( ubStatus & FLASH_SR_BUSY ) != 0;
+}
+
+
+void  spi_flash_read( uint32 ulAddr, uint8 *pbData, uint8 ubCount )
+{
+	spi_flash_command( FLASH_CMD_READ, ulAddr );
+	spi_read( pbData, ubCount );
+	spi_deselect();
+}
+
+
+/*
+|   Program ubCount bytes at ulAddr (which must have been erased), splitting the
+|   data at page boundaries.  Waits for each page program to finish (about 1ms).
+|   Returns FALSE if the flash is busy, or a page program times out.
+*/
+bool  spi_flash_program( uint32 ulAddr, const uint8 *pbData, uint8 ubCount )
+{
+	uint32  ulStart;
+	uint16  uwChunk;
+
+	if ( spi_flash_busy() )  return  FALSE;
+
+	while ( ubCount != 0 )
+	{
+		uwChunk = SPI_FLASH_PAGE_SIZE - (uint8) ulAddr;     // to end of page
+		if ( uwChunk > ubCount )  uwChunk = ubCount;
+
+		spi_flash_write_enable();
+		spi_flash_command( FLASH_CMD_PROGRAM, ulAddr );
+		ulAddr += uwChunk;
+		ubCount -= uwChunk;
+		while ( uwChunk-- != 0 )  spi_transfer_byte( *pbData++ );
+		spi_deselect();
+
+		ulStart = millisec_timer();
+		while ( spi_flash_busy() )
+		{
+			if ( millisec_timer() - ulStart >= SPI_PROGRAM_TIMEOUT )  return  FALSE;
+		}
+	}
+	return  TRUE;
+}
+
+
+/*
+|   Start erasing the sector or block at ulAddr;  ubCmd is FLASH_CMD_ERASE_4K,
+|   _32K or _64K.  The caller polls spi_flash_busy() for completion.
+*/
+void  spi_flash_erase( uint32 ulAddr, uint8 ubCmd )
+{
+	spi_flash_write_enable();
+	spi_flash_command( ubCmd, ulAddr );
+	spi_deselect();
+}
+
+
+/*____________________________________________________________________________*\
+|
+|   SPI and flash monitor commands
+\*____________________________________________________________________________*/
+
+static  uint32  ulFlashAddr;            // 'FR' next address
+static  uint16  uwFlashCount;           // 'FR' bytes remaining
+static  uint32  ulFlashTimer;           // 'FE' start time
+
+/*
+|   Get a 24-bit flash address (hex) from command argument n into *pulAddr.
+*/
+static  bool  flash_get_addr( uint8 n, uint32 *pulAddr )
+{
+	char  * pcArg = hci_arg( n );
+	uint8   ubDigits = 0;
+
+	*pulAddr = 0;
+	while ( isHexDigit( *pcArg ) )
+	{
+		if ( ++ubDigits > 6 )  return  FALSE;
+		*pulAddr = (*pulAddr << 4) | hexctobin( *pcArg++ );
+	}
+	return  ( ubDigits != 0 );
+}
+
+
+/*
+|   Get data bytes (hex) from command arguments n, n+1, ... into abSpiData[].
+|   Returns the number of bytes, or 0xFF if an argument is not a byte value.
+*/
+static  uint8  spi_get_data( uint8 n )
+{
+	char  * pcArg;
+	uint8   ubCount = 0;
+
+	for ( pcArg = hci_arg( n );  isHexDigit( *pcArg ) && ubCount < sizeof(abSpiData);
+	      pcArg = hci_arg( n + ubCount ) )
+	{
+		if ( hexatoi( pcArg ) > 0xFF )  return  0xFF;
+		abSpiData[ubCount++] = (uint8) hexatoi( pcArg );
+	}
+	return  ubCount;
+}
+
+
+/*
+|  Command function 'SX':  SPI full-duplex transfer.
+|  Cmd format:  "SX c bb [bb ...]"
+|
+|  Selects chip c (0..SPI_NUM_CS-1), sends the bytes bb (hex), then deselects it.
+|  Response:  the bytes received, "bb bb ...".
+*/
+void  spi_transfer_cmd( void )
+{
+	char  * pcArg = hci_arg( 1 );
+	uint8   ubCS = hexctobin( *pcArg );
+	uint8   ubCount = spi_get_data( 2 );
+	uint8   ubx;
+
+	if ( !isHexDigit( *pcArg ) || ubCS >= SPI_NUM_CS || ubCount == 0 || ubCount == 0xFF )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	spi_select( ubCS );
+	spi_transfer( abSpiData, ubCount );
+	spi_deselect();
+
+	for ( ubx = 0;  ubx < ubCount;  ubx++ )
+	{
+		if ( ubx != 0 || hci_interactive() )  putch( SPACE );
+		putHexByte( abSpiData[ubx] );
+	}
+}
+
+
+/*
+|  Command function 'FI':  Flash identification.
+|  Cmd format:  "FI"
+|
+|  Response:  "mm dddd ss" -- JEDEC manufacturer ID, device ID and status register.
+*/
+void  flash_id_cmd( void )
+{
+	abSpiData[0] = FLASH_CMD_READ_ID;
+	abSpiData[1] = abSpiData[2] = abSpiData[3] = 0xFF;
+	spi_select( SPI_FLASH_CS );
+	spi_transfer( abSpiData, 4 );
+	spi_deselect();
+
+	if ( hci_interactive() )  putch( SPACE );
+	putHexByte( abSpiData[1] );
+	putch( SPACE );
+	putHexByte( abSpiData[2] );
+	putHexByte( abSpiData[3] );
+	putch( SPACE );
+	spi_select( SPI_FLASH_CS );
+	spi_transfer_byte( FLASH_CMD_READ_SR );
+	putHexByte( spi_transfer_byte( 0xFF ) );
+	spi_deselect();
+}
+
+
+static  PT_THREAD( flash_read_thread( pt_t *pt ) )
+{
+	static  uint8  ubLineCount;
+	uint8   ubx;
+
+	PT_BEGIN( pt );
+	while ( uwFlashCount != 0 )
+	{
+		ubLineCount = hci_interactive() ? FLASH_DUMP_PER_LINE : FLASH_BYTES_PER_LINE;
+		if ( ubLineCount > uwFlashCount )  ubLineCount = (uint8) uwFlashCount;
+		PT_WAIT_TX( pt, FLASH_DUMP_PER_LINE * 4 + 12 );
+
+		spi_flash_read( ulFlashAddr, abSpiData, ubLineCount );
+		if ( hci_interactive() )    // Dump layout, as 'DD', with 24-bit address
+		{
+			putHexByte( (uint8) (ulFlashAddr >> 16) );
+			putHexWord( (uint16) ulFlashAddr );
+			putch( SPACE );
+			for ( ubx = 0;  ubx < ubLineCount;  ubx++ )
+			{
+				putch( SPACE );
+				if ( ubx == 8 )  putch( SPACE );
+				putHexByte( abSpiData[ubx] );
+			}
+			putch( SPACE );
+			putch( SPACE );
+			for ( ubx = 0;  ubx < ubLineCount;  ubx++ )
+			{
+				if ( abSpiData[ubx] >= 32 && abSpiData[ubx] < 127 )  putch( abSpiData[ubx] );
+				else  putch( SPACE );
+			}
+		}
+		else  for ( ubx = 0;  ubx < ubLineCount;  ubx++ )  putHexByte( abSpiData[ubx] );
+
+		ulFlashAddr += ubLineCount;
+		uwFlashCount -= ubLineCount;
+		if ( uwFlashCount != 0 )  NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'FR':  Flash read.
+|  Cmd format:  "FR aaaaaa [nnnn]"
+|
+|  Reads nnnn bytes (hex, default 100) from flash address aaaaaa (hex).
+|  Response, machine mode:  lines of up to 32 bytes as hex pairs, without spaces
+|  or addresses (64 hex digits per line).  Interactive mode:  a dump as 'DD'.
+|  The command fails if the flash is busy (erasing).
+*/
+void  flash_read_cmd( void )
+{
+	char  * pcArg = hci_arg( 2 );
+
+	if ( !flash_get_addr( 1, &ulFlashAddr ) || spi_flash_busy() )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	uwFlashCount = 0x100;
+	if ( isHexDigit( *pcArg ) )  uwFlashCount = hexatoi( pcArg );
+	hci_spawn( flash_read_thread );
+}
+
+
+/*
+|  Command function 'FP':  Flash program.
+|  Cmd format:  "FP aaaaaa bb [bb ...]"
+|
+|  Programs the bytes bb (hex) at flash address aaaaaa (hex), which must have
+|  been erased.  Larger images are loaded with 'XL F' (Intel HEX).
+*/
+void  flash_program_cmd( void )
+{
+	uint32  ulAddr;
+	uint8   ubCount = spi_get_data( 2 );
+
+	if ( !flash_get_addr( 1, &ulAddr ) || ubCount == 0 || ubCount == 0xFF
+	||   !spi_flash_program( ulAddr, abSpiData, ubCount ) )
+	{
+		hci_put_cmd_error();
+	}
+}
+
+
+static  PT_THREAD( flash_erase_thread( pt_t *pt ) )
+{
+	PT_BEGIN( pt );
+	PT_WAIT_UNTIL( pt, !spi_flash_busy() || (millisec_timer() - ulFlashTimer) >= SPI_ERASE_TIMEOUT );
+	ulFlashTimer = millisec_timer() - ulFlashTimer;
+	PT_WAIT_TX( pt, 12 );
+	if ( ulFlashTimer >= SPI_ERASE_TIMEOUT )  hci_put_cmd_error();
+	else if ( hci_interactive() )
+	{
+		putmsg( STR_XFER_TIME );
+		putDecWord( (uint16) ulFlashTimer, 5 );
+		putmsg( STR_UNIT_MS );
+	}
+	else  putHexWord( (uint16) ulFlashTimer );
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'FE':  Flash erase.
+|  Cmd format:  "FE aaaaaa [kk]"
+|
+|  Erases the sector or block containing flash address aaaaaa (hex);  kk is the
+|  size in Kbytes (hex):  04 (default), 20 or 40.
+|  Response:  "tttt", the erase time in msec (hex;  decimal in interactive mode).
+*/
+void  flash_erase_cmd( void )
+{
+	char  * pcArg = hci_arg( 2 );
+	uint32  ulAddr;
+	uint8   ubCmd = FLASH_CMD_ERASE_4K;
+
+	if ( isHexDigit( *pcArg ) )
+	{
+		switch ( hexatoi( pcArg ) )
+		{
+		case 0x04:  ubCmd = FLASH_CMD_ERASE_4K;   break;
+		case 0x20:  ubCmd = FLASH_CMD_ERASE_32K;  break;
+		case 0x40:  ubCmd = FLASH_CMD_ERASE_64K;  break;
+		default:    ubCmd = 0;  break;
+		}
+	}
+	if ( !flash_get_addr( 1, &ulAddr ) || ubCmd == 0 || spi_flash_busy() )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	spi_flash_erase( ulAddr, ubCmd );
+	ulFlashTimer = millisec_timer();
+	hci_spawn( flash_erase_thread );
+}
+
+#else
+
+void  spi_transfer_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  flash_id_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  flash_read_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  flash_program_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  flash_erase_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // SPI_SUPPORTED
+
+// end
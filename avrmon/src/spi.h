@@ -0,0 +1,61 @@
+/*
+*   spi.h  --  SPI master driver, and JEDEC serial flash access
+*
+*   The SPI runs in master mode 0 at the maximum clock, f/2 (8MHz).  At that rate
+*   a byte takes 16 CPU cycles, less than the overhead of an interrupt, so the
+*   driver uses a tight polled loop:  a burst goes at nearly 1 Mbyte/sec.
+*
+*   Devices are selected by chip-select outputs on port B, active low:
+*   CS0 on PB2 (SS -- which must be an output in master mode), CS1 on PB1.
+*   MOSI, MISO and SCK are PB3, PB4 and PB5 (Arduino D11..D13).
+*
+*   A JEDEC serial flash (W25Qxx, AT25SF, MX25L, etc) is assumed to be on CS0.
+*   The spi_flash_* functions use the common command set:  read ID (9F), read
+*   status (05), write enable (06), read (03), page program (02) and sector/block
+*   erase (20, 52, D8);  addresses are 24 bits.
+*
+*   'SX' does a full-duplex transfer with any device;  'FI', 'FR', 'FP', 'FE'
+*   identify, read, program and erase the flash.  'XL F' loads Intel HEX records
+*   into the flash (see cmnd.c).
+*/
+#ifndef  _SPI_H_
+#define  _SPI_H_
+
+#include "system.h"
+
+#define  SPI_NUM_CS             2     // Chip-select outputs
+#define  SPI_FLASH_CS           0     // Chip select of serial flash
+#define  SPI_FLASH_PAGE_SIZE  256     // Page program limit (bytes)
+#define  SPI_PROGRAM_TIMEOUT   10     // Page program time limit (msec)
+#define  SPI_ERASE_TIMEOUT   3000     // Sector/block erase time limit (msec)
+
+// JEDEC serial flash commands
+#define  FLASH_CMD_READ_ID     0x9F
+#define  FLASH_CMD_READ_SR     0x05
+#define  FLASH_CMD_WRITE_EN    0x06
+#define  FLASH_CMD_READ        0x03
+#define  FLASH_CMD_PROGRAM     0x02
+#define  FLASH_CMD_ERASE_4K    0x20
+#define  FLASH_CMD_ERASE_32K   0x52
+#define  FLASH_CMD_ERASE_64K   0xD8
+#define  FLASH_SR_BUSY         BIT_0  // Status register:  write/erase in progress
+
+void   spi_init( void );
+void   spi_select( uint8 ubCS );
+void   spi_deselect( void );
+uint8  spi_transfer_byte( uint8 ubData );
+void   spi_transfer( uint8 *pbData, uint8 ubCount );       // full duplex, in place
+void   spi_read( uint8 *pbData, uint8 ubCount );
+
+bool   spi_flash_busy( void );
+void   spi_flash_read( uint32 ulAddr, uint8 *pbData, uint8 ubCount );
+bool   spi_flash_program( uint32 ulAddr, const uint8 *pbData, uint8 ubCount );
+void   spi_flash_erase( uint32 ulAddr, uint8 ubCmd );       // starts erase only
+
+void   spi_transfer_cmd( void );
+void   flash_id_cmd( void );
+void   flash_read_cmd( void );
+void   flash_program_cmd( void );
+void   flash_erase_cmd( void );
+
+#endif  /* _SPI_H_ */
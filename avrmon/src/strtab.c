@@ -0,0 +1,254 @@
+/*
+*   strtab.c  --  Compressed message string table
+*
+*   GENERATED by host/mkstrtab.py from strtab.txt and cmdtab.h -- do not edit.
+*
+*   77 strings, 2143 bytes;  packed to 1518 bytes (data 1108, dictionary 256, index 154).
+*/
+#include "system.h"
+#include "strtab.h"
+
+// Token 0x80 + n expands to the pair aubStrDict[n]
+const  uint8  aubStrDict[][2] PROGMEM =
+{
+	{ 0x20, 0x20 },   // 80 "  "
+	{ 0x7C, 0x20 },   // 81 "| "
+	{ 0x80, 0x80 },   // 82 "    "
+	{ 0x20, 0x5B },   // 83 " ["
+	{ 0x61, 0x61 },   // 84 "aa"
+	{ 0x20, 0x81 },   // 85 " | "
+	{ 0x82, 0x81 },   // 86 "    | "
+	{ 0x65, 0x20 },   // 87 "e "
+	{ 0x74, 0x20 },   // 88 "t "
+	{ 0x5D, 0x85 },   // 89 "] | "
+	{ 0x82, 0x86 },   // 8A "        | "
+	{ 0x61, 0x72 },   // 8B "ar"
+	{ 0x65, 0x72 },   // 8C "er"
+	{ 0x72, 0x65 },   // 8D "re"
+	{ 0x61, 0x74 },   // 8E "at"
+	{ 0x20, 0x84 },   // 8F " aa"
+	{ 0x6F, 0x72 },   // 90 "or"
+	{ 0x6E, 0x6E },   // 91 "nn"
+	{ 0x29, 0x0A },   // 92 ")\n"
+	{ 0x76, 0x76 },   // 93 "vv"
+	{ 0x6D, 0x6D },   // 94 "mm"
+	{ 0x3D, 0x20 },   // 95 "= "
+	{ 0x73, 0x74 },   // 96 "st"
+	{ 0x64, 0x20 },   // 97 "d "
+	{ 0x49, 0x20 },   // 98 "I "
+	{ 0x61, 0x20 },   // 99 "a "
+	{ 0x6F, 0x6E },   // 9A "on"
+	{ 0x69, 0x74 },   // 9B "it"
+	{ 0x68, 0x20 },   // 9C "h "
+	{ 0x20, 0x95 },   // 9D " = "
+	{ 0x65, 0x0A },   // 9E "e\n"
+	{ 0x61, 0x73 },   // 9F "as"
+	{ 0x75, 0x6D },   // A0 "um"
+	{ 0xA0, 0x70 },   // A1 "ump"
+	{ 0x72, 0x72 },   // A2 "rr"
+	{ 0x2E, 0x2E },   // A3 ".."
+	{ 0x52, 0x65 },   // A4 "Re"
+	{ 0x8C, 0x20 },   // A5 "er "
+	{ 0x6E, 0x88 },   // A6 "nt "
+	{ 0x65, 0x6D },   // A7 "em"
+	{ 0x8F, 0x84 },   // A8 " aaaa"
+	{ 0x74, 0x74 },   // A9 "tt"
+	{ 0x53, 0x74 },   // AA "St"
+	{ 0x79, 0x20 },   // AB "y "
+	{ 0x62, 0x62 },   // AC "bb"
+	{ 0x69, 0x96 },   // AD "ist"
+	{ 0x3A, 0x20 },   // AE ": "
+	{ 0x30, 0x30 },   // AF "00"
+	{ 0x73, 0x0A },   // B0 "s\n"
+	{ 0x20, 0x70 },   // B1 " p"
+	{ 0x83, 0x43 },   // B2 " [C"
+	{ 0x44, 0xA1 },   // B3 "Dump"
+	{ 0x56, 0x8B },   // B4 "Var"
+	{ 0xB4, 0x69 },   // B5 "Vari"
+	{ 0xB5, 0x61 },   // B6 "Varia"
+	{ 0xB6, 0x62 },   // B7 "Variab"
+	{ 0xB7, 0x6C },   // B8 "Variabl"
+	{ 0x8D, 0x67 },   // B9 "reg"
+	{ 0x54, 0x57 },   // BA "TW"
+	{ 0x6F, 0x64 },   // BB "od"
+	{ 0x53, 0x8A },   // BC "S        | "
+	{ 0x83, 0x91 },   // BD " [nn"
+	{ 0x46, 0x6C },   // BE "Fl"
+	{ 0x8E, 0x63 },   // BF "atc"
+	{ 0x9F, 0x9C },   // C0 "ash "
+	{ 0x6C, 0x65 },   // C1 "le"
+	{ 0xC1, 0x8B },   // C2 "lear"
+	{ 0xA4, 0x61 },   // C3 "Rea"
+	{ 0xB8, 0x87 },   // C4 "Variable "
+	{ 0x69, 0x69 },   // C5 "ii"
+	{ 0xA3, 0x89 },   // C6 "..] | "
+	{ 0x28, 0x73 },   // C7 "(s"
+	{ 0x53, 0x50 },   // C8 "SP"
+	{ 0xC8, 0x98 },   // C9 "SPI "
+	{ 0x61, 0x6E },   // CA "an"
+	{ 0x63, 0x90 },   // CB "cor"
+	{ 0xCB, 0x64 },   // CC "cord"
+	{ 0xBA, 0x98 },   // CD "TWI "
+	{ 0x80, 0x81 },   // CE "  | "
+	{ 0x49, 0x6E },   // CF "In"
+	{ 0x68, 0x6F },   // D0 "ho"
+	{ 0x77, 0x20 },   // D1 "w "
+	{ 0x69, 0x9A },   // D2 "ion"
+	{ 0xA7, 0x0A },   // D3 "em\n"
+	{ 0x57, 0xBF },   // D4 "Watc"
+	{ 0x82, 0x85 },   // D5 "     | "
+	{ 0xC3, 0x97 },   // D6 "Read "
+	{ 0x8F, 0x99 },   // D7 " aaa "
+	{ 0x57, 0x72 },   // D8 "Wr"
+	{ 0xD8, 0x9B },   // D9 "Writ"
+	{ 0xD9, 0x87 },   // DA "Write "
+	{ 0x7C, 0x46 },   // DB "|F"
+	{ 0x93, 0x93 },   // DC "vvvv"
+	{ 0xAD, 0x0A },   // DD "ist\n"
+	{ 0x74, 0x2F },   // DE "t/"
+	{ 0x20, 0xA2 },   // DF " rr"
+	{ 0xC9, 0xBE },   // E0 "SPI Fl"
+	{ 0xE0, 0xC0 },   // E1 "SPI Flash "
+	{ 0x45, 0x76 },   // E2 "Ev"
+	{ 0xE2, 0x65 },   // E3 "Eve"
+	{ 0xE3, 0xA6 },   // E4 "Event "
+	{ 0x7C, 0x44 },   // E5 "|D"
+	{ 0x52, 0x4F },   // E6 "RO"
+	{ 0x53, 0x20 },   // E7 "S "
+	{ 0x64, 0x75 },   // E8 "du"
+	{ 0x6F, 0x20 },   // E9 "o "
+	{ 0x90, 0x20 },   // EA "or "
+	{ 0x45, 0xA2 },   // EB "Err"
+	{ 0xEB, 0x90 },   // EC "Error"
+	{ 0x42, 0x20 },   // ED "B "
+	{ 0x4C, 0x69 },   // EE "Li"
+	{ 0x76, 0x87 },   // EF "ve "
+	{ 0x20, 0x48 },   // F0 " H"
+	{ 0xCF, 0x74 },   // F1 "Int"
+	{ 0x61, 0x63 },   // F2 "ac"
+	{ 0x8A, 0x53 },   // F3 "        | S"
+	{ 0xF3, 0xD0 },   // F4 "        | Sho"
+	{ 0xF4, 0xD1 },   // F5 "        | Show "
+	{ 0x73, 0x20 },   // F6 "s "
+	{ 0x61, 0x67 },   // F7 "ag"
+	{ 0x44, 0x8A },   // F8 "D        | "
+	{ 0x5D, 0x89 },   // F9 "]] | "
+	{ 0x8E, 0x99 },   // FA "ata "
+	{ 0xFA, 0x6D },   // FB "ata m"
+	{ 0xD4, 0x68 },   // FC "Watch"
+	{ 0x6F, 0x67 },   // FD "og"
+	{ 0xAA, 0x8E },   // FE "Stat"
+	{ 0xB2, 0x5D }    // FF " [C]"
+};
+
+// Offset of each string in aubStrData[], by ID
+const  uint16  auwStrIndex[STR_COUNT] PROGMEM =
+{
+	   0,   24,   34,   39,   57,   66,   71,   75,   83,  103,  113,  116,
+	 120,  126,  130,  134,  139,  142,  144,  150,  154,  158,  164,  167,
+	 170,  175,  191,  206,  222,  231,  254,  260,  267,  278,  287,  304,
+	 314,  333,  347,  359,  375,  393,  408,  423,  443,  456,  467,  481,
+	 498,  513,  546,  570,  597,  609,  624,  643,  654,  668,  682,  707,
+	 715,  727,  745,  772,  794,  803,  825,  860,  902,  917,  934,  944,
+	 977, 1017, 1042, 1067, 1090
+};
+
+// Encoded strings, NUL terminated
+const  uint8  aubStrData[] PROGMEM =
+{
+	0x0A, 0x41, 0x56, 0xE6, 0xE7, 0xAE, 0x41, 0x72, 0xE8, 0x69, 0x6E, 0xE9,
+	0x44, 0x65, 0x62, 0x75, 0x67, 0x20, 0x4D, 0x9A, 0x9B, 0xEA, 0xAE, 0x00,
+	0x0A, 0x21, 0x20, 0x43, 0x6F, 0x94, 0xCA, 0x97, 0xEC, 0x00, 0x20, 0x4D,
+	0x4A, 0xED, 0x00, 0x48, 0x69, 0x88, 0x3C, 0x45, 0x73, 0x63, 0x3E, 0x20,
+	0x74, 0xE9, 0x71, 0x75, 0x9B, 0xA3, 0x2E, 0x0A, 0x00, 0x3A, 0xAF, 0xAF,
+	0xAF, 0x30, 0x31, 0x46, 0x46, 0x00, 0xA4, 0xCC, 0x73, 0xAE, 0x00, 0xEC,
+	0x73, 0xAE, 0x00, 0x1B, 0x5B, 0x32, 0x4A, 0x1B, 0x5B, 0x48, 0x00, 0xEE,
+	0xEF, 0x76, 0x69, 0x65, 0x77, 0x2C, 0x20, 0x3C, 0x45, 0x73, 0x63, 0x3E,
+	0x20, 0x74, 0xE9, 0x71, 0x75, 0x9B, 0x00, 0x54, 0x69, 0x6D, 0xA5, 0x63,
+	0x6F, 0x75, 0xA6, 0x95, 0x00, 0x6E, 0xB0, 0x00, 0x31, 0xAF, 0xAF, 0x00,
+	0x54, 0x69, 0x6D, 0x65, 0xAE, 0x00, 0x20, 0x75, 0x73, 0x00, 0x20, 0x6D,
+	0x73, 0x00, 0xCD, 0x8C, 0x72, 0xEA, 0x00, 0x43, 0x9C, 0x00, 0xAE, 0x00,
+	0xB1, 0x8C, 0x69, 0xBB, 0x73, 0x00, 0x80, 0x54, 0x9D, 0x00, 0x80, 0x66,
+	0x9D, 0x00, 0x80, 0xE8, 0x74, 0x79, 0x9D, 0x00, 0x20, 0x25, 0x00, 0xF0,
+	0x7A, 0x00, 0x20, 0x6B, 0x48, 0x7A, 0x00, 0x44, 0x50, 0x8A, 0x44, 0x65,
+	0x66, 0x61, 0x75, 0x6C, 0x88, 0x50, 0x8B, 0x61, 0x6D, 0xB0, 0x00, 0x4C,
+	0xBC, 0xEE, 0x73, 0x88, 0x43, 0x6F, 0x94, 0xCA, 0x97, 0x53, 0x65, 0x74,
+	0x0A, 0x00, 0x49, 0x4D, 0x20, 0x78, 0x82, 0xCE, 0xF1, 0x8C, 0xF2, 0x74,
+	0x69, 0xEF, 0x4D, 0xBB, 0x9E, 0x00, 0x56, 0x4E, 0xF5, 0x56, 0x8C, 0x73,
+	0xD2, 0x0A, 0x00, 0x4E, 0x41, 0xBD, 0x5D, 0x80, 0x85, 0x4E, 0xBB, 0x87,
+	0x41, 0x64, 0x64, 0x8D, 0x73, 0xF6, 0x28, 0xAF, 0x9D, 0x6E, 0x9A, 0x65,
+	0x92, 0x00, 0x53, 0x45, 0xF5, 0xEC, 0xB0, 0x00, 0x53, 0x46, 0xF5, 0xBE,
+	0xF7, 0xB0, 0x00, 0x52, 0xBC, 0xA4, 0x73, 0x65, 0x88, 0x53, 0x79, 0x96,
+	0xD3, 0x00, 0x57, 0xF8, 0xD4, 0x9C, 0x44, 0x8E, 0x61, 0x0A, 0x00, 0x4C,
+	0x56, 0xA8, 0xBD, 0x83, 0xA9, 0xF9, 0xEE, 0xEF, 0x56, 0x69, 0x65, 0xD1,
+	0x64, 0xFB, 0xD3, 0x00, 0x57, 0xBC, 0xFC, 0x64, 0xFD, 0x20, 0xFE, 0x75,
+	0xB0, 0x00, 0x43, 0x4D, 0xFF, 0x86, 0x43, 0x72, 0xC0, 0x4D, 0x61, 0x69,
+	0x6C, 0x62, 0x6F, 0x78, 0xB2, 0xC2, 0x5D, 0x0A, 0x00, 0x44, 0x43, 0x83,
+	0x84, 0x84, 0x89, 0xB3, 0x20, 0x43, 0xBB, 0x87, 0x6D, 0xD3, 0x00, 0x44,
+	0x44, 0x83, 0x84, 0x84, 0x89, 0xB3, 0x20, 0x44, 0xFB, 0xD3, 0x00, 0x44,
+	0x45, 0xB1, 0x70, 0xD5, 0xB3, 0x20, 0x45, 0x45, 0x50, 0xE6, 0x4D, 0xB1,
+	0xF7, 0x9E, 0x00, 0x45, 0x45, 0xB1, 0x70, 0xD5, 0x45, 0x72, 0x9F, 0x87,
+	0x45, 0x45, 0x50, 0xE6, 0x4D, 0xB1, 0xF7, 0x9E, 0x00, 0x52, 0x4D, 0x8F,
+	0x61, 0x86, 0xD6, 0x4D, 0xA7, 0x90, 0xAB, 0x62, 0x79, 0x74, 0x9E, 0x00,
+	0x57, 0x4D, 0xD7, 0xAC, 0x85, 0xDA, 0x4D, 0xA7, 0x90, 0xAB, 0x62, 0x79,
+	0x74, 0x9E, 0x00, 0x52, 0x56, 0x20, 0x88, 0x84, 0x61, 0xCE, 0xD6, 0xC4,
+	0x28, 0x88, 0x95, 0x42, 0x7C, 0x57, 0x7C, 0x4C, 0xDB, 0x92, 0x00, 0x57,
+	0x56, 0x20, 0x88, 0x84, 0x99, 0xDC, 0xDC, 0x85, 0xDA, 0xB8, 0x9E, 0x00,
+	0x56, 0x4C, 0x8A, 0xC4, 0xB9, 0xAD, 0x72, 0xAB, 0x4C, 0xDD, 0x00, 0x56,
+	0x52, 0x20, 0xC5, 0xD5, 0xC4, 0xD6, 0x28, 0x62, 0xAB, 0x49, 0x44, 0x92,
+	0x00, 0x56, 0x57, 0x20, 0xC5, 0x20, 0xDC, 0xDC, 0x85, 0xC4, 0xDA, 0x28,
+	0x62, 0xAB, 0x49, 0x44, 0x92, 0x00, 0x56, 0xED, 0xC5, 0x83, 0xC5, 0xC6,
+	0xC4, 0x42, 0xBF, 0x9C, 0x8D, 0x61, 0x64, 0x0A, 0x00, 0x57, 0x54, 0xD7,
+	0x94, 0x20, 0x93, 0x83, 0x45, 0x7C, 0x4E, 0x7C, 0x43, 0x83, 0xA9, 0xA9,
+	0x83, 0x70, 0x70, 0x5D, 0xF9, 0x57, 0x61, 0x69, 0x88, 0x66, 0xEA, 0x63,
+	0x9A, 0x64, 0x9B, 0xD2, 0x0A, 0x00, 0x53, 0x4E, 0xD7, 0x91, 0x83, 0x84,
+	0x99, 0x91, 0xC6, 0x53, 0x6E, 0x61, 0x70, 0x73, 0xD0, 0x88, 0x64, 0xFB,
+	0xA7, 0x20, 0xB9, 0xD2, 0xB0, 0x00, 0x57, 0x50, 0x83, 0x6E, 0xD7, 0xF6,
+	0x94, 0x94, 0x94, 0x94, 0x20, 0x78, 0x89, 0xFC, 0x70, 0x6F, 0x69, 0xA6,
+	0x73, 0x65, 0xDE, 0x63, 0xC2, 0x2F, 0x6C, 0xDD, 0x00, 0x57, 0x4C, 0x8A,
+	0xFC, 0x70, 0x6F, 0x69, 0xA6, 0x4C, 0xFD, 0x0A, 0x00, 0x49, 0x50, 0xDF,
+	0xD5, 0xCF, 0x70, 0x75, 0x88, 0x49, 0x2F, 0x4F, 0x20, 0xB9, 0x0A, 0x00,
+	0x4F, 0x50, 0xDF, 0x20, 0xAC, 0xCE, 0x4F, 0x75, 0x74, 0x70, 0x75, 0x88,
+	0x49, 0x2F, 0x4F, 0x20, 0xB9, 0x0A, 0x00, 0x54, 0xBC, 0xCD, 0x62, 0x75,
+	0xF6, 0x53, 0x63, 0xCA, 0x0A, 0x00, 0x54, 0x52, 0x8F, 0xDF, 0xBD, 0x89,
+	0xCD, 0xD6, 0xB9, 0xAD, 0x8C, 0xC7, 0x92, 0x00, 0xBA, 0x8F, 0xDF, 0x83,
+	0xAC, 0xC6, 0xCD, 0xDA, 0xB9, 0xAD, 0x8C, 0xC7, 0x92, 0x00, 0x53, 0x58,
+	0x20, 0x63, 0x20, 0xAC, 0x83, 0xAC, 0xC6, 0xC9, 0x74, 0x72, 0xCA, 0x73,
+	0x66, 0xA5, 0x28, 0x63, 0x68, 0x69, 0x70, 0x20, 0x63, 0x92, 0x00, 0x46,
+	0x49, 0x8A, 0xE1, 0x49, 0x44, 0x0A, 0x00, 0x46, 0x52, 0xA8, 0x84, 0xBD,
+	0x91, 0x89, 0xE1, 0xC3, 0x64, 0x0A, 0x00, 0x46, 0x50, 0xA8, 0x84, 0x20,
+	0xAC, 0x83, 0xAC, 0xC6, 0xE1, 0x50, 0x72, 0xFD, 0x72, 0x61, 0x6D, 0x0A,
+	0x00, 0x46, 0x45, 0xA8, 0x84, 0x83, 0x6B, 0x6B, 0x89, 0xE1, 0x45, 0x72,
+	0x9F, 0x87, 0x28, 0x6B, 0x6B, 0x9D, 0x30, 0x34, 0x7C, 0x32, 0x30, 0x7C,
+	0x34, 0x30, 0x92, 0x00, 0x45, 0x43, 0x83, 0xE7, 0x94, 0x20, 0x65, 0xDB,
+	0x89, 0xE4, 0x8D, 0xCC, 0xA5, 0xAA, 0x8B, 0xDE, 0x46, 0x8D, 0x65, 0x7A,
+	0x9E, 0x00, 0x45, 0xF8, 0xE4, 0x8D, 0xCC, 0xA5, 0xB3, 0x0A, 0x00, 0x45,
+	0xBC, 0xE4, 0x8D, 0xCC, 0xA5, 0x53, 0x75, 0x94, 0x8B, 0xAB, 0x28, 0x66,
+	0x8D, 0x71, 0x2C, 0x20, 0xE8, 0x74, 0x79, 0x92, 0x00, 0x50, 0x42, 0x83,
+	0xC5, 0x20, 0x93, 0x20, 0xA9, 0xA9, 0x83, 0x93, 0x20, 0xA9, 0xA9, 0xA3,
+	0xF9, 0x50, 0x8E, 0x74, 0x8C, 0x6E, 0x20, 0x42, 0x75, 0x66, 0x66, 0xA5,
+	0x6C, 0x6F, 0x61, 0x64, 0x2F, 0x6C, 0xDD, 0x00, 0x50, 0x50, 0x83, 0x4F,
+	0x7C, 0x4C, 0xB1, 0x20, 0x94, 0xBD, 0x83, 0x75, 0x75, 0x5D, 0x5D, 0x7C,
+	0x58, 0x89, 0x50, 0x8E, 0x74, 0x8C, 0x6E, 0x20, 0x50, 0x6C, 0x61, 0xAB,
+	0x9A, 0x63, 0x65, 0x2F, 0x6C, 0x6F, 0x6F, 0x70, 0x2F, 0x96, 0x6F, 0x70,
+	0x0A, 0x00, 0x49, 0x53, 0xFF, 0x86, 0x49, 0x53, 0x52, 0x20, 0xFE, 0x73,
+	0xB2, 0xC2, 0x5D, 0x0A, 0x00, 0x51, 0x53, 0xFF, 0x86, 0xE4, 0x51, 0x75,
+	0x65, 0x75, 0x87, 0xFE, 0x73, 0xB2, 0xC2, 0x5D, 0x0A, 0x00, 0x54, 0x4C,
+	0x8A, 0x54, 0x9F, 0x6B, 0x20, 0x4C, 0xDD, 0x00, 0x50, 0x46, 0x83, 0x53,
+	0xA8, 0x20, 0x73, 0x7C, 0x58, 0x7C, 0x43, 0xE5, 0x89, 0x50, 0x72, 0x6F,
+	0x66, 0x69, 0x6C, 0xA5, 0xAA, 0x8B, 0xDE, 0xAA, 0x6F, 0x70, 0x2F, 0x43,
+	0xC2, 0x2F, 0xB3, 0x0A, 0x00, 0x46, 0x54, 0x83, 0xE7, 0x97, 0x6C, 0x6C,
+	0x6C, 0x6C, 0x20, 0x68, 0x68, 0x68, 0x68, 0xDB, 0xE5, 0x89, 0x46, 0x75,
+	0x6E, 0x63, 0x74, 0xD2, 0x20, 0x54, 0x72, 0xF2, 0x87, 0xAA, 0x8B, 0xDE,
+	0x46, 0x8D, 0x65, 0x7A, 0x65, 0x2F, 0xB3, 0x0A, 0x00, 0x58, 0x73, 0xA8,
+	0x20, 0x91, 0x91, 0x85, 0xF1, 0x65, 0x6C, 0xF0, 0x45, 0x58, 0x20, 0x64,
+	0xA1, 0x20, 0xC7, 0x9D, 0x43, 0xE5, 0x7C, 0x45, 0x92, 0x00, 0x58, 0x4C,
+	0x20, 0x73, 0x82, 0xCE, 0xF1, 0x65, 0x6C, 0xF0, 0x45, 0x58, 0x20, 0x6C,
+	0x6F, 0x61, 0x97, 0xC7, 0x9D, 0x44, 0x7C, 0x45, 0xDB, 0x92, 0x00, 0x5A,
+	0x73, 0xA8, 0x20, 0x91, 0x91, 0x85, 0x50, 0xF2, 0x6B, 0x65, 0x97, 0x64,
+	0xA1, 0x20, 0xC7, 0x9D, 0x43, 0xE5, 0x7C, 0x45, 0x92, 0x00, 0x47, 0xF8,
+	0x47, 0x44, 0xED, 0x8D, 0x6D, 0x6F, 0x74, 0x87, 0x96, 0x75, 0x62, 0x20,
+	0x6D, 0xBB, 0x9E, 0x00
+};
+
+// end
@@ -0,0 +1,107 @@
+/*
+*   strtab.h  --  Compressed message string table
+*
+*   GENERATED by host/mkstrtab.py from strtab.txt and cmdtab.h -- do not edit.
+*
+*   77 strings, 2143 bytes;  packed to 1518 bytes (data 1108, dictionary 256, index 154).
+*/
+#ifndef  _STRTAB_H_
+#define  _STRTAB_H_
+
+#include "system.h"
+
+#define  STRTAB_TOKEN         0x80     // Data bytes >= this are dictionary tokens
+#define  STRTAB_MAX_DEPTH        7     // Token nesting limit
+#define  STRTAB_HELP_MAX_LEN    59     // Longest help line output (CR LF incl.)
+
+// String IDs -- argument of putmsg()
+enum  StrTableID_t
+{
+	STR_WELCOME = 0,     // "\nAVROS : Arduino Debug Monitor : "
+	STR_CMD_ERROR,       // "\n! Command Error"
+	STR_VERSION_TAG,     // " MJB "
+	STR_ESC_TO_QUIT,     // "Hit <Esc> to quit...\n"
+	STR_IHEX_EOF_REC,    // ":00000001FF"
+	STR_LOAD_RECORDS,    // "Records: "
+	STR_LOAD_ERRORS,     // "Errors: "
+	STR_LIVE_CLS,        // "\033[2J\033[H"
+	STR_LIVE_TITLE,      // "Live view, <Esc> to quit"
+	STR_ISR_TIMER_RES,   // "Timer count = "
+	STR_UNIT_NS_NL,      // "ns\n"
+	STR_TRACE_OVF,       // "10000"
+	STR_XFER_TIME,       // "Time: "
+	STR_UNIT_US,         // " us"
+	STR_UNIT_MS,         // " ms"
+	STR_TWI_ERROR,       // "TWI error "
+	STR_EVREC_CHAN,      // "Ch "
+	STR_EVREC_COLON,     // ": "
+	STR_EVREC_PERIODS,   // " periods"
+	STR_EVREC_PERIOD,    // "  T = "
+	STR_EVREC_FREQ,      // "  f = "
+	STR_EVREC_DUTY,      // "  duty = "
+	STR_EVREC_PERCENT,   // " %"
+	STR_UNIT_HZ,         // " Hz"
+	STR_UNIT_KHZ,        // " kHz"
+	STR_HELP_DP,         // "DP        | Default Params\n"
+	STR_HELP_LS,         // "LS        | List Command Set\n"
+	STR_HELP_IM,         // "IM x      | Interactive Mode\n"
+	STR_HELP_VN,         // "VN        | Show Version\n"
+	STR_HELP_NA,         // "NA [nn]   | Node Address (00 = none)\n"
+	STR_HELP_SE,         // "SE        | Show Errors\n"
+	STR_HELP_SF,         // "SF        | Show Flags\n"
+	STR_HELP_RS,         // "RS        | Reset System\n"
+	STR_HELP_WD,         // "WD        | Watch Data\n"
+	STR_HELP_LV,         // "LV aaaa [nn [tt]] | Live View data mem\n"
+	STR_HELP_WS,         // "WS        | Watchdog Status\n"
+	STR_HELP_CM,         // "CM [C]    | Crash Mailbox [Clear]\n"
+	STR_HELP_DC,         // "DC [aaaa] | Dump Code mem\n"
+	STR_HELP_DD,         // "DD [aaaa] | Dump Data mem\n"
+	STR_HELP_DE,         // "DE pp     | Dump EEPROM page\n"
+	STR_HELP_EE,         // "EE pp     | Erase EEPROM page\n"
+	STR_HELP_RM,         // "RM aaa    | Read Memory byte\n"
+	STR_HELP_WM,         // "WM aaa bb | Write Memory byte\n"
+	STR_HELP_RV,         // "RV t aaa  | Read Variable (t = B|W|L|F)\n"
+	STR_HELP_WV,         // "WV t aaa vvvvvvvv | Write Variable\n"
+	STR_HELP_VL,         // "VL        | Variable registry List\n"
+	STR_HELP_VR,         // "VR ii     | Variable Read (by ID)\n"
+	STR_HELP_VW,         // "VW ii vvvvvvvv | Variable Write (by ID)\n"
+	STR_HELP_VB,         // "VB ii [ii..] | Variable Batch read\n"
+	STR_HELP_WT,         // "WT aaa mm vv [E|N|C [tttt [pp]]] | Wait for condition\n"
+	STR_HELP_SN,         // "SN aaa nn [aaa nn..] | Snapshot data mem regions\n"
+	STR_HELP_WP,         // "WP [n aaa s mmmmmmmm x] | Watchpoint set/clear/list\n"
+	STR_HELP_WL,         // "WL        | Watchpoint Log\n"
+	STR_HELP_IP,         // "IP rr     | Input I/O reg\n"
+	STR_HELP_OP,         // "OP rr bb  | Output I/O reg\n"
+	STR_HELP_TS,         // "TS        | TWI bus Scan\n"
+	STR_HELP_TR,         // "TR aa rr [nn] | TWI Read register(s)\n"
+	STR_HELP_TW,         // "TW aa rr [bb..] | TWI Write register(s)\n"
+	STR_HELP_SX,         // "SX c bb [bb..] | SPI transfer (chip c)\n"
+	STR_HELP_FI,         // "FI        | SPI Flash ID\n"
+	STR_HELP_FR,         // "FR aaaaaa [nnnn] | SPI Flash Read\n"
+	STR_HELP_FP,         // "FP aaaaaa bb [bb..] | SPI Flash Program\n"
+	STR_HELP_FE,         // "FE aaaaaa [kk] | SPI Flash Erase (kk = 04|20|40)\n"
+	STR_HELP_EC,         // "EC [S mm e|F] | Event recorder Start/Freeze\n"
+	STR_HELP_ED,         // "ED        | Event recorder Dump\n"
+	STR_HELP_ES,         // "ES        | Event recorder Summary (freq, duty)\n"
+	STR_HELP_PB,         // "PB [ii vv tttt [vv tttt..]] | Pattern Buffer load/list\n"
+	STR_HELP_PP,         // "PP [O|L p mm [nn [uu]]|X] | Pattern Play once/loop/stop\n"
+	STR_HELP_IS,         // "IS [C]    | ISR Stats [Clear]\n"
+	STR_HELP_QS,         // "QS [C]    | Event Queue Stats [Clear]\n"
+	STR_HELP_TL,         // "TL        | Task List\n"
+	STR_HELP_PF,         // "PF [S aaaa s|X|C|D] | Profiler Start/Stop/Clear/Dump\n"
+	STR_HELP_FT,         // "FT [S d llll hhhh|F|D] | Function Trace Start/Freeze/Dump\n"
+	STR_HELP_XC,         // "Xs aaaa nnnn | Intel HEX dump (s = C|D|E)\n"
+	STR_HELP_XL,         // "XL s      | Intel HEX load (s = D|E|F)\n"
+	STR_HELP_ZC,         // "Zs aaaa nnnn | Packed dump (s = C|D|E)\n"
+	STR_HELP_GD,         // "GD        | GDB remote stub mode\n"
+	STR_COUNT
+};
+
+#define  STR_HELP_FIRST   STR_HELP_DP
+#define  STR_HELP_LAST    STR_HELP_GD
+
+extern  const  uint8   aubStrDict[][2] PROGMEM;
+extern  const  uint16  auwStrIndex[] PROGMEM;
+extern  const  uint8   aubStrData[] PROGMEM;    // see putmsg() in cmnd.c
+
+#endif  /* _STRTAB_H_ */
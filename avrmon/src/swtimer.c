@@ -0,0 +1,157 @@
+/*____________________________________________________________________________*\
+|
+|  File:        swtimer.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Software timer service -- a hashed timer wheel stepped once per RTI tick.
+|  Timers are kept in singly-linked lists, one per wheel slot, with a back-link
+|  to the pointer which points to each timer, so a timer is unlinked in constant
+|  time.  When the wheel reaches a slot, timers in the slot whose expiry time has
+|  come are moved to the expired list (timers due on a later turn of the wheel
+|  stay put);  then the expired list is emptied, calling each timer's callback.
+|  Callbacks may start, stop or restart any timer, including their own.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "swtimer.h"
+
+#define  WHEEL_MASK   (SWTIMER_WHEEL_SIZE - 1)
+
+static  swtimer_t  * apsWheel[SWTIMER_WHEEL_SIZE];    // Slot list heads
+static  swtimer_t  * psExpired;         // Expired timers, awaiting callback
+static  uint32  ulWheelTime;            // Tick reached by the wheel
+static  bool    yWheelStarted;
+
+
+/*
+|   Link a timer at the head of a list.
+*/
+static  void  timer_link( swtimer_t **ppsHead, swtimer_t *psTimer )
+{
+	psTimer->psNext = *ppsHead;
+	if ( psTimer->psNext != NULL )  psTimer->psNext->ppsLink = &psTimer->psNext;
+	psTimer->ppsLink = ppsHead;
+	*ppsHead = psTimer;
+}
+
+
+/*
+|   Unlink a timer from whichever list it is in.
+*/
+static  void  timer_unlink( swtimer_t *psTimer )
+{
+	*psTimer->ppsLink = psTimer->psNext;
+	if ( psTimer->psNext != NULL )  psTimer->psNext->ppsLink = psTimer->ppsLink;
+	psTimer->ppsLink = NULL;
+}
+
+
+/*
+|   Insert a timer into the wheel to expire at tick ulExpiry;  a time which the
+|   wheel has already passed (late periodic reload) is moved to the next tick.
+*/
+static  void  timer_insert( swtimer_t *psTimer, uint32 ulExpiry )
+{
+	if ( !yWheelStarted )
+	{
+		ulWheelTime = millisec_timer();
+		yWheelStarted = TRUE;
+	}
+	if ( (int32) (ulExpiry - ulWheelTime) <= 0 )  ulExpiry = ulWheelTime + 1;
+	psTimer->ulExpiry = ulExpiry;
+	timer_link( &apsWheel[ulExpiry & WHEEL_MASK], psTimer );
+}
+
+
+/*
+|   Initialise a timer (stopped).  Must be called once before a timer is used.
+*/
+void  swtimer_init( swtimer_t *psTimer, pfntimer pfnCallback, void *pvArg )
+{
+	psTimer->ppsLink = NULL;
+	psTimer->uwDelay = 0;
+	psTimer->uwPeriod = 0;
+	psTimer->pfnCallback = pfnCallback;
+	psTimer->pvArg = pvArg;
+}
+
+
+/*
+|   Start (or re-start) a timer.  The callback is called uwDelay ticks from now,
+|   then every uwPeriod ticks until the timer is stopped (if uwPeriod != 0).
+*/
+void  swtimer_start( swtimer_t *psTimer, uint16 uwDelay, uint16 uwPeriod )
+{
+	if ( psTimer->ppsLink != NULL )  timer_unlink( psTimer );
+	psTimer->uwDelay = uwDelay;
+	psTimer->uwPeriod = uwPeriod;
+	timer_insert( psTimer, millisec_timer() + uwDelay );
+}
+
+
+/*
+|   Re-start a timer with the delay and period it was last started with.
+*/
+void  swtimer_restart( swtimer_t *psTimer )
+{
+	swtimer_start( psTimer, psTimer->uwDelay, psTimer->uwPeriod );
+}
+
+
+/*
+|   Stop a timer.  No effect if the timer is not running.
+*/
+void  swtimer_stop( swtimer_t *psTimer )
+{
+	if ( psTimer->ppsLink != NULL )  timer_unlink( psTimer );
+}
+
+
+/*
+|   Return TRUE if the timer is running (started, and not yet expired if one-shot).
+*/
+bool  swtimer_active( swtimer_t *psTimer )
+{
+	return  ( psTimer->ppsLink != NULL );
+}
+
+
+/*
+|   Step the wheel to the current tick and call the callbacks of expired timers.
+|   Called frequently from the background task dispatcher.  If the background
+|   has fallen behind, the wheel catches up, one slot per tick missed.
+*/
+void  swtimer_service( void )
+{
+	swtimer_t  *psTimer, *psNext;
+	uint32  ulNow = millisec_timer();
+
+	if ( !yWheelStarted )  return;      // No timer started yet
+
+	while ( ulWheelTime != ulNow )
+	{
+		ulWheelTime++ ;
+		for ( psTimer = apsWheel[ulWheelTime & WHEEL_MASK];  psTimer != NULL;  psTimer = psNext )
+		{
+			psNext = psTimer->psNext;
+			if ( psTimer->ulExpiry == ulWheelTime )
+			{
+				timer_unlink( psTimer );
+				timer_link( &psExpired, psTimer );
+			}
+		}
+	}
+
+	while ( (psTimer = psExpired) != NULL )
+	{
+		timer_unlink( psTimer );
+		if ( psTimer->uwPeriod != 0 )       // reload -- no drift
+			timer_insert( psTimer, psTimer->ulExpiry + psTimer->uwPeriod );
+		(*psTimer->pfnCallback)( psTimer );
+	}
+}
+
+// end
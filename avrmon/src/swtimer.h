@@ -0,0 +1,50 @@
+/*
+*   swtimer.h  --  Software timers (hashed timer wheel on the RTI tick)
+*
+*   One-shot and periodic timers with expiry callbacks.  The RTI tick ISR advances
+*   the tick count (see millisec_timer);  swtimer_service(), called from the
+*   background task dispatcher, steps the wheel up to the current tick and calls
+*   the callbacks of expired timers, in background context (not in the ISR).
+*
+*   Each timer is linked into the wheel slot for its expiry tick (modulo the wheel
+*   size), so starting and stopping a timer take constant time, and each tick
+*   examines only the timers in one slot, regardless of the number of timers.
+*   Timers must be started and stopped only from background (monitor) context.
+*
+*       static  swtimer_t  sRetryTimer;
+*
+*       void  retry_expired( swtimer_t *psTimer ) { ... }
+*
+*       swtimer_init( &sRetryTimer, retry_expired, NULL );
+*       swtimer_start( &sRetryTimer, 250, 0 );      // one-shot, 250 ticks (msec)
+*/
+#ifndef  _SWTIMER_H_
+#define  _SWTIMER_H_
+
+#include "system.h"
+
+#define  SWTIMER_WHEEL_SIZE     32      // Wheel slots, power of 2
+
+typedef  struct  SwTimer_t  swtimer_t;
+
+typedef  void (* pfntimer)( swtimer_t * );     // pointer to timer callback function
+
+struct  SwTimer_t
+{
+	swtimer_t  * psNext;                // next timer in list
+	swtimer_t ** ppsLink;               // link pointing to this timer, NULL if stopped
+	uint32       ulExpiry;              // expiry time, ticks
+	uint16       uwDelay;               // initial delay, ticks (for restart)
+	uint16       uwPeriod;              // reload interval, ticks (0 => one-shot)
+	pfntimer     pfnCallback;           // function called on expiry
+	void       * pvArg;                 // for use by callback
+};
+
+void   swtimer_init( swtimer_t *psTimer, pfntimer pfnCallback, void *pvArg );
+void   swtimer_start( swtimer_t *psTimer, uint16 uwDelay, uint16 uwPeriod );
+void   swtimer_restart( swtimer_t *psTimer );
+void   swtimer_stop( swtimer_t *psTimer );
+bool   swtimer_active( swtimer_t *psTimer );
+void   swtimer_service( void );
+
+#endif  /* _SWTIMER_H_ */
@@ -23,11 +23,48 @@
 #define  UART_BAUDRATE  (19200)         // Set UART Baudrate
 #define  DEBUG_BUILD    TRUE            // Maybe FALSE in final release
 #define  INTERACTIVE_ON_STARTUP  TRUE   // Set mode for HCI comm's at startup
+#define  WATCHDOG_SUPPORTED  TRUE       // Enable hardware watchdog (see wdog.h)
+#define  ISR_STATS_SUPPORTED  TRUE      // Instrument ISR's for timing stats (isrstat.h)
+#define  WATCHPOINTS_SUPPORTED  TRUE    // Memory watchpoints checked on tick (watchpt.h)
+#define  KERNEL_SUPPORTED  FALSE        // Preemptive multitasking kernel (kernel.h)
+#define  PROFILER_SUPPORTED  FALSE      // PC-sampling profiler on timestamp timer (profile.h)
+#define  RS485_SUPPORTED  FALSE         // RS-485 transceiver driver control (periph.h)
+#define  TWI_SUPPORTED  TRUE            // TWI (I2C) master driver, on PC4/PC5 (twi.h)
+#define  SPI_SUPPORTED  TRUE            // SPI master driver and serial flash, on PB1..5 (spi.h)
+#define  EVREC_SUPPORTED  FALSE         // Input capture/pin change event recorder (evrec.h)
+#define  SNAPSHOT_SUPPORTED  FALSE      // Atomic data memory snapshot (snapshot.h)
+#define  PATGEN_SUPPORTED  TRUE         // Timed pattern playback on an output port (patgen.h)
+#define  CRASH_MAILBOX_SUPPORTED  TRUE  // Post-mortem record kept over reset, in .noinit (crash.h)
+#define  GDBSTUB_SUPPORTED  TRUE        // GDB remote serial protocol stub on the HCI port (gdbstub.h)
+#define  VARREG_SUPPORTED  TRUE         // Named variable registry, in flash (varreg.h, vartab.h)
+#ifdef  TRACE_BUILD                     // Defined in the "Trace" build configuration
+#define  TRACE_SUPPORTED  TRUE          // Function entry/exit trace (trace.h)
+#else
+#define  TRACE_SUPPORTED  FALSE
+#endif
+
+// SRAM budget (2048 bytes):  static data (data + bss + noinit) of the default build is
+// 1676 bytes, leaving 372 for the stack (main loop, command protothread and one ISR --
+// ISR's do not nest).  Keep at least 256 bytes for the stack, i.e. static data below 1792.
+// The largest items are the ISR stats 260, watchpoints and change log 260, serial
+// FIFOs 160, live view 128, pattern buffer 96, GDB packet 65 and command line 64.
+// Options off by default add (buffer size, set in the header, may be defined here):
+//   PROFILER 79 (PROF_NUM_BUCKETS 32),  EVREC 72 (EVREC_BUF_SIZE 16),
+//   SNAPSHOT 99 (SNAP_BUF_SIZE 64),  TRACE 90 (TRACE_BUF_SIZE 16).
+// Any one of them fits;  for more, or larger buffers, make room elsewhere.
+// After changing options, check with avr-size that data + bss stays below 1792.
 //-----------------------------------------------------------------------------
 
 #define  LITTLE_ENDIAN  TRUE            // ATmega AVR is little-endian
 
-#define  SET_DEBUG_FLAG(bm)   (gwDebugFlags |= bm)        // Debug aid
+#define  SET_DEBUG_FLAG(bm)   (gwDebugFlags |= (bm))      // Debug aid
+
+// System error flags (gwSystemError bits, shown by 'SE' command)
+#define  SYS_ERR_WDT_RESET        BIT_0     // Last reset was by watchdog
+#define  SYS_ERR_TASK_DEADLINE    BIT_1     // Supervised task missed its deadline
+#define  SYS_ERR_LOOP_OVERRUN     BIT_2     // Main loop iteration time limit exceeded
+#define  SYS_ERR_SERIAL_RX        BIT_3     // Serial input error or RX buffer overrun
+#define  SYS_ERR_CRASH_RECORD     BIT_4     // Crash record held from before reset ('CM')
 
 // TODO: Check ATmega16 bootloader block size and start address
 //#define  PROGRAM_ENTRY_POINT     (0x0000)     // Application program start address
@@ -0,0 +1,210 @@
+/*____________________________________________________________________________*\
+|
+|  File:        trace.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Function entry/exit trace (TRACE_BUILD configuration only).
+|  The -finstrument-functions hooks are here;  they must not be instrumented
+|  themselves, nor call any instrumented function.  Each hook takes about 60 cycles
+|  when the call is logged, which is included in the times measured, so the trace
+|  is best used to compare call paths rather than to time very short functions.
+|  See trace.h for the scheme.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "strtab.h"
+#include  "trace.h"
+
+#if TRACE_SUPPORTED
+
+#define  NO_TRACE   __attribute__ ((no_instrument_function))
+
+#define  TRACE_MASK   (TRACE_BUF_SIZE - 1)
+
+// Trace record -- function word address (with TRACE_EXIT flag) and timestamp
+struct  TraceRec_t
+{
+	uint16   uwFunc;            // function word address (bit 15 set on exit)
+	uint8    ubOvf;             // timestamp, bits 23..16
+	uint16   uwCount;           // timestamp, bits 15..0
+};
+
+void    __cyg_profile_func_enter( void *pvFunc, void *pvCaller ) NO_TRACE;
+void    __cyg_profile_func_exit( void *pvFunc, void *pvCaller ) NO_TRACE;
+
+static  struct  TraceRec_t  asTrace[TRACE_BUF_SIZE];
+static  uint8   ubTraceHead;            // Records logged (free-running)
+static  bool    yTraceFull;             // Buffer full (oldest records being overwritten)
+static  volatile  bool  yTraceOn;       // Logging enabled (not frozen)
+static  uint8   ubCallDepth;            // Current call depth (instrumented functions)
+static  uint8   ubMaxDepth = TRACE_DEFAULT_DEPTH;
+static  uint16  uwFilterLo;             // Filter range, function word addresses
+static  uint16  uwFilterHi = 0x7FFF;
+static  uint8   ubDumpIndex;            // Next record to output ('FT D')
+
+
+/*
+|   Log a trace record, if logging is on and the function passes the filter.
+*/
+static  void  trace_log( uint16 uwFunc, uint8 ubDepth ) NO_TRACE;
+static  void  trace_log( uint16 uwFunc, uint8 ubDepth )
+{
+	struct  TraceRec_t  *psRec;
+	uint32  ulStamp;
+	uint8   bSREG;
+
+	if ( !yTraceOn || ubDepth > ubMaxDepth )  return;
+	if ( (uwFunc & ~TRACE_EXIT) < uwFilterLo || (uwFunc & ~TRACE_EXIT) > uwFilterHi )  return;
+
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	psRec = &asTrace[ubTraceHead & TRACE_MASK];
+	psRec->uwFunc = uwFunc;
+	ulStamp = tstamp_extend( TSTAMP_COUNT );
+	psRec->uwCount = (uint16) ulStamp;
+	psRec->ubOvf = (uint8) (ulStamp >> 16);
+	if ( ++ubTraceHead == TRACE_BUF_SIZE )  yTraceFull = TRUE;
+	SREG = bSREG;
+}
+
+
+/*
+|   Instrumentation hooks -- called on entry to and exit from every instrumented
+|   function.  pvFunc is the function address (a word address on the AVR).
+*/
+void  __cyg_profile_func_enter( void *pvFunc, void *pvCaller )
+{
+	(void) pvCaller;            // not used
+	trace_log( (uint16) pvFunc, ++ubCallDepth );
+}
+
+void  __cyg_profile_func_exit( void *pvFunc, void *pvCaller )
+{
+	(void) pvCaller;
+	trace_log( (uint16) pvFunc | TRACE_EXIT, ubCallDepth-- );
+}
+
+
+/*
+|   Number of records in the buffer.
+*/
+static  uint8  trace_count( void )
+{
+	return  yTraceFull ? TRACE_BUF_SIZE : ubTraceHead;
+}
+
+
+static  PT_THREAD( trace_dump_thread( pt_t *pt ) )
+{
+	struct  TraceRec_t  *psRec;
+
+	PT_BEGIN( pt );
+	PT_WAIT_TX( pt, 20 );
+	putch( '#' );
+	putHexByte( trace_count() );
+	putch( SPACE );
+	putmsg( STR_TRACE_OVF );           // timestamp counts per overflow
+	putch( SPACE );
+	putHexByte( TSTAMP_COUNTS_PER_USEC );
+	NEW_LINE;
+
+	for ( ubDumpIndex = ubTraceHead - trace_count();  ubDumpIndex != ubTraceHead;  ubDumpIndex++ )
+	{
+		PT_WAIT_TX( pt, 16 );
+		psRec = &asTrace[ubDumpIndex & TRACE_MASK];
+		putch( (psRec->uwFunc & TRACE_EXIT) ? '<' : '>' );
+		putHexWord( (psRec->uwFunc & ~TRACE_EXIT) << 1 );
+		putch( SPACE );
+		putHexByte( psRec->ubOvf );
+		putHexWord( psRec->uwCount );
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'FT':  Function trace control.
+|  Cmd format:  "FT [S [d [llll hhhh]] | F | D]"
+|
+|    FT S d llll hhhh  ... Start (clears the buffer);  d = call depth limit (hex,
+|                          1..F, default TRACE_DEFAULT_DEPTH);  llll, hhhh = filter
+|                          range, byte addresses in flash (hex, default all).
+|    FT F              ... Freeze:  stop logging, keeping the buffer.
+|    FT D              ... Freeze and dump the buffer:  a header line "#nn pppp cc",
+|                          then one line per record, oldest first:  ">aaaa ttcccc" for
+|                          entry to, or "<aaaa ttcccc" for exit from, the function at
+|                          byte address aaaa, where ttcccc = timestamp timer count,
+|                          24 bits.  nn = number of records, pppp = 10000 (counts
+|                          per timer overflow), cc = timer counts per usec.
+|                          (Not '+' and '-':  a line starting with '-' would be taken
+|                          for the response terminator.)
+|    FT                ... Show status:  "r nn d" -- r = 1 if logging, nn = records,
+|                          d = depth limit.
+|
+|  Entries of calls which were in progress when the trace started, or which were
+|  overwritten in the ring buffer, are missing;  the host script allows for this.
+*/
+void  trace_cmd( void )
+{
+	char  * pcArg;
+
+	switch ( toupper( *hci_arg( 1 ) ) )
+	{
+	case 'S':
+		pcArg = hci_arg( 2 );
+		yTraceOn = FALSE;
+		ubMaxDepth = TRACE_DEFAULT_DEPTH;
+		uwFilterLo = 0;
+		uwFilterHi = 0x7FFF;
+		if ( isHexDigit( *pcArg ) )  ubMaxDepth = hexctobin( *pcArg );
+		pcArg = hci_arg( 3 );
+		if ( isHexDigit( *pcArg ) )
+		{
+			uwFilterLo = hexatoi( pcArg ) >> 1;
+			pcArg = hci_arg( 4 );
+			if ( !isHexDigit( *pcArg ) )  { hci_put_cmd_error();  break; }
+			uwFilterHi = hexatoi( pcArg ) >> 1;
+		}
+		ubTraceHead = 0;
+		yTraceFull = FALSE;
+		yTraceOn = TRUE;
+		break;
+
+	case 'F':
+		yTraceOn = FALSE;
+		break;
+
+	case 'D':
+		yTraceOn = FALSE;
+		hci_spawn( trace_dump_thread );
+		break;
+
+	case NUL:
+		putBoolean( yTraceOn );
+		putch( SPACE );
+		putHexByte( trace_count() );
+		putch( SPACE );
+		putHexDigit( ubMaxDepth );
+		break;
+
+	default:
+		hci_put_cmd_error();
+		break;
+	}
+}
+
+#else
+
+void  trace_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // TRACE_SUPPORTED
+
+// end
@@ -0,0 +1,38 @@
+/*
+*   trace.h  --  Function entry/exit trace
+*
+*   In the "Trace" build configuration (avrmon.cproj), TRACE_BUILD is defined and
+*   the modules are compiled with -finstrument-functions, so the compiler inserts
+*   calls to __cyg_profile_func_enter() and __cyg_profile_func_exit() in every
+*   function.  Low-level modules (periph.c, kernel.c, profile.c, isrstat.c, twi.c,
+*   spi.c, evrec.c, patgen.c, crash.c) and the character output functions are
+*   excluded by the -finstrument-functions-exclude-* options in the configuration;
+*   other functions may be excluded with the attribute
+*   __attribute__ ((no_instrument_function)).
+*
+*   The hooks log the function address and a timestamp into a ring buffer in SRAM.
+*   Calls nested more than the depth limit are not logged, nor are functions outside
+*   the address filter range;  their time is counted in the caller's.  Timestamps
+*   are the low 24 bits of the timestamp timer count (periph.h), so the host can
+*   reconstruct times as long as there is a record at least every 256 overflows
+*   (8.4 seconds at 0.5us resolution).
+*
+*   'FT' commands start, freeze and download the trace;  the host script
+*   host/tracetree.py rebuilds the call tree, with inclusive and exclusive times.
+*   The call depth is tracked for the whole program, so the trace is not meaningful
+*   for kernel tasks (KERNEL_SUPPORTED) other than the monitor.
+*/
+#ifndef  _TRACE_H_
+#define  _TRACE_H_
+
+#include "system.h"
+
+#ifndef  TRACE_BUF_SIZE                // May be set in system.h (SRAM budget)
+#define  TRACE_BUF_SIZE        16     // Trace records (5 bytes each), power of 2
+#endif
+#define  TRACE_DEFAULT_DEPTH    8     // Default call depth limit
+#define  TRACE_EXIT        0x8000     // Record function word flag -- exit record
+
+void   trace_cmd( void );
+
+#endif  /* _TRACE_H_ */
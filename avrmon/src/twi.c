@@ -0,0 +1,451 @@
+/*____________________________________________________________________________*\
+|
+|  File:        twi.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Interrupt-driven TWI (I2C) master driver (optional, TWI_SUPPORTED), and the
+|  bus scan and burst read/write commands, 'TS', 'TR' and 'TW'.
+|  The ISR steps each transfer through the TWI status codes (Atmel datasheet,
+|  "Master Transmitter/Receiver Mode") and starts the next queued transfer as
+|  soon as one finishes, so the bus is never idle while work is queued.
+|  See twi.h for the transfer descriptor and usage.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "strtab.h"
+#include  "isrstat.h"
+#include  "twi.h"
+
+#if TWI_SUPPORTED
+
+#define  TWI_QUEUE_MASK   (TWI_QUEUE_SIZE - 1)
+
+#define  TWCR_RUN      ((1<<TWINT)|(1<<TWEN)|(1<<TWIE))   // Clear TWINT: next bus action
+#define  TWCR_ACK      (TWCR_RUN | (1<<TWEA))             // ... receive, ACK the byte
+#define  TWCR_START    (TWCR_RUN | (1<<TWSTA))
+#define  TWCR_STOP     (TWCR_RUN | (1<<TWSTO))
+#define  TWI_STATUS    (TWSR & 0xF8)                      // Status code (prescaler bits masked)
+
+// TWI status codes, master modes
+#define  TW_START              0x08
+#define  TW_REP_START          0x10
+#define  TW_MT_SLA_ACK         0x18
+#define  TW_MT_SLA_NACK        0x20
+#define  TW_MT_DATA_ACK        0x28
+#define  TW_MT_DATA_NACK       0x30
+#define  TW_MT_ARB_LOST        0x38
+#define  TW_MR_SLA_ACK         0x40
+#define  TW_MR_SLA_NACK        0x48
+#define  TW_MR_DATA_ACK        0x50
+#define  TW_MR_DATA_NACK       0x58
+
+// The queue is a ring of transfer pointers;  the counts are free-running.
+static  twi_xfer_t  *apsTwiQueue[TWI_QUEUE_SIZE];
+static  volatile  uint8  ubTwiHead;     // Transfers submitted
+static  volatile  uint8  ubTwiTail;     // Transfers finished
+static  uint8   ubTwiIndex;             // Data bytes transferred (current transfer)
+static  bool    yTwiRegSent;            // Register address sent (current transfer)
+static  uint32  ulTwiStart;             // Time of START (usec)
+
+
+void  twi_init( void )
+{
+	TWSR = 0;                                   // Prescaler = 1
+	TWBR = ((CLOCK_FREQ / TWI_BUS_FREQ) - 16) / 2;
+	PORTC |= BIT_4 | BIT_5;                     // Weak pull-ups on SDA, SCL
+	TWCR = (1<<TWEN);
+}
+
+
+/*
+|   Set up the transfer at the queue tail, before its START is issued.
+|   Called with interrupts disabled (or from the ISR).
+*/
+static  void  twi_begin( void )
+{
+	apsTwiQueue[ubTwiTail & TWI_QUEUE_MASK]->ubStatus = TWI_ACTIVE;
+	ubTwiIndex = 0;
+	yTwiRegSent = FALSE;
+	ulTwiStart = microsec_timer();
+}
+
+
+/*
+|   Finish the current transfer with status ubStatus;  ubControl is the TWCR
+|   value to end it (STOP, or just release the bus).  If another transfer is
+|   queued, its START is issued in the same write (after the STOP).
+*/
+static  void  twi_finish( uint8 ubStatus, uint8 ubControl )
+{
+	twi_xfer_t  *psXfer = apsTwiQueue[ubTwiTail & TWI_QUEUE_MASK];
+
+	psXfer->ubDone = ubTwiIndex;
+	psXfer->uwTime = (uint16) (microsec_timer() - ulTwiStart);
+	psXfer->ubStatus = ubStatus;
+	ubTwiTail++ ;
+
+	if ( ubTwiHead != ubTwiTail )
+	{
+		twi_begin();
+		ubControl |= (1<<TWSTA);
+	}
+	TWCR = ubControl;
+}
+
+
+/*
+|   Queue a transfer.  Returns FALSE if the queue is full, or the transfer is
+|   invalid (a read of zero bytes).
+*/
+bool  twi_submit( twi_xfer_t *psXfer )
+{
+	uint8  bSREG;
+
+	if ( (psXfer->ubFlags & TWI_READ) && psXfer->ubCount == 0 )  return  FALSE;
+
+	bSREG = SREG;
+	DISABLE_GLOBAL_IRQ;
+	if ( (uint8) (ubTwiHead - ubTwiTail) >= TWI_QUEUE_SIZE )
+	{
+		SREG = bSREG;
+		return  FALSE;
+	}
+	psXfer->ubStatus = TWI_QUEUED;
+	psXfer->ubDone = 0;
+	apsTwiQueue[ubTwiHead & TWI_QUEUE_MASK] = psXfer;
+	if ( ubTwiHead++ == ubTwiTail )         // Bus idle -- start now
+	{
+		twi_begin();
+		TWCR = TWCR_START;
+	}
+	SREG = bSREG;
+
+	return  TRUE;
+}
+
+
+/*
+|   Abandon all queued transfers (status TWI_ERR_TIMEOUT) and reset the TWI,
+|   e.g. if a slave holds SCL low.
+*/
+void  twi_reset( void )
+{
+	uint8  bSREG = SREG;
+
+	DISABLE_GLOBAL_IRQ;
+	TWCR = 0;                               // Disable TWI, releasing SDA and SCL
+	while ( ubTwiTail != ubTwiHead )
+	{
+		apsTwiQueue[ubTwiTail & TWI_QUEUE_MASK]->ubStatus = TWI_ERR_TIMEOUT;
+		ubTwiTail++ ;
+	}
+	TWCR = (1<<TWEN);
+	SREG = bSREG;
+}
+
+
+/*
+|   INTERRUPT SERVICE ROUTINE --- TWI
+|   Called when the bus action requested has completed (TWINT set);  the action
+|   taken depends on the status code and the current transfer.
+*/
+ISR ( TWI_vect )
+{
+	twi_xfer_t  *psXfer = apsTwiQueue[ubTwiTail & TWI_QUEUE_MASK];
+	uint8   ubFlags = psXfer->ubFlags;
+
+	ISRSTAT_ENTER( ISRSTAT_TWI );
+
+	switch ( TWI_STATUS )
+	{
+	case TW_START:          // Address slave:  write first, unless a read without register
+		if ( (ubFlags & TWI_READ) && !(ubFlags & TWI_REG) )  TWDR = (psXfer->ubSlave << 1) | 1;
+		else  TWDR = psXfer->ubSlave << 1;
+		TWCR = TWCR_RUN;
+		break;
+
+	case TW_REP_START:      // Read after register address written
+		TWDR = (psXfer->ubSlave << 1) | 1;
+		TWCR = TWCR_RUN;
+		break;
+
+	case TW_MT_SLA_ACK:
+	case TW_MT_DATA_ACK:
+		if ( (ubFlags & TWI_REG) && !yTwiRegSent )
+		{
+			TWDR = psXfer->ubReg;
+			yTwiRegSent = TRUE;
+			TWCR = TWCR_RUN;
+		}
+		else if ( ubFlags & TWI_READ )  TWCR = TWCR_START;      // repeated START
+		else if ( ubTwiIndex < psXfer->ubCount )
+		{
+			TWDR = psXfer->pbData[ubTwiIndex++];
+			TWCR = TWCR_RUN;
+		}
+		else  twi_finish( TWI_OK, TWCR_STOP );
+		break;
+
+	case TW_MT_SLA_NACK:
+	case TW_MR_SLA_NACK:
+		twi_finish( TWI_ERR_ADDR_NACK, TWCR_STOP );
+		break;
+
+	case TW_MT_DATA_NACK:   // Slave may NACK the last byte written
+		if ( !(ubFlags & TWI_READ) && ubTwiIndex != 0 && ubTwiIndex == psXfer->ubCount )
+			twi_finish( TWI_OK, TWCR_STOP );
+		else  twi_finish( TWI_ERR_DATA_NACK, TWCR_STOP );
+		break;
+
+	case TW_MT_ARB_LOST:    // (also TW_MR_ARB_LOST) -- release the bus
+		twi_finish( TWI_ERR_ARB_LOST, TWCR_RUN );
+		break;
+
+	case TW_MR_SLA_ACK:     // ACK each byte received, except the last
+		TWCR = ( psXfer->ubCount > 1 ) ? TWCR_ACK : TWCR_RUN;
+		break;
+
+	case TW_MR_DATA_ACK:
+		psXfer->pbData[ubTwiIndex++] = TWDR;
+		TWCR = ( ubTwiIndex + 1 < psXfer->ubCount ) ? TWCR_ACK : TWCR_RUN;
+		break;
+
+	case TW_MR_DATA_NACK:   // Last byte
+		psXfer->pbData[ubTwiIndex++] = TWDR;
+		twi_finish( TWI_OK, TWCR_STOP );
+		break;
+
+	default:                // Bus error (0x00) or unexpected status
+		twi_finish( TWI_ERR_BUS, TWCR_STOP );
+		break;
+	}
+
+	ISRSTAT_EXIT( ISRSTAT_TWI );
+}
+
+
+/*____________________________________________________________________________*\
+|
+|   TWI monitor commands
+\*____________________________________________________________________________*/
+
+static  twi_xfer_t  sTwiXfer;                   // Command transfer
+static  uint8   abTwiData[TWI_MAX_BURST];       // Command transfer data
+static  uint8   ubTwiScanAddr;                  // 'TS' slave address
+static  uint8   ubTwiFound;                     // 'TS' slaves found
+static  uint32  ulTwiTimer;                     // Transfer timeout timer
+
+// Wait for sTwiXfer to finish;  reset the bus if it takes too long.
+#define  PT_WAIT_XFER(pt)  do { ulTwiTimer = millisec_timer(); \
+	PT_WAIT_UNTIL( (pt), !twi_busy( &sTwiXfer ) || (millisec_timer() - ulTwiTimer) >= TWI_TIMEOUT_MS ); \
+	if ( twi_busy( &sTwiXfer ) )  twi_reset(); } while (0)
+
+
+/*
+|   Output the error status of a failed transfer, then the command error.
+*/
+static  void  twi_put_error( uint8 ubStatus )
+{
+	if ( hci_interactive() )  putmsg( STR_TWI_ERROR );
+	putHexDigit( ubStatus );
+	hci_put_cmd_error();
+}
+
+
+/*
+|   Output the bus time of the command transfer:  "tttt" usec (hex), or decimal
+|   in interactive mode.
+*/
+static  void  twi_put_time( void )
+{
+	if ( hci_interactive() )
+	{
+		putmsg( STR_XFER_TIME );
+		putDecWord( sTwiXfer.uwTime, 5 );
+		putmsg( STR_UNIT_US );
+	}
+	else  putHexWord( sTwiXfer.uwTime );
+}
+
+
+/*
+|   Get the slave address (hex, 00..7F) from command argument 1, and the register
+|   address from argument 2, into sTwiXfer.  Returns FALSE if either is invalid.
+*/
+static  bool  twi_get_slave_reg( void )
+{
+	char  * pcArg = hci_arg( 1 );
+
+	if ( !isHexDigit( *pcArg ) || hexatoi( pcArg ) > 0x7F )  return  FALSE;
+	sTwiXfer.ubSlave = (uint8) hexatoi( pcArg );
+	pcArg = hci_arg( 2 );
+	if ( !isHexDigit( *pcArg ) || hexatoi( pcArg ) > 0xFF )  return  FALSE;
+	sTwiXfer.ubReg = (uint8) hexatoi( pcArg );
+	sTwiXfer.pbData = abTwiData;
+
+	return  TRUE;
+}
+
+
+static  PT_THREAD( twi_scan_thread( pt_t *pt ) )
+{
+	PT_BEGIN( pt );
+	ubTwiFound = 0;
+	for ( ubTwiScanAddr = 0x08;  ubTwiScanAddr < 0x78;  ubTwiScanAddr++ )
+	{
+		sTwiXfer.ubSlave = ubTwiScanAddr;
+		PT_WAIT_UNTIL( pt, twi_submit( &sTwiXfer ) );
+		PT_WAIT_XFER( pt );
+		PT_WAIT_TX( pt, 20 );
+		if ( sTwiXfer.ubStatus == TWI_OK )
+		{
+			if ( ubTwiFound++ != 0 )  putch( SPACE );
+			putHexByte( ubTwiScanAddr );
+		}
+		else if ( sTwiXfer.ubStatus != TWI_ERR_ADDR_NACK )
+		{
+			if ( ubTwiFound != 0 )  NEW_LINE;
+			twi_put_error( sTwiXfer.ubStatus );
+			PT_EXIT( pt );
+		}
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'TS':  TWI bus scan.
+|  Cmd format:  "TS"
+|
+|  Each slave address 08..77 is written with no data;  the response lists the
+|  addresses acknowledged, e.g. "3C 68" (empty if none).
+*/
+void  twi_scan_cmd( void )
+{
+	sTwiXfer.ubFlags = 0;
+	sTwiXfer.ubCount = 0;
+	hci_spawn( twi_scan_thread );
+}
+
+
+static  PT_THREAD( twi_read_thread( pt_t *pt ) )
+{
+	static  uint8  ubIndex;
+
+	PT_BEGIN( pt );
+	PT_WAIT_UNTIL( pt, twi_submit( &sTwiXfer ) );
+	PT_WAIT_XFER( pt );
+	if ( sTwiXfer.ubStatus != TWI_OK )
+	{
+		PT_WAIT_TX( pt, 20 );
+		twi_put_error( sTwiXfer.ubStatus );
+		PT_EXIT( pt );
+	}
+	for ( ubIndex = 0;  ubIndex < sTwiXfer.ubCount;  ubIndex++ )
+	{
+		PT_WAIT_TX( pt, 4 );
+		if ( ubIndex != 0 )  putch( SPACE );
+		putHexByte( abTwiData[ubIndex] );
+	}
+	PT_WAIT_TX( pt, 20 );
+	NEW_LINE;
+	twi_put_time();
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'TR':  TWI burst read.
+|  Cmd format:  "TR aa rr [nn]"
+|
+|  Reads nn bytes (hex, 1..TWI_MAX_BURST, default 1) from register rr of the
+|  slave at address aa (hex, 7 bits), in one transfer.
+|
+|  Response:  "dd dd ..."  (the data), then "tttt" on the next line, the bus
+|  time in usec (hex;  decimal in interactive mode).  If the transfer fails,
+|  the response is the TwiStatus_t error code (twi.h), with the error code '!'.
+*/
+void  twi_read_cmd( void )
+{
+	char  * pcArg = hci_arg( 3 );
+
+	if ( !twi_get_slave_reg() )  { hci_put_cmd_error();  return; }
+	sTwiXfer.ubFlags = TWI_READ | TWI_REG;
+	sTwiXfer.ubCount = 1;
+	if ( isHexDigit( *pcArg ) )
+	{
+		if ( hexatoi( pcArg ) == 0 || hexatoi( pcArg ) > TWI_MAX_BURST )
+		{
+			hci_put_cmd_error();
+			return;
+		}
+		sTwiXfer.ubCount = (uint8) hexatoi( pcArg );
+	}
+	hci_spawn( twi_read_thread );
+}
+
+
+static  PT_THREAD( twi_write_thread( pt_t *pt ) )
+{
+	PT_BEGIN( pt );
+	PT_WAIT_UNTIL( pt, twi_submit( &sTwiXfer ) );
+	PT_WAIT_XFER( pt );
+	PT_WAIT_TX( pt, 20 );
+	if ( sTwiXfer.ubStatus != TWI_OK )  twi_put_error( sTwiXfer.ubStatus );
+	else  twi_put_time();
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'TW':  TWI burst write.
+|  Cmd format:  "TW aa rr [bb bb ...]"
+|
+|  Writes the bytes bb (hex, as many as fit on the command line) to register rr
+|  of the slave at address aa (hex, 7 bits), in one transfer.  With no data, only
+|  the register address is written (e.g. to set a slave's read pointer).
+|
+|  Response:  "tttt", the bus time in usec (hex;  decimal in interactive mode).
+|  If the transfer fails, the response is the TwiStatus_t error code (twi.h),
+|  with the error code '!'.
+*/
+void  twi_write_cmd( void )
+{
+	char  * pcArg;
+	uint8   ubCount = 0;
+
+	if ( !twi_get_slave_reg() )  { hci_put_cmd_error();  return; }
+	for ( pcArg = hci_arg( 3 );  isHexDigit( *pcArg ) && ubCount < TWI_MAX_BURST;  pcArg = hci_arg( 3 + ubCount ) )
+	{
+		if ( hexatoi( pcArg ) > 0xFF )  { hci_put_cmd_error();  return; }
+		abTwiData[ubCount++] = (uint8) hexatoi( pcArg );
+	}
+	sTwiXfer.ubFlags = TWI_REG;
+	sTwiXfer.ubCount = ubCount;
+	hci_spawn( twi_write_thread );
+}
+
+#else
+
+void  twi_scan_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  twi_read_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  twi_write_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // TWI_SUPPORTED
+
+// end
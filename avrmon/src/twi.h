@@ -0,0 +1,83 @@
+/*
+*   twi.h  --  Interrupt-driven TWI (I2C) master driver, with transaction queue
+*
+*   A transfer is described by a twi_xfer_t, which the caller owns and keeps until
+*   it is finished.  twi_submit() puts it in the queue;  the TWI ISR runs each
+*   transfer in turn, from START to STOP, without any background processing, so
+*   bursts go at bus speed.  The caller polls ubStatus (e.g. with PT_WAIT_UNTIL in
+*   a protothread) until it is no longer TWI_QUEUED or TWI_ACTIVE.
+*
+*   A transfer addresses slave ubSlave (7-bit address) and, if the TWI_REG flag is
+*   set, first writes the register address ubReg.  A write then sends ubCount bytes
+*   from pbData;  a read (TWI_READ flag) does a repeated START (if a register
+*   address was written) and reads ubCount bytes into pbData, the last one NACK'd.
+*   A write of zero bytes without TWI_REG only addresses the slave ("ping").
+*
+*       static  uint8   abData[6];
+*       static  twi_xfer_t  sXfer = { 0x68, 0x3B, TWI_READ | TWI_REG, 6, abData };
+*
+*       twi_submit( &sXfer );
+*       PT_WAIT_UNTIL( pt, !twi_busy( &sXfer ) );
+*       if ( sXfer.ubStatus == TWI_OK ) ...
+*
+*   On ATmega328P, SDA and SCL are on PC4 and PC5, which then are not driven by
+*   the LED port output (see LED_7SEG_MASK).  The bus needs external pull-up
+*   resistors.
+*   'TS', 'TR' and 'TW' commands scan the bus and read/write a device register.
+*/
+#ifndef  _TWI_H_
+#define  _TWI_H_
+
+#include "system.h"
+
+#define  TWI_BUS_FREQ     100000UL    // SCL frequency (Hz), 100k or 400k
+#define  TWI_QUEUE_SIZE        4      // Transfers queued (power of 2)
+#define  TWI_MAX_BURST        32      // Largest transfer by 'TR' (bytes)
+#define  TWI_TIMEOUT_MS       25      // Bus hung if a transfer takes longer (msec)
+
+// TWBR = (CLOCK_FREQ / TWI_BUS_FREQ - 16) / 2, with prescaler 1, must be 0..255
+#if (CLOCK_FREQ / TWI_BUS_FREQ) < 16 || (CLOCK_FREQ / TWI_BUS_FREQ) > (16 + 2 * 255)
+#error "TWI_BUS_FREQ is out of range for CLOCK_FREQ (TWBR)"
+#endif
+
+// Transfer flags (ubFlags)
+#define  TWI_READ         BIT_0       // Read from slave (else write)
+#define  TWI_REG          BIT_1       // Write register address ubReg first
+
+// Transfer status (ubStatus)
+enum  TwiStatus_t
+{
+	TWI_OK = 0,                       // Done
+	TWI_QUEUED,                       // Waiting in the queue
+	TWI_ACTIVE,                       // In progress
+	TWI_ERR_ADDR_NACK,                // Slave did not acknowledge its address
+	TWI_ERR_DATA_NACK,                // Slave did not acknowledge a data byte
+	TWI_ERR_ARB_LOST,                 // Arbitration lost (another master)
+	TWI_ERR_BUS,                      // Bus error (illegal START/STOP) or bad state
+	TWI_ERR_TIMEOUT                   // Transfer timed out (reset by twi_reset)
+};
+
+typedef  struct  TwiXfer_t
+{
+	uint8    ubSlave;                 // Slave address (7 bits)
+	uint8    ubReg;                   // Register address (with TWI_REG)
+	uint8    ubFlags;                 // TWI_READ, TWI_REG
+	uint8    ubCount;                 // Number of data bytes
+	uint8   *pbData;                  // Data buffer
+	volatile  uint8  ubStatus;        // TWI_OK, TWI_QUEUED, TWI_ACTIVE or error
+	uint8    ubDone;                  // Data bytes transferred
+	uint16   uwTime;                  // Bus time, START to STOP (usec)
+}
+twi_xfer_t;
+
+#define  twi_busy(psXfer)   ((psXfer)->ubStatus == TWI_QUEUED || (psXfer)->ubStatus == TWI_ACTIVE)
+
+void   twi_init( void );
+bool   twi_submit( twi_xfer_t *psXfer );
+void   twi_reset( void );
+
+void   twi_scan_cmd( void );
+void   twi_read_cmd( void );
+void   twi_write_cmd( void );
+
+#endif  /* _TWI_H_ */
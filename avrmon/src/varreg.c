@@ -0,0 +1,229 @@
+/*____________________________________________________________________________*\
+|
+|  File:        varreg.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Variable registry (optional, VARREG_SUPPORTED).  The registry is built in
+|  flash from vartab.h;  the 'Vx' commands list it and read and write the
+|  variables by ID, using the typed variable access of 'RV' and 'WV' (cmnd.c).
+|  See varreg.h.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "wdog.h"
+#include  "varreg.h"
+
+#if VARREG_SUPPORTED
+
+// Registry entry, in flash
+struct  VarEntry_t
+{
+	uint8   *pubAddr;               // Data address
+	char     cType;                 // B|W|L|F (element type)
+	uint8    ubSize;                // sizeof variable, bytes
+	char     cAccess;               // R|W
+	char     acName[VAR_NAME_SIZE];
+};
+
+/*****
+|   Registry -- built from vartab.h.
+*/
+#define  VAR( name, var, type, access )    { (uint8 *) &(var), type, sizeof(var), access, name },
+
+const  struct  VarEntry_t  asVarTable[] PROGMEM =
+{
+#include  "vartab.h"
+} ;
+
+#undef   VAR
+
+#define  VAR_COUNT   ((uint8) (sizeof(asVarTable) / sizeof(struct VarEntry_t)))
+
+static  uint8   ubVarIndex;             // 'VL' and 'VB' progress
+
+
+/*
+|   Parse a variable ID argument (2 hex digits).  Returns 0xFF if not valid.
+*/
+static  uint8  var_get_id( char *pcArg )
+{
+	uint8   ubID;
+
+	if ( !isHexDigit( pcArg[0] ) || !isHexDigit( pcArg[1] ) || isHexDigit( pcArg[2] ) )
+		return  0xFF;
+	ubID = (uint8) hexatoi( pcArg );
+	return  ( ubID < VAR_COUNT ) ? ubID : 0xFF;
+}
+
+
+/*
+|   Output the value of variable ubID:  elements in index order, each MS digit first.
+*/
+static  void  var_put( uint8 ubID )
+{
+	const struct VarEntry_t  *psVar = &asVarTable[ubID];
+	uint8   ubSize = pgm_read_byte( &psVar->ubSize );
+	uint8   ubElem = var_size( pgm_read_byte( &psVar->cType ) );
+	uint8   aubValue[VAR_SIZE_MAX];
+	uint8   ubx;
+
+	if ( ubSize > VAR_SIZE_MAX )  ubSize = VAR_SIZE_MAX;
+	var_read( (uint8 *) pgm_read_word( &psVar->pubAddr ), aubValue, ubSize );
+	for ( ubx = 0;  ubx + ubElem <= ubSize;  ubx += ubElem )
+		var_put_value( &aubValue[ubx], ubElem );
+}
+
+
+static  PT_THREAD( var_list_thread( pt_t *pt ) )
+{
+	const struct VarEntry_t  *psVar;
+
+	PT_BEGIN( pt );
+
+	for ( ubVarIndex = 0;  ubVarIndex < VAR_COUNT;  ubVarIndex++ )
+	{
+		PT_WAIT_TX( pt, 32 );       // one line, up to 30 chars
+		psVar = &asVarTable[ubVarIndex];
+		putHexByte( ubVarIndex );
+		putch( SPACE );
+		putch( pgm_read_byte( &psVar->cType ) );
+		putch( SPACE );
+		putHexByte( pgm_read_byte( &psVar->ubSize ) );
+		putch( SPACE );
+		putch( pgm_read_byte( &psVar->cAccess ) );
+		putch( SPACE );
+		putHexWord( pgm_read_word( &psVar->pubAddr ) );
+		putch( SPACE );
+		putstr_P( psVar->acName );
+		NEW_LINE;
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'VL':  List the variable registry.
+|  Cmd format:  "VL"
+|  Response:  one line per variable, "ii t ss a aaaa name" (see varreg.h).
+*/
+void  var_list_cmd( void )
+{
+	hci_spawn( var_list_thread );
+}
+
+
+/*
+|  Command function 'VR':  Read a registered variable.
+|  Cmd format:  "VR ii"   where ii = variable ID (hex).
+*/
+void  var_read_cmd( void )
+{
+	uint8   ubID = var_get_id( hci_arg( 1 ) );
+
+	if ( ubID == 0xFF )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	if ( hci_interactive() )  putch( SPACE );
+	var_put( ubID );
+}
+
+
+/*
+|  Command function 'VW':  Write a registered variable.
+|  Cmd format:  "VW ii vvvvvvvv"   where ii = variable ID (hex), v = value (hex,
+|  as for 'WV').  The variable must have W access, and not be an array.
+*/
+void  var_write_cmd( void )
+{
+	const struct VarEntry_t  *psVar;
+	uint8   ubID = var_get_id( hci_arg( 1 ) );
+	uint8   ubSize;
+
+	if ( ubID == 0xFF )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	psVar = &asVarTable[ubID];
+	ubSize = pgm_read_byte( &psVar->ubSize );
+
+	if ( pgm_read_byte( &psVar->cAccess ) != 'W'
+	||   ubSize != var_size( pgm_read_byte( &psVar->cType ) )
+	||   !var_write( (uint8 *) pgm_read_word( &psVar->pubAddr ), ubSize, hci_arg( 2 ) ) )
+	{
+		hci_put_cmd_error();
+	}
+}
+
+
+static  PT_THREAD( var_batch_thread( pt_t *pt ) )
+{
+	PT_BEGIN( pt );
+
+	for ( ubVarIndex = 1;  *hci_arg( ubVarIndex ) != NUL;  ubVarIndex++ )
+	{
+		PT_WAIT_TX( pt, VAR_SIZE_MAX * 2 + 1 );
+		if ( ubVarIndex > 1 || hci_interactive() )  putch( SPACE );
+		var_put( var_get_id( hci_arg( ubVarIndex ) ) );
+	}
+	PT_END( pt );
+}
+
+
+/*
+|  Command function 'VB':  Batched read of registered variables.
+|  Cmd format:  "VB ii [ii..]"   where ii = variable ID (hex).
+|  Response:  the values, separated by spaces, in the order given.
+|  If any ID is not valid, no values are output.
+*/
+void  var_batch_cmd( void )
+{
+	uint8   ubArg;
+
+	if ( *hci_arg( 1 ) == NUL )
+	{
+		hci_put_cmd_error();
+		return;
+	}
+	for ( ubArg = 1;  *hci_arg( ubArg ) != NUL;  ubArg++ )
+	{
+		if ( var_get_id( hci_arg( ubArg ) ) == 0xFF )
+		{
+			hci_put_cmd_error();
+			return;
+		}
+	}
+	hci_spawn( var_batch_thread );
+}
+
+#else
+
+void  var_list_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  var_read_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  var_write_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  var_batch_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+#endif  // VARREG_SUPPORTED
+
+// end
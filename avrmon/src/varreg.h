@@ -0,0 +1,32 @@
+/*
+*   varreg.h  --  Variable registry:  named variables, read and written by ID
+*
+*   Variables declared in vartab.h are listed in a flash-resident registry, with
+*   name, address, type, size and access, so host tools need not know addresses
+*   that change with every build.  A tool lists the registry once with 'VL', then
+*   reads and writes variables by their 2-digit ID.  Values are copied with
+*   interrupts disabled (see 'RV'), and are hex, MS digit first;  an array is
+*   output element by element, in index order, with no separator.
+*
+*   'VL' response:  one line per variable,  "ii t ss a aaaa name"
+*      ii = ID, t = type (B|W|L|F), ss = size (bytes), a = access (R|W),
+*      aaaa = data address, name = variable name.
+*
+*   'VB ii [ii..]' reads up to 20 variables with one command;  the values are
+*   separated by spaces, in the order requested.  Each variable is copied
+*   atomically, but not the batch as a whole (use 'SN' for that).
+*/
+#ifndef  _VARREG_H_
+#define  _VARREG_H_
+
+#include "system.h"
+
+#define  VAR_NAME_SIZE      12      // Max. name length + 1 (NUL)
+#define  VAR_SIZE_MAX       16      // Max. variable (array) size, bytes
+
+void   var_list_cmd( void );
+void   var_read_cmd( void );
+void   var_write_cmd( void );
+void   var_batch_cmd( void );
+
+#endif  /* _VARREG_H_ */
@@ -0,0 +1,21 @@
+/*
+*   vartab.h  --  Variable registry table (see varreg.h)
+*
+*   One VAR() entry per registered variable:  the name (up to VAR_NAME_SIZE-1 chars),
+*   the variable, its type and access.  varreg.c includes this file to build the
+*   registry in flash;  the variable must be declared (extern) in a header included
+*   there.  The address and size are taken from the variable itself, so they follow
+*   the build.  An array of B|W|L|F elements may be registered, up to VAR_SIZE_MAX bytes.
+*
+*       type    B = uint8, W = uint16, L = uint32, F = float (element type, if an array)
+*       access  R = read-only, W = read/write ('VW')
+*
+*   Variable ID's are the table indexes, 00, 01, ..., so they change when entries are
+*   added or moved;  host tools look up the names with 'VL' rather than keeping ID's.
+*   (Application variables should go at the top)
+*/
+VAR( "sys_error",    gwSystemError,   'W', 'R' )
+VAR( "debug_flags",  gwDebugFlags,    'W', 'W' )
+VAR( "reset_cause",  gbResetCause,    'B', 'R' )
+
+// end
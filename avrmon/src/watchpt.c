@@ -0,0 +1,265 @@
+/*____________________________________________________________________________*\
+|
+|  File:        watchpt.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Memory watchpoints (optional, WATCHPOINTS_SUPPORTED).
+|  Up to WATCHPT_MAX data space locations (1, 2 or 4 bytes, with a bit mask)
+|  are compared with their previous value on every RTI tick.  Each change is
+|  appended to a ring buffer in SRAM with a microsecond timestamp and the old
+|  and new (masked) values.  The host downloads the log with 'WL'.
+|
+|  Changes are sampled at the tick rate, so several writes within one tick
+|  appear as one change.  A multi-byte variable being written by background
+|  code may be seen half-updated; such transients are logged as they are seen.
+\*____________________________________________________________________________*/
+
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "watchpt.h"
+
+#if WATCHPOINTS_SUPPORTED
+
+// Watchpoint definition
+struct  Watchpoint_t
+{
+	uint16   uwAddr;            // data space address
+	uint8    ubSize;            // 1, 2 or 4 bytes (0 => disabled)
+	uint8    ubAction;          // WP_ACT_xxx
+	uint8    ubFlagBit;         // gwDebugFlags bit number (WP_ACT_FLAG)
+	uint32   ulMask;            // bits of interest
+	uint32   ulValue;           // last (masked) value
+};
+
+// Change log entry
+struct  WatchEvent_t
+{
+	uint32   ulTime;            // microsec timer at detection
+	uint8    ubIndex;           // watchpoint number
+	uint32   ulOldValue;
+	uint32   ulNewValue;
+};
+
+volatile  bool  gyWatchActive;
+
+static  struct  Watchpoint_t  asWatchpt[WATCHPT_MAX];
+static  struct  WatchEvent_t  asWatchLog[WATCHPT_LOG_SIZE];
+static  uint8   ubLogHead;              // Index of next free log entry
+static  uint8   ubLogCount;             // Number of entries in log
+static  uint16  uwLogLost;              // Entries overwritten since last download
+static  bool    yLogFrozen;             // Logging stopped by WP_ACT_FREEZE
+
+
+/*
+|   Read a 1, 2 or 4 byte value from data space (little-endian).
+*/
+static  uint32  watch_read( uint16 uwAddr, uint8 ubSize )
+{
+	uint32  ulValue = 0;
+
+	while ( ubSize-- != 0 )
+	{
+		ulValue = (ulValue << 8) | *(volatile uint8 *) (uwAddr + ubSize);
+	}
+	return  ulValue;
+}
+
+
+/*
+|   Check watchpoints for change -- called from the RTI tick ISR when
+|   gyWatchActive is set.
+*/
+void  watchpt_check( void )
+{
+	struct  Watchpoint_t  *psWp;
+	struct  WatchEvent_t  *psEv;
+	uint32  ulValue;
+	uint8   ubIdx;
+
+	for ( ubIdx = 0;  ubIdx < WATCHPT_MAX;  ubIdx++ )
+	{
+		psWp = &asWatchpt[ubIdx];
+		if ( psWp->ubSize == 0 )  continue;
+
+		ulValue = watch_read( psWp->uwAddr, psWp->ubSize ) & psWp->ulMask;
+		if ( ulValue == psWp->ulValue )  continue;
+
+		if ( !yLogFrozen )
+		{
+			psEv = &asWatchLog[ubLogHead];
+			psEv->ulTime = microsec_timer();
+			psEv->ubIndex = ubIdx;
+			psEv->ulOldValue = psWp->ulValue;
+			psEv->ulNewValue = ulValue;
+			if ( ++ubLogHead == WATCHPT_LOG_SIZE )  ubLogHead = 0;
+			if ( ubLogCount < WATCHPT_LOG_SIZE )  ubLogCount++ ;
+			else  uwLogLost++ ;
+		}
+		psWp->ulValue = ulValue;
+
+		if ( psWp->ubAction == WP_ACT_FREEZE )  yLogFrozen = TRUE;
+		else if ( psWp->ubAction == WP_ACT_FLAG )  SET_DEBUG_FLAG( (uint16) 1 << psWp->ubFlagBit );
+		else if ( psWp->ubAction == WP_ACT_HALT )  HALT( 0x20 + ubIdx );
+	}
+}
+
+
+/*
+|  Command function 'WP':  Set, clear or list watchpoints.
+|
+|  Cmd format:  "WP n aaa s mmmmmmmm [x]"  -- set watchpoint n (0..3)
+|               "WP n"                     -- clear watchpoint n
+|               "WP"                       -- list watchpoints
+|
+|  where aaa = data space address (hex), s = size (1, 2 or 4 bytes),
+|  mmmmmmmm = bit mask (hex, up to 8 digits), and x = action on change:
+|  'F' = freeze log, 'H' = halt, 'Db' = set gwDebugFlags bit b (hex), else none.
+|
+|  List format, one line per enabled watchpoint:  "n aaaa s mmmmmmmm x vvvvvvvv"
+*/
+void  watchpt_cmd( void )
+{
+	struct  Watchpoint_t  *psWp;
+	char  * pcAct = hci_arg( 5 );
+	uint8   ubIdx = hexctobin( *hci_arg( 1 ) );
+	uint8   ubSize = hexctobin( *hci_arg( 3 ) );
+
+	if ( *hci_arg( 1 ) == NUL )         // List watchpoints
+	{
+		for ( ubIdx = 0;  ubIdx < WATCHPT_MAX;  ubIdx++ )
+		{
+			psWp = &asWatchpt[ubIdx];
+			if ( psWp->ubSize == 0 )  continue;
+			putHexDigit( ubIdx );
+			putch( SPACE );
+			putHexWord( psWp->uwAddr );
+			putch( SPACE );
+			putHexDigit( psWp->ubSize );
+			putch( SPACE );
+			putHexWord( (uint16) (psWp->ulMask >> 16) );
+			putHexWord( (uint16) psWp->ulMask );
+			putch( SPACE );
+			putHexDigit( psWp->ubAction );
+			putch( SPACE );
+			putHexWord( (uint16) (psWp->ulValue >> 16) );
+			putHexWord( (uint16) psWp->ulValue );
+			NEW_LINE;
+		}
+		return;
+	}
+	if ( ubIdx >= WATCHPT_MAX )  { hci_put_cmd_error();  return; }
+
+	psWp = &asWatchpt[ubIdx];
+	DISABLE_GLOBAL_IRQ;
+	psWp->ubSize = 0;                   // Disable while (re)defining
+	ENABLE_GLOBAL_IRQ;
+
+	if ( *hci_arg( 2 ) != NUL )         // Set watchpoint
+	{
+		if ( !isHexDigit( *hci_arg( 2 ) ) || !isHexDigit( *hci_arg( 4 ) )
+		||   (ubSize != 1 && ubSize != 2 && ubSize != 4) )
+		{
+			hci_put_cmd_error();
+		}
+		else
+		{
+			psWp->uwAddr = hexatoi( hci_arg( 2 ) );
+			psWp->ulMask = hexatol( hci_arg( 4 ) );
+			psWp->ubAction = WP_ACT_NONE;
+			if ( toupper( *pcAct ) == 'F' )  psWp->ubAction = WP_ACT_FREEZE;
+			else if ( toupper( *pcAct ) == 'H' )  psWp->ubAction = WP_ACT_HALT;
+			else if ( toupper( *pcAct ) == 'D' && isHexDigit( pcAct[1] ) )
+			{
+				psWp->ubAction = WP_ACT_FLAG;
+				psWp->ubFlagBit = hexctobin( pcAct[1] );
+			}
+			psWp->ulValue = watch_read( psWp->uwAddr, ubSize ) & psWp->ulMask;
+			DISABLE_GLOBAL_IRQ;
+			psWp->ubSize = ubSize;
+			ENABLE_GLOBAL_IRQ;
+		}
+	}
+
+	gyWatchActive = FALSE;
+	for ( ubIdx = 0;  ubIdx < WATCHPT_MAX;  ubIdx++ )
+	{
+		if ( asWatchpt[ubIdx].ubSize != 0 )  gyWatchActive = TRUE;
+	}
+}
+
+
+/*
+|  Log download protothread -- entries are removed from the log (oldest first)
+|  one at a time, so entries added during the download are not lost.
+*/
+static  PT_THREAD( watch_log_thread( pt_t *pt ) )
+{
+	static  uint8   ubCount;            // Entries to go
+	struct  WatchEvent_t  sEv;
+	uint16  uwLost;
+
+	PT_BEGIN( pt );
+	ubCount = ubLogCount;
+	while ( ubCount-- != 0 )
+	{
+		PT_WAIT_TX( pt, 32 );
+		DISABLE_GLOBAL_IRQ;
+		if ( ubLogCount == 0 )  { ENABLE_GLOBAL_IRQ;  break; }
+		sEv = asWatchLog[(ubLogHead + WATCHPT_LOG_SIZE - ubLogCount) % WATCHPT_LOG_SIZE];
+		ubLogCount-- ;
+		ENABLE_GLOBAL_IRQ;
+
+		putHexWord( (uint16) (sEv.ulTime >> 16) );
+		putHexWord( (uint16) sEv.ulTime );
+		putch( SPACE );
+		putHexDigit( sEv.ubIndex );
+		putch( SPACE );
+		putHexWord( (uint16) (sEv.ulOldValue >> 16) );
+		putHexWord( (uint16) sEv.ulOldValue );
+		putch( SPACE );
+		putHexWord( (uint16) (sEv.ulNewValue >> 16) );
+		putHexWord( (uint16) sEv.ulNewValue );
+		NEW_LINE;
+	}
+	DISABLE_GLOBAL_IRQ;
+	uwLost = uwLogLost;
+	uwLogLost = 0;
+	yLogFrozen = FALSE;
+	ENABLE_GLOBAL_IRQ;
+
+	putch( '#' );
+	putDecWord( uwLost, 5 );
+	PT_END( pt );
+}
+
+/*
+|  Command function 'WL':  Download the watchpoint change log, then clear it.
+|  The log is read out oldest entry first; a frozen log is re-armed.
+|
+|  Response:  One line per entry:  "tttttttt n oooooooo vvvvvvvv"
+|  where t = timestamp (usec), n = watchpoint #, o = old value, v = new value (hex);
+|  then a final line:  "#nnnnn" = number of entries lost by ring buffer overwrite.
+*/
+void  watch_log_cmd( void )
+{
+	hci_spawn( watch_log_thread );
+}
+
+#else
+
+void  watchpt_cmd( void )
+{
+	hci_put_cmd_error();        // Not supported in this build
+}
+
+void  watch_log_cmd( void )
+{
+	hci_put_cmd_error();
+}
+
+#endif  // WATCHPOINTS_SUPPORTED
+
+// end
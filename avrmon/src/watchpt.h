@@ -0,0 +1,24 @@
+/*
+*   watchpt.h  --  Memory watchpoints with timestamped change log
+*/
+#ifndef  _WATCHPT_H_
+#define  _WATCHPT_H_
+
+#include "system.h"
+
+#define  WATCHPT_MAX             4      // Number of watchpoints
+#define  WATCHPT_LOG_SIZE       16      // Change log entries (ring buffer)
+
+// Action on change (watchpoint option)
+#define  WP_ACT_NONE             0      // Log only
+#define  WP_ACT_FREEZE           1      // Log, then freeze the log
+#define  WP_ACT_HALT             2      // Log, then HALT() with code 0x20 + watchpoint #
+#define  WP_ACT_FLAG             3      // Log, and set a gwDebugFlags bit
+
+extern  volatile  bool  gyWatchActive;  // TRUE if any watchpoint is enabled
+
+void   watchpt_check( void );
+void   watchpt_cmd( void );
+void   watch_log_cmd( void );
+
+#endif  /* _WATCHPT_H_ */
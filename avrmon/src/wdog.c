@@ -0,0 +1,257 @@
+/*____________________________________________________________________________*\
+|
+|  File:        wdog.c
+|  Compiler:    GNU-AVR-GCC
+|
+|  Project:     Stand-alone 'AVR Operating System' (debug monitor).
+|
+|  Watchdog supervisor.  Each registered task must check in (wdog_checkin())
+|  within its deadline; the hardware watchdog is kicked only while every
+|  registered task is on time, so a hung or starved task causes a watchdog
+|  reset after WDOG_TIMEOUT.  Missed deadlines, the longest check-in interval
+|  of each task and main loop iteration time are recorded for the 'WS' command.
+|
+|  The MCU reset cause (MCUSR) is captured at boot, before the C run-time
+|  start-up code, and is reported by 'WS'.
+\*____________________________________________________________________________*/
+
+#include  <avr/wdt.h>
+#include  "system.h"
+#include  "periph.h"
+#include  "cmnd.h"
+#include  "wdog.h"
+
+// Supervised task record
+struct  WdogTask_t
+{
+	uint16   uwDeadline;        // max. check-in interval, msec (0 => unused)
+	uint16   uwLastCheckin;     // time of last check-in (msec timer, LS word)
+	uint16   uwMaxInterval;     // longest check-in interval seen, msec
+	uint16   uwMisses;          // number of missed deadlines
+	bool     yLate;             // overdue at last service (miss counted)
+};
+
+uint8   gbResetCause  __attribute__ ((section (".noinit")));
+
+static  struct  WdogTask_t  asWdogTask[WDOG_MAX_TASKS];
+static  uint16  uwLoopStartTime;        // Start time of current main loop iteration
+static  uint16  uwLoopMaxTime;          // Longest main loop iteration, msec
+static  uint16  uwLoopOverruns;         // Iterations exceeding WDOG_LOOP_LIMIT_MS
+
+
+/*
+|   Capture and clear the MCU reset flags, then stop the watchdog.
+|   This code is placed in section .init3, so it runs before .bss is cleared;
+|   after a watchdog reset the WDT stays enabled (at its shortest period) until
+|   WDRF is cleared, so it must be turned off before the start-up code runs.
+*/
+void  wdog_early_init( void )  __attribute__ ((naked, used, section (".init3")));
+
+void  wdog_early_init( void )
+{
+	gbResetCause = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+
+/*
+|   Initialise the supervisor, register the scheduled periodic tasks and
+|   start the hardware watchdog (if WATCHDOG_SUPPORTED).
+|   Called from main() after the tick timer is set up.
+*/
+void  wdog_init( void )
+{
+	if ( gbResetCause & (1<<WDRF) )  gwSystemError |= SYS_ERR_WDT_RESET;
+
+	wdog_register( WDOG_TASK_5MS, WDOG_DEADLINE_5MS );
+	wdog_register( WDOG_TASK_50MS, WDOG_DEADLINE_50MS );
+	wdog_register( WDOG_TASK_500MS, WDOG_DEADLINE_500MS );
+	uwLoopStartTime = (uint16) millisec_timer();
+
+#if WATCHDOG_SUPPORTED
+	wdt_enable( WDOG_TIMEOUT );
+#if CRASH_MAILBOX_SUPPORTED
+	WDTCSR |= (1<<WDIE);        // interrupt, then reset (see crash.h)
+#endif
+#endif
+}
+
+
+/*
+|   Register a task to be supervised.
+|   The task must call wdog_checkin() at intervals not exceeding uwDeadline (msec).
+|   A deadline of zero removes the task from supervision.
+*/
+void  wdog_register( uint8 ubTask, uint16 uwDeadline )
+{
+	if ( ubTask >= WDOG_MAX_TASKS )  return;
+
+	asWdogTask[ubTask].uwDeadline = uwDeadline;
+	asWdogTask[ubTask].uwLastCheckin = (uint16) millisec_timer();
+	asWdogTask[ubTask].uwMaxInterval = 0;
+	asWdogTask[ubTask].uwMisses = 0;
+	asWdogTask[ubTask].yLate = FALSE;
+}
+
+
+/*
+|   Task check-in -- to be called by a supervised task each time it runs.
+|   The interval since the previous check-in is recorded.
+*/
+void  wdog_checkin( uint8 ubTask )
+{
+	struct  WdogTask_t  *psTask;
+	uint16  uwNow = (uint16) millisec_timer();
+	uint16  uwInterval;
+
+	if ( ubTask >= WDOG_MAX_TASKS )  return;
+
+	psTask = &asWdogTask[ubTask];
+	uwInterval = uwNow - psTask->uwLastCheckin;
+	if ( uwInterval > psTask->uwMaxInterval )  psTask->uwMaxInterval = uwInterval;
+	psTask->uwLastCheckin = uwNow;
+}
+
+
+/*
+|   Supervisor service routine -- called from the 5ms periodic task.
+|   Checks every registered task against its deadline; the hardware watchdog
+|   is kicked only if all tasks are on time.  A miss is counted once per overdue
+|   period of each task, i.e. when that task goes from on time to late.
+*/
+void  wdog_service( void )
+{
+	uint16  uwNow = (uint16) millisec_timer();
+	bool    yLate = FALSE;
+	uint8   ubTask;
+
+	for ( ubTask = 0;  ubTask < WDOG_MAX_TASKS;  ubTask++ )
+	{
+		struct  WdogTask_t  *psTask = &asWdogTask[ubTask];
+
+		if ( psTask->uwDeadline == 0 )  continue;
+		if ( (uint16)(uwNow - psTask->uwLastCheckin) > psTask->uwDeadline )
+		{
+			if ( !psTask->yLate )
+			{
+				psTask->uwMisses++ ;
+				gwSystemError |= SYS_ERR_TASK_DEADLINE;
+			}
+			psTask->yLate = TRUE;
+			yLate = TRUE;
+		}
+		else  psTask->yLate = FALSE;
+	}
+
+#if WATCHDOG_SUPPORTED
+	if ( !yLate )  wdt_reset();
+#endif
+}
+
+
+/*
+|   Return the ID of the first supervised task which is overdue, or 0xFF if none.
+|   May be called from an ISR.
+*/
+uint8  wdog_late_task( void )
+{
+	uint16  uwNow = (uint16) millisec_timer();
+	uint8   ubTask;
+
+	for ( ubTask = 0;  ubTask < WDOG_MAX_TASKS;  ubTask++ )
+	{
+		struct  WdogTask_t  *psTask = &asWdogTask[ubTask];
+
+		if ( psTask->uwDeadline != 0
+		&&   (uint16)(uwNow - psTask->uwLastCheckin) > psTask->uwDeadline )  return  ubTask;
+	}
+	return  0xFF;
+}
+
+
+/*
+|   Main loop iteration marker -- called once per pass of the main loop.
+|   Measures the time since the previous call against WDOG_LOOP_LIMIT_MS.
+*/
+void  wdog_loop_mark( void )
+{
+	uint16  uwNow = (uint16) millisec_timer();
+	uint16  uwLoopTime = uwNow - uwLoopStartTime;
+
+	if ( uwLoopTime > uwLoopMaxTime )  uwLoopMaxTime = uwLoopTime;
+	if ( uwLoopTime > WDOG_LOOP_LIMIT_MS )
+	{
+		uwLoopOverruns++ ;
+		gwSystemError |= SYS_ERR_LOOP_OVERRUN;
+	}
+	uwLoopStartTime = uwNow;
+}
+
+
+/*
+|   Force a clean MCU reset by watchdog timeout (shortest period).
+|   Does not return.
+*/
+void  wdog_force_reset( void )
+{
+	DISABLE_GLOBAL_IRQ;
+	wdt_enable( WDTO_15MS );
+	while ( 1 )  continue;
+}
+
+
+const  char  acResetFlagNames[] PROGMEM = "POEXBOWD";   // MCUSR bits 0..3
+
+/*
+|  Command function 'WS':  Show watchdog supervisor status, then clear statistics.
+|
+|  Response format:
+|      Line 1:  cc  -- reset cause (MCUSR flags, hex) [+ flag names if interactive]
+|      Line 2:  mmmmm nnnnn  -- longest loop time (ms), loop overruns
+|      Then for each registered task:
+|               t ddddd mmmmm nnnnn  -- task ID, deadline (ms), longest interval (ms), misses
+*/
+void  wdog_status_cmd( void )
+{
+	uint8   ubTask, ubBit;
+
+	putHexByte( gbResetCause );
+	if ( hci_interactive() )
+	{
+		for ( ubBit = 0;  ubBit < 4;  ubBit++ )
+		{
+			if ( gbResetCause & (1 << ubBit) )
+			{
+				putch( SPACE );
+				putch( pgm_read_byte( &acResetFlagNames[ubBit * 2] ) );
+				putch( pgm_read_byte( &acResetFlagNames[ubBit * 2 + 1] ) );
+			}
+		}
+	}
+	NEW_LINE;
+	putDecWord( uwLoopMaxTime, 5 );
+	putch( SPACE );
+	putDecWord( uwLoopOverruns, 5 );
+
+	for ( ubTask = 0;  ubTask < WDOG_MAX_TASKS;  ubTask++ )
+	{
+		struct  WdogTask_t  *psTask = &asWdogTask[ubTask];
+
+		if ( psTask->uwDeadline == 0 )  continue;
+		NEW_LINE;
+		putHexDigit( ubTask );
+		putch( SPACE );
+		putDecWord( psTask->uwDeadline, 5 );
+		putch( SPACE );
+		putDecWord( psTask->uwMaxInterval, 5 );
+		putch( SPACE );
+		putDecWord( psTask->uwMisses, 5 );
+		psTask->uwMaxInterval = 0;
+		psTask->uwMisses = 0;
+	}
+	uwLoopMaxTime = 0;
+	uwLoopOverruns = 0;
+}
+
+// end
@@ -0,0 +1,38 @@
+/*
+*   wdog.h  --  Watchdog supervisor
+*/
+#ifndef  _WDOG_H_
+#define  _WDOG_H_
+
+#include "system.h"
+
+#define  WDOG_TIMEOUT          WDTO_2S    // Hardware watchdog period (see avr/wdt.h)
+#define  WDOG_LOOP_LIMIT_MS       50      // Main loop iteration time limit, msec
+#define  WDOG_MAX_TASKS            8      // Number of supervised task slots
+
+// Supervised task ID's -- application tasks may use the remaining slots
+enum  WdogTaskID_t
+{
+	WDOG_TASK_5MS = 0,
+	WDOG_TASK_50MS,
+	WDOG_TASK_500MS,
+	WDOG_TASK_APP                       // First application task ID
+};
+
+// Deadlines for the scheduled periodic tasks (max. interval between check-ins, msec)
+#define  WDOG_DEADLINE_5MS       100
+#define  WDOG_DEADLINE_50MS      250
+#define  WDOG_DEADLINE_500MS    1000
+
+extern  uint8   gbResetCause;           // MCUSR reset flags captured at boot
+
+void   wdog_init( void );
+void   wdog_register( uint8 ubTask, uint16 uwDeadline );
+void   wdog_checkin( uint8 ubTask );
+void   wdog_service( void );
+void   wdog_loop_mark( void );
+uint8  wdog_late_task( void );
+void   wdog_force_reset( void );
+void   wdog_status_cmd( void );
+
+#endif  /* _WDOG_H_ */
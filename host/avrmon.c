@@ -0,0 +1,1110 @@
+/*____________________________________________________________________________*\
+|
+|  File:        avrmon.c
+|  Compiler:    GCC (Linux host)
+|
+|  Host client library for the AVR monitor "host command interface" (HCI).
+|  Reference implementation for driving the monitor from a Linux host:
+|  serial port set-up, command/response framing, request pipelining,
+|  response parsing and link statistics.  See avrmon.h for the API.
+\*____________________________________________________________________________*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "avrmon.h"
+
+#define  ASCII_CR        13
+#define  ASCII_LF        10
+#define  ASCII_ESC       27
+
+// Connection state
+struct  avrmon
+{
+	int       fd;
+	int       yOwnFd;           // fd was opened by avrmon_open()
+	int       iDepth;           // pipeline depth = monitor RX buffer size, bytes
+	int       iTimeout;         // response timeout, msec
+	int       iNode;            // node address (multi-drop bus), 0 = none
+	char     *pcRx;             // received data not yet consumed
+	size_t    nRx;
+	size_t    nRxAlloc;
+	// statistics
+	unsigned long  ulCommands;
+	unsigned long  ulErrors;
+	unsigned long  ulTxBytes;
+	unsigned long  ulRxBytes;
+	double    dMinRtt;
+	double    dMaxRtt;
+	double    dSumRtt;
+	double    dStatStart;
+};
+
+
+static  int  hexval( char c );
+
+
+static  double  now_sec( void )
+{
+	struct timespec  ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return  ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static  speed_t  baud_to_speed( int iBaud )
+{
+	switch ( iBaud )
+	{
+	case 9600:    return  B9600;
+	case 19200:   return  B19200;
+	case 38400:   return  B38400;
+	case 57600:   return  B57600;
+	case 115200:  return  B115200;
+	case 230400:  return  B230400;
+	default:      return  B0;
+	}
+}
+
+
+/*
+|  Write a whole buffer to the port.
+*/
+static  int  write_all( avrmon_t *psMon, const char *pc, size_t n )
+{
+	ssize_t  nDone;
+
+	while ( n != 0 )
+	{
+		nDone = write( psMon->fd, pc, n );
+		if ( nDone < 0 )
+		{
+			if ( errno == EINTR || errno == EAGAIN )  continue;
+			return  AVRMON_ERR_IO;
+		}
+		pc += nDone;
+		n -= (size_t) nDone;
+		psMon->ulTxBytes += (unsigned long) nDone;
+	}
+	return  AVRMON_OK;
+}
+
+
+/*
+|  Read whatever is available into the RX buffer, waiting until dDeadline at most.
+*/
+static  int  fill_rx( avrmon_t *psMon, double dDeadline )
+{
+	struct pollfd  sPoll = { psMon->fd, POLLIN, 0 };
+	int      iWait = (int) ((dDeadline - now_sec()) * 1000.0);
+	ssize_t  nRead;
+
+	if ( iWait < 0 )  return  AVRMON_ERR_TIMEOUT;
+	if ( poll( &sPoll, 1, iWait ) <= 0 )  return  AVRMON_ERR_TIMEOUT;
+
+	if ( psMon->nRx + 4096 > psMon->nRxAlloc )
+	{
+		size_t  nNew = psMon->nRxAlloc * 2 + 4096;
+		char   *pcNew = realloc( psMon->pcRx, nNew );
+
+		if ( pcNew == NULL )  return  AVRMON_ERR_IO;
+		psMon->pcRx = pcNew;
+		psMon->nRxAlloc = nNew;
+	}
+	nRead = read( psMon->fd, psMon->pcRx + psMon->nRx, 4096 );
+	if ( nRead < 0 && (errno == EINTR || errno == EAGAIN) )  return  AVRMON_OK;
+	if ( nRead <= 0 )  return  AVRMON_ERR_IO;
+	psMon->nRx += (size_t) nRead;
+	psMon->ulRxBytes += (unsigned long) nRead;
+
+	return  AVRMON_OK;
+}
+
+
+/*
+|  Extract the next response from the RX buffer, reading more data as needed.
+|  The response terminator is CR, LF, then the response code ('-', '!' or, in
+|  interactive mode, '=' followed by '>').
+*/
+static  int  read_response( avrmon_t *psMon, avrmon_resp_t *psResp, double dDeadline )
+{
+	size_t   nScan = 0;
+	size_t   nEnd;
+	int      iResult;
+	char     c;
+
+	while ( 1 )
+	{
+		for ( ;  nScan + 2 < psMon->nRx;  nScan++ )
+		{
+			if ( psMon->pcRx[nScan] != ASCII_CR || psMon->pcRx[nScan + 1] != ASCII_LF )
+				continue;
+			c = psMon->pcRx[nScan + 2];
+			if ( c != '-' && c != '!' && c != '=' )  continue;
+
+			nEnd = nScan + 3;
+			if ( c == '=' )             // Interactive prompt "=>"
+			{
+				if ( nEnd >= psMon->nRx )  break;      // need more data
+				if ( psMon->pcRx[nEnd] == '>' )  nEnd++ ;
+			}
+			psResp->pszText = malloc( nScan + 1 );
+			if ( psResp->pszText == NULL )  return  AVRMON_ERR_IO;
+			memcpy( psResp->pszText, psMon->pcRx, nScan );
+			psResp->pszText[nScan] = '\0';
+			psResp->nLength = nScan;
+			psResp->cCode = ( c == '=' ) ? '-' : c;
+			psMon->nRx -= nEnd;
+			memmove( psMon->pcRx, psMon->pcRx + nEnd, psMon->nRx );
+			return  AVRMON_OK;
+		}
+		iResult = fill_rx( psMon, dDeadline );
+		if ( iResult != AVRMON_OK )  return  iResult;
+	}
+}
+
+
+static  void  record_rtt( avrmon_t *psMon, const avrmon_resp_t *psResp )
+{
+	psMon->ulCommands++ ;
+	if ( psResp->cCode == '!' )  psMon->ulErrors++ ;
+	if ( psMon->ulCommands == 1 || psResp->dRtt < psMon->dMinRtt )  psMon->dMinRtt = psResp->dRtt;
+	if ( psResp->dRtt > psMon->dMaxRtt )  psMon->dMaxRtt = psResp->dRtt;
+	psMon->dSumRtt += psResp->dRtt;
+}
+
+
+/*
+|  Bring the monitor to a known state: cancel any partial command (or running
+|  'WD' watch), discard pending output, then select machine mode.
+*/
+int  avrmon_sync( avrmon_t *psMon )
+{
+	avrmon_resp_t  sResp;
+	char     cEsc = ASCII_ESC;
+	double   dDeadline;
+	int      iResult;
+
+	if ( write_all( psMon, &cEsc, 1 ) != AVRMON_OK )  return  AVRMON_ERR_IO;
+	dDeadline = now_sec() + 0.2;
+	while ( fill_rx( psMon, dDeadline ) == AVRMON_OK )  continue;
+	psMon->nRx = 0;
+
+	iResult = avrmon_command( psMon, "IM 0", &sResp );
+	if ( iResult == AVRMON_OK )  avrmon_resp_free( &sResp );
+	avrmon_reset_stats( psMon );
+
+	return  iResult;
+}
+
+
+avrmon_t  *avrmon_attach_node( int fd, int iNode )
+{
+	avrmon_t  *psMon = calloc( 1, sizeof(avrmon_t) );
+
+	if ( psMon == NULL )  return  NULL;
+	psMon->fd = fd;
+	psMon->iDepth = AVRMON_DEFAULT_DEPTH;
+	psMon->iTimeout = AVRMON_DEFAULT_TIMEOUT;
+	avrmon_set_node( psMon, iNode );
+
+	if ( avrmon_sync( psMon ) != AVRMON_OK )
+	{
+		free( psMon->pcRx );
+		free( psMon );
+		return  NULL;
+	}
+	return  psMon;
+}
+
+
+avrmon_t  *avrmon_attach( int fd )
+{
+	return  avrmon_attach_node( fd, 0 );
+}
+
+
+/*
+|  Connect to a Unix domain socket, e.g. that of the avrmond daemon.
+*/
+static  int  connect_socket( const char *pszPath )
+{
+	struct sockaddr_un  sAddr;
+	int    fd;
+
+	if ( strlen( pszPath ) >= sizeof(sAddr.sun_path) )  { errno = ENAMETOOLONG;  return  -1; }
+	memset( &sAddr, 0, sizeof(sAddr) );
+	sAddr.sun_family = AF_UNIX;
+	strcpy( sAddr.sun_path, pszPath );
+
+	fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( fd < 0 )  return  -1;
+	if ( connect( fd, (struct sockaddr *) &sAddr, sizeof(sAddr) ) < 0 )
+	{
+		close( fd );
+		return  -1;
+	}
+	return  fd;
+}
+
+
+avrmon_t  *avrmon_open_node( const char *pszDevice, int iBaud, int iNode )
+{
+	struct termios  sTio;
+	struct stat     sStat;
+	speed_t    tSpeed = baud_to_speed( iBaud );
+	avrmon_t  *psMon;
+	int        fd;
+
+	if ( tSpeed == B0 )  { errno = EINVAL;  return  NULL; }
+
+	if ( stat( pszDevice, &sStat ) == 0 && S_ISSOCK( sStat.st_mode ) )
+		fd = connect_socket( pszDevice );
+	else
+		fd = open( pszDevice, O_RDWR | O_NOCTTY );
+	if ( fd < 0 )  return  NULL;
+
+	if ( tcgetattr( fd, &sTio ) == 0 )      // Not a tty (e.g. socket) => leave as is
+	{
+		cfmakeraw( &sTio );
+		sTio.c_cflag |= CLOCAL | CREAD;
+		sTio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+		sTio.c_cc[VMIN] = 1;
+		sTio.c_cc[VTIME] = 0;
+		cfsetispeed( &sTio, tSpeed );
+		cfsetospeed( &sTio, tSpeed );
+		tcsetattr( fd, TCSANOW, &sTio );
+		tcflush( fd, TCIOFLUSH );
+	}
+
+	psMon = avrmon_attach_node( fd, iNode );
+	if ( psMon == NULL )  { close( fd );  return  NULL; }
+	psMon->yOwnFd = 1;
+
+	return  psMon;
+}
+
+
+avrmon_t  *avrmon_open( const char *pszDevice, int iBaud )
+{
+	return  avrmon_open_node( pszDevice, iBaud, 0 );
+}
+
+
+void  avrmon_close( avrmon_t *psMon )
+{
+	if ( psMon == NULL )  return;
+	if ( psMon->yOwnFd )  close( psMon->fd );
+	free( psMon->pcRx );
+	free( psMon );
+}
+
+
+void  avrmon_set_depth( avrmon_t *psMon, int iDepth )
+{
+	psMon->iDepth = ( iDepth > 0 ) ? iDepth : 1;
+}
+
+
+/*
+|  Address commands to a node on a multi-drop bus.  The bus is half-duplex, so
+|  a command must not be sent while a node is responding:  pipelining is off.
+*/
+void  avrmon_set_node( avrmon_t *psMon, int iNode )
+{
+	psMon->iNode = iNode & 0xFF;
+	if ( psMon->iNode != 0 )  psMon->iDepth = 1;
+}
+
+
+/*
+|  Send a command to all nodes on a multi-drop bus ("@FF ").  There is no
+|  response;  the caller should allow time for the nodes to execute it, e.g. by
+|  following it with an addressed command to each node.
+*/
+int  avrmon_broadcast( avrmon_t *psMon, const char *pszCmd )
+{
+	char    acLine[AVRMON_CMD_MAX + 2];
+	size_t  nLen = strlen( pszCmd );
+
+	if ( nLen + AVRMON_NODE_PREFIX_LEN > AVRMON_CMD_MAX )  return  AVRMON_ERR_ARG;
+	snprintf( acLine, sizeof(acLine), "@%02X %s\r", AVRMON_BROADCAST, pszCmd );
+
+	return  write_all( psMon, acLine, nLen + AVRMON_NODE_PREFIX_LEN + 1 );
+}
+
+
+void  avrmon_set_timeout( avrmon_t *psMon, int iTimeoutMs )
+{
+	psMon->iTimeout = iTimeoutMs;
+}
+
+
+int  avrmon_fd( avrmon_t *psMon )
+{
+	return  psMon->fd;
+}
+
+
+void  avrmon_resp_free( avrmon_resp_t *psResp )
+{
+	free( psResp->pszText );
+	psResp->pszText = NULL;
+	psResp->nLength = 0;
+}
+
+
+/*
+|  Execute a list of commands, pipelined.  A command is sent while the total
+|  length of the unanswered commands (including CR) does not exceed the depth;
+|  the first unanswered command is always allowed, so depth 1 = no pipelining.
+|  If a node address is set, each command is prefixed "@nn ".
+*/
+int  avrmon_pipeline( avrmon_t *psMon, const char * const *apszCmds, int nCmds,
+                      avrmon_resp_t *asResp )
+{
+	double  *adSent;
+	size_t   nInFlight = 0;
+	size_t   nLen;
+	size_t   nPrefix = ( psMon->iNode != 0 ) ? AVRMON_NODE_PREFIX_LEN : 0;
+	char     acLine[AVRMON_CMD_MAX + 2];
+	int      iSent = 0;
+	int      iDone = 0;
+	int      iResult = AVRMON_OK;
+	int      i;
+
+	for ( i = 0;  i < nCmds;  i++ )
+	{
+		if ( strlen( apszCmds[i] ) + nPrefix > AVRMON_CMD_MAX )  return  AVRMON_ERR_ARG;
+		asResp[i].pszText = NULL;
+	}
+	adSent = calloc( (size_t) nCmds + 1, sizeof(double) );
+	if ( adSent == NULL )  return  AVRMON_ERR_IO;
+
+	while ( iDone < nCmds && iResult == AVRMON_OK )
+	{
+		while ( iSent < nCmds )
+		{
+			nLen = nPrefix + strlen( apszCmds[iSent] ) + 1;
+			if ( iSent > iDone && nInFlight + nLen > (size_t) psMon->iDepth )  break;
+			if ( nPrefix != 0 )  snprintf( acLine, sizeof(acLine), "@%02X ", psMon->iNode );
+			memcpy( acLine + nPrefix, apszCmds[iSent], nLen - nPrefix - 1 );
+			acLine[nLen - 1] = ASCII_CR;
+			iResult = write_all( psMon, acLine, nLen );
+			if ( iResult != AVRMON_OK )  break;
+			adSent[iSent++] = now_sec();
+			nInFlight += nLen;
+		}
+		if ( iResult != AVRMON_OK )  break;
+
+		iResult = read_response( psMon, &asResp[iDone], now_sec() + psMon->iTimeout / 1000.0 );
+		if ( iResult != AVRMON_OK )  break;
+		asResp[iDone].dRtt = now_sec() - adSent[iDone];
+		record_rtt( psMon, &asResp[iDone] );
+		nInFlight -= nPrefix + strlen( apszCmds[iDone] ) + 1;
+		iDone++ ;
+	}
+	free( adSent );
+
+	if ( iResult != AVRMON_OK )
+	{
+		for ( i = 0;  i < iDone;  i++ )  avrmon_resp_free( &asResp[i] );
+	}
+	return  iResult;
+}
+
+
+int  avrmon_command( avrmon_t *psMon, const char *pszCmd, avrmon_resp_t *psResp )
+{
+	return  avrmon_pipeline( psMon, &pszCmd, 1, psResp );
+}
+
+
+/*
+|  Send one command without waiting for the response (with the node prefix, if
+|  set).  The caller is responsible for the pipeline depth.
+*/
+int  avrmon_send( avrmon_t *psMon, const char *pszCmd )
+{
+	char    acLine[AVRMON_CMD_MAX + 2];
+	size_t  nPrefix = ( psMon->iNode != 0 ) ? AVRMON_NODE_PREFIX_LEN : 0;
+	size_t  nLen = strlen( pszCmd );
+
+	if ( nLen + nPrefix > AVRMON_CMD_MAX )  return  AVRMON_ERR_ARG;
+	if ( nPrefix != 0 )  snprintf( acLine, sizeof(acLine), "@%02X ", psMon->iNode );
+	memcpy( acLine + nPrefix, pszCmd, nLen );
+	acLine[nPrefix + nLen] = ASCII_CR;
+
+	return  write_all( psMon, acLine, nPrefix + nLen + 1 );
+}
+
+
+/*
+|  Return the next response, if it is complete within iWaitMs msec (0 = only if
+|  already received), else AVRMON_ERR_TIMEOUT;  for an event loop polling
+|  avrmon_fd().  dRtt is not measured (0) and the command is not counted in the
+|  link statistics, as the library does not know when the command was sent.
+*/
+int  avrmon_recv( avrmon_t *psMon, avrmon_resp_t *psResp, int iWaitMs )
+{
+	psResp->pszText = NULL;
+	psResp->dRtt = 0;
+
+	return  read_response( psMon, psResp, now_sec() + iWaitMs / 1000.0 );
+}
+
+
+/*
+|  Execute a command expecting a short response; copies the response text into
+|  pszText (size nMax) and maps an error response to AVRMON_ERR_CMD.
+*/
+static  int  simple_command( avrmon_t *psMon, const char *pszCmd, char *pszText, size_t nMax )
+{
+	avrmon_resp_t  sResp;
+	int      iResult = avrmon_command( psMon, pszCmd, &sResp );
+
+	if ( iResult != AVRMON_OK )  return  iResult;
+	if ( pszText != NULL )
+	{
+		strncpy( pszText, sResp.pszText, nMax - 1 );
+		pszText[nMax - 1] = '\0';
+	}
+	iResult = ( sResp.cCode == '!' ) ? AVRMON_ERR_CMD : AVRMON_OK;
+	avrmon_resp_free( &sResp );
+
+	return  iResult;
+}
+
+
+/*
+|  Read nCount bytes of SPI serial flash from ulAddr ('FR'), in blocks of up to
+|  AVRMON_FLASH_BLOCK bytes.  The response is lines of hex pairs.
+*/
+int  avrmon_flash_read( avrmon_t *psMon, unsigned long ulAddr, uint8_t *abData, size_t nCount )
+{
+	avrmon_resp_t  sResp;
+	char     acCmd[24];
+	size_t   nBlock, n;
+	const char *pc;
+	int      iResult = AVRMON_OK;
+	int      hi, lo;
+
+	while ( nCount != 0 && iResult == AVRMON_OK )
+	{
+		nBlock = ( nCount > AVRMON_FLASH_BLOCK ) ? AVRMON_FLASH_BLOCK : nCount;
+		snprintf( acCmd, sizeof(acCmd), "FR %06lX %04X", ulAddr & 0xFFFFFF, (unsigned) nBlock );
+		iResult = avrmon_command( psMon, acCmd, &sResp );
+		if ( iResult != AVRMON_OK )  return  iResult;
+		if ( sResp.cCode == '!' )  iResult = AVRMON_ERR_CMD;
+
+		pc = sResp.pszText;
+		for ( n = 0;  n < nBlock && iResult == AVRMON_OK;  n++ )
+		{
+			while ( *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+			hi = hexval( pc[0] );
+			lo = ( hi < 0 ) ? -1 : hexval( pc[1] );
+			if ( lo < 0 )  iResult = AVRMON_ERR_PARSE;
+			else  abData[n] = (uint8_t) ((hi << 4) | lo);
+			pc += 2;
+		}
+		avrmon_resp_free( &sResp );
+		abData += nBlock;
+		ulAddr += nBlock;
+		nCount -= nBlock;
+	}
+	return  iResult;
+}
+
+
+/*****************************  RESPONSE PARSERS  ******************************/
+
+static  int  hexval( char c )
+{
+	if ( c >= '0' && c <= '9' )  return  c - '0';
+	if ( c >= 'A' && c <= 'F' )  return  c - 'A' + 10;
+	if ( c >= 'a' && c <= 'f' )  return  c - 'a' + 10;
+	return  -1;
+}
+
+
+/*
+|  Parse a 'Dx' dump response: lines of "AAAA  HH HH .. HH  HH .. HH  <ascii>".
+|  Returns the data and the start address; the lines must be contiguous.
+*/
+int  avrmon_parse_dump( const char *pszText, uint8_t *abData, size_t nMax,
+                        unsigned *puStart, size_t *pnCount )
+{
+	const char *pc = pszText;
+	unsigned    uAddr, uNext = 0;
+	size_t      nCount = 0;
+	int         iCol, hi, lo;
+
+	while ( *pc != '\0' )
+	{
+		while ( *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+		if ( *pc == '\0' )  break;
+
+		if ( sscanf( pc, "%4x", &uAddr ) != 1 )  return  AVRMON_ERR_PARSE;
+		if ( nCount == 0 )  { if ( puStart != NULL )  *puStart = uAddr; }
+		else if ( uAddr != uNext )  return  AVRMON_ERR_PARSE;
+		pc += 4;
+
+		for ( iCol = 0;  iCol < 16;  iCol++ )
+		{
+			while ( *pc == ' ' )  pc++ ;
+			hi = hexval( pc[0] );
+			lo = ( hi < 0 ) ? -1 : hexval( pc[1] );
+			if ( lo < 0 || nCount >= nMax )  return  AVRMON_ERR_PARSE;
+			abData[nCount++] = (uint8_t) ((hi << 4) | lo);
+			pc += 2;
+		}
+		uNext = uAddr + 16;
+		while ( *pc != '\0' && *pc != ASCII_LF )  pc++ ;     // skip ASCII column
+	}
+	if ( pnCount != NULL )  *pnCount = nCount;
+
+	return  ( nCount != 0 ) ? AVRMON_OK : AVRMON_ERR_PARSE;
+}
+
+
+/*
+|  Parse a 16-bit word output as binary digits, MS bit first ('SE', 'SF').
+*/
+int  avrmon_parse_bits( const char *pszText, uint16_t *pwValue )
+{
+	uint16_t  wValue = 0;
+	int       nBits = 0;
+
+	for ( ;  *pszText != '\0' && nBits < 16;  pszText++ )
+	{
+		if ( *pszText == '0' || *pszText == '1' )
+		{
+			wValue = (uint16_t) ((wValue << 1) | (*pszText - '0'));
+			nBits++ ;
+		}
+		else if ( *pszText != ' ' && *pszText != ASCII_CR && *pszText != ASCII_LF )
+			return  AVRMON_ERR_PARSE;
+	}
+	if ( nBits != 16 )  return  AVRMON_ERR_PARSE;
+	*pwValue = wValue;
+
+	return  AVRMON_OK;
+}
+
+
+/*
+|  Parse the 'VN' response "Vm.n.ddd [...]".
+*/
+int  avrmon_parse_version( const char *pszText, avrmon_version_t *psVer )
+{
+	while ( *pszText == ' ' || *pszText == ASCII_CR || *pszText == ASCII_LF )  pszText++ ;
+
+	if ( sscanf( pszText, "V%d.%d.%d", &psVer->iMajor, &psVer->iMinor, &psVer->iBuild ) != 3 )
+		return  AVRMON_ERR_PARSE;
+
+	return  AVRMON_OK;
+}
+
+
+/*
+|  Apply one line of 'LV' (live view) machine mode output, "+oovvoovv...", to a
+|  shadow copy of the region.  Returns the number of records applied, or
+|  AVRMON_ERR_PARSE if the line is not a record line or an offset is beyond nSize.
+*/
+int  avrmon_parse_live( const char *pszLine, uint8_t *abShadow, size_t nSize )
+{
+	const char *pc = pszLine;
+	int         nRecs = 0;
+	int         aiNyb[4], i;
+
+	while ( *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+	if ( *pc++ != '+' )  return  AVRMON_ERR_PARSE;
+
+	while ( *pc != '\0' && *pc != ASCII_CR && *pc != ASCII_LF )
+	{
+		for ( i = 0;  i < 4;  i++ )
+			if ( (aiNyb[i] = hexval( pc[i] )) < 0 )  return  AVRMON_ERR_PARSE;
+		if ( (size_t) ((aiNyb[0] << 4) | aiNyb[1]) >= nSize )  return  AVRMON_ERR_PARSE;
+		abShadow[(aiNyb[0] << 4) | aiNyb[1]] = (uint8_t) ((aiNyb[2] << 4) | aiNyb[3]);
+		nRecs++ ;
+		pc += 4;
+	}
+
+	return  nRecs;
+}
+
+
+/*****************************  STRUCTURED ACCESS  *****************************/
+
+int  avrmon_version( avrmon_t *psMon, avrmon_version_t *psVer )
+{
+	char  acText[80];
+	int   iResult = simple_command( psMon, "VN", acText, sizeof(acText) );
+
+	if ( iResult != AVRMON_OK )  return  iResult;
+	return  avrmon_parse_version( acText, psVer );
+}
+
+
+int  avrmon_errors( avrmon_t *psMon, uint16_t *pwFlags )
+{
+	char  acText[80];
+	int   iResult = simple_command( psMon, "SE", acText, sizeof(acText) );
+
+	if ( iResult != AVRMON_OK )  return  iResult;
+	return  avrmon_parse_bits( acText, pwFlags );
+}
+
+
+int  avrmon_debug_flags( avrmon_t *psMon, uint16_t *pwFlags )
+{
+	char  acText[80];
+	int   iResult = simple_command( psMon, "SF", acText, sizeof(acText) );
+
+	if ( iResult != AVRMON_OK )  return  iResult;
+	return  avrmon_parse_bits( acText, pwFlags );
+}
+
+
+int  avrmon_read_byte( avrmon_t *psMon, unsigned uAddr, uint8_t *pbValue )
+{
+	return  avrmon_read_bytes( psMon, &uAddr, 1, pbValue );
+}
+
+
+/*
+|  'WM' requires exactly 3 address digits and 2 data digits.
+*/
+int  avrmon_write_byte( avrmon_t *psMon, unsigned uAddr, uint8_t bValue )
+{
+	char  acCmd[16];
+
+	if ( uAddr > 0xFFF )  return  AVRMON_ERR_ARG;
+	snprintf( acCmd, sizeof(acCmd), "WM %03X %02X", uAddr, bValue );
+
+	return  simple_command( psMon, acCmd, NULL, 0 );
+}
+
+
+/*
+|  Read a list of data space bytes with pipelined 'RM' commands.
+*/
+int  avrmon_read_bytes( avrmon_t *psMon, const unsigned *auAddr, int nCount, uint8_t *abValue )
+{
+	avrmon_resp_t  *asResp = calloc( (size_t) nCount, sizeof(avrmon_resp_t) );
+	char          **apszCmd = calloc( (size_t) nCount, sizeof(char *) );
+	char           *pcCmds = calloc( (size_t) nCount, 12 );
+	int             iResult = AVRMON_ERR_IO;
+	int             i, hi, lo;
+
+	if ( asResp != NULL && apszCmd != NULL && pcCmds != NULL )
+	{
+		for ( i = 0;  i < nCount;  i++ )
+		{
+			apszCmd[i] = pcCmds + i * 12;
+			snprintf( apszCmd[i], 12, "RM %03X", auAddr[i] & 0xFFFF );
+		}
+		iResult = avrmon_pipeline( psMon, (const char * const *) apszCmd, nCount, asResp );
+		for ( i = 0;  i < nCount && iResult == AVRMON_OK;  i++ )
+		{
+			const char *pc = asResp[i].pszText;
+
+			while ( *pc == ' ' )  pc++ ;
+			hi = hexval( pc[0] );
+			lo = ( hi < 0 ) ? -1 : hexval( pc[1] );
+			if ( asResp[i].cCode == '!' )  iResult = AVRMON_ERR_CMD;
+			else if ( lo < 0 )  iResult = AVRMON_ERR_PARSE;
+			else  abValue[i] = (uint8_t) ((hi << 4) | lo);
+		}
+		for ( i = 0;  i < nCount;  i++ )  avrmon_resp_free( &asResp[i] );
+	}
+	free( asResp );
+	free( apszCmd );
+	free( pcCmds );
+
+	return  iResult;
+}
+
+
+/*
+|  Read ('RV') or write ('WV') a typed variable:  cType = 'B', 'W', 'L' or 'F'
+|  (uint8, uint16, uint32, float).  The monitor copies the bytes with interrupts
+|  disabled.  A float is transferred as its IEEE-754 bit pattern.
+*/
+int  avrmon_read_var( avrmon_t *psMon, char cType, unsigned uAddr, uint32_t *pulValue )
+{
+	char   acCmd[16];
+	char   acText[32];
+	char  *pcEnd;
+	const char *pc = acText;
+	int    iResult;
+
+	if ( strchr( "BWLF", cType ) == NULL || cType == '\0' )  return  AVRMON_ERR_ARG;
+	snprintf( acCmd, sizeof(acCmd), "RV %c %03X", cType, uAddr & 0xFFFF );
+	iResult = simple_command( psMon, acCmd, acText, sizeof(acText) );
+	if ( iResult != AVRMON_OK )  return  iResult;
+
+	while ( *pc == ' ' || *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+	if ( hexval( *pc ) < 0 )  return  AVRMON_ERR_PARSE;
+	*pulValue = (uint32_t) strtoul( pc, &pcEnd, 16 );
+
+	return  AVRMON_OK;
+}
+
+
+int  avrmon_write_var( avrmon_t *psMon, char cType, unsigned uAddr, uint32_t ulValue )
+{
+	char   acCmd[24];
+
+	if ( strchr( "BWLF", cType ) == NULL || cType == '\0' )  return  AVRMON_ERR_ARG;
+	if ( (cType == 'B' && ulValue > 0xFF) || (cType == 'W' && ulValue > 0xFFFF) )  return  AVRMON_ERR_ARG;
+	snprintf( acCmd, sizeof(acCmd), "WV %c %03X %lX", cType, uAddr & 0xFFFF, (unsigned long) ulValue );
+
+	return  simple_command( psMon, acCmd, NULL, 0 );
+}
+
+
+int  avrmon_read_float( avrmon_t *psMon, unsigned uAddr, float *pfValue )
+{
+	uint32_t  ulBits;
+	int       iResult = avrmon_read_var( psMon, 'F', uAddr, &ulBits );
+
+	if ( iResult == AVRMON_OK )  memcpy( pfValue, &ulBits, sizeof(float) );
+	return  iResult;
+}
+
+
+int  avrmon_write_float( avrmon_t *psMon, unsigned uAddr, float fValue )
+{
+	uint32_t  ulBits;
+
+	memcpy( &ulBits, &fValue, sizeof(float) );
+	return  avrmon_write_var( psMon, 'F', uAddr, ulBits );
+}
+
+
+static  int  var_type_size( char cType )
+{
+	switch ( cType )
+	{
+	case 'B':  return  1;
+	case 'W':  return  2;
+	case 'L':
+	case 'F':  return  4;
+	}
+	return  0;
+}
+
+
+/*
+|  Fetch the variable registry ('VL'), up to nMax entries.  Each response line is
+|  "ii t ss a aaaa name";  *pnCount is set to the number of entries.
+*/
+int  avrmon_var_list( avrmon_t *psMon, avrmon_var_t *asVar, int nMax, int *pnCount )
+{
+	avrmon_resp_t  sResp;
+	avrmon_var_t   sVar;
+	const char *pc;
+	char     acType[2], acAccess[2];
+	int      iResult;
+
+	*pnCount = 0;
+	iResult = avrmon_command( psMon, "VL", &sResp );
+	if ( iResult != AVRMON_OK )  return  iResult;
+	if ( sResp.cCode == '!' )  iResult = AVRMON_ERR_CMD;
+
+	for ( pc = sResp.pszText;  *pc != '\0' && iResult == AVRMON_OK;  pc += strcspn( pc, "\r\n" ) )
+	{
+		while ( *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+		if ( *pc == '\0' )  break;
+		memset( &sVar, 0, sizeof(sVar) );
+		if ( sscanf( pc, "%x %1s %x %1s %x %11s", (unsigned *) &sVar.iID, acType, &sVar.uSize,
+		             acAccess, &sVar.uAddr, sVar.acName ) != 6
+		||   var_type_size( acType[0] ) == 0 )
+		{
+			iResult = AVRMON_ERR_PARSE;
+			break;
+		}
+		sVar.cType = acType[0];
+		sVar.cAccess = acAccess[0];
+		if ( *pnCount < nMax )  asVar[(*pnCount)++] = sVar;
+	}
+	avrmon_resp_free( &sResp );
+
+	return  iResult;
+}
+
+
+const avrmon_var_t *avrmon_var_find( const avrmon_var_t *asVar, int nCount, const char *pszName )
+{
+	int   i;
+
+	for ( i = 0;  i < nCount;  i++ )
+	{
+		if ( strcmp( asVar[i].acName, pszName ) == 0 )  return  &asVar[i];
+	}
+	return  NULL;
+}
+
+
+int  avrmon_var_elements( const avrmon_var_t *psVar )
+{
+	int   nSize = var_type_size( psVar->cType );
+
+	return  ( nSize == 0 ) ? 0 : (int) psVar->uSize / nSize;
+}
+
+
+/*
+|  Read registered variables with 'VB' commands of up to AVRMON_VAR_BATCH ID's.
+|  The response is the values separated by spaces;  each value is the variable's
+|  elements, each of 2, 4 or 8 hex digits (by type), with no separator.
+*/
+int  avrmon_var_read( avrmon_t *psMon, const avrmon_var_t * const *apsVar, int nVars,
+                      uint32_t *aulValue )
+{
+	avrmon_resp_t  sResp;
+	char     acCmd[AVRMON_CMD_MAX + 1];
+	const char *pc;
+	int      iResult = AVRMON_OK;
+	int      iFirst, nBatch, i, k, d, nDigits, h;
+	uint32_t  ulValue;
+
+	for ( iFirst = 0;  iFirst < nVars && iResult == AVRMON_OK;  iFirst += nBatch )
+	{
+		nBatch = ( nVars - iFirst > AVRMON_VAR_BATCH ) ? AVRMON_VAR_BATCH : nVars - iFirst;
+		strcpy( acCmd, "VB" );
+		for ( i = 0;  i < nBatch;  i++ )
+			sprintf( acCmd + 2 + 3 * i, " %02X", apsVar[iFirst + i]->iID & 0xFF );
+		iResult = avrmon_command( psMon, acCmd, &sResp );
+		if ( iResult != AVRMON_OK )  return  iResult;
+		if ( sResp.cCode == '!' )  iResult = AVRMON_ERR_CMD;
+
+		pc = sResp.pszText;
+		for ( i = 0;  i < nBatch && iResult == AVRMON_OK;  i++ )
+		{
+			while ( *pc == ' ' || *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+			nDigits = 2 * var_type_size( apsVar[iFirst + i]->cType );
+			for ( k = avrmon_var_elements( apsVar[iFirst + i] );  k > 0 && iResult == AVRMON_OK;  k-- )
+			{
+				for ( ulValue = 0, d = 0;  d < nDigits;  d++ )
+				{
+					if ( (h = hexval( *pc++ )) < 0 )  { iResult = AVRMON_ERR_PARSE;  break; }
+					ulValue = (ulValue << 4) | (uint32_t) h;
+				}
+				*aulValue++ = ulValue;
+			}
+		}
+		avrmon_resp_free( &sResp );
+	}
+	return  iResult;
+}
+
+
+int  avrmon_var_write( avrmon_t *psMon, const avrmon_var_t *psVar, uint32_t ulValue )
+{
+	char   acCmd[24];
+
+	if ( psVar->cAccess != 'W' || avrmon_var_elements( psVar ) != 1 )  return  AVRMON_ERR_ARG;
+	if ( (psVar->cType == 'B' && ulValue > 0xFF) || (psVar->cType == 'W' && ulValue > 0xFFFF) )  return  AVRMON_ERR_ARG;
+	snprintf( acCmd, sizeof(acCmd), "VW %02X %lX", psVar->iID & 0xFF, (unsigned long) ulValue );
+
+	return  simple_command( psMon, acCmd, NULL, 0 );
+}
+
+
+/*
+|  Snapshot up to AVRMON_SNAP_REGIONS regions of data space with one 'SN' command.
+|  The monitor copies all the regions with interrupts disabled, so they are
+|  consistent.  The bytes are returned in abData, region after region (up to
+|  AVRMON_SNAP_MAX in total), and the monitor's timestamp timer count at the copy
+|  in *pulStamp (if not NULL).  The response is a header line "#tttttttt nnnn",
+|  then lines of "aaaa bbbbbb...".
+*/
+int  avrmon_snapshot( avrmon_t *psMon, const avrmon_region_t *asRegion, int nRegions,
+                      uint8_t *abData, uint32_t *pulStamp )
+{
+	avrmon_resp_t  sResp;
+	char     acCmd[80];
+	size_t   nLen = 2, nTotal = 0, nCount = 0;
+	unsigned long  ulStamp;
+	const char *pc;
+	char    *pcEnd;
+	int      iResult = AVRMON_OK;
+	int      i, hi, lo;
+
+	if ( nRegions < 1 || nRegions > AVRMON_SNAP_REGIONS )  return  AVRMON_ERR_ARG;
+	strcpy( acCmd, "SN" );
+	for ( i = 0;  i < nRegions;  i++ )
+	{
+		if ( asRegion[i].uCount < 1 || asRegion[i].uCount > 0xFF )  return  AVRMON_ERR_ARG;
+		nTotal += asRegion[i].uCount;
+		nLen += (size_t) snprintf( acCmd + nLen, sizeof(acCmd) - nLen, " %03X %02X",
+		                           asRegion[i].uAddr & 0xFFFF, asRegion[i].uCount );
+	}
+	if ( nTotal > AVRMON_SNAP_MAX )  return  AVRMON_ERR_ARG;
+
+	iResult = avrmon_command( psMon, acCmd, &sResp );
+	if ( iResult != AVRMON_OK )  return  iResult;
+	if ( sResp.cCode == '!' )  iResult = AVRMON_ERR_CMD;
+
+	pc = ( iResult == AVRMON_OK ) ? strchr( sResp.pszText, '#' ) : NULL;
+	if ( iResult == AVRMON_OK && pc == NULL )  iResult = AVRMON_ERR_PARSE;
+	if ( iResult == AVRMON_OK )
+	{
+		ulStamp = strtoul( pc + 1, &pcEnd, 16 );
+		if ( pulStamp != NULL )  *pulStamp = (uint32_t) ulStamp;
+		if ( strtoul( pcEnd, NULL, 16 ) != nTotal )  iResult = AVRMON_ERR_PARSE;
+		pc = strchr( pcEnd, ASCII_LF );
+	}
+	while ( iResult == AVRMON_OK && pc != NULL && nCount < nTotal )
+	{
+		while ( *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+		pc = strchr( pc, ' ' );                 // skip line address
+		if ( pc == NULL )  break;
+		pc++ ;
+		while ( nCount < nTotal && (hi = hexval( pc[0] )) >= 0 )
+		{
+			if ( (lo = hexval( pc[1] )) < 0 )  { iResult = AVRMON_ERR_PARSE;  break; }
+			abData[nCount++] = (uint8_t) ((hi << 4) | lo);
+			pc += 2;
+		}
+	}
+	if ( iResult == AVRMON_OK && nCount != nTotal )  iResult = AVRMON_ERR_PARSE;
+	avrmon_resp_free( &sResp );
+
+	return  iResult;
+}
+
+
+/*
+|  Wait on the monitor ('WT') until the byte at data space uAddr, masked with bMask,
+|  meets a condition:  cCond = 'E' (equals bValue), 'N' (not equal) or 'C' (changes).
+|  The monitor polls every pass of its main loop, or every uPeriodMs msec, for up to
+|  uTimeoutMs msec (1..65535);  the response timeout is extended to suit.  Returns
+|  AVRMON_OK if the condition was met, or AVRMON_ERR_CMD if the wait timed out;  in
+|  both cases the elapsed time (usec) and the last masked value are returned in
+|  *pulElapsed and *pbValue (if not NULL).
+*/
+int  avrmon_wait( avrmon_t *psMon, unsigned uAddr, uint8_t bMask, uint8_t bValue, char cCond,
+                  unsigned uTimeoutMs, unsigned uPeriodMs, uint32_t *pulElapsed, uint8_t *pbValue )
+{
+	avrmon_resp_t  sResp;
+	char   acCmd[40];
+	char  *pcEnd;
+	const char *pc;
+	unsigned long  ulElapsed, ulValue;
+	int    iTimeout = psMon->iTimeout;
+	int    iResult;
+
+	if ( strchr( "ENC", cCond ) == NULL || cCond == '\0' )  return  AVRMON_ERR_ARG;
+	if ( uTimeoutMs < 1 || uTimeoutMs > 0xFFFF || uPeriodMs > 0xFF )  return  AVRMON_ERR_ARG;
+	snprintf( acCmd, sizeof(acCmd), "WT %03X %02X %02X %c %X %X", uAddr & 0xFFFF,
+	          bMask, bValue, cCond, uTimeoutMs, uPeriodMs );
+	psMon->iTimeout = iTimeout + (int) uTimeoutMs + (int) uPeriodMs;
+	iResult = avrmon_command( psMon, acCmd, &sResp );
+	psMon->iTimeout = iTimeout;
+	if ( iResult != AVRMON_OK )  return  iResult;
+
+	pc = sResp.pszText;
+	while ( *pc == ' ' || *pc == ASCII_CR || *pc == ASCII_LF )  pc++ ;
+	ulElapsed = strtoul( pc, &pcEnd, 16 );
+	if ( pcEnd == pc || *pcEnd != ' ' )  iResult = AVRMON_ERR_PARSE;
+	else
+	{
+		pc = pcEnd + 1;
+		ulValue = strtoul( pc, &pcEnd, 16 );
+		if ( pcEnd == pc || ulValue > 0xFF )  iResult = AVRMON_ERR_PARSE;
+		else
+		{
+			if ( pulElapsed != NULL )  *pulElapsed = (uint32_t) ulElapsed;
+			if ( pbValue != NULL )  *pbValue = (uint8_t) ulValue;
+			if ( sResp.cCode == '!' )  iResult = AVRMON_ERR_CMD;
+		}
+	}
+	avrmon_resp_free( &sResp );
+
+	return  iResult;
+}
+
+/*
+|  Dump a block with 'DC', 'DD' (256 bytes from uAddr & ~F) or 'DE' (128 byte
+|  page, uAddr = page number).  abData must have room for 256 bytes.
+*/
+int  avrmon_dump( avrmon_t *psMon, char cSpace, unsigned uAddr,
+                  uint8_t *abData, unsigned *puStart, size_t *pnCount )
+{
+	avrmon_resp_t  sResp;
+	char     acCmd[16];
+	int      iResult;
+
+	if ( cSpace == 'E' )  snprintf( acCmd, sizeof(acCmd), "DE %02X", uAddr & 0xFF );
+	else if ( cSpace == 'C' || cSpace == 'D' )
+		snprintf( acCmd, sizeof(acCmd), "D%c %04X", cSpace, uAddr & 0xFFFF );
+	else  return  AVRMON_ERR_ARG;
+
+	iResult = avrmon_command( psMon, acCmd, &sResp );
+	if ( iResult != AVRMON_OK )  return  iResult;
+	if ( sResp.cCode == '!' )  iResult = AVRMON_ERR_CMD;
+	else  iResult = avrmon_parse_dump( sResp.pszText, abData, 256, puStart, pnCount );
+	avrmon_resp_free( &sResp );
+
+	return  iResult;
+}
+
+
+/*****************************  STATISTICS  ************************************/
+
+void  avrmon_get_stats( avrmon_t *psMon, avrmon_stats_t *psStats )
+{
+	psStats->ulCommands = psMon->ulCommands;
+	psStats->ulErrors = psMon->ulErrors;
+	psStats->ulTxBytes = psMon->ulTxBytes;
+	psStats->ulRxBytes = psMon->ulRxBytes;
+	psStats->dMinRtt = psMon->dMinRtt;
+	psStats->dMaxRtt = psMon->dMaxRtt;
+	psStats->dMeanRtt = psMon->ulCommands ? psMon->dSumRtt / psMon->ulCommands : 0.0;
+	psStats->dElapsed = now_sec() - psMon->dStatStart;
+	psStats->dCmdRate = psStats->dElapsed > 0 ? psMon->ulCommands / psStats->dElapsed : 0.0;
+	psStats->dRxRate = psStats->dElapsed > 0 ? psMon->ulRxBytes / psStats->dElapsed : 0.0;
+}
+
+
+void  avrmon_reset_stats( avrmon_t *psMon )
+{
+	psMon->ulCommands = 0;
+	psMon->ulErrors = 0;
+	psMon->ulTxBytes = 0;
+	psMon->ulRxBytes = 0;
+	psMon->dMinRtt = 0;
+	psMon->dMaxRtt = 0;
+	psMon->dSumRtt = 0;
+	psMon->dStatStart = now_sec();
+}
+
+
+const char  *avrmon_strerror( int iResult )
+{
+	switch ( iResult )
+	{
+	case AVRMON_OK:            return  "OK";
+	case AVRMON_ERR_CMD:       return  "command error response";
+	case AVRMON_ERR_IO:        return  "I/O error";
+	case AVRMON_ERR_TIMEOUT:   return  "response timeout";
+	case AVRMON_ERR_PARSE:     return  "unexpected response format";
+	case AVRMON_ERR_ARG:       return  "invalid argument";
+	default:                   return  "unknown error";
+	}
+}
+
+// end
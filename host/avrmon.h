@@ -0,0 +1,197 @@
+/*
+*   avrmon.h  --  Host client library for the AVR monitor "host command interface" (HCI)
+*
+*   The library drives the monitor in machine (non-interactive) mode: each command line
+*   is terminated by CR, and each response is the command output followed by the
+*   response terminator "\r\n" + code, where code is '-' (OK) or '!' (command error).
+*
+*   Requests may be pipelined: several commands are sent before their responses are
+*   read, as long as the total length of unanswered commands does not exceed the
+*   monitor's serial RX buffer size (SERIAL_RX_BUF_SIZE in periph.h), so no input is
+*   lost while the monitor is busy executing a command.
+*
+*   Several monitors may share the host link (RS-485 multi-drop bus), each with a
+*   node address set by its 'NA' command.  Commands are then prefixed "@nn ", and
+*   sent one at a time, as the bus is half-duplex.
+*/
+#ifndef  _AVRMON_H_
+#define  _AVRMON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define  AVRMON_DEFAULT_BAUD      19200
+#define  AVRMON_DEFAULT_DEPTH        64     // Monitor serial RX buffer size (bytes)
+#define  AVRMON_DEFAULT_TIMEOUT    2000     // Response timeout (msec)
+#define  AVRMON_CMD_MAX              63     // Monitor command buffer size (CMD_MSG_SIZE)
+#define  AVRMON_BROADCAST          0xFF     // Node address of broadcast commands
+#define  AVRMON_NODE_PREFIX_LEN       4     // Length of node address prefix "@nn "
+#define  AVRMON_FLASH_BLOCK       0x200     // Bytes per 'FR' command (avrmon_flash_read)
+#define  AVRMON_SNAP_MAX            256     // Bytes per 'SN' command, all regions (monitor may have less)
+#define  AVRMON_SNAP_REGIONS          8     // Regions per 'SN' command
+#define  AVRMON_VAR_NAME_MAX         11     // Registered variable name length (VAR_NAME_SIZE - 1)
+#define  AVRMON_VAR_SIZE_MAX         16     // Registered variable size, bytes (VAR_SIZE_MAX)
+#define  AVRMON_VAR_BATCH            19     // Variable ID's per 'VB' command (with node prefix)
+
+// Result codes
+#define  AVRMON_OK                    0
+#define  AVRMON_ERR_CMD              -1     // Monitor responded with '!' (command error)
+#define  AVRMON_ERR_IO               -2     // Serial port read/write error
+#define  AVRMON_ERR_TIMEOUT          -3     // No (complete) response within timeout
+#define  AVRMON_ERR_PARSE            -4     // Response not in expected format
+#define  AVRMON_ERR_ARG              -5     // Invalid argument (e.g. command too long)
+
+typedef  struct  avrmon  avrmon_t;
+
+// Response to one command
+typedef  struct
+{
+	char    *pszText;           // Response text, without terminator (malloc'd)
+	size_t   nLength;           // Length of text
+	char     cCode;             // Response code: '-' OK, '!' error
+	double   dRtt;              // Round-trip time (sec), from send to terminator
+}
+avrmon_resp_t;
+
+// Firmware version ('VN')
+typedef  struct
+{
+	int      iMajor;
+	int      iMinor;
+	int      iBuild;
+}
+avrmon_version_t;
+
+// Data space region (avrmon_snapshot)
+typedef  struct
+{
+	unsigned  uAddr;                // Start address
+	unsigned  uCount;               // Byte count, 1..255
+}
+avrmon_region_t;
+
+// Registered variable ('VL'), see varreg.h
+typedef  struct
+{
+	int       iID;                  // Variable ID, 00..FF
+	char      cType;                // B|W|L|F (element type, if an array)
+	unsigned  uSize;                // Size, bytes
+	char      cAccess;              // R = read-only, W = read/write
+	unsigned  uAddr;                // Data address (changes with the build)
+	char      acName[AVRMON_VAR_NAME_MAX + 1];
+}
+avrmon_var_t;
+
+// Link statistics
+typedef  struct
+{
+	unsigned long  ulCommands;      // Commands completed
+	unsigned long  ulErrors;        // Commands answered with '!'
+	unsigned long  ulTxBytes;       // Bytes sent
+	unsigned long  ulRxBytes;       // Bytes received
+	double         dMinRtt;         // Round-trip time, min/mean/max (sec)
+	double         dMeanRtt;
+	double         dMaxRtt;
+	double         dElapsed;        // Time since open or last stats reset (sec)
+	double         dCmdRate;        // Commands per second
+	double         dRxRate;         // Received bytes per second
+}
+avrmon_stats_t;
+
+
+/*
+|  Connection management.
+|  avrmon_open() opens and configures a serial device (or pty); avrmon_attach()
+|  uses an already open descriptor.  Both put the monitor into machine mode ("IM 0").
+|  If pszDevice is a Unix domain socket (see avrmond.c), avrmon_open() connects to it.
+|  The _node variants address a monitor on a multi-drop bus (iNode 01..FE, or 0 for
+|  a point-to-point link);  avrmon_set_node() switches to another node on the bus.
+*/
+avrmon_t *avrmon_open( const char *pszDevice, int iBaud );
+avrmon_t *avrmon_open_node( const char *pszDevice, int iBaud, int iNode );
+avrmon_t *avrmon_attach( int fd );
+avrmon_t *avrmon_attach_node( int fd, int iNode );
+void      avrmon_close( avrmon_t *psMon );
+void      avrmon_set_node( avrmon_t *psMon, int iNode );        // also sets depth 1
+void      avrmon_set_depth( avrmon_t *psMon, int iDepth );
+void      avrmon_set_timeout( avrmon_t *psMon, int iTimeoutMs );
+int       avrmon_fd( avrmon_t *psMon );
+int       avrmon_sync( avrmon_t *psMon );           // cancel, flush, "IM 0"; resets stats
+
+/*
+|  Generic command execution.
+|  avrmon_command() sends one command and waits for its response.
+|  avrmon_pipeline() executes nCmds commands, keeping as many in flight as the
+|  pipeline depth allows; responses are returned in asResp[] (in command order).
+|  Returns AVRMON_OK if all commands completed (some may have cCode '!'), or a
+|  negative error code.  Response text must be released with avrmon_resp_free().
+*/
+int       avrmon_command( avrmon_t *psMon, const char *pszCmd, avrmon_resp_t *psResp );
+int       avrmon_pipeline( avrmon_t *psMon, const char * const *apszCmds, int nCmds,
+                           avrmon_resp_t *asResp );
+void      avrmon_resp_free( avrmon_resp_t *psResp );
+int       avrmon_broadcast( avrmon_t *psMon, const char *pszCmd );    // no response
+
+/*
+|  Asynchronous use, from an event loop polling avrmon_fd() (see avrmond.c):
+|  avrmon_send() sends one command;  avrmon_recv() returns the next response if it
+|  arrives within iWaitMs msec, else AVRMON_ERR_TIMEOUT.  The caller keeps the
+|  unanswered commands within the pipeline depth.
+*/
+int       avrmon_send( avrmon_t *psMon, const char *pszCmd );
+int       avrmon_recv( avrmon_t *psMon, avrmon_resp_t *psResp, int iWaitMs );
+
+/*
+|  Structured access.  These return AVRMON_OK or a negative error code.
+*/
+int       avrmon_version( avrmon_t *psMon, avrmon_version_t *psVer );
+int       avrmon_errors( avrmon_t *psMon, uint16_t *pwFlags );      // 'SE' (clears flags)
+int       avrmon_debug_flags( avrmon_t *psMon, uint16_t *pwFlags ); // 'SF' (clears flags)
+int       avrmon_read_byte( avrmon_t *psMon, unsigned uAddr, uint8_t *pbValue );
+int       avrmon_write_byte( avrmon_t *psMon, unsigned uAddr, uint8_t bValue );
+int       avrmon_read_bytes( avrmon_t *psMon, const unsigned *auAddr, int nCount,
+                             uint8_t *abValue );                   // pipelined 'RM'
+int       avrmon_read_var( avrmon_t *psMon, char cType, unsigned uAddr,
+                             uint32_t *pulValue );                 // 'RV', t = B|W|L|F
+int       avrmon_write_var( avrmon_t *psMon, char cType, unsigned uAddr,
+                              uint32_t ulValue );                  // 'WV'
+int       avrmon_read_float( avrmon_t *psMon, unsigned uAddr, float *pfValue );
+int       avrmon_write_float( avrmon_t *psMon, unsigned uAddr, float fValue );
+int       avrmon_snapshot( avrmon_t *psMon, const avrmon_region_t *asRegion, int nRegions,
+                           uint8_t *abData, uint32_t *pulStamp );  // 'SN', atomic
+int       avrmon_wait( avrmon_t *psMon, unsigned uAddr, uint8_t bMask, uint8_t bValue,
+                       char cCond, unsigned uTimeoutMs, unsigned uPeriodMs,
+                       uint32_t *pulElapsed, uint8_t *pbValue );    // 'WT'
+int       avrmon_dump( avrmon_t *psMon, char cSpace, unsigned uAddr,
+                       uint8_t *abData, unsigned *puStart, size_t *pnCount );
+int       avrmon_flash_read( avrmon_t *psMon, unsigned long ulAddr, uint8_t *abData,
+                             size_t nCount );                      // SPI flash, 'FR'
+
+/*
+|  Variable registry.  avrmon_var_list() fetches the registry ('VL');  variables are
+|  then looked up by name with avrmon_var_find(), so tools need no addresses or ID's.
+|  avrmon_var_read() reads any number of variables with as few 'VB' commands as will
+|  hold their ID's (one for up to AVRMON_VAR_BATCH);  aulValue[] receives the value of
+|  each element of each variable in turn (avrmon_var_elements() per variable).
+*/
+int       avrmon_var_list( avrmon_t *psMon, avrmon_var_t *asVar, int nMax, int *pnCount );
+const avrmon_var_t *avrmon_var_find( const avrmon_var_t *asVar, int nCount, const char *pszName );
+int       avrmon_var_elements( const avrmon_var_t *psVar );
+int       avrmon_var_read( avrmon_t *psMon, const avrmon_var_t * const *apsVar, int nVars,
+                           uint32_t *aulValue );                   // 'VB'
+int       avrmon_var_write( avrmon_t *psMon, const avrmon_var_t *psVar, uint32_t ulValue );  // 'VW'
+
+/*
+|  Response parsers (usable on text captured by other means).
+*/
+int       avrmon_parse_dump( const char *pszText, uint8_t *abData, size_t nMax,
+                             unsigned *puStart, size_t *pnCount );
+int       avrmon_parse_bits( const char *pszText, uint16_t *pwValue );
+int       avrmon_parse_version( const char *pszText, avrmon_version_t *psVer );
+int       avrmon_parse_live( const char *pszLine, uint8_t *abShadow, size_t nSize );  // 'LV'
+
+void      avrmon_get_stats( avrmon_t *psMon, avrmon_stats_t *psStats );
+void      avrmon_reset_stats( avrmon_t *psMon );
+const char *avrmon_strerror( int iResult );
+
+#endif  /* _AVRMON_H_ */
@@ -0,0 +1,443 @@
+/*____________________________________________________________________________*\
+|
+|  File:        avrmon_cli.c
+|  Compiler:    GCC (Linux host)
+|
+|  Command-line client for the AVR monitor, built on the avrmon library.
+|
+|  Usage:   avrmon-cli [-d device] [-b baud] [-n node] [-p depth] [-t msec] [-s] op [args]
+|
+|      -d device    serial device, pty or avrmond socket (default /dev/ttyACM0, or $AVRMON_DEV)
+|      -b baud      baud rate (default 19200)
+|      -n node      node address on a multi-drop bus (hex, 01..FE)
+|      -p depth     pipeline depth in bytes, 1 = no pipelining (default 64;
+|                   1 if a node address is given)
+|      -t msec      response timeout (default 2000)
+|      -s           print link statistics on exit (stderr)
+|
+|  Operations:
+|      vn                     firmware version
+|      se | sf               error / debug flags (hex; flags are cleared)
+|      rm aaa [aaa ...]       read data bytes (pipelined)
+|      wm aaa bb              write data byte
+|      vl                     list the variable registry
+|      vr name [name ...]     read registered variables by name (batched)
+|      vw name value          write a registered variable (hex;  decimal if float)
+|      dc|dd aaaa | de pp     dump block as "aaaa: hh hh ..." (16 per line)
+|      fr aaaaaa nnnn [file]  read SPI flash (hex address, count) to file or stdout, binary
+|      cmd "XX args" [...]    execute raw commands (pipelined), print responses
+|      bcast "XX args"        send a command to all nodes on the bus (no response)
+|      batch [file]           execute raw commands from file or stdin (pipelined)
+|      bench [n]              time n pipelined 'RM' commands (default 1000)
+|
+|  Exit status is 0 on success, 1 if the monitor reported a command error,
+|  2 on any other failure.
+|
+|  Build:   gcc -O2 -o avrmon-cli avrmon_cli.c avrmon.c
+\*____________________________________________________________________________*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "avrmon.h"
+
+
+static  int  exit_code( int iResult )
+{
+	if ( iResult == AVRMON_OK )  return  0;
+	if ( iResult == AVRMON_ERR_CMD )  return  1;
+	return  2;
+}
+
+
+static  int  report( int iResult )
+{
+	if ( iResult != AVRMON_OK )  fprintf( stderr, "avrmon-cli: %s\n", avrmon_strerror( iResult ) );
+	return  exit_code( iResult );
+}
+
+
+/*
+|  Execute raw commands, pipelined, and print each response text.
+*/
+static  int  run_commands( avrmon_t *psMon, const char * const *apszCmds, int nCmds )
+{
+	avrmon_resp_t  *asResp = calloc( (size_t) nCmds, sizeof(avrmon_resp_t) );
+	int      iResult, i;
+	int      yError = 0;
+
+	if ( asResp == NULL )  return  report( AVRMON_ERR_IO );
+	iResult = avrmon_pipeline( psMon, apszCmds, nCmds, asResp );
+	if ( iResult == AVRMON_OK )
+	{
+		for ( i = 0;  i < nCmds;  i++ )
+		{
+			fputs( asResp[i].pszText, stdout );
+			if ( asResp[i].nLength == 0 || asResp[i].pszText[asResp[i].nLength - 1] != '\n' )
+				putchar( '\n' );
+			if ( asResp[i].cCode == '!' )
+			{
+				fprintf( stderr, "avrmon-cli: \"%s\": command error\n", apszCmds[i] );
+				yError = 1;
+			}
+			avrmon_resp_free( &asResp[i] );
+		}
+	}
+	free( asResp );
+	if ( iResult != AVRMON_OK )  return  report( iResult );
+
+	return  yError;
+}
+
+
+static  int  run_batch( avrmon_t *psMon, const char *pszFile )
+{
+	FILE    *pf = ( pszFile == NULL || strcmp( pszFile, "-" ) == 0 ) ? stdin : fopen( pszFile, "r" );
+	char   **apszCmds = NULL;
+	char     acLine[256];
+	int      nCmds = 0, iResult, i;
+
+	if ( pf == NULL )  { perror( pszFile );  return  2; }
+	while ( fgets( acLine, sizeof(acLine), pf ) != NULL )
+	{
+		acLine[strcspn( acLine, "\r\n" )] = '\0';
+		if ( acLine[0] == '\0' || acLine[0] == '#' )  continue;
+		apszCmds = realloc( apszCmds, (size_t) (nCmds + 1) * sizeof(char *) );
+		apszCmds[nCmds++] = strdup( acLine );
+	}
+	if ( pf != stdin )  fclose( pf );
+
+	iResult = nCmds ? run_commands( psMon, (const char * const *) apszCmds, nCmds ) : 0;
+	for ( i = 0;  i < nCmds;  i++ )  free( apszCmds[i] );
+	free( apszCmds );
+
+	return  iResult;
+}
+
+
+static  int  run_bench( avrmon_t *psMon, int nCount )
+{
+	unsigned  *auAddr = calloc( (size_t) nCount, sizeof(unsigned) );
+	uint8_t   *abValue = calloc( (size_t) nCount, 1 );
+	avrmon_stats_t  sStats;
+	int        iResult, i;
+
+	if ( auAddr == NULL || abValue == NULL )  return  report( AVRMON_ERR_IO );
+	for ( i = 0;  i < nCount;  i++ )  auAddr[i] = 0x100 + (unsigned) (i & 0x7FF);
+
+	avrmon_reset_stats( psMon );
+	iResult = avrmon_read_bytes( psMon, auAddr, nCount, abValue );
+	avrmon_get_stats( psMon, &sStats );
+	free( auAddr );
+	free( abValue );
+	if ( iResult != AVRMON_OK )  return  report( iResult );
+
+	printf( "%lu commands in %.3f s: %.1f cmd/s, %.0f bytes/s received\n",
+		sStats.ulCommands, sStats.dElapsed, sStats.dCmdRate, sStats.dRxRate );
+	printf( "round-trip (incl. queueing): min %.2f ms, mean %.2f ms, max %.2f ms\n",
+		sStats.dMinRtt * 1e3, sStats.dMeanRtt * 1e3, sStats.dMaxRtt * 1e3 );
+
+	return  0;
+}
+
+
+/*
+|  Variable registry:  'vl' lists it, 'vr' reads variables by name (with as few
+|  'VB' commands as possible), 'vw' writes one.
+*/
+static  int  run_vars( avrmon_t *psMon, const char *pszOp, char * const *apszArgs, int nArgs )
+{
+	avrmon_var_t  asVar[256];
+	const avrmon_var_t  **apsVar;
+	uint32_t  *aulValue;
+	float      fValue;
+	int        nVars, nValues = 0, iResult, i, k;
+
+	iResult = avrmon_var_list( psMon, asVar, 256, &nVars );
+	if ( iResult != AVRMON_OK )  return  report( iResult );
+
+	if ( pszOp[1] == 'l' )
+	{
+		for ( i = 0;  i < nVars;  i++ )
+			printf( "%02X %-11s %c %2u %c %04X\n", asVar[i].iID, asVar[i].acName, asVar[i].cType,
+			        asVar[i].uSize, asVar[i].cAccess, asVar[i].uAddr );
+		return  0;
+	}
+	apsVar = calloc( (size_t) nArgs, sizeof(avrmon_var_t *) );
+	for ( i = 0;  i < nArgs;  i++ )
+	{
+		if ( (apsVar[i] = avrmon_var_find( asVar, nVars, apszArgs[i] )) == NULL )
+		{
+			fprintf( stderr, "avrmon-cli: %s: no such variable\n", apszArgs[i] );
+			free( apsVar );
+			return  2;
+		}
+		nValues += avrmon_var_elements( apsVar[i] );
+	}
+	if ( pszOp[1] == 'w' )
+	{
+		uint32_t  ulValue = (uint32_t) strtoul( apszArgs[1], NULL, 16 );
+
+		if ( apsVar[0]->cType == 'F' )
+		{
+			fValue = strtof( apszArgs[1], NULL );
+			memcpy( &ulValue, &fValue, sizeof(float) );
+		}
+		iResult = avrmon_var_write( psMon, apsVar[0], ulValue );
+		free( apsVar );
+		return  report( iResult );
+	}
+
+	aulValue = calloc( (size_t) nValues + 1, sizeof(uint32_t) );
+	iResult = report( avrmon_var_read( psMon, apsVar, nArgs, aulValue ) );
+	for ( i = 0, nValues = 0;  i < nArgs && iResult == 0;  i++ )
+	{
+		printf( "%s", apsVar[i]->acName );
+		for ( k = avrmon_var_elements( apsVar[i] );  k > 0;  k-- )
+		{
+			if ( apsVar[i]->cType == 'F' )
+			{
+				memcpy( &fValue, &aulValue[nValues++], sizeof(float) );
+				printf( " %g", fValue );
+			}
+			else  printf( " %0*lX", apsVar[i]->cType == 'B' ? 2 : apsVar[i]->cType == 'W' ? 4 : 8,
+			              (unsigned long) aulValue[nValues++] );
+		}
+		putchar( '\n' );
+	}
+	free( aulValue );
+	free( apsVar );
+
+	return  iResult;
+}
+
+
+static  void  usage( void )
+{
+	fprintf( stderr,
+		"usage: avrmon-cli [-d device] [-b baud] [-n node] [-p depth] [-t msec] [-s] op [args]\n"
+		"ops:   vn | se | sf | rm aaa.. | wm aaa bb | dc aaaa | dd aaaa | de pp\n"
+		"       rv t aaa | wv t aaa value | sn aaa nn [aaa nn..]  (t = b|w|l|f)\n"
+		"       wt aaa mm vv [e|n|c [msec [period]]]\n"
+		"       vl | vr name [name..] | vw name value\n"
+		"       fr aaaaaa nnnn [file]\n"
+		"       cmd \"XX args\".. | bcast \"XX args\" | batch [file] | bench [n]\n" );
+}
+
+
+int  main( int argc, char **argv )
+{
+	const char *pszDevice = getenv( "AVRMON_DEV" );
+	avrmon_t   *psMon;
+	int         iBaud = AVRMON_DEFAULT_BAUD;
+	int         iDepth = 0;             // default: per node address
+	int         iNode = 0;
+	int         iTimeout = AVRMON_DEFAULT_TIMEOUT;
+	int         yStats = 0;
+	int         iExit = 0;
+	int         iOpt, i;
+	const char *pszOp;
+
+	if ( pszDevice == NULL )  pszDevice = "/dev/ttyACM0";
+	while ( (iOpt = getopt( argc, argv, "d:b:n:p:t:s" )) != -1 )
+	{
+		switch ( iOpt )
+		{
+		case 'd':  pszDevice = optarg;  break;
+		case 'b':  iBaud = atoi( optarg );  break;
+		case 'n':  iNode = (int) strtol( optarg, NULL, 16 );  break;
+		case 'p':  iDepth = atoi( optarg );  break;
+		case 't':  iTimeout = atoi( optarg );  break;
+		case 's':  yStats = 1;  break;
+		default:   usage();  return  2;
+		}
+	}
+	if ( optind >= argc )  { usage();  return  2; }
+	pszOp = argv[optind++];
+
+	psMon = avrmon_open_node( pszDevice, iBaud, iNode );
+	if ( psMon == NULL )
+	{
+		fprintf( stderr, "avrmon-cli: cannot connect to monitor on %s\n", pszDevice );
+		return  2;
+	}
+	if ( iDepth != 0 )  avrmon_set_depth( psMon, iDepth );
+	avrmon_set_timeout( psMon, iTimeout );
+
+	if ( strcmp( pszOp, "vn" ) == 0 )
+	{
+		avrmon_version_t  sVer;
+
+		iExit = report( avrmon_version( psMon, &sVer ) );
+		if ( iExit == 0 )  printf( "%d.%d.%03d\n", sVer.iMajor, sVer.iMinor, sVer.iBuild );
+	}
+	else if ( strcmp( pszOp, "se" ) == 0 || strcmp( pszOp, "sf" ) == 0 )
+	{
+		uint16_t  wFlags;
+
+		if ( pszOp[1] == 'e' )  iExit = report( avrmon_errors( psMon, &wFlags ) );
+		else  iExit = report( avrmon_debug_flags( psMon, &wFlags ) );
+		if ( iExit == 0 )  printf( "%04X\n", wFlags );
+	}
+	else if ( strcmp( pszOp, "rm" ) == 0 && optind < argc )
+	{
+		int        nCount = argc - optind;
+		unsigned  *auAddr = calloc( (size_t) nCount, sizeof(unsigned) );
+		uint8_t   *abValue = calloc( (size_t) nCount, 1 );
+
+		for ( i = 0;  i < nCount;  i++ )  auAddr[i] = (unsigned) strtoul( argv[optind + i], NULL, 16 );
+		iExit = report( avrmon_read_bytes( psMon, auAddr, nCount, abValue ) );
+		for ( i = 0;  i < nCount && iExit == 0;  i++ )  printf( "%03X %02X\n", auAddr[i], abValue[i] );
+		free( auAddr );
+		free( abValue );
+	}
+	else if ( strcmp( pszOp, "wm" ) == 0 && optind + 1 < argc )
+	{
+		iExit = report( avrmon_write_byte( psMon, (unsigned) strtoul( argv[optind], NULL, 16 ),
+			(uint8_t) strtoul( argv[optind + 1], NULL, 16 ) ) );
+	}
+	else if ( (strcmp( pszOp, "rv" ) == 0 && optind + 1 < argc)
+	||        (strcmp( pszOp, "wv" ) == 0 && optind + 2 < argc) )
+	{
+		char      cType = (char) toupper( (unsigned char) argv[optind][0] );
+		unsigned  uAddr = (unsigned) strtoul( argv[optind + 1], NULL, 16 );
+		uint32_t  ulValue;
+		float     fValue;
+
+		if ( pszOp[0] == 'r' )
+		{
+			iExit = report( avrmon_read_var( psMon, cType, uAddr, &ulValue ) );
+			if ( iExit == 0 && cType == 'F' )
+			{
+				memcpy( &fValue, &ulValue, sizeof(float) );
+				printf( "%08lX %g\n", (unsigned long) ulValue, fValue );
+			}
+			else if ( iExit == 0 )  printf( "%0*lX\n", cType == 'B' ? 2 : cType == 'W' ? 4 : 8, (unsigned long) ulValue );
+		}
+		else if ( cType == 'F' )
+			iExit = report( avrmon_write_float( psMon, uAddr, strtof( argv[optind + 2], NULL ) ) );
+		else
+			iExit = report( avrmon_write_var( psMon, cType, uAddr, (uint32_t) strtoul( argv[optind + 2], NULL, 16 ) ) );
+	}
+	else if ( strcmp( pszOp, "vl" ) == 0
+	||        (strcmp( pszOp, "vr" ) == 0 && optind < argc)
+	||        (strcmp( pszOp, "vw" ) == 0 && optind + 1 < argc) )
+	{
+		iExit = run_vars( psMon, pszOp, &argv[optind], pszOp[1] == 'w' ? 1 : argc - optind );
+	}
+	else if ( strcmp( pszOp, "sn" ) == 0 && optind + 1 < argc )
+	{
+		avrmon_region_t  asRegion[AVRMON_SNAP_REGIONS];
+		uint8_t   abData[AVRMON_SNAP_MAX];
+		uint32_t  ulStamp;
+		int       nRegions = 0;
+		size_t    n = 0, k;
+
+		while ( optind + 1 < argc && nRegions < AVRMON_SNAP_REGIONS )
+		{
+			asRegion[nRegions].uAddr = (unsigned) strtoul( argv[optind++], NULL, 16 );
+			asRegion[nRegions++].uCount = (unsigned) strtoul( argv[optind++], NULL, 16 );
+		}
+		iExit = report( avrmon_snapshot( psMon, asRegion, nRegions, abData, &ulStamp ) );
+		if ( iExit == 0 )  printf( "# %08lX\n", (unsigned long) ulStamp );
+		for ( i = 0;  i < nRegions && iExit == 0;  i++ )
+		{
+			for ( k = 0;  k < asRegion[i].uCount;  k++ )
+			{
+				if ( k % 16 == 0 )  printf( "%04X:", (unsigned) (asRegion[i].uAddr + k) );
+				printf( " %02X", abData[n++] );
+				if ( k % 16 == 15 || k + 1 == asRegion[i].uCount )  putchar( '\n' );
+			}
+		}
+	}
+	else if ( strcmp( pszOp, "wt" ) == 0 && optind + 2 < argc )
+	{
+		char      cCond = ( optind + 3 < argc ) ? (char) toupper( (unsigned char) argv[optind + 3][0] ) : 'E';
+		unsigned  uTimeout = ( optind + 4 < argc ) ? (unsigned) atoi( argv[optind + 4] ) : 1000;
+		unsigned  uPeriod = ( optind + 5 < argc ) ? (unsigned) atoi( argv[optind + 5] ) : 0;
+		uint32_t  ulElapsed;
+		uint8_t   bValue;
+
+		i = avrmon_wait( psMon, (unsigned) strtoul( argv[optind], NULL, 16 ),
+		                 (uint8_t) strtoul( argv[optind + 1], NULL, 16 ),
+		                 (uint8_t) strtoul( argv[optind + 2], NULL, 16 ),
+		                 cCond, uTimeout, uPeriod, &ulElapsed, &bValue );
+		iExit = report( i );
+		if ( i == AVRMON_OK || i == AVRMON_ERR_CMD )
+			printf( "%s %lu us %02X\n", i == AVRMON_OK ? "met" : "timeout",
+			        (unsigned long) ulElapsed, bValue );
+	}
+	else if ( pszOp[0] == 'd' && strchr( "cde", pszOp[1] ) && pszOp[2] == '\0' && optind < argc )
+	{
+		uint8_t   abData[256];
+		unsigned  uStart;
+		size_t    nCount, n;
+
+		iExit = report( avrmon_dump( psMon, (char) (pszOp[1] - 'a' + 'A'),
+			(unsigned) strtoul( argv[optind], NULL, 16 ), abData, &uStart, &nCount ) );
+		for ( n = 0;  n < nCount && iExit == 0;  n++ )
+		{
+			if ( n % 16 == 0 )  printf( "%04X:", (unsigned) (uStart + n) );
+			printf( " %02X", abData[n] );
+			if ( n % 16 == 15 )  putchar( '\n' );
+		}
+	}
+	else if ( strcmp( pszOp, "fr" ) == 0 && optind + 1 < argc )
+	{
+		size_t    nCount = (size_t) strtoul( argv[optind + 1], NULL, 16 );
+		uint8_t  *abData = malloc( nCount + 1 );
+		FILE     *pf = stdout;
+
+		iExit = report( avrmon_flash_read( psMon, strtoul( argv[optind], NULL, 16 ), abData, nCount ) );
+		if ( iExit == 0 && optind + 2 < argc && (pf = fopen( argv[optind + 2], "wb" )) == NULL )
+		{
+			perror( argv[optind + 2] );
+			iExit = 2;
+		}
+		if ( iExit == 0 )
+		{
+			fwrite( abData, 1, nCount, pf );
+			if ( pf != stdout )  fclose( pf );
+		}
+		free( abData );
+	}
+	else if ( strcmp( pszOp, "cmd" ) == 0 && optind < argc )
+	{
+		iExit = run_commands( psMon, (const char * const *) &argv[optind], argc - optind );
+	}
+	else if ( strcmp( pszOp, "bcast" ) == 0 && optind < argc )
+	{
+		iExit = report( avrmon_broadcast( psMon, argv[optind] ) );
+	}
+	else if ( strcmp( pszOp, "batch" ) == 0 )
+	{
+		iExit = run_batch( psMon, optind < argc ? argv[optind] : NULL );
+	}
+	else if ( strcmp( pszOp, "bench" ) == 0 )
+	{
+		iExit = run_bench( psMon, optind < argc ? atoi( argv[optind] ) : 1000 );
+	}
+	else
+	{
+		usage();
+		iExit = 2;
+	}
+
+	if ( yStats )
+	{
+		avrmon_stats_t  sStats;
+
+		avrmon_get_stats( psMon, &sStats );
+		fprintf( stderr, "%lu cmds (%lu errors), tx %lu rx %lu bytes, %.3f s; "
+			"rtt min/mean/max %.2f/%.2f/%.2f ms\n",
+			sStats.ulCommands, sStats.ulErrors, sStats.ulTxBytes, sStats.ulRxBytes,
+			sStats.dElapsed, sStats.dMinRtt * 1e3, sStats.dMeanRtt * 1e3, sStats.dMaxRtt * 1e3 );
+	}
+	avrmon_close( psMon );
+
+	return  iExit;
+}
+
+// end
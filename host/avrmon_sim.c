@@ -0,0 +1,1957 @@
+/*____________________________________________________________________________*\
+|
+|  File:        avrmon_sim.c
+|  Compiler:    GCC (Linux host)
+|
+|  Stand-in for the AVR monitor on a local pseudo-terminal, so that host tools
+|  (avrmon library, CLI, etc) can be exercised without a board.
+|
+|  The HCI framing rules of cmnd.c are reproduced (CR terminator, ESC/CAN
+|  cancel, echo and '=>' prompt in interactive mode, '-' and '!' response
+|  codes), as is the timing that matters for pipelining: input and output are
+|  paced at the configured baud rate, input is not consumed while a response is
+|  being sent, and input beyond the 64-byte RX buffer is dropped (and counted).
+|  Memory spaces are simulated: 2K data space, 32K flash, 1K EEPROM.
+|  A 1 Mbyte JEDEC serial flash (W25Q80) is simulated on SPI chip select 0, at
+|  the byte level, for 'SX' and the flash commands 'FI', 'FR', 'FP' and 'FE':
+|  writes need write enable, programming can only clear bits, and erases keep
+|  the flash busy for a typical erase time.
+|
+|  A variable registry ('VL', 'VR', 'VW', 'VB') of a few example variables at
+|  fixed data addresses is simulated (see asSimVar[]).
+|
+|  The dump and load commands 'Zs' (same encoder as pack.c), 'Xs', 'XL' (with the
+|  Intel HEX records) and 'EE' work on the simulated memory.  The diagnostics
+|  'CM', 'WS', 'IS', 'TL', 'PF' and 'FT' answer in the firmware formats, with
+|  made-up values (see DIAGNOSTICS).  'LV' and 'GD' take over the node's input
+|  until they end, as the command thread does:  the live view refreshes at its
+|  period until Esc;  the GDB stub (also entered by a line starting with '$')
+|  answers packets until GDB detaches or kills, or Esc is received.
+|
+|  Several monitors on a multi-drop bus may be simulated:  each node has its
+|  own address ('NA'), HCI state and data space (flash and EEPROM are shared),
+|  and all nodes receive every char sent by the host.  A node with an address
+|  executes only commands prefixed with it ("@nn ") or broadcast ("@FF "), as
+|  cmnd.c does;  if more than one node responds to a command (bus contention),
+|  a collision is reported on stderr.
+|
+|  Usage:   avrmon-sim [-b baud] [-l linkpath] [-a addr] [-n nodes] [-c]
+|
+|      -b baud      pace input and output at this baud rate (default 19200; 0 = unpaced)
+|      -l path      create a symlink to the pty slave device (e.g. /tmp/avrmon)
+|      -a addr      node address (hex) of the first node (default 00 = point-to-point,
+|                   or 01 if more than one node)
+|      -n nodes     number of nodes on the bus, at consecutive addresses (default 1)
+|      -c           start as after a watchdog reset, with a crash record ('CM')
+|
+|  The pty slave device name is printed on stdout.  Overrun counts are
+|  reported on stderr.
+|
+|  Build:   gcc -O2 -o avrmon-sim avrmon_sim.c
+\*____________________________________________________________________________*/
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define  SIM_VER_MAJOR        1         // Version reported by 'VN' (see system.h)
+#define  SIM_VER_MINOR        2
+#define  SIM_VER_DEBUG       20
+
+#define  CMD_MSG_SIZE        63         // as cmnd.h
+#define  SERIAL_RX_BUF_SIZE  64         // as periph.h
+#define  DATA_SPACE_SIZE     0x900      // ATmega328P registers + SRAM
+#define  FLASH_SIZE          0x8000
+#define  EEPROM_SIZE         0x400
+#define  SPI_FLASH_SIZE      0x100000   // W25Q80
+#define  SPI_FLASH_ID        0xEF4014   // JEDEC ID:  manufacturer, type, capacity
+#define  OUT_BUF_SIZE        65536
+#define  MAX_NODES           16
+#define  HCI_BROADCAST       0xFF       // as cmnd.h
+
+#define  E2END               (EEPROM_SIZE - 1)
+#define  RAMEND              (DATA_SPACE_SIZE - 1)
+#define  TSTAMP_COUNTS_PER_USEC   2     // as periph.h (16 MHz, prescale 8)
+#define  LIVE_VIEW_MAX      128         // as liveview.h
+#define  LIVE_RECS_PER_LINE  16
+#define  LIVE_MIN_PERIOD     10
+#define  GDB_PKT_SIZE        64         // as gdbstub.h
+#define  GDB_MEM_MAX         32
+#define  GDB_ADDR_DATA   0x800000
+#define  GDB_ADDR_EEPROM 0x810000
+
+#define  ESC                 27
+#define  CAN                 24
+
+// Simulated monitor (bus node)
+typedef  struct
+{
+	int     iAddr;                  // node address, 0 = point-to-point
+	unsigned char  aubData[DATA_SPACE_SIZE];
+	unsigned short wSystemError;
+	unsigned short wDebugFlags;
+	char    acCmdMsg[CMD_MSG_SIZE + 1];
+	int     iCmdLen;
+	char    cRespCode;
+	int     yInteractive;
+	int     yMute;                  // output discarded (broadcast command)
+	unsigned  uwStartAddr;          // 'Dx' next address
+	int     iMode;                  // MODE_HCI, or the command thread running
+	char    cLoadSpace;             // 'XL' load target ('D', 'E' or 'F'), else NUL
+	unsigned long  ulLoadBase;      // 'XL F' extended address
+	unsigned  uwLoadRecords;        // 'XL' records received
+	unsigned  uwLoadErrors;         // 'XL' bad records
+	// 'LV' live view thread
+	unsigned  uwLiveAddr;
+	int     nLiveCount;
+	double  dLivePeriod;
+	double  dLiveNext;              // Time of next refresh
+	int     yLiveFirst;             // Send all bytes on first refresh
+	int     iLiveCursor;            // Offset last output (interactive), or -1
+	int     nLiveRecs;              // Records output on current line (machine)
+	unsigned char  aubLive[LIVE_VIEW_MAX];  // Region as last sent
+	// 'GD' stub thread
+	int     iGdbState;
+	char    acGdbPkt[GDB_PKT_SIZE + 1];
+	int     nGdbLen;
+	unsigned  uGdbSum, uGdbRxSum;
+	int     yGdbEscape, yGdbOverflow, yGdbBreak, yGdbRunning, yGdbExit;
+}
+node_t;
+
+enum  { MODE_HCI = 0, MODE_LIVE, MODE_GDB };   // node_t.iMode
+
+static  node_t  asNode[MAX_NODES];
+static  int     nNodes = 1;
+static  node_t *psNode = &asNode[0];    // node executing
+
+static  unsigned char  aubFlash[FLASH_SIZE];
+static  unsigned char  aubEeprom[EEPROM_SIZE];
+
+static  unsigned char  aubSpiFlash[SPI_FLASH_SIZE];
+static  int     iSpiIndex = -1;         // Byte index in current SPI command, -1 = deselected
+static  unsigned char  ubSpiCmd;
+static  unsigned long  ulSpiAddr;
+static  int     ySpiWriteEnable;
+static  double  dSpiBusyUntil;          // Erase/program in progress until this time
+
+static  unsigned char  acRxFifo[SERIAL_RX_BUF_SIZE];
+static  int     iRxHead, iRxCount;
+static  unsigned long  ulRxOverruns;
+
+static  unsigned char  acWire[OUT_BUF_SIZE];    // Input "on the wire" (not yet received)
+static  size_t  nWireHead, nWireTail;
+static  double  dCharTime = 10.0 / 19200;       // Time per char at baud rate
+
+static  char    acOut[OUT_BUF_SIZE];    // Pending output
+static  size_t  nOutHead, nOutTail;
+
+
+/*****************************  OUTPUT  *******************************/
+
+static  void  putch( char c )
+{
+	if ( psNode->yMute )  return;
+	if ( nOutTail < OUT_BUF_SIZE )  acOut[nOutTail++] = c;
+}
+
+static  void  putstr( const char *psz )
+{
+	while ( *psz )
+	{
+		if ( *psz == '\n' )  putch( '\r' );
+		putch( *psz++ );
+	}
+}
+
+static  void  putHexDigit( unsigned d )
+{
+	putch( "0123456789ABCDEF"[d & 15] );
+}
+
+static  void  putHexByte( unsigned b )
+{
+	putHexDigit( b >> 4 );
+	putHexDigit( b );
+}
+
+static  void  putHexWord( unsigned w )
+{
+	putHexByte( w >> 8 );
+	putHexByte( w );
+}
+
+static  void  putDecWord( unsigned w, int nPlaces )
+{
+	char  ac[8];
+
+	snprintf( ac, sizeof(ac), "%05u", w & 0xFFFF );
+	putstr( ac + 5 - nPlaces );
+}
+
+static  void  put_word_bits( unsigned w )
+{
+	unsigned  uBit;
+
+	for ( uBit = 0x8000;  uBit != 0;  uBit >>= 1 )
+	{
+		putch( (w & uBit) ? '1' : '0' );
+		putch( ' ' );
+		if ( uBit == 0x0100 )  { putch( ' ' );  putch( ' ' ); }
+	}
+}
+
+#define  NEW_LINE   { putch( '\r' );  putch( '\n' ); }
+
+
+/*****************************  SPI FLASH  ****************************/
+
+static  double  now_sec( void );
+
+static  int  spi_flash_busy( void )
+{
+	return  now_sec() < dSpiBusyUntil;
+}
+
+static  void  spi_select( int iCS )
+{
+	iSpiIndex = ( iCS == 0 ) ? 0 : -1;      // Only CS0 has a device
+}
+
+static  void  spi_deselect( void )
+{
+	unsigned long  ulSize = 0;
+
+	if ( iSpiIndex >= 4 && ySpiWriteEnable && !spi_flash_busy() )
+	{
+		if ( ubSpiCmd == 0x20 )  ulSize = 0x1000;
+		else if ( ubSpiCmd == 0x52 )  ulSize = 0x8000;
+		else if ( ubSpiCmd == 0xD8 )  ulSize = 0x10000;
+		if ( ulSize != 0 )
+		{
+			memset( aubSpiFlash + (ulSpiAddr & ~(ulSize - 1)), 0xFF, ulSize );
+			dSpiBusyUntil = now_sec() + 0.045 * (ulSize >> 12);     // ~45ms per 4K
+		}
+	}
+	if ( iSpiIndex >= 4 && (ubSpiCmd == 0x02 || ulSize != 0) )  ySpiWriteEnable = 0;
+	if ( iSpiIndex >= 5 && ubSpiCmd == 0x02 )  dSpiBusyUntil = now_sec() + 0.0007;
+	iSpiIndex = -1;
+}
+
+static  unsigned char  spi_transfer_byte( unsigned char b )
+{
+	unsigned char  ubRx = 0xFF;
+	int     i = iSpiIndex;
+
+	if ( i < 0 )  return  0xFF;             // Nothing selected:  MISO pulled up
+	iSpiIndex++ ;
+	if ( i == 0 )
+	{
+		ubSpiCmd = b;
+		if ( b == 0x06 && !spi_flash_busy() )  ySpiWriteEnable = 1;
+		if ( b == 0x04 )  ySpiWriteEnable = 0;
+		return  ubRx;
+	}
+	switch ( ubSpiCmd )
+	{
+	case 0x9F:  if ( i <= 3 )  ubRx = (unsigned char) (SPI_FLASH_ID >> (8 * (3 - i)));  break;
+	case 0x05:  ubRx = (unsigned char) (spi_flash_busy() | (ySpiWriteEnable << 1));  break;
+	case 0x03:
+	case 0x02:
+	case 0x20:
+	case 0x52:
+	case 0xD8:
+		if ( i <= 3 )  { ulSpiAddr = ((ulSpiAddr << 8) | b) & (SPI_FLASH_SIZE - 1);  break; }
+		if ( spi_flash_busy() )  break;
+		if ( ubSpiCmd == 0x03 )  ubRx = aubSpiFlash[ulSpiAddr++ % SPI_FLASH_SIZE];
+		else if ( ubSpiCmd == 0x02 && ySpiWriteEnable )     // wraps within the page
+		{
+			aubSpiFlash[(ulSpiAddr & ~0xFFUL) | ((ulSpiAddr + i - 4) & 0xFF)] &= b;
+		}
+		break;
+	}
+	return  ubRx;
+}
+
+
+/*****************************  HCI  **********************************/
+
+static  unsigned  hexatoi( const char *s )
+{
+	unsigned  u = 0;
+	int       n;
+
+	for ( n = 0;  n < 4 && isxdigit( (unsigned char) s[n] );  n++ )
+		u = u * 16 + (unsigned) (isdigit( (unsigned char) s[n] ) ? s[n] - '0' : toupper( s[n] ) - 'A' + 10);
+	return  u;
+}
+
+static  void  cmd_error( void )
+{
+	psNode->cRespCode = '!';
+	if ( psNode->yInteractive )  putstr( "\n! Command Error" );
+}
+
+static  void  clear_command( void )
+{
+	memset( psNode->acCmdMsg, 0, sizeof(psNode->acCmdMsg) );
+	psNode->iCmdLen = 0;
+	psNode->cRespCode = psNode->yInteractive ? '=' : '-';
+}
+
+static  void  put_resp_term( void )
+{
+	putch( '\r' );
+	putch( '\n' );
+	putch( psNode->cRespCode );
+	if ( psNode->yInteractive )  putch( '>' );
+}
+
+static  unsigned char  mem_read( char cSpace, unsigned uAddr )
+{
+	if ( cSpace == 'C' )  return  aubFlash[uAddr % FLASH_SIZE];
+	if ( cSpace == 'E' )  return  aubEeprom[uAddr % EEPROM_SIZE];
+	return  psNode->aubData[uAddr % DATA_SPACE_SIZE];
+}
+
+static  void  dump_memory( char c2 )
+{
+	unsigned  uwAddr, uwArg = hexatoi( &psNode->acCmdMsg[3] );
+	int       nRows = 16, iRow, iCol;
+	unsigned char  b;
+
+	if ( c2 == 'E' )  { uwAddr = (uwArg & 7) * 128;  nRows = 8; }
+	else if ( isxdigit( (unsigned char) psNode->acCmdMsg[3] ) )  uwAddr = psNode->uwStartAddr = uwArg & 0xFFF0;
+	else  uwAddr = psNode->uwStartAddr;
+
+	for ( iRow = 0;  iRow < nRows;  iRow++ )
+	{
+		putHexWord( uwAddr );
+		putch( ' ' );
+		for ( iCol = 0;  iCol < 16;  iCol++ )
+		{
+			putch( ' ' );
+			if ( iCol == 8 )  putch( ' ' );
+			putHexByte( mem_read( c2, uwAddr + iCol ) );
+		}
+		putch( ' ' );
+		putch( ' ' );
+		for ( iCol = 0;  iCol < 16;  iCol++ )
+		{
+			b = mem_read( c2, uwAddr + iCol );
+			putch( (b >= 32 && b < 127) ? b : ' ' );
+		}
+		uwAddr = (uwAddr + 16) & 0xFFFF;
+		NEW_LINE;
+	}
+	if ( c2 != 'E' )  psNode->uwStartAddr += 256;
+}
+
+static  int  hex_args_ok( const char *pszPattern )      // 'h' = hex digit, ' ' = space
+{
+	int  i;
+
+	for ( i = 0;  pszPattern[i];  i++ )
+	{
+		if ( pszPattern[i] == 'h' && !isxdigit( (unsigned char) psNode->acCmdMsg[3 + i] ) )  return 0;
+		if ( pszPattern[i] == ' ' && psNode->acCmdMsg[3 + i] != ' ' )  return 0;
+	}
+	return  1;
+}
+
+static  void  put_version( void )
+{
+	putch( 'V' );
+	putDecWord( SIM_VER_MAJOR, 1 );
+	putch( '.' );
+	putDecWord( SIM_VER_MINOR, 1 );
+	putch( '.' );
+	putDecWord( SIM_VER_DEBUG, 3 );
+	if ( psNode->yInteractive )  { putstr( " SIM " __DATE__ );  NEW_LINE; }
+}
+
+static  char  *cmd_arg( int n )        // as hci_arg()
+{
+	char  *pc = psNode->acCmdMsg;
+
+	while ( n-- != 0 )
+	{
+		while ( *pc != '\0' && *pc != ' ' )  pc++ ;
+		while ( *pc == ' ' )  pc++ ;
+	}
+	return  pc;
+}
+
+static  int  arg_hex( int n, unsigned long *pulValue, int nMaxDigits )
+{
+	char  *pc = cmd_arg( n );
+	int    nDigits;
+
+	for ( nDigits = 0;  isxdigit( (unsigned char) pc[nDigits] );  nDigits++ )  continue;
+	if ( nDigits == 0 || nDigits > nMaxDigits )  return  0;
+	*pulValue = strtoul( pc, NULL, 16 );
+	return  1;
+}
+
+static  int  spi_get_data( int n, unsigned char *abData )
+{
+	unsigned long  ul;
+	int     nCount = 0;
+
+	while ( nCount < 32 && isxdigit( (unsigned char) *cmd_arg( n + nCount ) ) )
+	{
+		if ( !arg_hex( n + nCount, &ul, 2 ) )  return  -1;
+		abData[nCount++] = (unsigned char) ul;
+	}
+	return  nCount;
+}
+
+static  void  spi_flash_command( unsigned char ubCmd, unsigned long ulAddr )
+{
+	spi_select( 0 );
+	spi_transfer_byte( ubCmd );
+	spi_transfer_byte( (unsigned char) (ulAddr >> 16) );
+	spi_transfer_byte( (unsigned char) (ulAddr >> 8) );
+	spi_transfer_byte( (unsigned char) ulAddr );
+}
+
+static  int  spi_flash_program( unsigned long ulAddr, const unsigned char *pbData, int nCount )
+{
+	int  i, nChunk;
+
+	if ( spi_flash_busy() )  return  0;
+	for ( i = 0;  i < nCount;  )        // split at page boundaries, as spi.c
+	{
+		nChunk = 256 - (int) (ulAddr & 0xFF);
+		if ( nChunk > nCount - i )  nChunk = nCount - i;
+		spi_select( 0 );
+		spi_transfer_byte( 0x06 );
+		spi_deselect();
+		spi_flash_command( 0x02, ulAddr );
+		while ( nChunk-- > 0 )  { spi_transfer_byte( pbData[i++] );  ulAddr++ ; }
+		spi_deselect();
+		dSpiBusyUntil = 0;              // page program time is not simulated here
+	}
+	return  1;
+}
+
+static  void  spi_commands( char c1, char c2 )     // 'SX', 'FI', 'FR', 'FP', 'FE'
+{
+	unsigned char  abData[32];
+	unsigned long  ulAddr, ulCount = 0x100, ulArg;
+	int     nCount, i, nLine;
+	double  dStart;
+
+	if ( c1 == 'S' )
+	{
+		nCount = spi_get_data( 2, abData );
+		if ( !arg_hex( 1, &ulArg, 1 ) || ulArg > 1 || nCount <= 0 )  { cmd_error();  return; }
+		spi_select( (int) ulArg );
+		for ( i = 0;  i < nCount;  i++ )  abData[i] = spi_transfer_byte( abData[i] );
+		spi_deselect();
+		for ( i = 0;  i < nCount;  i++ )
+		{
+			if ( i != 0 || psNode->yInteractive )  putch( ' ' );
+			putHexByte( abData[i] );
+		}
+		return;
+	}
+	if ( c2 == 'I' )
+	{
+		spi_select( 0 );
+		for ( i = 0;  i < 4;  i++ )  abData[i] = spi_transfer_byte( 0x9F );
+		spi_deselect();
+		if ( psNode->yInteractive )  putch( ' ' );
+		putHexByte( abData[1] );
+		putch( ' ' );
+		putHexByte( abData[2] );
+		putHexByte( abData[3] );
+		putch( ' ' );
+		spi_select( 0 );
+		spi_transfer_byte( 0x05 );
+		putHexByte( spi_transfer_byte( 0xFF ) );
+		spi_deselect();
+		return;
+	}
+	if ( !arg_hex( 1, &ulAddr, 6 ) || spi_flash_busy() )  { cmd_error();  return; }
+
+	if ( c2 == 'R' )
+	{
+		if ( isxdigit( (unsigned char) *cmd_arg( 2 ) ) && !arg_hex( 2, &ulCount, 4 ) )  { cmd_error();  return; }
+		while ( ulCount != 0 )
+		{
+			nLine = psNode->yInteractive ? 16 : 32;
+			if ( (unsigned long) nLine > ulCount )  nLine = (int) ulCount;
+			spi_flash_command( 0x03, ulAddr );
+			for ( i = 0;  i < nLine;  i++ )  abData[i] = spi_transfer_byte( 0xFF );
+			spi_deselect();
+			if ( psNode->yInteractive )
+			{
+				putHexByte( (unsigned) (ulAddr >> 16) );
+				putHexWord( (unsigned) ulAddr );
+				putch( ' ' );
+				for ( i = 0;  i < nLine;  i++ )
+				{
+					putch( ' ' );
+					if ( i == 8 )  putch( ' ' );
+					putHexByte( abData[i] );
+				}
+				putch( ' ' );
+				putch( ' ' );
+				for ( i = 0;  i < nLine;  i++ )  putch( (abData[i] >= 32 && abData[i] < 127) ? abData[i] : ' ' );
+			}
+			else  for ( i = 0;  i < nLine;  i++ )  putHexByte( abData[i] );
+			ulAddr += (unsigned long) nLine;
+			ulCount -= (unsigned long) nLine;
+			if ( ulCount != 0 )  NEW_LINE;
+		}
+	}
+	else if ( c2 == 'P' )
+	{
+		nCount = spi_get_data( 2, abData );
+		if ( nCount <= 0 )  { cmd_error();  return; }
+		spi_flash_program( ulAddr, abData, nCount );
+	}
+	else if ( c2 == 'E' )
+	{
+		unsigned char  ubCmd = 0x20;
+
+		if ( isxdigit( (unsigned char) *cmd_arg( 2 ) ) )
+		{
+			if ( !arg_hex( 2, &ulArg, 2 ) )  ulArg = 0;
+			ubCmd = ( ulArg == 0x04 ) ? 0x20 : ( ulArg == 0x20 ) ? 0x52 : ( ulArg == 0x40 ) ? 0xD8 : 0;
+			if ( ubCmd == 0 )  { cmd_error();  return; }
+		}
+		spi_select( 0 );
+		spi_transfer_byte( 0x06 );
+		spi_deselect();
+		dStart = now_sec();
+		spi_flash_command( ubCmd, ulAddr );
+		spi_deselect();
+		ulArg = (unsigned long) ((dSpiBusyUntil - dStart) * 1000.0);  // erase time, msec
+		dSpiBusyUntil = 0;              // 'FE' responds when the erase is done
+		if ( psNode->yInteractive )  { putstr( "Time: " );  putDecWord( (unsigned) ulArg, 5 );  putstr( " ms" ); }
+		else  putHexWord( (unsigned) ulArg );
+	}
+	else  cmd_error();
+}
+
+static  void  var_commands( char c1 )     // 'RV', 'WV', 'SN'
+{
+	unsigned long  ulAddr, ulValue, ulCount;
+	int     nSize = 0, nTotal = 0, nRegions, i, n;
+	char    c = (char) toupper( (unsigned char) *cmd_arg( 1 ) );
+
+	if ( c1 == 'S' )
+	{
+		for ( nRegions = 0;  *cmd_arg( nRegions * 2 + 1 ) != '\0';  nRegions++ )
+		{
+			if ( nRegions == 8 || !arg_hex( nRegions * 2 + 1, &ulAddr, 4 )
+			||   !arg_hex( nRegions * 2 + 2, &ulCount, 2 ) || ulCount == 0 )  { cmd_error();  return; }
+			nTotal += (int) ulCount;
+		}
+		if ( nRegions == 0 || nTotal > 256 )  { cmd_error();  return; }
+		putch( '#' );
+		ulValue = (unsigned long) (now_sec() * 2e6);        // 0.5us timestamp counts
+		putHexWord( (unsigned) (ulValue >> 16) & 0xFFFF );
+		putHexWord( (unsigned) ulValue & 0xFFFF );
+		putch( ' ' );
+		putHexWord( (unsigned) nTotal );
+		NEW_LINE;
+		for ( i = 0;  i < nRegions;  i++ )
+		{
+			arg_hex( i * 2 + 1, &ulAddr, 4 );
+			arg_hex( i * 2 + 2, &ulCount, 2 );
+			for ( n = 0;  n < (int) ulCount;  n++ )
+			{
+				if ( n % 32 == 0 )  { putHexWord( (unsigned) (ulAddr + n) );  putch( ' ' ); }
+				putHexByte( psNode->aubData[(ulAddr + n) % DATA_SPACE_SIZE] );
+				if ( n % 32 == 31 || n + 1 == (int) ulCount )  NEW_LINE;
+			}
+		}
+		return;
+	}
+	nSize = ( c == 'B' ) ? 1 : ( c == 'W' ) ? 2 : ( c == 'L' || c == 'F' ) ? 4 : 0;
+	if ( nSize == 0 || !arg_hex( 2, &ulAddr, 4 ) )  { cmd_error();  return; }
+	if ( c1 == 'R' )
+	{
+		if ( psNode->yInteractive )  putch( ' ' );
+		for ( i = nSize;  i-- != 0; )  putHexByte( psNode->aubData[(ulAddr + i) % DATA_SPACE_SIZE] );
+	}
+	else if ( !arg_hex( 3, &ulValue, nSize * 2 ) )  cmd_error();
+	else  for ( i = 0;  i < nSize;  i++ )  psNode->aubData[(ulAddr + i) % DATA_SPACE_SIZE] = (unsigned char) (ulValue >> (8 * i));
+}
+
+/*
+|  Variable registry, as vartab.h/varreg.c:  name, type, size, access, data address.
+*/
+typedef  struct
+{
+	const char  *pszName;
+	char     cType;
+	int      nSize;
+	char     cAccess;
+	unsigned  uAddr;
+}
+simvar_t;
+
+static  const  simvar_t  asSimVar[] =
+{
+	{ "sys_error",    'W',  2, 'R', 0x100 },
+	{ "debug_flags",  'W',  2, 'W', 0x102 },
+	{ "reset_cause",  'B',  1, 'R', 0x104 },
+	{ "adc_raw",      'W',  8, 'R', 0x106 },
+	{ "setpoint",     'F',  4, 'W', 0x10E },
+};
+
+#define  SIM_VARS   ((int) (sizeof(asSimVar) / sizeof(asSimVar[0])))
+
+static  int  var_id( int n )         // ID argument n, or -1 if invalid
+{
+	char  *pc = cmd_arg( n );
+	unsigned long  ulID;
+
+	if ( !arg_hex( n, &ulID, 2 ) || !isxdigit( (unsigned char) pc[1] ) || ulID >= SIM_VARS )  return  -1;
+	return  (int) ulID;
+}
+
+static  void  var_put( int iID )
+{
+	const simvar_t  *psVar = &asSimVar[iID];
+	int    nElem = ( psVar->cType == 'B' ) ? 1 : ( psVar->cType == 'W' ) ? 2 : 4;
+	int    n, i;
+
+	for ( n = 0;  n < psVar->nSize;  n += nElem )
+		for ( i = nElem;  i-- != 0; )  putHexByte( psNode->aubData[psVar->uAddr + n + i] );
+}
+
+static  void  varreg_commands( char c2 )     // 'VL', 'VR', 'VW', 'VB'
+{
+	const simvar_t  *psVar;
+	unsigned long  ulValue;
+	int     iID, n, i;
+
+	if ( c2 == 'L' )
+	{
+		for ( iID = 0;  iID < SIM_VARS;  iID++ )
+		{
+			psVar = &asSimVar[iID];
+			putHexByte( iID );
+			putch( ' ' );
+			putch( psVar->cType );
+			putch( ' ' );
+			putHexByte( psVar->nSize );
+			putch( ' ' );
+			putch( psVar->cAccess );
+			putch( ' ' );
+			putHexWord( psVar->uAddr );
+			putch( ' ' );
+			putstr( psVar->pszName );
+			NEW_LINE;
+		}
+	}
+	else if ( c2 == 'R' )
+	{
+		if ( (iID = var_id( 1 )) < 0 )  { cmd_error();  return; }
+		if ( psNode->yInteractive )  putch( ' ' );
+		var_put( iID );
+	}
+	else if ( c2 == 'W' )
+	{
+		if ( (iID = var_id( 1 )) < 0 )  { cmd_error();  return; }
+		psVar = &asSimVar[iID];
+		n = ( psVar->cType == 'B' ) ? 1 : ( psVar->cType == 'W' ) ? 2 : 4;
+		if ( psVar->cAccess != 'W' || psVar->nSize != n || !arg_hex( 2, &ulValue, n * 2 ) )  { cmd_error();  return; }
+		for ( i = 0;  i < n;  i++ )  psNode->aubData[psVar->uAddr + i] = (unsigned char) (ulValue >> (8 * i));
+	}
+	else
+	{
+		for ( n = 1;  *cmd_arg( n ) != '\0';  n++ )
+			if ( var_id( n ) < 0 )  { cmd_error();  return; }
+		if ( n == 1 )  { cmd_error();  return; }
+		for ( n = 1;  *cmd_arg( n ) != '\0';  n++ )
+		{
+			if ( n > 1 || psNode->yInteractive )  putch( ' ' );
+			var_put( var_id( n ) );
+		}
+	}
+}
+
+/*
+|  'WT':  nothing else writes the simulated data space while a command runs, so
+|  a condition not met at once can only time out;  that is reported at once.
+*/
+static  void  wait_command( void )
+{
+	unsigned long  ulAddr, ulMask, ulValue, ulTimeout = 1000, ulElapsed = 0;
+	char    c = (char) toupper( (unsigned char) *cmd_arg( 4 ) );
+	unsigned char  ubNow;
+	int     yMet;
+
+	if ( !arg_hex( 1, &ulAddr, 4 ) || !arg_hex( 2, &ulMask, 2 ) || !arg_hex( 3, &ulValue, 2 )
+	||   (c != '\0' && c != 'E' && c != 'N' && c != 'C')
+	||   (*cmd_arg( 5 ) != '\0' && !arg_hex( 5, &ulTimeout, 4 )) )  { cmd_error();  return; }
+	ubNow = psNode->aubData[ulAddr % DATA_SPACE_SIZE] & (unsigned char) ulMask;
+	yMet = ( c == 'N' ) ? ( ubNow != (ulValue & ulMask) ) : ( c == 'C' ) ? 0 : ( ubNow == (ulValue & ulMask) );
+	if ( !yMet )  ulElapsed = ulTimeout * 1000;
+	if ( psNode->yInteractive )  putch( ' ' );
+	putHexWord( (unsigned) (ulElapsed >> 16) & 0xFFFF );
+	putHexWord( (unsigned) ulElapsed & 0xFFFF );
+	putch( ' ' );
+	putHexByte( ubNow );
+	if ( !yMet )  cmd_error();
+}
+
+/*****************************  DUMP AND LOAD  ************************/
+
+static  int  mem_write( char cSpace, unsigned uAddr, unsigned char b )
+{
+	if ( cSpace == 'E' )  aubEeprom[uAddr % EEPROM_SIZE] = b;
+	else if ( cSpace == 'D' )  psNode->aubData[uAddr % DATA_SPACE_SIZE] = b;
+	else  return  0;                    // flash is not writable
+	return  1;
+}
+
+static  unsigned  hex_digit( char c )
+{
+	if ( isdigit( (unsigned char) c ) )  return  (unsigned) (c - '0');
+	return  (unsigned) (toupper( (unsigned char) c ) - 'A' + 10) & 15;
+}
+
+static  unsigned  hex_pair( const char *pc )
+{
+	return  (hex_digit( pc[0] ) << 4) | hex_digit( pc[1] );
+}
+
+/*
+|  'Zs' packed dump:  the encoder of pack.c, token for token (see pack.h).
+*/
+#define  PACK_WINDOW_SIZE      64       // as pack.h
+#define  PACK_MIN_MATCH         3
+#define  PACK_MAX_RUN          65
+#define  PACK_MAX_COPY         66
+#define  PACK_BYTES_PER_LINE   32
+#define  PACK_LITERAL_LIMIT    32       // as pack.c
+
+static  unsigned char  aubWindow[PACK_WINDOW_SIZE];
+static  unsigned  uWinHead, uWinCount, uPackLine;
+static  unsigned long  ulPackedCount;
+
+static  void  pack_put_byte( unsigned b )
+{
+	if ( uPackLine == PACK_BYTES_PER_LINE )  { NEW_LINE;  uPackLine = 0; }
+	putHexByte( b );
+	uPackLine++ ;
+	ulPackedCount++ ;
+}
+
+static  void  window_push( unsigned char b )
+{
+	aubWindow[uWinHead] = b;
+	uWinHead = (uWinHead + 1) % PACK_WINDOW_SIZE;
+	if ( uWinCount < PACK_WINDOW_SIZE )  uWinCount++ ;
+}
+
+static  void  flush_literals( unsigned uCount )
+{
+	unsigned  uIdx = (uWinHead + PACK_WINDOW_SIZE - uCount) % PACK_WINDOW_SIZE;
+
+	if ( uCount == 0 )  return;
+	pack_put_byte( uCount - 1 );
+	while ( uCount-- != 0 )
+	{
+		pack_put_byte( aubWindow[uIdx] );
+		uIdx = (uIdx + 1) % PACK_WINDOW_SIZE;
+	}
+}
+
+static  void  packed_dump( char cSpace )
+{
+	unsigned  uAddr, uCount = 256, uRawCount, uRun, uLen, uBestLen, uDist, uBestDist;
+	unsigned  uLiterals = 0;
+	unsigned char  ubDat, ubRef;
+
+	if ( !isxdigit( (unsigned char) *cmd_arg( 1 ) ) )  { cmd_error();  return; }
+	uAddr = hexatoi( cmd_arg( 1 ) );
+	if ( isxdigit( (unsigned char) *cmd_arg( 2 ) ) )  uCount = hexatoi( cmd_arg( 2 ) );
+	uRawCount = uCount;
+	uWinHead = uWinCount = uPackLine = 0;
+	ulPackedCount = 0;
+
+	while ( uCount != 0 )
+	{
+		ubDat = mem_read( cSpace, uAddr );
+		for ( uRun = 1;  uRun < uCount;  uRun++ )
+			if ( mem_read( cSpace, (uAddr + uRun) & 0xFFFF ) != ubDat )  break;
+
+		uBestLen = uBestDist = 0;
+		for ( uDist = 1;  uDist <= uWinCount && uRun < PACK_MIN_MATCH;  uDist++ )
+		{
+			for ( uLen = 0;  uLen < PACK_MAX_COPY && uLen < uCount;  uLen++ )
+			{
+				if ( uLen < uDist )
+					ubRef = aubWindow[(uWinHead + PACK_WINDOW_SIZE - uDist + uLen) % PACK_WINDOW_SIZE];
+				else  ubRef = mem_read( cSpace, (uAddr + uLen - uDist) & 0xFFFF );
+				if ( mem_read( cSpace, (uAddr + uLen) & 0xFFFF ) != ubRef )  break;
+			}
+			if ( uLen > uBestLen )  { uBestLen = uLen;  uBestDist = uDist; }
+		}
+
+		if ( uRun >= PACK_MIN_MATCH )
+		{
+			flush_literals( uLiterals );
+			uLiterals = 0;
+			if ( uRun <= PACK_MAX_RUN )  pack_put_byte( 0x80 + uRun - PACK_MIN_MATCH );
+			else
+			{
+				pack_put_byte( 0xBF );
+				pack_put_byte( uRun >> 8 );
+				pack_put_byte( uRun & 0xFF );
+			}
+			pack_put_byte( ubDat );
+			for ( uLen = 0;  uLen < uRun && uLen < PACK_WINDOW_SIZE;  uLen++ )  window_push( ubDat );
+			uAddr = (uAddr + uRun) & 0xFFFF;
+			uCount -= uRun;
+		}
+		else if ( uBestLen >= PACK_MIN_MATCH )
+		{
+			flush_literals( uLiterals );
+			uLiterals = 0;
+			pack_put_byte( 0xC0 + uBestLen - PACK_MIN_MATCH );
+			pack_put_byte( uBestDist - 1 );
+			for ( uLen = 0;  uLen < uBestLen;  uLen++ )
+				window_push( aubWindow[(uWinHead + PACK_WINDOW_SIZE - uBestDist) % PACK_WINDOW_SIZE] );
+			uAddr = (uAddr + uBestLen) & 0xFFFF;
+			uCount -= uBestLen;
+		}
+		else
+		{
+			window_push( ubDat );
+			uAddr = (uAddr + 1) & 0xFFFF;
+			uCount-- ;
+			if ( ++uLiterals == PACK_LITERAL_LIMIT )  { flush_literals( uLiterals );  uLiterals = 0; }
+		}
+	}
+	flush_literals( uLiterals );
+
+	NEW_LINE;
+	putch( '#' );
+	putHexWord( uRawCount );
+	putch( ' ' );
+	putHexDigit( (unsigned) (ulPackedCount >> 16) );
+	putHexWord( (unsigned) ulPackedCount );
+	putch( ' ' );
+	putDecWord( uRawCount ? (unsigned) ((ulPackedCount * 100) / uRawCount) : 0, 3 );
+	putch( '%' );
+}
+
+static  void  ihex_dump( char cSpace )          // 'Xs'
+{
+	unsigned  uAddr, uCount = 256, uLen, uSum;
+	unsigned char  ubDat;
+
+	if ( !isxdigit( (unsigned char) *cmd_arg( 1 ) ) )  { cmd_error();  return; }
+	uAddr = hexatoi( cmd_arg( 1 ) );
+	if ( isxdigit( (unsigned char) *cmd_arg( 2 ) ) )  uCount = hexatoi( cmd_arg( 2 ) );
+	while ( uCount != 0 )
+	{
+		uLen = ( uCount < 16 ) ? uCount : 16;
+		putch( ':' );
+		putHexByte( uLen );
+		putHexWord( uAddr );
+		putHexByte( 0x00 );
+		uSum = uLen + (uAddr >> 8) + uAddr;
+		uCount -= uLen;
+		while ( uLen-- != 0 )
+		{
+			ubDat = mem_read( cSpace, uAddr );
+			uAddr = (uAddr + 1) & 0xFFFF;
+			putHexByte( ubDat );
+			uSum += ubDat;
+		}
+		putHexByte( 0x100 - (uSum & 0xFF) );
+		NEW_LINE;
+	}
+	putstr( ":00000001FF" );
+}
+
+static  void  ihex_load( void )                 // 'XL'
+{
+	char  c = (char) toupper( (unsigned char) *cmd_arg( 1 ) );
+
+	if ( c != 'D' && c != 'E' && c != 'F' )  { cmd_error();  return; }
+	psNode->cLoadSpace = c;
+	psNode->ulLoadBase = 0;
+	psNode->uwLoadRecords = 0;
+	psNode->uwLoadErrors = 0;
+}
+
+/*
+|  Intel HEX record (line starting with ':'), as ihex_record_cmd() in cmnd.c.
+|  EEPROM bytes are written at once:  the write time is not simulated.
+*/
+static  void  ihex_record( void )
+{
+	unsigned char  aubRec[(CMD_MSG_SIZE - 1) / 2];
+	const char  *pc = &psNode->acCmdMsg[1];
+	unsigned  uSum = 0, uAddr;
+	int     nNum = 0, yBad = 0, i;
+
+	if ( psNode->cLoadSpace == '\0' )  { cmd_error();  return; }
+
+	psNode->uwLoadRecords++ ;
+	while ( *pc != '\0' )
+	{
+		if ( !isxdigit( (unsigned char) pc[0] ) || !isxdigit( (unsigned char) pc[1] ) )  { yBad = 1;  break; }
+		aubRec[nNum] = (unsigned char) hex_pair( pc );
+		uSum += aubRec[nNum++];
+		pc += 2;
+	}
+	if ( nNum < 5 || nNum != aubRec[0] + 5 || (uSum & 0xFF) != 0 )  yBad = 1;
+
+	if ( !yBad )
+	{
+		uAddr = ((unsigned) aubRec[1] << 8) | aubRec[2];
+		switch ( aubRec[3] )
+		{
+		case 0x00:
+			if ( (psNode->cLoadSpace == 'E' && uAddr + aubRec[0] > E2END + 1)
+			||   (psNode->cLoadSpace == 'D' && uAddr + aubRec[0] > RAMEND + 1) )  yBad = 1;
+			else if ( psNode->cLoadSpace == 'F' )
+				yBad = !spi_flash_program( psNode->ulLoadBase + uAddr, &aubRec[4], aubRec[0] );
+			else  for ( i = 0;  i < aubRec[0];  i++ )  mem_write( psNode->cLoadSpace, uAddr + i, aubRec[4 + i] );
+			break;
+
+		case 0x01:
+			if ( psNode->yInteractive )  putstr( "Records: " );
+			putDecWord( psNode->uwLoadRecords, 5 );
+			putch( ' ' );
+			if ( psNode->yInteractive )  putstr( "Errors: " );
+			putDecWord( psNode->uwLoadErrors, 5 );
+			psNode->cLoadSpace = '\0';
+			break;
+
+		case 0x02:
+		case 0x04:
+			if ( aubRec[0] != 2 )  yBad = 1;
+			else if ( psNode->cLoadSpace == 'F' )
+				psNode->ulLoadBase = (((unsigned long) aubRec[4] << 8) | aubRec[5]) << ( aubRec[3] == 0x04 ? 16 : 4 );
+			else if ( aubRec[4] != 0 || aubRec[5] != 0 )  yBad = 1;
+			break;
+
+		case 0x03:
+		case 0x05:
+			break;
+
+		default:
+			yBad = 1;
+			break;
+		}
+	}
+	if ( yBad )
+	{
+		psNode->uwLoadErrors++ ;
+		cmd_error();
+	}
+}
+
+
+/*****************************  DIAGNOSTICS  **************************/
+
+/*
+|  The sim has no interrupts, tasks or code of its own to measure, so 'CM', 'WS',
+|  'IS', 'TL', 'PF' and 'FT' report made-up but consistent values, in the formats
+|  of the firmware (a build with all options):  ISR call counts follow the elapsed
+|  time and the chars received and sent, the profiler samples a few fixed "hot
+|  spots" once per msec, and the function trace logs each command executed.
+*/
+static  int     yCrashRecord;           // 'CM' record kept (-c:  watchdog reset)
+static  double  dIsrClearTime;          // 'IS' statistics cleared
+static  unsigned long  ulIsrRxCount, ulIsrTxCount;
+
+static  void  crash_mailbox_cmd( void )
+{
+	char  c = (char) toupper( (unsigned char) *cmd_arg( 1 ) );
+
+	if ( c == 'C' )  yCrashRecord = 0;
+	else if ( c != '\0' )  cmd_error();
+	else if ( !yCrashRecord )  putHexByte( 0x00 );
+	else  putstr( "01 00 08 00 08D2 0A3C 0001D4C0 0000 0000 0000 0000" );  // WDT, task 0 late
+}
+
+static  void  wdog_status_cmd( void )
+{
+	static const unsigned  auDeadline[] = { 100, 250, 1000 };     // as wdog.h
+	static const unsigned  auInterval[] = { 5, 50, 500 };
+	unsigned  uResetCause = yCrashRecord ? 0x08 : 0x01;
+	int     i;
+
+	putHexByte( uResetCause );
+	if ( psNode->yInteractive )
+	{
+		for ( i = 0;  i < 4;  i++ )
+			if ( uResetCause & (1 << i) )  { putch( ' ' );  putch( "POEXBOWD"[i * 2] );  putch( "POEXBOWD"[i * 2 + 1] ); }
+	}
+	NEW_LINE;
+	putDecWord( 1, 5 );                 // longest loop time, overruns
+	putch( ' ' );
+	putDecWord( 0, 5 );
+	for ( i = 0;  i < 3;  i++ )
+	{
+		NEW_LINE;
+		putHexDigit( (unsigned) i );
+		putch( ' ' );
+		putDecWord( auDeadline[i], 5 );
+		putch( ' ' );
+		putDecWord( auInterval[i], 5 );
+		putch( ' ' );
+		putDecWord( 0, 5 );
+	}
+}
+
+static  void  isr_stat_line( int iVect, unsigned long ulCount, unsigned uLatMin, unsigned uLatMax,
+                             unsigned uDurMin, unsigned uDurMax )
+{
+	unsigned  uLimit = 2 * TSTAMP_COUNTS_PER_USEC;
+	int     iBucket, i;
+
+	if ( ulCount == 0 )  return;
+	if ( ulCount > 0xFFFF )  ulCount = 0xFFFF;
+	for ( iBucket = 0;  iBucket < 7 && uDurMax >= uLimit;  iBucket++ )  uLimit <<= 1;
+	putHexDigit( (unsigned) iVect );
+	putch( ' ' );
+	putDecWord( (unsigned) ulCount, 5 );
+	putch( ' ' );
+	putHexWord( uLatMin );
+	putch( ' ' );
+	putHexWord( uLatMax );
+	putch( ' ' );
+	putHexWord( uDurMin );
+	putch( ' ' );
+	putHexWord( uDurMax );
+	for ( i = 0;  i < 8;  i++ )
+	{
+		putch( ' ' );
+		putDecWord( (i == iBucket) ? (unsigned) ulCount : 0, 5 );
+	}
+	NEW_LINE;
+}
+
+static  void  isr_stats_cmd( void )
+{
+	if ( toupper( (unsigned char) *cmd_arg( 1 ) ) == 'C' )
+	{
+		dIsrClearTime = now_sec();
+		ulIsrRxCount = ulIsrTxCount = 0;
+		return;
+	}
+	if ( psNode->yInteractive )
+	{
+		putstr( "Timer count = " );
+		putDecWord( 1000 / TSTAMP_COUNTS_PER_USEC, 4 );
+		putstr( "ns\n" );
+	}
+	isr_stat_line( 0, (unsigned long) ((now_sec() - dIsrClearTime) * 1000.0), 0x0002, 0x0030, 0x0010, 0x001C );
+	isr_stat_line( 1, ulIsrRxCount, 0xFFFF, 0x0000, 0x0006, 0x0007 );
+	isr_stat_line( 2, ulIsrTxCount, 0xFFFF, 0x0000, 0x000A, 0x000C );
+}
+
+typedef  struct
+{
+	char     cState;
+	unsigned  ubPrio;
+	unsigned  uwStackUsed;
+	unsigned  uwStackSize;
+	unsigned  uwShare;              // CPU share, per cent
+	const char  *pszName;
+}
+simtask_t;
+
+static  const  simtask_t  asSimTask[] =
+{
+	{ 'R',  0x00,  0x00C8,  0x0180,  70,  "monitor" },
+	{ 'D',  0x02,  0x0052,  0x0080,  20,  "sampler" },
+	{ 'B',  0x01,  0x003A,  0x0060,  10,  "logger" },
+};
+
+static  void  task_list_cmd( void )
+{
+	const simtask_t  *psTask;
+	int     i;
+
+	for ( i = 0;  i < (int) (sizeof(asSimTask) / sizeof(asSimTask[0]));  i++ )
+	{
+		psTask = &asSimTask[i];
+		putHexDigit( (unsigned) i );
+		putch( ' ' );
+		putch( psTask->cState );
+		putch( ' ' );
+		putHexByte( psTask->ubPrio );
+		putch( ' ' );
+		putHexWord( psTask->uwStackUsed );
+		putch( ' ' );
+		putHexWord( psTask->uwStackSize );
+		putch( ' ' );
+		putDecWord( psTask->uwShare, 3 );
+		putch( '%' );
+		putch( ' ' );
+		putstr( psTask->pszName );
+		NEW_LINE;
+	}
+}
+
+/*
+|  'PF' profiler:  one sample per msec while running, shared among the hot spots.
+*/
+#define  PROF_NUM_BUCKETS      32       // as profile.h
+#define  PROF_DEFAULT_SHIFT    10
+#define  PROF_BUCKETS_PER_LINE  8
+
+static  const  unsigned  auProfSpot[][2] = { { 0x0100, 50 }, { 0x0480, 30 }, { 0x0A3C, 20 } };  // addr, %
+
+static  int     yProfRunning;
+static  unsigned  uwProfBase, ubProfShift = PROF_DEFAULT_SHIFT;
+static  unsigned long  ulProfSamples;   // Samples before dProfStart
+static  double  dProfStart;
+
+static  unsigned long  profile_samples( void )
+{
+	if ( !yProfRunning )  return  ulProfSamples;
+	return  ulProfSamples + (unsigned long) ((now_sec() - dProfStart) * 1000.0);
+}
+
+// Histogram of ulSamples samples;  returns the number outside the range
+static  unsigned long  profile_histogram( unsigned long ulSamples, unsigned long *pulHist )
+{
+	unsigned long  ulOutside = 0, ulCount;
+	unsigned  uBucket;
+	int     i;
+
+	memset( pulHist, 0, PROF_NUM_BUCKETS * sizeof(unsigned long) );
+	for ( i = 0;  i < (int) (sizeof(auProfSpot) / sizeof(auProfSpot[0]));  i++ )
+	{
+		ulCount = ulSamples * auProfSpot[i][1] / 100;
+		uBucket = (auProfSpot[i][0] - uwProfBase) >> ubProfShift;
+		if ( auProfSpot[i][0] < uwProfBase || uBucket >= PROF_NUM_BUCKETS )  ulOutside += ulCount;
+		else  pulHist[uBucket] += ulCount;
+	}
+	return  ulOutside;
+}
+
+static  void  profile_cmd( void )
+{
+	unsigned long  aulHist[PROF_NUM_BUCKETS], ulSamples = profile_samples(), ulOutside;
+	char    c = (char) toupper( (unsigned char) *cmd_arg( 1 ) );
+	int     i, j, yNonZero;
+
+	if ( c == 'S' )
+	{
+		yProfRunning = 0;
+		uwProfBase = 0;
+		ubProfShift = PROF_DEFAULT_SHIFT;
+		if ( isxdigit( (unsigned char) *cmd_arg( 2 ) ) )  uwProfBase = hexatoi( cmd_arg( 2 ) );
+		if ( isxdigit( (unsigned char) *cmd_arg( 3 ) ) )  ubProfShift = hex_digit( *cmd_arg( 3 ) );
+		if ( ubProfShift == 0 )  { cmd_error();  return; }
+		ulProfSamples = 0;
+		dProfStart = now_sec();
+		yProfRunning = 1;
+		return;
+	}
+	if ( c == 'X' )  { ulProfSamples = ulSamples;  yProfRunning = 0;  return; }
+	if ( c == 'C' )  { ulProfSamples = 0;  dProfStart = now_sec();  return; }
+	if ( c != '\0' && c != 'D' )  { cmd_error();  return; }
+
+	ulOutside = profile_histogram( ulSamples, aulHist );
+	putch( '#' );
+	putHexWord( uwProfBase );
+	putch( ' ' );
+	putHexDigit( ubProfShift );
+	putch( ' ' );
+	putHexByte( PROF_NUM_BUCKETS );
+	putch( ' ' );
+	putHexWord( (unsigned) (ulSamples >> 16) & 0xFFFF );
+	putHexWord( (unsigned) ulSamples & 0xFFFF );
+	putch( ' ' );
+	putHexWord( (unsigned) (ulOutside >> 16) & 0xFFFF );
+	putHexWord( (unsigned) ulOutside & 0xFFFF );
+	if ( c == '\0' )  { putch( ' ' );  putch( yProfRunning ? '1' : '0' );  return; }
+
+	NEW_LINE;
+	for ( i = 0;  i < PROF_NUM_BUCKETS;  i += PROF_BUCKETS_PER_LINE )
+	{
+		for ( yNonZero = 0, j = 0;  j < PROF_BUCKETS_PER_LINE;  j++ )
+			if ( aulHist[i + j] != 0 )  yNonZero = 1;
+		if ( !yNonZero )  continue;
+		putHexWord( uwProfBase + ((unsigned) i << ubProfShift) );
+		for ( j = 0;  j < PROF_BUCKETS_PER_LINE;  j++ )
+		{
+			putch( ' ' );
+			putHexWord( aulHist[i + j] > 0xFFFF ? 0xFFFF : (unsigned) aulHist[i + j] );
+		}
+		NEW_LINE;
+	}
+}
+
+/*
+|  'FT' function trace:  each command executed while the trace is on is logged as
+|  a call of hci_exec_command() (depth 1) and of the command function (depth 2),
+|  at made-up flash addresses.  A command which stops the trace ('FT F', 'FT D')
+|  leaves entry records only, as a call still in progress.
+*/
+#define  TRACE_BUF_SIZE        16       // as trace.h
+#define  TRACE_DEFAULT_DEPTH    8
+#define  TRACE_EXIT        0x8000
+#define  TRACE_ADDR_EXEC   0x0A3C       // "hci_exec_command"
+
+static  struct
+{
+	unsigned  uwFunc;                   // word address, | TRACE_EXIT
+	unsigned  ubOvf;
+	unsigned  uwCount;
+}
+asTrace[TRACE_BUF_SIZE];
+
+static  int     yTraceOn, yTraceFull;
+static  unsigned  ubTraceHead, ubMaxDepth = TRACE_DEFAULT_DEPTH;
+static  unsigned  uwFilterLo, uwFilterHi = 0x7FFF;
+static  double  dTraceEntry;            // Time of entry to the command being logged
+
+static  unsigned  trace_count( void )
+{
+	return  yTraceFull ? TRACE_BUF_SIZE : ubTraceHead;
+}
+
+static  void  trace_log( unsigned uAddr, int yExit, double dTime )
+{
+	unsigned long  ulCounts = (unsigned long) (dTime * 1e6 * TSTAMP_COUNTS_PER_USEC);
+	unsigned  uwFunc = uAddr >> 1;
+
+	if ( !yTraceOn || uwFunc < uwFilterLo || uwFunc > uwFilterHi )  return;
+	asTrace[ubTraceHead].uwFunc = uwFunc | (yExit ? TRACE_EXIT : 0);
+	asTrace[ubTraceHead].ubOvf = (unsigned) (ulCounts >> 16) & 0xFF;
+	asTrace[ubTraceHead].uwCount = (unsigned) ulCounts & 0xFFFF;
+	ubTraceHead = (ubTraceHead + 1) % TRACE_BUF_SIZE;
+	if ( ubTraceHead == 0 )  yTraceFull = 1;
+}
+
+static  unsigned  trace_cmd_addr( char c1, char c2 )   // "command function" address
+{
+	return  0x1000 + ((unsigned) (c1 & 0x1F) << 7) + ((unsigned) (c2 & 0x1F) << 2);
+}
+
+static  void  trace_command( char c1, char c2, int yExit )
+{
+	double  dNow = now_sec();
+
+	if ( !yExit )
+	{
+		dTraceEntry = dNow;
+		trace_log( TRACE_ADDR_EXEC, 0, dNow );
+		if ( ubMaxDepth >= 2 )  trace_log( trace_cmd_addr( c1, c2 ), 0, dNow + 4e-6 );
+		return;
+	}
+	if ( dNow < dTraceEntry + 30e-6 )  dNow = dTraceEntry + 30e-6;
+	if ( ubMaxDepth >= 2 )  trace_log( trace_cmd_addr( c1, c2 ), 1, dNow - 5e-6 );
+	trace_log( TRACE_ADDR_EXEC, 1, dNow );
+}
+
+static  void  trace_cmd( void )
+{
+	unsigned  i, uIdx;
+
+	switch ( toupper( (unsigned char) *cmd_arg( 1 ) ) )
+	{
+	case 'S':
+		yTraceOn = 0;
+		ubMaxDepth = TRACE_DEFAULT_DEPTH;
+		uwFilterLo = 0;
+		uwFilterHi = 0x7FFF;
+		if ( isxdigit( (unsigned char) *cmd_arg( 2 ) ) )  ubMaxDepth = hex_digit( *cmd_arg( 2 ) );
+		if ( isxdigit( (unsigned char) *cmd_arg( 3 ) ) )
+		{
+			uwFilterLo = hexatoi( cmd_arg( 3 ) ) >> 1;
+			if ( !isxdigit( (unsigned char) *cmd_arg( 4 ) ) )  { cmd_error();  break; }
+			uwFilterHi = hexatoi( cmd_arg( 4 ) ) >> 1;
+		}
+		ubTraceHead = 0;
+		yTraceFull = 0;
+		yTraceOn = 1;
+		break;
+
+	case 'F':
+		yTraceOn = 0;
+		break;
+
+	case 'D':
+		yTraceOn = 0;
+		putch( '#' );
+		putHexByte( trace_count() );
+		putstr( " 10000 " );
+		putHexByte( TSTAMP_COUNTS_PER_USEC );
+		NEW_LINE;
+		for ( i = 0;  i < trace_count();  i++ )
+		{
+			uIdx = (ubTraceHead + TRACE_BUF_SIZE - trace_count() + i) % TRACE_BUF_SIZE;
+			putch( (asTrace[uIdx].uwFunc & TRACE_EXIT) ? '<' : '>' );
+			putHexWord( (asTrace[uIdx].uwFunc & ~TRACE_EXIT) << 1 );
+			putch( ' ' );
+			putHexByte( asTrace[uIdx].ubOvf );
+			putHexWord( asTrace[uIdx].uwCount );
+			NEW_LINE;
+		}
+		break;
+
+	case '\0':
+		putch( yTraceOn ? '1' : '0' );
+		putch( ' ' );
+		putHexByte( trace_count() );
+		putch( ' ' );
+		putHexDigit( ubMaxDepth );
+		break;
+
+	default:
+		cmd_error();
+		break;
+	}
+}
+
+
+/*****************************  COMMAND THREADS  **********************/
+
+/*
+|  'LV' and 'GD' run as the command thread in the firmware:  the node's input goes
+|  to the thread, not the HCI, until the thread ends with the response terminator.
+*/
+static  void  cmd_thread_end( void )    // as hci_service() when the thread ends
+{
+	psNode->iMode = MODE_HCI;
+	put_resp_term();
+	clear_command();
+	psNode->yMute = 0;
+}
+
+static  void  put_cursor_posn( int iRow, int iCol )
+{
+	putch( ESC );
+	putch( '[' );
+	putDecWord( (unsigned) iRow, 2 );
+	putch( ';' );
+	putDecWord( (unsigned) iCol, 2 );
+	putch( 'H' );
+}
+
+static  void  live_view_cmd( void )
+{
+	unsigned  uCount = 0x40, uPeriod = 100;
+	int     iOffset;
+
+	if ( !isxdigit( (unsigned char) *cmd_arg( 1 ) ) )  { cmd_error();  return; }
+	if ( isxdigit( (unsigned char) *cmd_arg( 2 ) ) )  uCount = hexatoi( cmd_arg( 2 ) );
+	if ( uCount == 0 || uCount > LIVE_VIEW_MAX )  { cmd_error();  return; }
+	if ( isxdigit( (unsigned char) *cmd_arg( 3 ) ) )  uPeriod = hexatoi( cmd_arg( 3 ) );
+	if ( uPeriod < LIVE_MIN_PERIOD )  uPeriod = LIVE_MIN_PERIOD;
+
+	psNode->uwLiveAddr = hexatoi( cmd_arg( 1 ) );
+	psNode->nLiveCount = (int) uCount;
+	psNode->dLivePeriod = uPeriod / 1000.0;
+	psNode->dLiveNext = now_sec() + psNode->dLivePeriod;
+	psNode->yLiveFirst = 1;
+	psNode->iMode = MODE_LIVE;
+	if ( psNode->yInteractive )         // Clear screen and draw dump frame (addresses)
+	{
+		putstr( "\033[2J\033[HLive view, <Esc> to quit" );
+		for ( iOffset = 0;  iOffset < psNode->nLiveCount;  iOffset += 16 )
+		{
+			put_cursor_posn( 3 + (iOffset >> 4), 1 );
+			putHexWord( psNode->uwLiveAddr + (unsigned) iOffset );
+		}
+	}
+}
+
+static  void  live_put_update( int iOffset, unsigned char ubValue )
+{
+	int  iCol = iOffset & 15;
+
+	if ( psNode->yInteractive )
+	{
+		if ( iOffset == psNode->iLiveCursor + 1 && iCol != 0 )
+		{
+			putch( ' ' );
+			if ( iCol == 8 )  putch( ' ' );
+		}
+		else  put_cursor_posn( 3 + (iOffset >> 4), 7 + iCol * 3 + (iCol >= 8) );
+		psNode->iLiveCursor = iOffset;
+	}
+	else
+	{
+		if ( psNode->nLiveRecs == LIVE_RECS_PER_LINE )  { NEW_LINE;  psNode->nLiveRecs = 0; }
+		if ( psNode->nLiveRecs == 0 )  putch( '+' );
+		putHexByte( (unsigned) iOffset );
+		psNode->nLiveRecs++ ;
+	}
+	putHexByte( ubValue );
+}
+
+static  void  live_refresh( double dNow )
+{
+	unsigned char  ubValue;
+	int     iOffset;
+
+	psNode->dLiveNext += psNode->dLivePeriod;
+	if ( psNode->dLiveNext < dNow )  psNode->dLiveNext = dNow;     // link too slow
+	psNode->iLiveCursor = -1;
+	psNode->nLiveRecs = 0;
+	for ( iOffset = 0;  iOffset < psNode->nLiveCount;  iOffset++ )
+	{
+		ubValue = psNode->aubData[(psNode->uwLiveAddr + (unsigned) iOffset) % DATA_SPACE_SIZE];
+		if ( ubValue != psNode->aubLive[iOffset] || psNode->yLiveFirst )
+		{
+			psNode->aubLive[iOffset] = ubValue;
+			live_put_update( iOffset, ubValue );
+		}
+	}
+	psNode->yLiveFirst = 0;
+	if ( psNode->nLiveRecs != 0 )  NEW_LINE;
+}
+
+static  void  live_input( char c )
+{
+	if ( c != ESC )  return;
+	if ( psNode->yInteractive )  put_cursor_posn( 3 + ((psNode->nLiveCount + 15) >> 4), 1 );
+	cmd_thread_end();
+}
+
+/*
+|  'GD' GDB stub, as gdbstub.c.  Registers r0..r31, SREG and SP are read from the
+|  simulated data space;  the PC is a fixed value.
+*/
+enum  { GDB_IDLE = 0, GDB_DATA, GDB_CSUM1, GDB_CSUM2 };
+
+#define  GDB_SIM_PC      0x0C20         // Reported PC (byte address)
+
+static  unsigned  uGdbTxSum;
+
+static  void  gdb_put_start( void )
+{
+	putch( '$' );
+	uGdbTxSum = 0;
+}
+
+static  void  gdb_put_char( char c )
+{
+	putch( c );
+	uGdbTxSum += (unsigned char) c;
+}
+
+static  void  gdb_put_hex( unsigned b )
+{
+	gdb_put_char( "0123456789abcdef"[(b >> 4) & 15] );
+	gdb_put_char( "0123456789abcdef"[b & 15] );
+}
+
+static  void  gdb_put_end( void )
+{
+	putch( '#' );
+	putch( "0123456789abcdef"[(uGdbTxSum >> 4) & 15] );
+	putch( "0123456789abcdef"[uGdbTxSum & 15] );
+}
+
+static  void  gdb_put_reply( const char *psz )
+{
+	gdb_put_start();
+	while ( *psz )  gdb_put_char( *psz++ );
+	gdb_put_end();
+}
+
+static  void  gdb_put_reg( unsigned uReg )
+{
+	if ( uReg < 32 )  gdb_put_hex( psNode->aubData[uReg] );
+	else if ( uReg == 32 )  gdb_put_hex( psNode->aubData[0x5F] );      // SREG
+	else if ( uReg == 33 )  { gdb_put_hex( psNode->aubData[0x5D] );  gdb_put_hex( psNode->aubData[0x5E] ); }
+	else  { gdb_put_hex( GDB_SIM_PC & 0xFF );  gdb_put_hex( GDB_SIM_PC >> 8 );  gdb_put_hex( 0 );  gdb_put_hex( 0 ); }
+}
+
+static  char  gdb_mem_space( unsigned long *pulAddr )
+{
+	if ( *pulAddr >= GDB_ADDR_EEPROM )  { *pulAddr -= GDB_ADDR_EEPROM;  return  'E'; }
+	if ( *pulAddr >= GDB_ADDR_DATA )  { *pulAddr -= GDB_ADDR_DATA;  return  'D'; }
+	return  'C';
+}
+
+static  void  gdb_mem_access( char *pc, int yWrite, int yBinary )     // 'm', 'M', 'X'
+{
+	unsigned long  ulAddr = strtoul( pc, &pc, 16 ), ulLen;
+	unsigned char  ubDat;
+	char    cSpace;
+
+	if ( *pc++ != ',' )  { gdb_put_reply( "E01" );  return; }
+	ulLen = strtoul( pc, &pc, 16 );
+	cSpace = gdb_mem_space( &ulAddr );
+	if ( !yWrite )
+	{
+		if ( ulLen > GDB_MEM_MAX )  ulLen = GDB_MEM_MAX;
+		gdb_put_start();
+		while ( ulLen-- != 0 )  gdb_put_hex( mem_read( cSpace, (unsigned) ulAddr++ & 0xFFFF ) );
+		gdb_put_end();
+		return;
+	}
+	if ( *pc++ != ':' )  { gdb_put_reply( "E01" );  return; }
+	if ( ulLen > (unsigned long) (psNode->acGdbPkt + psNode->nGdbLen - pc) / (yBinary ? 1 : 2) )
+	{
+		gdb_put_reply( "E02" );
+		return;
+	}
+	while ( ulLen-- != 0 )
+	{
+		if ( yBinary )  ubDat = (unsigned char) *pc++;
+		else  { ubDat = (unsigned char) hex_pair( pc );  pc += 2; }
+		if ( !mem_write( cSpace, (unsigned) ulAddr++ & 0xFFFF, ubDat ) )  { gdb_put_reply( "E03" );  return; }
+	}
+	gdb_put_reply( "OK" );
+}
+
+static  void  gdb_execute( void )
+{
+	char     *pc = &psNode->acGdbPkt[1];
+	unsigned  uReg;
+
+	if ( psNode->yGdbBreak )
+	{
+		psNode->yGdbBreak = 0;
+		if ( psNode->yGdbRunning )  gdb_put_reply( "S02" );
+		psNode->yGdbRunning = 0;
+		return;
+	}
+	if ( psNode->yGdbOverflow || psNode->uGdbRxSum != (psNode->uGdbSum & 0xFF) )
+	{
+		putch( '-' );
+		return;
+	}
+	putch( '+' );
+
+	switch ( psNode->acGdbPkt[0] )
+	{
+	case '?':
+	case 's':  gdb_put_reply( "S05" );  break;
+	case 'c':  psNode->yGdbRunning = 1;  break;
+	case 'g':
+		gdb_put_start();
+		for ( uReg = 0;  uReg < 35;  uReg++ )  gdb_put_reg( uReg );
+		gdb_put_end();
+		break;
+	case 'p':
+		uReg = (unsigned) strtoul( pc, NULL, 16 );
+		if ( uReg < 35 )  { gdb_put_start();  gdb_put_reg( uReg );  gdb_put_end(); }
+		else  gdb_put_reply( "E01" );
+		break;
+	case 'G':
+	case 'P':  gdb_put_reply( "E01" );  break;
+	case 'm':  gdb_mem_access( pc, 0, 0 );  break;
+	case 'M':  gdb_mem_access( pc, 1, 0 );  break;
+	case 'X':  gdb_mem_access( pc, 1, 1 );  break;
+	case 'H':  gdb_put_reply( "OK" );  break;
+	case 'q':
+		if ( strncmp( pc, "Supported", 9 ) == 0 )  gdb_put_reply( "PacketSize=40" );
+		else if ( strncmp( pc, "Attached", 8 ) == 0 )  gdb_put_reply( "1" );
+		else  gdb_put_reply( "" );
+		break;
+	case 'D':  gdb_put_reply( "OK" );  psNode->yGdbExit = 1;  break;
+	case 'k':  psNode->yGdbExit = 1;  break;
+	default:   gdb_put_reply( "" );  break;
+	}
+}
+
+static  void  gdb_start_packet( void )
+{
+	psNode->iGdbState = GDB_DATA;
+	psNode->nGdbLen = 0;
+	psNode->uGdbSum = 0;
+	psNode->yGdbEscape = 0;
+	psNode->yGdbOverflow = 0;
+}
+
+static  void  gdb_start( void )
+{
+	psNode->iMode = MODE_GDB;
+	psNode->iGdbState = GDB_IDLE;
+	psNode->yGdbRunning = 0;
+	psNode->yGdbBreak = 0;
+	psNode->yGdbExit = 0;
+}
+
+static  int  gdb_receive( char c )     // TRUE when a packet (or Ctrl-C) is to be executed
+{
+	switch ( psNode->iGdbState )
+	{
+	case GDB_IDLE:
+		if ( c == '$' )  gdb_start_packet();
+		else if ( c == 0x03 )  { psNode->yGdbBreak = 1;  return  1; }
+		else if ( c == ESC )  psNode->yGdbExit = 1;
+		break;
+
+	case GDB_DATA:
+		if ( c == '$' )  { gdb_start_packet();  break; }
+		if ( c == '#' )  { psNode->iGdbState = GDB_CSUM1;  break; }
+		psNode->uGdbSum += (unsigned char) c;
+		if ( c == '}' && !psNode->yGdbEscape )  { psNode->yGdbEscape = 1;  break; }
+		if ( psNode->yGdbEscape )  c ^= 0x20;
+		psNode->yGdbEscape = 0;
+		if ( psNode->nGdbLen < GDB_PKT_SIZE )  psNode->acGdbPkt[psNode->nGdbLen++] = c;
+		else  psNode->yGdbOverflow = 1;
+		break;
+
+	case GDB_CSUM1:
+		psNode->uGdbRxSum = hex_digit( c ) << 4;
+		psNode->iGdbState = GDB_CSUM2;
+		break;
+
+	case GDB_CSUM2:
+		psNode->uGdbRxSum |= hex_digit( c );
+		psNode->iGdbState = GDB_IDLE;
+		psNode->acGdbPkt[psNode->nGdbLen] = '\0';
+		return  1;
+	}
+	return  0;
+}
+
+static  void  gdb_input( char c )
+{
+	if ( gdb_receive( c ) )  gdb_execute();
+	if ( psNode->yGdbExit )  cmd_thread_end();
+}
+
+
+static  void  exec_command( void )
+{
+	char   c1, c2;
+	int    iAddr;
+
+	if ( psNode->acCmdMsg[0] == '@' && isxdigit( (unsigned char) psNode->acCmdMsg[1] )
+	&&   isxdigit( (unsigned char) psNode->acCmdMsg[2] ) && psNode->acCmdMsg[3] == ' ' )
+	{
+		iAddr = (int) hexatoi( &psNode->acCmdMsg[1] ) & 0xFF;
+		if ( iAddr != psNode->iAddr && iAddr != HCI_BROADCAST )  { clear_command();  return; }
+		psNode->yMute = ( iAddr == HCI_BROADCAST );
+		memmove( psNode->acCmdMsg, psNode->acCmdMsg + 4, CMD_MSG_SIZE - 3 );
+	}
+	else if ( psNode->iAddr != 0 )  { clear_command();  return; }
+
+	c1 = toupper( psNode->acCmdMsg[0] );
+	c2 = toupper( psNode->acCmdMsg[1] );
+	trace_command( c1, c2, 0 );
+	if ( psNode->yInteractive && c1 != ':' )  NEW_LINE;
+
+	if ( c1 == ':' )  ihex_record();        // Intel HEX record (see 'XL')
+	else if ( c1 == 'V' && c2 == 'N' )  put_version();
+	else if ( c1 == 'I' && c2 == 'M' )
+	{
+		char  c = psNode->acCmdMsg[3];
+
+		if ( (c == '1' || c == 'Y' || c == 'y') && psNode->iAddr != 0 )  cmd_error();
+		else
+		{
+			psNode->yInteractive = ( c == '1' || c == 'Y' || c == 'y' );
+			clear_command();
+		}
+	}
+	else if ( (c1 == 'S' && c2 == 'X') || (c1 == 'F' && strchr( "IRPE", c2 ) && c2 != '\0') )
+		spi_commands( c1, c2 );
+	else if ( (c1 == 'R' && c2 == 'V') || (c1 == 'W' && c2 == 'V') || (c1 == 'S' && c2 == 'N') )
+		var_commands( c1 );
+	else if ( c1 == 'W' && c2 == 'T' )  wait_command();
+	else if ( c1 == 'V' && c2 != '\0' && strchr( "LRWB", c2 ) )  varreg_commands( c2 );
+	else if ( c1 == 'N' && c2 == 'A' )
+	{
+		if ( !isxdigit( (unsigned char) psNode->acCmdMsg[3] ) )  putHexByte( psNode->iAddr );
+		else if ( (hexatoi( &psNode->acCmdMsg[3] ) & 0xFF) == HCI_BROADCAST )  cmd_error();
+		else
+		{
+			psNode->iAddr = (int) hexatoi( &psNode->acCmdMsg[3] ) & 0xFF;
+			if ( psNode->iAddr != 0 )  { psNode->yInteractive = 0;  psNode->cRespCode = '-'; }
+		}
+	}
+	else if ( c1 == 'L' && c2 == 'S' )  putstr( "(simulated monitor)\n" );
+	else if ( c1 == 'D' && c2 == 'P' )  { }
+	else if ( c1 == 'S' && c2 == 'E' )  { put_word_bits( psNode->wSystemError );  psNode->wSystemError = 0; }
+	else if ( c1 == 'S' && c2 == 'F' )  { put_word_bits( psNode->wDebugFlags );  psNode->wDebugFlags = 0; }
+	else if ( c1 == 'R' && c2 == 'S' )  { memset( psNode->aubData, 0, sizeof(psNode->aubData) );  psNode->yInteractive = ( psNode->iAddr == 0 ); }
+	else if ( c1 == 'D' && (c2 == 'C' || c2 == 'D' || c2 == 'E') )  dump_memory( c2 );
+	else if ( c1 == 'R' && c2 == 'M' )
+	{
+		if ( psNode->yInteractive )  putch( ' ' );
+		putHexByte( psNode->aubData[hexatoi( &psNode->acCmdMsg[3] ) % DATA_SPACE_SIZE] );
+	}
+	else if ( c1 == 'W' && c2 == 'M' )
+	{
+		if ( !hex_args_ok( "hhh hh" ) )  cmd_error();
+		else  psNode->aubData[hexatoi( &psNode->acCmdMsg[3] ) % DATA_SPACE_SIZE] = (unsigned char) hexatoi( &psNode->acCmdMsg[7] );
+	}
+	else if ( c1 == 'I' && c2 == 'P' )
+	{
+		if ( psNode->yInteractive )  putch( ' ' );
+		putHexByte( psNode->aubData[(hexatoi( &psNode->acCmdMsg[3] ) + 0x20) % DATA_SPACE_SIZE] );
+	}
+	else if ( c1 == 'O' && c2 == 'P' )
+	{
+		if ( !hex_args_ok( "hh hh" ) )  cmd_error();
+		else  psNode->aubData[(hexatoi( &psNode->acCmdMsg[3] ) + 0x20) % DATA_SPACE_SIZE] = (unsigned char) hexatoi( &psNode->acCmdMsg[6] );
+	}
+	else if ( c1 == 'Z' && c2 != '\0' && strchr( "CDE", c2 ) )  packed_dump( c2 );
+	else if ( c1 == 'X' && c2 != '\0' && strchr( "CDE", c2 ) )  ihex_dump( c2 );
+	else if ( c1 == 'X' && c2 == 'L' )  ihex_load();
+	else if ( c1 == 'E' && c2 == 'E' )
+	{
+		if ( !isxdigit( (unsigned char) *cmd_arg( 1 ) ) )  cmd_error();
+		else  memset( aubEeprom + (hexatoi( cmd_arg( 1 ) ) & 7) * 128, 0xFF, 128 );
+	}
+	else if ( c1 == 'C' && c2 == 'M' )  crash_mailbox_cmd();
+	else if ( c1 == 'W' && c2 == 'S' )  wdog_status_cmd();
+	else if ( c1 == 'I' && c2 == 'S' )  isr_stats_cmd();
+	else if ( c1 == 'T' && c2 == 'L' )  task_list_cmd();
+	else if ( c1 == 'P' && c2 == 'F' )  profile_cmd();
+	else if ( c1 == 'F' && c2 == 'T' )  trace_cmd();
+	else if ( c1 == 'L' && c2 == 'V' )  live_view_cmd();
+	else if ( c1 == 'G' && c2 == 'D' )  gdb_start();
+	else  cmd_error();
+
+	trace_command( c1, c2, 1 );
+	if ( psNode->iMode != MODE_HCI )  return;      // Completed when the thread ends
+	put_resp_term();
+	clear_command();
+	psNode->yMute = 0;
+}
+
+static  void  process_input( char c )
+{
+	if ( psNode->iMode == MODE_LIVE )  live_input( c );
+	else if ( psNode->iMode == MODE_GDB )  gdb_input( c );
+	else if ( c == '\r' )
+	{
+		if ( psNode->iCmdLen != 0 )  exec_command();
+		else if ( psNode->iAddr == 0 )  put_resp_term();
+	}
+	else if ( psNode->iCmdLen == 0 && psNode->iAddr == 0 && (c == '$' || c == '+') )
+	{
+		if ( c == '$' )  { gdb_start();  gdb_start_packet(); }     // GDB packet:  enter GDB mode
+	}
+	else if ( isprint( (unsigned char) c ) )
+	{
+		if ( psNode->iCmdLen < CMD_MSG_SIZE )  psNode->acCmdMsg[psNode->iCmdLen++] = c;
+		if ( psNode->yInteractive )  putch( c );
+	}
+	else if ( c == ESC || c == CAN )
+	{
+		clear_command();
+		if ( psNode->iAddr == 0 )  put_resp_term();
+	}
+}
+
+
+/*****************************  MAIN LOOP  ****************************/
+
+static  double  now_sec( void )
+{
+	struct timespec  ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return  ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static  void  wire_input( int fdMaster )      // data sent by host, in transit
+{
+	ssize_t  n;
+
+	if ( nWireHead == nWireTail )  nWireHead = nWireTail = 0;
+	n = read( fdMaster, acWire + nWireTail, sizeof(acWire) - nWireTail );
+	if ( n > 0 )  nWireTail += (size_t) n;
+}
+
+static  void  rx_input( double dNow )         // emulates the UART RX ISR
+{
+	static double  dNextRx;
+
+	while ( nWireHead < nWireTail && (dCharTime == 0 || dNextRx <= dNow) )
+	{
+		if ( dNextRx < dNow - dCharTime )  dNextRx = dNow - dCharTime;
+		dNextRx += dCharTime;
+		if ( iRxCount < SERIAL_RX_BUF_SIZE )
+		{
+			acRxFifo[(iRxHead + iRxCount) % SERIAL_RX_BUF_SIZE] = acWire[nWireHead];
+			iRxCount++ ;
+		}
+		else
+		{
+			ulRxOverruns++ ;
+			fprintf( stderr, "avrmon-sim: RX buffer overrun (%lu)\n", ulRxOverruns );
+		}
+		nWireHead++ ;
+		ulIsrRxCount++ ;
+	}
+}
+
+
+int  main( int argc, char **argv )
+{
+	struct termios  sTio;
+	const char *pszLink = NULL;
+	char       *pszSlave;
+	double      dNextTx = 0;
+	int         iFirstAddr = -1;
+	int         fdMaster, fdSlave, iOpt, i;
+
+	while ( (iOpt = getopt( argc, argv, "b:l:a:n:c" )) != -1 )
+	{
+		if ( iOpt == 'c' )  yCrashRecord = 1;
+		else if ( iOpt == 'b' )  dCharTime = atoi( optarg ) > 0 ? 10.0 / atoi( optarg ) : 0.0;
+		else if ( iOpt == 'l' )  pszLink = optarg;
+		else if ( iOpt == 'a' )  iFirstAddr = (int) strtol( optarg, NULL, 16 ) & 0xFF;
+		else if ( iOpt == 'n' )  nNodes = atoi( optarg );
+		else  nNodes = 0;
+		if ( nNodes < 1 || nNodes > MAX_NODES || iFirstAddr == HCI_BROADCAST )
+		{
+			fprintf( stderr, "usage: avrmon-sim [-b baud] [-l linkpath] [-a addr] [-n nodes] [-c]\n" );
+			return  2;
+		}
+	}
+	if ( iFirstAddr < 0 )  iFirstAddr = ( nNodes > 1 ) ? 1 : 0;
+	if ( iFirstAddr == 0 && nNodes > 1 )
+	{
+		fprintf( stderr, "avrmon-sim: nodes on a bus need addresses (-a)\n" );
+		return  2;
+	}
+	if ( iFirstAddr + nNodes - 1 >= HCI_BROADCAST )
+	{
+		fprintf( stderr, "avrmon-sim: node address out of range\n" );
+		return  2;
+	}
+
+	for ( i = 0;  i < FLASH_SIZE;  i++ )    // Some "code", then erased flash
+		aubFlash[i] = ( i < 0x800 ) ? (unsigned char) (i * 37 + (i >> 5)) : 0xFF;
+	memset( aubEeprom, 0xFF, sizeof(aubEeprom) );
+	memset( aubSpiFlash, 0xFF, sizeof(aubSpiFlash) );
+	memcpy( aubSpiFlash, "SPI FLASH SIM", 13 );
+	dIsrClearTime = now_sec();
+	for ( i = 0;  i < nNodes;  i++ )
+	{
+		psNode = &asNode[i];
+		psNode->iAddr = iFirstAddr + i;
+		psNode->yInteractive = ( psNode->iAddr == 0 );     // INTERACTIVE_ON_STARTUP
+		snprintf( (char *) psNode->aubData + 0x100, 16, "AVRMON SIM %02X", psNode->iAddr );
+	}
+	psNode = &asNode[0];
+
+	fdMaster = posix_openpt( O_RDWR | O_NOCTTY );
+	if ( fdMaster < 0 || grantpt( fdMaster ) < 0 || unlockpt( fdMaster ) < 0 )
+	{
+		perror( "avrmon-sim: pty" );
+		return  1;
+	}
+	pszSlave = ptsname( fdMaster );
+	fdSlave = open( pszSlave, O_RDWR | O_NOCTTY );      // held open, so master never sees EIO
+	if ( fdSlave < 0 || tcgetattr( fdSlave, &sTio ) < 0 )
+	{
+		perror( "avrmon-sim: slave" );
+		return  1;
+	}
+	cfmakeraw( &sTio );
+	tcsetattr( fdSlave, TCSANOW, &sTio );
+
+	if ( pszLink != NULL )
+	{
+		unlink( pszLink );
+		if ( symlink( pszSlave, pszLink ) < 0 )  perror( "avrmon-sim: symlink" );
+	}
+	signal( SIGPIPE, SIG_IGN );
+	printf( "%s\n", pszSlave );
+	fflush( stdout );
+
+	for ( i = 0;  i < nNodes;  i++ )
+	{
+		psNode = &asNode[i];
+		clear_command();
+	}
+	psNode = &asNode[0];
+	if ( psNode->yInteractive )
+	{
+		putstr( "\nAVROS : Arduino Debug Monitor : " );      // as main.c at startup
+		put_version();
+		put_resp_term();
+	}
+
+	while ( 1 )
+	{
+		struct pollfd  sPoll = { fdMaster, POLLIN, 0 };
+		int     iWait = -1, iLive;
+		double  dNow = now_sec();
+
+		if ( nOutHead < nOutTail )
+			iWait = ( dNextTx > dNow ) ? (int) ((dNextTx - dNow) * 1000.0) : 0;
+		else if ( iRxCount != 0 )  iWait = 0;
+		for ( i = 0;  i < nNodes;  i++ )      // Wake for the next 'LV' refresh
+		{
+			if ( asNode[i].iMode != MODE_LIVE || nOutHead != nOutTail )  continue;
+			iLive = ( asNode[i].dLiveNext > dNow ) ? 1 + (int) ((asNode[i].dLiveNext - dNow) * 1000.0) : 0;
+			if ( iWait < 0 || iLive < iWait )  iWait = iLive;
+		}
+		if ( nWireHead < nWireTail )  iWait = 0;
+		if ( poll( &sPoll, 1, iWait ) > 0 && (sPoll.revents & POLLIN) )  wire_input( fdMaster );
+
+		dNow = now_sec();
+		rx_input( dNow );
+		if ( nOutHead < nOutTail )          // Transmit, paced at baud rate
+		{
+			size_t  nSend = nOutTail - nOutHead;
+
+			if ( dCharTime > 0 )
+			{
+				if ( dNow < dNextTx )  continue;
+				nSend = 1 + (size_t) ((dNow - dNextTx) / dCharTime);
+				if ( nSend > nOutTail - nOutHead )  nSend = nOutTail - nOutHead;
+				dNextTx = ( dNextTx > dNow - dCharTime ? dNextTx : dNow ) + nSend * dCharTime;
+			}
+			if ( write( fdMaster, acOut + nOutHead, nSend ) > 0 )
+			{
+				nOutHead += nSend;
+				ulIsrTxCount += nSend;
+			}
+			if ( nOutHead == nOutTail )  nOutHead = nOutTail = 0;
+			continue;
+		}
+		while ( iRxCount != 0 && nOutHead == nOutTail )     // Main loop: hci_service()
+		{
+			char  c = (char) acRxFifo[iRxHead];
+			int   nResponders = 0;
+
+			iRxHead = (iRxHead + 1) % SERIAL_RX_BUF_SIZE;
+			iRxCount-- ;
+			for ( i = 0;  i < nNodes;  i++ )    // Every node receives every char
+			{
+				size_t  nOutBefore = nOutTail;
+
+				psNode = &asNode[i];
+				process_input( c );
+				if ( nOutTail != nOutBefore )  nResponders++ ;
+			}
+			if ( nResponders > 1 )
+				fprintf( stderr, "avrmon-sim: bus collision (%d nodes responding)\n", nResponders );
+		}
+		for ( i = 0;  i < nNodes && nOutHead == nOutTail;  i++ )     // 'LV' refresh
+		{
+			psNode = &asNode[i];
+			if ( psNode->iMode == MODE_LIVE && now_sec() >= psNode->dLiveNext )  live_refresh( now_sec() );
+		}
+	}
+	return  0;
+}
+
+// end
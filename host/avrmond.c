@@ -0,0 +1,982 @@
+/*____________________________________________________________________________*\
+|
+|  File:        avrmond.c
+|  Compiler:    GCC (Linux host)
+|
+|  Serial link multiplexer daemon for the AVR monitor.  avrmond owns the HCI
+|  link (serial device or avrmon-sim pty) and serves any number of local
+|  clients on a Unix domain socket, so a dashboard, a logger and a test runner
+|  can use one board at the same time.
+|
+|  To a client the socket looks like the monitor in machine mode:  it sends
+|  command lines (CR or LF terminated) and receives each response followed by
+|  "\r\n" and the response code, '-' or '!', in the order of its commands.
+|  The avrmon library connects to the socket when given its path as the device
+|  (avrmon_open()), so avrmon-cli and other library clients work unchanged.
+|
+|  Requests from all clients are queued and pipelined on the link, up to the
+|  monitor's RX buffer depth, as avrmon_pipeline() does.  In addition:
+|
+|    -  Coalescing:  a read-only request (VN, RM, RV, SN, VR, VB, DD/DE aaaa, XD,
+|       XE, ZD, ZE, FR, FI) identical to one still queued, with no other kind of
+|       request queued after it, is answered by the same link transaction.
+|    -  Caching:  responses to requests for data which only changes with the
+|       firmware (LS, VL, and DC, XC and ZC with an address) are kept and answered
+|       without using the link.  The cache is cleared by 'RS', by any '!' response
+|       or timeout (the monitor may have been reset or reloaded), when the 'VN'
+|       response changes (VN itself is not cached) and by the daemon command '%C'.
+|    -  'XL' (Intel HEX load) gives its client the link until the end-of-file
+|       record is sent (or the client disconnects), so other clients' commands
+|       are not taken as records.
+|    -  'IM 0' (sent by the library on connection) is answered locally;  'IM 1',
+|       the streaming commands 'WD' and 'LV', 'NA nn' (which would take the
+|       monitor off the link), and GDB packets, acks and interrupts (lines starting
+|       with '$', '+' or Ctrl-C, which would switch the monitor to the GDB stub)
+|       are refused with '!'.  Esc discards a partial line.
+|    -  If the monitor does not respond within the timeout (extended for 'WT'),
+|       the requests in flight are answered with '!' and the link is re-synced;
+|       while that fails, requests are answered with '!' and re-sync is retried.
+|
+|  Daemon commands (lines starting with '%'):
+|      %S       link statistics, one "name value" per line
+|      %R       reset statistics
+|      %C       clear the response cache
+|
+|  Usage:   avrmond [-d device] [-b baud] [-n node] [-p depth] [-t msec] [-s socket] [-v]
+|
+|      -d device    serial device or pty (default /dev/ttyACM0, or $AVRMON_DEV)
+|      -b baud      baud rate (default 19200)
+|      -n node      node address on a multi-drop bus (hex, 01..FE)
+|      -p depth     pipeline depth in bytes (default 64;  1 if a node address is given)
+|      -t msec      response timeout (default 2000)
+|      -s socket    socket path (default /tmp/avrmond.sock, or $AVRMOND_SOCKET)
+|      -v           log client connections and link errors on stderr
+|
+|  The daemon runs in the foreground;  SIGINT or SIGTERM removes the socket and
+|  exits.  Test it against the simulator, e.g.
+|
+|      avrmon-sim -l /tmp/avrmon &
+|      avrmond -d /tmp/avrmon -s /tmp/avrmond.sock &
+|      avrmon-cli -d /tmp/avrmond.sock rm 100 101 & avrmon-cli -d /tmp/avrmond.sock vn
+|      avrmon-cli -d /tmp/avrmond.sock cmd %S
+|
+|  Build:   gcc -O2 -o avrmond avrmond.c avrmon.c
+\*____________________________________________________________________________*/
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "avrmon.h"
+
+#define  DEFAULT_SOCKET     "/tmp/avrmond.sock"
+#define  MAX_CLIENTS         64
+#define  CACHE_SIZE         256         // Cached responses (oldest replaced)
+#define  RESYNC_INTERVAL    1.0         // Link down:  re-sync attempt interval, sec
+
+#define  ASCII_CR        13
+#define  ASCII_LF        10
+#define  ASCII_ESC       27
+#define  ASCII_CAN       24
+#define  ASCII_ETX        3          // Ctrl-C:  GDB interrupt
+
+// Request classes
+#define  REQ_OTHER           0          // Forwarded in order
+#define  REQ_READ            1          // No side effects:  may be coalesced
+#define  REQ_CACHE           2          // Immutable data:  cached (and coalesced)
+#define  REQ_LOCAL           3          // Answered by the daemon
+
+typedef  struct  client  client_t;
+typedef  struct  slot  slot_t;
+typedef  struct  request  request_t;
+
+// Client request, in the client's response order
+struct  slot
+{
+	client_t  *psClient;        // NULL if the client has gone
+	slot_t    *psNext;          // Client's next request
+	slot_t    *psNextWaiter;    // Next slot answered by the same link request
+	int        yDone;
+	char       cCode;
+	char      *pszText;         // Response text (malloc'd)
+	size_t     nLength;
+};
+
+// Client connection
+struct  client
+{
+	int        fd;
+	char       acLine[AVRMON_CMD_MAX + 1];
+	size_t     nLine;
+	int        yOverlong;       // Line too long:  answer '!'
+	char      *pcOut;           // Output not yet written
+	size_t     nOut;
+	size_t     nOutAlloc;
+	slot_t    *psHead;          // Requests, oldest first
+	slot_t    *psTail;
+};
+
+// Link request
+struct  request
+{
+	char       acCmd[AVRMON_CMD_MAX + 1];
+	char       acKey[AVRMON_CMD_MAX + 1];   // Normalised command (coalescing, cache)
+	int        iClass;
+	client_t  *psOwner;         // Client which made the request
+	double     dSent;
+	double     dDeadline;
+	slot_t    *psWaiters;
+	request_t *psNext;
+};
+
+// Cached response
+typedef  struct
+{
+	char      *pszKey;
+	char      *pszText;
+	size_t     nLength;
+}
+cache_t;
+
+// Statistics
+typedef  struct
+{
+	double         dStart;
+	unsigned long  ulClients;       // Connections accepted
+	unsigned long  ulRequests;      // Client requests
+	unsigned long  ulLinkCmds;      // Commands sent on the link
+	unsigned long  ulCoalesced;     // Requests answered by another's link command
+	unsigned long  ulCacheHits;
+	unsigned long  ulLocal;         // Answered by the daemon
+	unsigned long  ulErrors;        // '!' responses from the monitor
+	unsigned long  ulTimeouts;
+	unsigned long  ulTxBytes;
+	unsigned long  ulRxBytes;
+	double         dMinRtt;
+	double         dMaxRtt;
+	double         dSumRtt;
+	double         dBusy;           // Time with requests in flight
+	int            iMaxQueue;       // Longest queue (pending + in flight)
+}
+stats_t;
+
+static  avrmon_t   *psMon;
+static  client_t   *apsClient[MAX_CLIENTS];
+static  int         nClients;
+static  request_t  *psPending;      // Not yet sent, in arrival order
+static  request_t  *psInFlight;     // Sent, in link order
+static  request_t  *psInFlightTail;
+static  size_t      nInFlightBytes;
+static  client_t   *psLockOwner;    // 'XL' in progress:  only this client's requests sent
+static  int         yLinkDown;      // No response to re-sync:  requests refused
+static  double      dNextResync;
+static  cache_t     asCache[CACHE_SIZE];
+static  int         iCacheNext;
+static  char       *pszVersion;     // Last 'VN' response (malloc'd), or NULL
+static  stats_t     sStats;
+static  double      dBusyStart;
+static  int         iBaud = AVRMON_DEFAULT_BAUD;
+static  int         iNode = 0;
+static  int         iDepth = 0;
+static  int         iTimeout = AVRMON_DEFAULT_TIMEOUT;
+static  int         yVerbose = 0;
+static  volatile sig_atomic_t  yQuit = 0;
+
+
+static  double  now_sec( void )
+{
+	struct timespec  ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return  ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static  void  on_signal( int iSig )
+{
+	(void) iSig;
+	yQuit = 1;
+}
+
+
+static  void  reset_stats( void )
+{
+	memset( &sStats, 0, sizeof(sStats) );
+	sStats.dStart = now_sec();
+	if ( psInFlight != NULL )  dBusyStart = sStats.dStart;
+}
+
+
+/*****************************  CLIENT OUTPUT  ********************************/
+
+static  void  client_append( client_t *psClient, const char *pc, size_t n )
+{
+	if ( psClient->nOut + n > psClient->nOutAlloc )
+	{
+		size_t  nNew = psClient->nOutAlloc * 2 + n + 256;
+		char   *pcNew = realloc( psClient->pcOut, nNew );
+
+		if ( pcNew == NULL )  return;
+		psClient->pcOut = pcNew;
+		psClient->nOutAlloc = nNew;
+	}
+	memcpy( psClient->pcOut + psClient->nOut, pc, n );
+	psClient->nOut += n;
+}
+
+
+static  void  client_flush( client_t *psClient )
+{
+	ssize_t  nDone;
+
+	while ( psClient->nOut != 0 )
+	{
+		nDone = write( psClient->fd, psClient->pcOut, psClient->nOut );
+		if ( nDone <= 0 )  return;              // EAGAIN:  rest on POLLOUT
+		psClient->nOut -= (size_t) nDone;
+		memmove( psClient->pcOut, psClient->pcOut + nDone, psClient->nOut );
+	}
+}
+
+
+/*
+|  Output the client's completed responses, in order, up to the first one not
+|  yet answered.
+*/
+static  void  client_deliver( client_t *psClient )
+{
+	slot_t  *psSlot;
+	char     acTerm[3] = { ASCII_CR, ASCII_LF, '-' };
+
+	while ( (psSlot = psClient->psHead) != NULL && psSlot->yDone )
+	{
+		client_append( psClient, psSlot->pszText, psSlot->nLength );
+		acTerm[2] = psSlot->cCode;
+		client_append( psClient, acTerm, 3 );
+		psClient->psHead = psSlot->psNext;
+		if ( psClient->psHead == NULL )  psClient->psTail = NULL;
+		free( psSlot->pszText );
+		free( psSlot );
+	}
+	client_flush( psClient );
+}
+
+
+static  slot_t  *slot_new( client_t *psClient )
+{
+	slot_t  *psSlot = calloc( 1, sizeof(slot_t) );
+
+	if ( psSlot == NULL )  return  NULL;
+	psSlot->psClient = psClient;
+	if ( psClient->psTail != NULL )  psClient->psTail->psNext = psSlot;
+	else  psClient->psHead = psSlot;
+	psClient->psTail = psSlot;
+
+	return  psSlot;
+}
+
+
+/*
+|  Answer a slot.  A slot of a client which has gone is freed.
+*/
+static  void  slot_answer( slot_t *psSlot, const char *pszText, size_t nLength, char cCode )
+{
+	psSlot->pszText = malloc( nLength + 1 );
+	if ( psSlot->pszText != NULL )
+	{
+		memcpy( psSlot->pszText, pszText, nLength );
+		psSlot->pszText[nLength] = '\0';
+		psSlot->nLength = nLength;
+	}
+	psSlot->cCode = cCode;
+	psSlot->yDone = 1;
+	if ( psSlot->psClient == NULL )
+	{
+		free( psSlot->pszText );
+		free( psSlot );
+	}
+}
+
+
+/*****************************  CACHE  ****************************************/
+
+static  const cache_t  *cache_find( const char *pszKey )
+{
+	int  i;
+
+	for ( i = 0;  i < CACHE_SIZE;  i++ )
+		if ( asCache[i].pszKey != NULL && strcmp( asCache[i].pszKey, pszKey ) == 0 )
+			return  &asCache[i];
+	return  NULL;
+}
+
+
+static  void  cache_store( const char *pszKey, const char *pszText, size_t nLength )
+{
+	cache_t  *psEnt = &asCache[iCacheNext];
+
+	iCacheNext = (iCacheNext + 1) % CACHE_SIZE;
+	free( psEnt->pszKey );
+	free( psEnt->pszText );
+	psEnt->pszKey = strdup( pszKey );
+	psEnt->pszText = malloc( nLength + 1 );
+	if ( psEnt->pszKey == NULL || psEnt->pszText == NULL )
+	{
+		free( psEnt->pszKey );
+		free( psEnt->pszText );
+		psEnt->pszKey = psEnt->pszText = NULL;
+		return;
+	}
+	memcpy( psEnt->pszText, pszText, nLength );
+	psEnt->pszText[nLength] = '\0';
+	psEnt->nLength = nLength;
+}
+
+
+static  void  cache_clear( void )
+{
+	int  i;
+
+	for ( i = 0;  i < CACHE_SIZE;  i++ )
+	{
+		free( asCache[i].pszKey );
+		free( asCache[i].pszText );
+		asCache[i].pszKey = asCache[i].pszText = NULL;
+	}
+	iCacheNext = 0;
+}
+
+
+/*
+|  Check a 'VN' response against the last one:  if the firmware has changed,
+|  the cached responses are stale.
+*/
+static  void  cache_check_version( const char *pszText, size_t nLength )
+{
+	if ( pszVersion != NULL && strlen( pszVersion ) == nLength
+	&&   memcmp( pszVersion, pszText, nLength ) == 0 )  return;
+
+	if ( pszVersion != NULL )
+	{
+		if ( yVerbose )  fprintf( stderr, "avrmond: version changed, cache cleared\n" );
+		cache_clear();
+		free( pszVersion );
+	}
+	pszVersion = malloc( nLength + 1 );
+	if ( pszVersion == NULL )  return;
+	memcpy( pszVersion, pszText, nLength );
+	pszVersion[nLength] = '\0';
+}
+
+
+/*****************************  REQUEST CLASSES  ******************************/
+
+/*
+|  Normalise a command line for comparison:  upper case, single spaces, no
+|  leading or trailing space.
+*/
+static  void  normalise( const char *pszCmd, char *pszKey )
+{
+	char  *pc = pszKey;
+
+	while ( *pszCmd == ' ' )  pszCmd++ ;
+	while ( *pszCmd != '\0' )
+	{
+		if ( *pszCmd == ' ' )
+		{
+			while ( *pszCmd == ' ' )  pszCmd++ ;
+			if ( *pszCmd != '\0' )  *pc++ = ' ';
+			continue;
+		}
+		*pc++ = (char) toupper( (unsigned char) *pszCmd++ );
+	}
+	*pc = '\0';
+}
+
+
+/*
+|  Classify a (normalised) command.  Commands which dump "the next block" when
+|  no address is given depend on the previous command, so are REQ_OTHER.
+*/
+static  int  classify( const char *pszKey )
+{
+	char  c1 = pszKey[0];
+	char  c2 = ( c1 != '\0' ) ? pszKey[1] : '\0';
+	int   yArg = ( c2 != '\0' && pszKey[2] == ' ' );
+
+	if ( c1 == '%' )  return  REQ_LOCAL;
+	if ( (c1 == 'I' && c2 == 'M') || (c1 == 'W' && c2 == 'D') || (c1 == 'L' && c2 == 'V') )
+		return  REQ_LOCAL;
+	if ( c1 == 'N' && c2 == 'A' && yArg )  return  REQ_LOCAL;
+	if ( c1 == '$' || c1 == '+' || c1 == ASCII_ETX )  return  REQ_LOCAL;   // GDB stub
+
+	if ( (c1 == 'V' && c2 == 'L') || (c1 == 'L' && c2 == 'S') )  return  REQ_CACHE;
+	if ( (c1 == 'D' || c1 == 'X' || c1 == 'Z') && c2 == 'C' && yArg )  return  REQ_CACHE;
+
+	if ( (c1 == 'R' && c2 == 'M') || (c1 == 'R' && c2 == 'V') || (c1 == 'S' && c2 == 'N')
+	||   (c1 == 'V' && (c2 == 'N' || c2 == 'R' || c2 == 'B'))
+	||   (c1 == 'F' && (c2 == 'R' || c2 == 'I')) )  return  REQ_READ;
+	if ( (c1 == 'X' || c1 == 'Z') && (c2 == 'D' || c2 == 'E') && yArg )  return  REQ_READ;
+	if ( c1 == 'D' && (c2 == 'D' || c2 == 'E') && yArg )  return  REQ_READ;
+
+	return  REQ_OTHER;
+}
+
+
+/*
+|  Intel HEX end-of-file record (type 01), which ends an 'XL' load.
+*/
+static  int  is_ihex_eof( const char *pszKey )
+{
+	return  ( pszKey[0] == ':' && strlen( pszKey ) >= 9 && pszKey[7] == '0' && pszKey[8] == '1' );
+}
+
+
+/*
+|  Response timeout for a command, msec:  'WT' adds its own timeout and period.
+*/
+static  int  request_timeout( const char *pszKey )
+{
+	unsigned long  ulWait = 1000, ulPeriod = 0;
+	char   acMode[4];
+	int    n;
+
+	if ( pszKey[0] != 'W' || pszKey[1] != 'T' )  return  iTimeout;
+	n = sscanf( pszKey + 2, "%*x %*x %*x %3s %lx %lx", acMode, &ulWait, &ulPeriod );
+	if ( n < 2 )  ulWait = 1000;
+	if ( n < 3 )  ulPeriod = 0;
+
+	return  iTimeout + (int) ulWait + (int) ulPeriod;
+}
+
+
+/*****************************  DAEMON COMMANDS  ******************************/
+
+static  size_t  put_stat( char *pc, size_t nMax, const char *pszName, double dValue, int iPlaces )
+{
+	int  n = snprintf( pc, nMax, "%s %.*f\n", pszName, iPlaces, dValue );
+
+	return  ( n > 0 && (size_t) n < nMax ) ? (size_t) n : 0;
+}
+
+
+/*
+|  '%S':  link statistics.  Utilisation is the fraction of the link capacity
+|  (10 bits per char at the baud rate) used in each direction;  busy is the
+|  fraction of time with requests in flight.
+*/
+static  size_t  format_stats( char *pc, size_t nMax )
+{
+	double  dNow = now_sec();
+	double  dElapsed = dNow - sStats.dStart;
+	double  dCapacity = dElapsed * iBaud / 10.0;
+	double  dBusy = sStats.dBusy + ( psInFlight != NULL ? dNow - dBusyStart : 0.0 );
+	size_t  n = 0;
+
+	if ( dElapsed <= 0 )  dElapsed = 1e-9;
+	n += put_stat( pc + n, nMax - n, "elapsed_s", dElapsed, 3 );
+	n += put_stat( pc + n, nMax - n, "clients", nClients, 0 );
+	n += put_stat( pc + n, nMax - n, "connections", sStats.ulClients, 0 );
+	n += put_stat( pc + n, nMax - n, "requests", sStats.ulRequests, 0 );
+	n += put_stat( pc + n, nMax - n, "link_commands", sStats.ulLinkCmds, 0 );
+	n += put_stat( pc + n, nMax - n, "coalesced", sStats.ulCoalesced, 0 );
+	n += put_stat( pc + n, nMax - n, "cache_hits", sStats.ulCacheHits, 0 );
+	n += put_stat( pc + n, nMax - n, "local", sStats.ulLocal, 0 );
+	n += put_stat( pc + n, nMax - n, "errors", sStats.ulErrors, 0 );
+	n += put_stat( pc + n, nMax - n, "timeouts", sStats.ulTimeouts, 0 );
+	n += put_stat( pc + n, nMax - n, "tx_bytes", sStats.ulTxBytes, 0 );
+	n += put_stat( pc + n, nMax - n, "rx_bytes", sStats.ulRxBytes, 0 );
+	n += put_stat( pc + n, nMax - n, "tx_util_pct", 100.0 * sStats.ulTxBytes / dCapacity, 1 );
+	n += put_stat( pc + n, nMax - n, "rx_util_pct", 100.0 * sStats.ulRxBytes / dCapacity, 1 );
+	n += put_stat( pc + n, nMax - n, "busy_pct", 100.0 * dBusy / dElapsed, 1 );
+	n += put_stat( pc + n, nMax - n, "cmd_rate", sStats.ulLinkCmds / dElapsed, 1 );
+	n += put_stat( pc + n, nMax - n, "rtt_min_ms", sStats.dMinRtt * 1e3, 2 );
+	n += put_stat( pc + n, nMax - n, "rtt_mean_ms", sStats.ulLinkCmds ?
+	                                  sStats.dSumRtt * 1e3 / sStats.ulLinkCmds : 0.0, 2 );
+	n += put_stat( pc + n, nMax - n, "rtt_max_ms", sStats.dMaxRtt * 1e3, 2 );
+	n += put_stat( pc + n, nMax - n, "max_queue", sStats.iMaxQueue, 0 );
+	if ( n != 0 )  n-- ;                    // no newline after the last line
+
+	return  n;
+}
+
+
+/*
+|  Answer a REQ_LOCAL request.
+*/
+static  void  local_command( slot_t *psSlot, const char *pszKey )
+{
+	char    acText[1024];
+	size_t  n = 0;
+	char    cCode = '-';
+
+	if ( strcmp( pszKey, "%S" ) == 0 )  n = format_stats( acText, sizeof(acText) );
+	else if ( strcmp( pszKey, "%R" ) == 0 )  reset_stats();
+	else if ( strcmp( pszKey, "%C" ) == 0 )  cache_clear();
+	else if ( strcmp( pszKey, "IM" ) == 0 || strcmp( pszKey, "IM 0" ) == 0
+	     ||   strcmp( pszKey, "IM N" ) == 0 )  { }
+	else  cCode = '!';
+
+	sStats.ulLocal++ ;
+	slot_answer( psSlot, acText, n, cCode );
+}
+
+
+/*****************************  LINK  *****************************************/
+
+static  int  queue_length( void )
+{
+	request_t  *psReq;
+	int         n = 0;
+
+	for ( psReq = psPending;  psReq != NULL;  psReq = psReq->psNext )  n++ ;
+	for ( psReq = psInFlight;  psReq != NULL;  psReq = psReq->psNext )  n++ ;
+	return  n;
+}
+
+
+static  size_t  line_bytes( const request_t *psReq )
+{
+	return  strlen( psReq->acCmd ) + 1 + ( iNode != 0 ? AVRMON_NODE_PREFIX_LEN : 0 );
+}
+
+
+/*
+|  Queue a client request, or answer it at once (local, cached, or coalesced with
+|  an identical read still pending).
+*/
+static  void  submit( client_t *psClient, const char *pszCmd )
+{
+	slot_t     *psSlot = slot_new( psClient );
+	request_t  *psReq, *psMatch = NULL, **ppsLink;
+	slot_t    **ppsWaiter;
+	const cache_t  *psCache;
+	char        acKey[AVRMON_CMD_MAX + 1];
+	int         iClass;
+
+	if ( psSlot == NULL )  return;
+	sStats.ulRequests++ ;
+	normalise( pszCmd, acKey );
+	iClass = classify( acKey );
+
+	if ( iClass == REQ_LOCAL )
+	{
+		local_command( psSlot, acKey );
+		return;
+	}
+	if ( iClass == REQ_CACHE && (psCache = cache_find( acKey )) != NULL )
+	{
+		sStats.ulCacheHits++ ;
+		slot_answer( psSlot, psCache->pszText, psCache->nLength, '-' );
+		return;
+	}
+	if ( iClass != REQ_OTHER )
+	{
+		for ( psReq = psPending;  psReq != NULL;  psReq = psReq->psNext )
+		{
+			if ( psReq->iClass == REQ_OTHER )  psMatch = NULL;
+			else if ( strcmp( psReq->acKey, acKey ) == 0 )  psMatch = psReq;
+		}
+		if ( psMatch != NULL )
+		{
+			sStats.ulCoalesced++ ;
+			for ( ppsWaiter = &psMatch->psWaiters;  *ppsWaiter != NULL;
+			      ppsWaiter = &(*ppsWaiter)->psNextWaiter )  continue;
+			*ppsWaiter = psSlot;
+			return;
+		}
+	}
+
+	psReq = calloc( 1, sizeof(request_t) );
+	if ( psReq == NULL )
+	{
+		slot_answer( psSlot, "", 0, '!' );
+		return;
+	}
+	strcpy( psReq->acCmd, pszCmd );
+	strcpy( psReq->acKey, acKey );
+	psReq->iClass = iClass;
+	psReq->psOwner = psClient;
+	psReq->psWaiters = psSlot;
+	for ( ppsLink = &psPending;  *ppsLink != NULL;  ppsLink = &(*ppsLink)->psNext )  continue;
+	*ppsLink = psReq;
+}
+
+
+/*
+|  Answer every slot waiting on a request, deliver to the clients concerned,
+|  and free the request.
+*/
+static  void  request_answer( request_t *psReq, const char *pszText, size_t nLength, char cCode )
+{
+	slot_t     *psSlot, *psNextSlot;
+	client_t   *psClient;
+
+	for ( psSlot = psReq->psWaiters;  psSlot != NULL;  psSlot = psNextSlot )
+	{
+		psNextSlot = psSlot->psNextWaiter;
+		psClient = psSlot->psClient;
+		slot_answer( psSlot, pszText, nLength, cCode );
+		if ( psClient != NULL )  client_deliver( psClient );
+	}
+	free( psReq );
+}
+
+
+/*
+|  Re-synchronise the link after a timeout:  the monitor may have been busy,
+|  reset or disconnected.  A late response could be taken as that of "IM 0",
+|  so the link is only up again when 'VN' then gets a version response.
+|  Otherwise it is down:  requests are refused, and a re-sync is tried every
+|  RESYNC_INTERVAL sec.
+*/
+static  void  link_resync( void )
+{
+	avrmon_version_t  sVer;
+	int   i;
+
+	psLockOwner = NULL;
+	cache_clear();
+	for ( i = 0;  i < 3;  i++ )
+	{
+		if ( avrmon_sync( psMon ) == AVRMON_OK && avrmon_version( psMon, &sVer ) == AVRMON_OK )
+		{
+			if ( yLinkDown && yVerbose )  fprintf( stderr, "avrmond: link up\n" );
+			yLinkDown = 0;
+			return;
+		}
+	}
+	if ( !yLinkDown && yVerbose )  fprintf( stderr, "avrmond: link down\n" );
+	yLinkDown = 1;
+	dNextResync = now_sec() + RESYNC_INTERVAL;
+}
+
+
+/*
+|  Send pending requests while the unanswered commands fit in the pipeline
+|  depth.  During an 'XL' load only the loading client's requests are sent.
+*/
+static  int  link_send( void )
+{
+	request_t  **ppsLink = &psPending;
+	request_t   *psReq;
+	size_t       nLen;
+	int          n = queue_length();
+
+	if ( n > sStats.iMaxQueue )  sStats.iMaxQueue = n;
+	if ( yLinkDown && psPending != NULL && now_sec() >= dNextResync )  link_resync();
+	while ( yLinkDown && (psReq = psPending) != NULL )
+	{
+		psPending = psReq->psNext;
+		request_answer( psReq, "", 0, '!' );
+	}
+	while ( (psReq = *ppsLink) != NULL )
+	{
+		if ( psLockOwner != NULL && psReq->psOwner != psLockOwner )
+		{
+			ppsLink = &psReq->psNext;
+			continue;
+		}
+		nLen = line_bytes( psReq );
+		if ( psInFlight != NULL && nInFlightBytes + nLen > (size_t) iDepth )  break;
+		if ( avrmon_send( psMon, psReq->acCmd ) != AVRMON_OK )  return  AVRMON_ERR_IO;
+
+		*ppsLink = psReq->psNext;
+		psReq->psNext = NULL;
+		psReq->dSent = now_sec();
+		psReq->dDeadline = psReq->dSent + request_timeout( psReq->acKey ) / 1000.0;
+		if ( psInFlight == NULL )  dBusyStart = psReq->dSent;
+		if ( psInFlightTail != NULL )  psInFlightTail->psNext = psReq;
+		else  psInFlight = psReq;
+		psInFlightTail = psReq;
+		nInFlightBytes += nLen;
+		sStats.ulLinkCmds++ ;
+		sStats.ulTxBytes += (unsigned long) nLen;
+
+		if ( psReq->acKey[0] == 'X' && psReq->acKey[1] == 'L' )  psLockOwner = psReq->psOwner;
+		else if ( psLockOwner != NULL && is_ihex_eof( psReq->acKey ) )  psLockOwner = NULL;
+		if ( psReq->acKey[0] == 'R' && psReq->acKey[1] == 'S' && psReq->acKey[2] == '\0' )
+			cache_clear();
+	}
+	return  AVRMON_OK;
+}
+
+
+/*
+|  Complete the oldest request in flight with a response (or, if !yReceived,
+|  with '!' after a timeout), answering every slot waiting on it, and deliver
+|  to the clients concerned.
+*/
+static  void  link_complete( const char *pszText, size_t nLength, char cCode, int yReceived )
+{
+	request_t  *psReq = psInFlight;
+	double      dRtt = now_sec() - psReq->dSent;
+
+	psInFlight = psReq->psNext;
+	if ( psInFlight == NULL )
+	{
+		psInFlightTail = NULL;
+		sStats.dBusy += now_sec() - dBusyStart;
+	}
+	nInFlightBytes -= line_bytes( psReq );
+
+	if ( !yReceived )  sStats.ulTimeouts++ ;
+	else
+	{
+		if ( sStats.dMinRtt == 0 || dRtt < sStats.dMinRtt )  sStats.dMinRtt = dRtt;
+		if ( dRtt > sStats.dMaxRtt )  sStats.dMaxRtt = dRtt;
+		sStats.dSumRtt += dRtt;
+		sStats.ulRxBytes += (unsigned long) nLength + 3;
+		if ( cCode == '!' )  sStats.ulErrors++ ;
+	}
+	if ( cCode == '!' && psReq->psOwner == psLockOwner && psReq->acKey[0] == 'X' )
+		psLockOwner = NULL;                 // 'XL' refused
+	if ( cCode == '!' )  cache_clear();
+	else if ( cCode == '-' && psReq->iClass == REQ_CACHE )  cache_store( psReq->acKey, pszText, nLength );
+	else if ( cCode == '-' && strcmp( psReq->acKey, "VN" ) == 0 )  cache_check_version( pszText, nLength );
+
+	request_answer( psReq, pszText, nLength, cCode );
+}
+
+
+/*
+|  Read the responses received;  check the oldest request in flight for timeout.
+*/
+static  int  link_receive( void )
+{
+	avrmon_resp_t  sResp;
+	int   iResult;
+
+	while ( psInFlight != NULL )
+	{
+		iResult = avrmon_recv( psMon, &sResp, 0 );
+		if ( iResult == AVRMON_ERR_TIMEOUT )  break;
+		if ( iResult != AVRMON_OK )  return  iResult;
+		link_complete( sResp.pszText, sResp.nLength, sResp.cCode, 1 );
+		avrmon_resp_free( &sResp );
+	}
+	if ( psInFlight != NULL && now_sec() > psInFlight->dDeadline )
+	{
+		if ( yVerbose )  fprintf( stderr, "avrmond: \"%s\": response timeout\n", psInFlight->acCmd );
+		while ( psInFlight != NULL )  link_complete( "", 0, '!', 0 );
+		link_resync();
+	}
+	return  AVRMON_OK;
+}
+
+
+/*****************************  CLIENTS  **************************************/
+
+static  void  client_input( client_t *psClient, const char *pc, size_t n )
+{
+	char  c;
+
+	while ( n-- != 0 )
+	{
+		c = *pc++ ;
+		if ( c == ASCII_CR || c == ASCII_LF )
+		{
+			if ( psClient->yOverlong )  slot_answer( slot_new( psClient ), "", 0, '!' );
+			else if ( psClient->nLine != 0 )
+			{
+				psClient->acLine[psClient->nLine] = '\0';
+				submit( psClient, psClient->acLine );
+			}
+			psClient->nLine = 0;
+			psClient->yOverlong = 0;
+		}
+		else if ( c == ASCII_ESC || c == ASCII_CAN )
+		{
+			psClient->nLine = 0;
+			psClient->yOverlong = 0;
+		}
+		else if ( isprint( (unsigned char) c ) || (c == ASCII_ETX && psClient->nLine == 0) )
+		{
+			if ( psClient->nLine < AVRMON_CMD_MAX - (iNode != 0 ? AVRMON_NODE_PREFIX_LEN : 0) )
+				psClient->acLine[psClient->nLine++] = c;
+			else  psClient->yOverlong = 1;
+		}
+	}
+	client_deliver( psClient );
+}
+
+
+static  void  client_accept( int fdListen )
+{
+	client_t  *psClient;
+	int        fd = accept( fdListen, NULL, NULL );
+
+	if ( fd < 0 )  return;
+	if ( nClients >= MAX_CLIENTS || (psClient = calloc( 1, sizeof(client_t) )) == NULL )
+	{
+		close( fd );
+		return;
+	}
+	fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+	psClient->fd = fd;
+	apsClient[nClients++] = psClient;
+	sStats.ulClients++ ;
+	if ( yVerbose )  fprintf( stderr, "avrmond: client connected (%d)\n", nClients );
+}
+
+
+/*
+|  Drop a client.  Its requests on the link still complete;  their slots are
+|  then freed.
+*/
+static  void  client_close( int iIndex )
+{
+	client_t  *psClient = apsClient[iIndex];
+	request_t *psReq;
+	slot_t    *psSlot, *psNext;
+
+	for ( psSlot = psClient->psHead;  psSlot != NULL;  psSlot = psNext )
+	{
+		psNext = psSlot->psNext;
+		if ( psSlot->yDone )
+		{
+			free( psSlot->pszText );
+			free( psSlot );
+		}
+		else  psSlot->psClient = NULL;
+	}
+	if ( psLockOwner == psClient )  psLockOwner = NULL;
+	for ( psReq = psPending;  psReq != NULL;  psReq = psReq->psNext )
+		if ( psReq->psOwner == psClient )  psReq->psOwner = NULL;
+	for ( psReq = psInFlight;  psReq != NULL;  psReq = psReq->psNext )
+		if ( psReq->psOwner == psClient )  psReq->psOwner = NULL;
+
+	close( psClient->fd );
+	free( psClient->pcOut );
+	free( psClient );
+	apsClient[iIndex] = apsClient[--nClients];
+	if ( yVerbose )  fprintf( stderr, "avrmond: client disconnected (%d)\n", nClients );
+}
+
+
+static  int  listen_socket( const char *pszPath )
+{
+	struct sockaddr_un  sAddr;
+	int    fd;
+
+	if ( strlen( pszPath ) >= sizeof(sAddr.sun_path) )  return  -1;
+	memset( &sAddr, 0, sizeof(sAddr) );
+	sAddr.sun_family = AF_UNIX;
+	strcpy( sAddr.sun_path, pszPath );
+
+	fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( fd < 0 )  return  -1;
+	unlink( pszPath );
+	if ( bind( fd, (struct sockaddr *) &sAddr, sizeof(sAddr) ) < 0 || listen( fd, 16 ) < 0 )
+	{
+		close( fd );
+		return  -1;
+	}
+	return  fd;
+}
+
+
+static  void  usage( void )
+{
+	fprintf( stderr, "usage: avrmond [-d device] [-b baud] [-n node] [-p depth] [-t msec]"
+	                 " [-s socket] [-v]\n" );
+}
+
+
+int  main( int argc, char **argv )
+{
+	struct pollfd  asPoll[MAX_CLIENTS + 2];
+	const char *pszDevice = getenv( "AVRMON_DEV" );
+	const char *pszSocket = getenv( "AVRMOND_SOCKET" );
+	char        acBuf[4096];
+	ssize_t     nRead;
+	int         fdListen, iOpt, iWait, nPoll, i;
+	int         iResult = AVRMON_OK;
+
+	if ( pszDevice == NULL )  pszDevice = "/dev/ttyACM0";
+	if ( pszSocket == NULL )  pszSocket = DEFAULT_SOCKET;
+	while ( (iOpt = getopt( argc, argv, "d:b:n:p:t:s:v" )) != -1 )
+	{
+		switch ( iOpt )
+		{
+		case 'd':  pszDevice = optarg;  break;
+		case 'b':  iBaud = atoi( optarg );  break;
+		case 'n':  iNode = (int) strtol( optarg, NULL, 16 ) & 0xFF;  break;
+		case 'p':  iDepth = atoi( optarg );  break;
+		case 't':  iTimeout = atoi( optarg );  break;
+		case 's':  pszSocket = optarg;  break;
+		case 'v':  yVerbose = 1;  break;
+		default:   usage();  return  2;
+		}
+	}
+	if ( iDepth <= 0 )  iDepth = ( iNode != 0 ) ? 1 : AVRMON_DEFAULT_DEPTH;
+
+	psMon = avrmon_open_node( pszDevice, iBaud, iNode );
+	if ( psMon == NULL )
+	{
+		fprintf( stderr, "avrmond: cannot connect to monitor on %s\n", pszDevice );
+		return  2;
+	}
+	fdListen = listen_socket( pszSocket );
+	if ( fdListen < 0 )
+	{
+		perror( pszSocket );
+		avrmon_close( psMon );
+		return  2;
+	}
+	signal( SIGPIPE, SIG_IGN );
+	signal( SIGINT, on_signal );
+	signal( SIGTERM, on_signal );
+	reset_stats();
+
+	while ( !yQuit && iResult == AVRMON_OK )
+	{
+		asPoll[0].fd = avrmon_fd( psMon );
+		asPoll[0].events = POLLIN;
+		asPoll[1].fd = fdListen;
+		asPoll[1].events = ( nClients < MAX_CLIENTS ) ? POLLIN : 0;
+		for ( i = 0;  i < nClients;  i++ )
+		{
+			asPoll[i + 2].fd = apsClient[i]->fd;
+			asPoll[i + 2].events = POLLIN | ( apsClient[i]->nOut != 0 ? POLLOUT : 0 );
+		}
+		nPoll = nClients + 2;
+		iWait = -1;
+		if ( psInFlight != NULL )
+		{
+			iWait = (int) ((psInFlight->dDeadline - now_sec()) * 1000.0) + 1;
+			if ( iWait < 0 )  iWait = 0;
+		}
+		if ( poll( asPoll, (nfds_t) nPoll, iWait ) < 0 && errno != EINTR )  break;
+
+		iResult = link_receive();
+		for ( i = nPoll - 3;  i >= 0;  i-- )        // backwards:  client_close() moves the last
+		{
+			if ( asPoll[i + 2].revents & POLLOUT )  client_flush( apsClient[i] );
+			if ( !(asPoll[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) )  continue;
+			nRead = read( apsClient[i]->fd, acBuf, sizeof(acBuf) );
+			if ( nRead > 0 )  client_input( apsClient[i], acBuf, (size_t) nRead );
+			else if ( nRead == 0 || (errno != EAGAIN && errno != EINTR) )  client_close( i );
+		}
+		if ( asPoll[1].revents & POLLIN )  client_accept( fdListen );
+		if ( iResult == AVRMON_OK )  iResult = link_send();
+	}
+	if ( iResult != AVRMON_OK )  fprintf( stderr, "avrmond: link: %s\n", avrmon_strerror( iResult ) );
+
+	for ( i = nClients - 1;  i >= 0;  i-- )  client_close( i );
+	close( fdListen );
+	unlink( pszSocket );
+	avrmon_close( psMon );
+
+	return  ( iResult == AVRMON_OK ) ? 0 : 1;
+}
+
+// end
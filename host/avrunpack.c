@@ -0,0 +1,67 @@
+/*____________________________________________________________________________*\
+|
+|  File:        avrunpack.c
+|  Compiler:    GCC (Linux host)
+|
+|  Command-line unpacker for captured 'Zs' (packed dump) responses.
+|
+|  Usage:   avrunpack [-s] < response.txt > image.bin
+|
+|  The response text (hex lines and the '#' statistics line) is read from stdin;
+|  the unpacked binary image is written to stdout.  Option -s reports the packed
+|  and raw sizes and the compression ratio on stderr.
+|
+|  Build:   gcc -O2 -o avrunpack avrunpack.c unpack.c
+\*____________________________________________________________________________*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unpack.h"
+
+#define  MAX_IMAGE_SIZE    65536
+
+
+int  main( int argc, char **argv )
+{
+	static uint8_t abImage[MAX_IMAGE_SIZE];
+	char   *pszText = NULL;
+	size_t  nText = 0, nAlloc = 0, nRead;
+	long    lRaw;
+	int     yStats = ( argc > 1 && strcmp( argv[1], "-s" ) == 0 );
+
+	do
+	{
+		if ( nText + 4096 + 1 > nAlloc )
+		{
+			nAlloc = nAlloc * 2 + 4096 + 1;
+			pszText = realloc( pszText, nAlloc );
+			if ( pszText == NULL )  { perror( "avrunpack" );  return 2; }
+		}
+		nRead = fread( pszText + nText, 1, 4096, stdin );
+		nText += nRead;
+	}
+	while ( nRead != 0 );
+	pszText[nText] = '\0';
+
+	lRaw = unpack_response( pszText, abImage, sizeof(abImage) );
+	if ( lRaw < 0 )
+	{
+		fprintf( stderr, "avrunpack: corrupt or incomplete packed dump\n" );
+		return 1;
+	}
+	fwrite( abImage, 1, (size_t) lRaw, stdout );
+
+	if ( yStats )
+	{
+		const char *pszStats = strchr( pszText, '#' );
+		unsigned    uRaw = 0, uPacked = 0;
+
+		sscanf( pszStats + 1, "%x %x", &uRaw, &uPacked );
+		fprintf( stderr, "raw %u bytes, packed %u bytes (%.1f%%), link chars %u vs %u for 'Dx'\n",
+			uRaw, uPacked, uRaw ? 100.0 * uPacked / uRaw : 0.0,
+			(unsigned) nText, (uRaw / 16) * 75 );
+	}
+	free( pszText );
+	return 0;
+}
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+#
+#   mkstrtab.py  --  Build the AVR monitor's compressed message string table
+#
+#   Usage:   mkstrtab.py [srcdir]
+#
+#       srcdir       firmware source directory (default avrmon/src)
+#
+#   Reads the message strings in strtab.txt and the help text of the command table
+#   in cmdtab.h, and writes strtab.c and strtab.h, which are kept in the source tree
+#   so the firmware builds without this script.  Files are rewritten only if their
+#   content changes, so it can run as a pre-build step.
+#
+#   Compression is byte-pair encoding:  the strings are 7-bit ASCII, so bytes 80..FF
+#   are free to be tokens, each standing for a pair of bytes (chars or tokens) held
+#   in a dictionary in flash.  The most frequent pair in all the strings is replaced
+#   by a new token, and so on until the tokens run out or no pair occurs 3 times
+#   (a dictionary entry costs 2 bytes).  putmsg() in cmnd.c expands the tokens on
+#   the fly with a small stack, so token nesting is limited to STRTAB_MAX_DEPTH.
+#
+
+import os
+import re
+import sys
+from collections import Counter
+
+
+MAX_DEPTH = 8               # Token nesting limit (putmsg() stack size)
+FIRST_TOKEN = 0x80
+MAX_TOKENS = 128
+
+
+def usage():
+    sys.stderr.write( "usage: mkstrtab.py [srcdir]\n" )
+    sys.exit( 2 )
+
+
+def c_unescape( text, where ):
+    """Decode C string escapes;  only 7-bit chars (excluding NUL) are allowed."""
+    try:
+        s = text.encode( "latin-1" ).decode( "unicode_escape" )
+    except UnicodeDecodeError as e:
+        sys.exit( "%s: bad escape (%s)" % (where, e) )
+    for c in s:
+        if not 0 < ord( c ) < FIRST_TOKEN:
+            sys.exit( "%s: char %02X not allowed" % (where, ord( c )) )
+    return s
+
+
+def read_messages( path ):
+    """Parse strtab.txt;  return a list of (id, text)."""
+    msgs = []
+    for n, line in enumerate( open( path ), 1 ):
+        line = line.strip()
+        if not line or line.startswith( "#" ):
+            continue
+        m = re.match( r'^([A-Z][A-Z0-9_]*)\s+"(.*)"$', line )
+        if not m:
+            sys.exit( "%s:%d: syntax error" % (path, n) )
+        msgs.append( (m.group( 1 ), c_unescape( m.group( 2 ), "%s:%d" % (path, n) )) )
+    return msgs
+
+
+def read_help( path ):
+    """Parse the CMD() entries in cmdtab.h;  return a list of (id, text)."""
+    helps = []
+    pat = re.compile( r"^\s*CMD\(\s*'(.)'\s*,\s*'(.)'\s*,\s*\w+\s*,\s*\"(.*)\"\s*\)" )
+    for n, line in enumerate( open( path ), 1 ):
+        m = pat.match( line )
+        if not m or not m.group( 3 ):
+            continue
+        name = m.group( 1 ) + m.group( 2 )
+        if not name.isalnum():
+            sys.exit( "%s:%d: command name '%s' can't be an identifier" % (path, n, name) )
+        helps.append( ("HELP_" + name, c_unescape( m.group( 3 ), "%s:%d" % (path, n) ) + "\n") )
+    return helps
+
+
+def compress( strings ):
+    """Byte-pair encode the strings;  return (encoded lists, dictionary, max depth)."""
+    seqs = [[ord( c ) for c in s] for s in strings]
+    pairs = []
+    depth = {}
+    while len( pairs ) < MAX_TOKENS:
+        counts = Counter()
+        for seq in seqs:
+            i = 0
+            while i < len( seq ) - 1:
+                pair = (seq[i], seq[i + 1])
+                counts[pair] += 1
+                if seq[i] == seq[i + 1] and i + 2 < len( seq ) and seq[i + 2] == seq[i]:
+                    i += 2          # don't count overlapping pairs, e.g. "aaa"
+                else:
+                    i += 1
+        best = None
+        for pair, count in counts.most_common():
+            if count < 3:
+                break
+            d = 1 + max( depth.get( pair[0], 0 ), depth.get( pair[1], 0 ) )
+            if d <= MAX_DEPTH:
+                best = pair
+                break
+        if best is None:
+            break
+        token = FIRST_TOKEN + len( pairs )
+        depth[token] = 1 + max( depth.get( best[0], 0 ), depth.get( best[1], 0 ) )
+        pairs.append( best )
+        for k, seq in enumerate( seqs ):
+            out = []
+            i = 0
+            while i < len( seq ):
+                if i < len( seq ) - 1 and (seq[i], seq[i + 1]) == best:
+                    out.append( token )
+                    i += 2
+                else:
+                    out.append( seq[i] )
+                    i += 1
+            seqs[k] = out
+    return seqs, pairs, max( depth.values(), default=1 )
+
+
+def expand( sym, pairs ):
+    if sym < FIRST_TOKEN:
+        return chr( sym )
+    a, b = pairs[sym - FIRST_TOKEN]
+    return expand( a, pairs ) + expand( b, pairs )
+
+
+def c_comment( s ):
+    return s.replace( "\n", "\\n" ).replace( "\033", "\\033" ).replace( "*/", "*\\/" )
+
+
+def write_if_changed( path, text ):
+    try:
+        if open( path ).read() == text:
+            return
+    except OSError:
+        pass
+    open( path, "w" ).write( text )
+    print( "wrote " + path )
+
+
+def hex_rows( values, fmt, per_row, indent="\t" ):
+    rows = []
+    for i in range( 0, len( values ), per_row ):
+        rows.append( indent + ", ".join( fmt % v for v in values[i:i + per_row] ) )
+    return ",\n".join( rows )
+
+
+def main():
+    args = sys.argv[1:]
+    if len( args ) > 1 or (args and args[0].startswith( "-" )):
+        usage()
+    srcdir = args[0] if args else os.path.join( "avrmon", "src" )
+
+    msgs = read_messages( os.path.join( srcdir, "strtab.txt" ) )
+    helps = read_help( os.path.join( srcdir, "cmdtab.h" ) )
+    if not helps:
+        sys.exit( "no help text found in cmdtab.h" )
+    table = msgs + helps
+    ids = [t[0] for t in table]
+    dups = set( i for i in ids if ids.count( i ) > 1 )
+    if dups:
+        sys.exit( "duplicate string id(s): " + ", ".join( sorted( dups ) ) )
+    if len( table ) > 255:
+        sys.exit( "too many strings (max 255)" )
+
+    seqs, pairs, max_depth = compress( [t[1] for t in table] )
+    for seq, (ident, text) in zip( seqs, table ):
+        assert "".join( expand( s, pairs ) for s in seq ) == text, ident
+
+    data = []
+    index = []
+    for seq in seqs:
+        index.append( len( data ) )
+        data.extend( seq + [0] )
+    raw_size = sum( len( t[1] ) + 1 for t in table )
+    packed_size = len( data ) + 2 * len( pairs ) + 2 * len( index )
+    help_max = max( len( t[1] ) + t[1].count( "\n" ) for t in helps )
+
+    banner = ( "/*\n"
+               "*   %s  --  Compressed message string table\n"
+               "*\n"
+               "*   GENERATED by host/mkstrtab.py from strtab.txt and cmdtab.h -- do not edit.\n"
+               "*\n"
+               "*   %d strings, %d bytes;  packed to %d bytes (data %d, dictionary %d, index %d).\n"
+               "*/\n" )
+    sizes = (len( table ), raw_size, packed_size, len( data ), 2 * len( pairs ), 2 * len( index ))
+
+    h = banner % (("strtab.h",) + sizes)
+    h += "#ifndef  _STRTAB_H_\n#define  _STRTAB_H_\n\n#include \"system.h\"\n\n"
+    h += "#define  STRTAB_TOKEN         0x%02X     // Data bytes >= this are dictionary tokens\n" % FIRST_TOKEN
+    h += "#define  STRTAB_MAX_DEPTH     %4d     // Token nesting limit\n" % max_depth
+    h += "#define  STRTAB_HELP_MAX_LEN  %4d     // Longest help line output (CR LF incl.)\n" % help_max
+    h += "\n// String IDs -- argument of putmsg()\nenum  StrTableID_t\n{\n"
+    for i, (ident, text) in enumerate( table ):
+        h += "\t%-20s // \"%s\"\n" % ("STR_%s," % ident if i else "STR_%s = 0," % ident, c_comment( text ))
+    h += "\tSTR_COUNT\n};\n\n"
+    h += "#define  STR_HELP_FIRST   STR_%s\n" % helps[0][0]
+    h += "#define  STR_HELP_LAST    STR_%s\n\n" % helps[-1][0]
+    h += "extern  const  uint8   aubStrDict[][2] PROGMEM;\n"
+    h += "extern  const  uint16  auwStrIndex[] PROGMEM;\n"
+    h += "extern  const  uint8   aubStrData[] PROGMEM;    // see putmsg() in cmnd.c\n\n"
+    h += "#endif  /* _STRTAB_H_ */\n"
+
+    c = banner % (("strtab.c",) + sizes)
+    c += "#include \"system.h\"\n#include \"strtab.h\"\n\n"
+    c += "// Token 0x%02X + n expands to the pair aubStrDict[n]\n" % FIRST_TOKEN
+    c += "const  uint8  aubStrDict[][2] PROGMEM =\n{\n"
+    for n, (a, b) in enumerate( pairs ):
+        sep = "," if n < len( pairs ) - 1 else " "
+        c += "\t{ 0x%02X, 0x%02X }%s   // %02X \"%s\"\n" % (a, b, sep, FIRST_TOKEN + n,
+                                                      c_comment( expand( FIRST_TOKEN + n, pairs ) ))
+    c += "};\n\n"
+    c += "// Offset of each string in aubStrData[], by ID\n"
+    c += "const  uint16  auwStrIndex[STR_COUNT] PROGMEM =\n{\n"
+    c += hex_rows( index, "%4d", 12 ) + "\n};\n\n"
+    c += "// Encoded strings, NUL terminated\n"
+    c += "const  uint8  aubStrData[] PROGMEM =\n{\n"
+    c += hex_rows( data, "0x%02X", 12 ) + "\n};\n\n// end\n"
+
+    write_if_changed( os.path.join( srcdir, "strtab.h" ), h )
+    write_if_changed( os.path.join( srcdir, "strtab.c" ), c )
+    print( "%d strings, %d bytes packed to %d" % (len( table ), raw_size, packed_size) )
+
+
+if __name__ == "__main__":
+    main()
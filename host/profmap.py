@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+#
+#   profmap.py  --  Map an AVR monitor profile histogram ('PF D') to functions
+#
+#   Usage:   profmap.py [-n nm] [-b] [-t top] firmware.elf [dumpfile]
+#
+#       -n nm        nm program (default avr-nm, or $AVR_NM)
+#       -b           also list the buckets, with the functions each one covers
+#       -t top       list only the top N functions (default all)
+#       dumpfile     captured 'PF D' response (default stdin), e.g.
+#                        avrmon-cli cmd "PF D" | profmap.py avrmon.elf
+#
+#   The bucket counts are shared among the functions (text symbols) overlapping
+#   each bucket, in proportion to the overlap, so a small bucket size (PF S aaaa s)
+#   gives the most accurate attribution.  Addresses are flash byte addresses, as
+#   shown by avr-nm and avr-objdump.
+#
+
+import os
+import subprocess
+import sys
+from collections import defaultdict
+
+
+def usage():
+    sys.stderr.write( "usage: profmap.py [-n nm] [-b] [-t top] firmware.elf [dumpfile]\n" )
+    sys.exit( 2 )
+
+
+def read_symbols( nm, elf ):
+    """Return the function symbols as a sorted list of (start, end, name)."""
+    text = subprocess.run( [nm, "-n", "-S", "--defined-only", elf],
+                           check=True, capture_output=True, text=True ).stdout
+    syms = []
+    for line in text.splitlines():
+        fields = line.split()
+        if len( fields ) == 4:
+            addr, size, kind, name = int( fields[0], 16 ), int( fields[1], 16 ), fields[2], fields[3]
+        elif len( fields ) == 3:
+            addr, size, kind, name = int( fields[0], 16 ), None, fields[1], fields[2]
+        else:
+            continue
+        if kind not in "TtWw" or addr >= 0x800000:      # text only, not data space
+            continue
+        syms.append( [addr, size, name] )
+
+    functions = []
+    for i, (addr, size, name) in enumerate( syms ):
+        if not size:        # no size (e.g. asm labels) -- assume up to next symbol
+            size = ( syms[i + 1][0] - addr ) if i + 1 < len( syms ) else 2
+        if size > 0:
+            functions.append( (addr, addr + size, name) )
+    return functions
+
+
+def read_histogram( lines ):
+    """Parse 'PF D' output; return (header dict, list of (addr, bucket size, count))."""
+    header = None
+    buckets = []
+    for line in lines:
+        line = line.strip()
+        if line.startswith( "#" ):
+            f = line[1:].split()
+            header = dict( base=int( f[0], 16 ), shift=int( f[1], 16 ), nbuckets=int( f[2], 16 ),
+                           samples=int( f[3], 16 ), outside=int( f[4], 16 ) )
+        elif header is not None and line and line[0] in "0123456789ABCDEFabcdef":
+            f = line.split()
+            addr = int( f[0], 16 )
+            size = 1 << header["shift"]
+            for i, count in enumerate( f[1:] ):
+                if int( count, 16 ) != 0:
+                    buckets.append( (addr + i * size, size, int( count, 16 )) )
+    if header is None:
+        sys.stderr.write( "profmap: no 'PF D' header line found\n" )
+        sys.exit( 1 )
+    return header, buckets
+
+
+def overlaps( functions, start, end ):
+    """Yield (name, bytes) for each function overlapping [start, end)."""
+    for fstart, fend, name in functions:
+        if fstart >= end:
+            break
+        n = min( end, fend ) - max( start, fstart )
+        if n > 0:
+            yield name, n
+
+
+def main( argv ):
+    nm = os.environ.get( "AVR_NM", "avr-nm" )
+    list_buckets = False
+    top = None
+    args = []
+    i = 0
+    while i < len( argv ):
+        if argv[i] == "-n" and i + 1 < len( argv ):
+            nm = argv[i + 1];  i += 1
+        elif argv[i] == "-t" and i + 1 < len( argv ):
+            top = int( argv[i + 1] );  i += 1
+        elif argv[i] == "-b":
+            list_buckets = True
+        elif argv[i].startswith( "-" ):
+            usage()
+        else:
+            args.append( argv[i] )
+        i += 1
+    if len( args ) not in (1, 2):
+        usage()
+
+    functions = read_symbols( nm, args[0] )
+    if len( args ) == 2:
+        with open( args[1] ) as f:
+            header, buckets = read_histogram( f )
+    else:
+        header, buckets = read_histogram( sys.stdin )
+
+    total = header["samples"] or 1
+    per_function = defaultdict( float )
+
+    if list_buckets:
+        print( "address  samples  functions" )
+    for addr, size, count in buckets:
+        shared = list( overlaps( functions, addr, addr + size ) )
+        covered = sum( n for _, n in shared )
+        for name, n in shared:
+            per_function[name] += count * n / covered
+        if not shared:
+            per_function["(unknown)"] += count
+        if list_buckets:
+            print( "%06X  %7d  %s" % (addr, count, " ".join( name for name, _ in shared ) or "(unknown)") )
+    if list_buckets:
+        print()
+
+    print( "Samples: %d, outside range %06X..%06X: %d (%.1f%%)" % (
+           header["samples"], header["base"],
+           header["base"] + (header["nbuckets"] << header["shift"]) - 1,
+           header["outside"], 100.0 * header["outside"] / total) )
+    print()
+    print( " samples      %  function" )
+    ranked = sorted( per_function.items(), key=lambda item: -item[1] )
+    for name, count in ranked[:top]:
+        print( "%8.0f  %5.1f  %s" % (count, 100.0 * count / total, name) )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit( main( sys.argv[1:] ) )
@@ -0,0 +1,375 @@
+#!/usr/bin/env python3
+#
+#   test_host.py  --  Host tools test, against the monitor simulator
+#
+#   Usage:   test_host.py [-v]        (run by 'make check', after building the tools)
+#
+#   Starts avrmon-sim on a pty and drives it with avrmon-cli, directly and through
+#   avrmond, and with raw link I/O for the modes which take over the link ('LV',
+#   'GD').  Responses are checked against the simulated memory and the formats of
+#   the firmware commands.  Exit status 0 if all tests pass.
+#
+
+import os
+import re
+import select
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+import unittest
+
+HOST_DIR = os.path.dirname( os.path.abspath( __file__ ) )
+
+
+def tool( name ):
+    return os.path.join( HOST_DIR, name )
+
+
+class Sim:
+    """avrmon-sim running on a pty, with a symlink to it in a temporary folder."""
+
+    def __init__( self, *args ):
+        self.dir = tempfile.mkdtemp( prefix="avrmon-test-" )
+        self.link = os.path.join( self.dir, "avrmon" )
+        self.procs = []
+        self.proc = self.spawn( [tool( "avrmon-sim" ), "-b", "115200", "-l", self.link] + list( args ) )
+        self.proc.stdout.readline()         # pty name:  the link is made before it
+
+    def spawn( self, argv ):
+        proc = subprocess.Popen( argv, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL )
+        self.procs.append( proc )
+        return proc
+
+    def daemon( self ):
+        """Start avrmond on the link;  return its socket path."""
+        sock = os.path.join( self.dir, "avrmond.sock" )
+        self.spawn( [tool( "avrmond" ), "-d", self.link, "-b", "115200", "-s", sock] )
+        for _ in range( 100 ):
+            if os.path.exists( sock ):
+                return sock
+            time.sleep( 0.02 )
+        raise RuntimeError( "avrmond did not start" )
+
+    def close( self ):
+        for proc in reversed( self.procs ):
+            proc.terminate()
+            proc.wait()
+            proc.stdout.close()
+        shutil.rmtree( self.dir, ignore_errors=True )
+
+
+def cli( dev, *args, stdin=None ):
+    """Run avrmon-cli;  return (exit status, stdout text)."""
+    res = subprocess.run( [tool( "avrmon-cli" ), "-d", dev] + list( args ), input=stdin,
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=20 )
+    return res.returncode, res.stdout.decode( "latin-1" )
+
+
+def cmd( dev, *cmds ):
+    """Raw commands;  return the response text, which must have no errors."""
+    status, out = cli( dev, "cmd", *cmds )
+    if status != 0:
+        raise AssertionError( "commands %r: exit status %d" % (cmds, status) )
+    return out
+
+
+def read_data( dev, addr, count ):
+    """Read data space bytes with 'DD' (via the library parser)."""
+    status, out = cli( dev, "dd", "%04X" % (addr & ~15) )
+    assert status == 0
+    image = {}
+    for line in out.splitlines():
+        a, _, data = line.partition( ":" )
+        for i, h in enumerate( data.split() ):
+            image[int( a, 16 ) + i] = int( h, 16 )
+    return bytes( image[addr + i] for i in range( count ) )
+
+
+def ihex_parse( text ):
+    """Parse Intel HEX records;  return {address: byte}, checking the checksums."""
+    image = {}
+    eof = False
+    for line in text.split():
+        rec = bytes.fromhex( line[1:] )
+        assert line[0] == ":" and sum( rec ) & 0xFF == 0 and len( rec ) == rec[0] + 5, line
+        if rec[3] == 0x01:
+            eof = True
+        for i in range( rec[0] ):
+            image[(rec[1] << 8 | rec[2]) + i] = rec[4 + i]
+    assert eof, "no end-of-file record"
+    return image
+
+
+def ihex_record( addr, data, rtype=0 ):
+    rec = bytes( [len( data ), addr >> 8, addr & 0xFF, rtype] ) + bytes( data )
+    return ":" + (rec + bytes( [-sum( rec ) & 0xFF] )).hex().upper()
+
+
+class Link:
+    """Raw I/O on the simulator's pty, in machine mode."""
+
+    def __init__( self, path ):
+        import termios
+        import tty
+        self.fd = os.open( path, os.O_RDWR | os.O_NOCTTY )
+        tty.setraw( self.fd )
+        termios.tcflush( self.fd, termios.TCIOFLUSH )
+        self.buf = b""
+        self.send( b"\x1bIM 0\r" )
+        self.expect( b"\r\n-" )
+        while self.buf != b"" or select.select( [self.fd], [], [], 0.1 )[0]:
+            self.buf = b""                  # Esc may be answered too:  drain it
+            self.read( 0.1 )
+
+    def send( self, data ):
+        os.write( self.fd, data )
+
+    def read( self, timeout ):
+        ready, _, _ = select.select( [self.fd], [], [], timeout )
+        if ready:
+            self.buf += os.read( self.fd, 4096 )
+
+    def expect( self, pattern, timeout=2.0 ):
+        """Wait for pattern (bytes);  return the data before it, consuming both."""
+        end = time.monotonic() + timeout
+        while pattern not in self.buf:
+            if time.monotonic() > end:
+                raise AssertionError( "expected %r, got %r" % (pattern, self.buf) )
+            self.read( 0.05 )
+        head, _, self.buf = self.buf.partition( pattern )
+        return head
+
+    def close( self ):
+        os.close( self.fd )
+
+
+def gdb_packet( data ):
+    return b"$" + data + b"#" + b"%02x" % (sum( data ) & 0xFF)
+
+
+class SimTest( unittest.TestCase ):
+
+    @classmethod
+    def setUpClass( cls ):
+        cls.sim = Sim()
+        cls.dev = cls.sim.link
+
+    @classmethod
+    def tearDownClass( cls ):
+        cls.sim.close()
+
+    def test_version( self ):
+        status, out = cli( self.dev, "vn" )
+        self.assertEqual( status, 0 )
+        self.assertRegex( out, r"^\d+\.\d+\.\d+\n$" )
+
+    def test_read_write( self ):
+        self.assertEqual( cli( self.dev, "wm", "120", "5A" )[0], 0 )
+        self.assertEqual( cli( self.dev, "rm", "120" ), (0, "120 5A\n") )
+        self.assertEqual( cli( self.dev, "cmd", "XX" )[0], 1 )
+
+    def test_packed_dump( self ):
+        cmd( self.dev, *("WM %03X %02X" % (0x200 + i, (i * 7) & 0xFF) for i in range( 24 )) )
+        for space, addr, count in (("D", 0x1F0, 0x80), ("C", 0x0000, 0x1000), ("E", 0, 0x100)):
+            packed = cmd( self.dev, "Z%s %04X %X" % (space, addr, count) )
+            res = subprocess.run( [tool( "avrunpack" )], input=packed.encode(), stdout=subprocess.PIPE )
+            self.assertEqual( res.returncode, 0 )
+            image = ihex_parse( cmd( self.dev, "X%s %04X %X" % (space, addr, count) ) )
+            self.assertEqual( res.stdout, bytes( image[addr + i] for i in range( count ) ) )
+            self.assertRegex( packed.splitlines()[-1], r"^#%04X [0-9A-F]{5} \d{3}%%$" % count )
+
+    def test_ihex_load( self ):
+        data = list( range( 0x30, 0x40 ) )
+        out = cmd( self.dev, "XL D", ihex_record( 0x180, data ), ihex_record( 0, [], 1 ) )
+        self.assertEqual( out.split(), ["00002", "00000"] )
+        self.assertEqual( read_data( self.dev, 0x180, 16 ), bytes( data ) )
+
+        bad = ihex_record( 0x190, [1, 2, 3] )[:-2] + "00"
+        status, out = cli( self.dev, "batch", stdin=("XL D\n%s\n%s\n" % (bad, ihex_record( 0, [], 1 ))).encode() )
+        self.assertEqual( status, 1 )
+        self.assertEqual( out.split()[-2:], ["00002", "00001"] )
+
+        cmd( self.dev, "XL E", ihex_record( 0x85, [0xA5, 0x5A] ), ihex_record( 0, [], 1 ) )
+        self.assertIn( "0080: FF FF FF FF FF A5 5A FF", cli( self.dev, "de", "1" )[1] )
+        cmd( self.dev, "EE 1" )
+        self.assertNotIn( "A5", cli( self.dev, "de", "1" )[1] )
+
+    def test_diagnostics( self ):
+        self.assertEqual( cmd( self.dev, "CM" ).strip(), "00" )
+        lines = cmd( self.dev, "WS" ).strip().split( "\r\n" )
+        self.assertRegex( lines[0], r"^[0-9A-F]{2}$" )
+        self.assertRegex( lines[1], r"^\d{5} \d{5}$" )
+        for line in lines[2:]:
+            self.assertRegex( line, r"^[0-9A-F]( \d{5}){3}$" )
+        lines = cmd( self.dev, "IS" ).strip().split( "\r\n" )
+        self.assertEqual( [line[0] for line in lines], ["0", "1", "2"] )
+        for line in lines:
+            self.assertRegex( line, r"^[0-9A-F] \d{5}( [0-9A-F]{4}){4}( \d{5}){8}$" )
+        for line in cmd( self.dev, "TL" ).strip().split( "\r\n" ):
+            self.assertRegex( line, r"^[0-9A-F] [RDB-] [0-9A-F]{2} [0-9A-F]{4} [0-9A-F]{4} \d{3}% \w+$" )
+
+    def test_profiler( self ):
+        cmd( self.dev, "PF S 0 8" )
+        time.sleep( 0.1 )
+        lines = cmd( self.dev, "PF D" ).strip().split( "\r\n" )
+        m = re.match( r"^#0000 8 ([0-9A-F]{2}) ([0-9A-F]{8}) ([0-9A-F]{8})$", lines[0] )
+        self.assertIsNotNone( m, lines[0] )
+        samples = int( m.group( 2 ), 16 )
+        self.assertGreaterEqual( samples, 100 )
+        total = int( m.group( 3 ), 16 )
+        for line in lines[1:]:
+            f = line.split()
+            self.assertEqual( len( f ), 9 )
+            total += sum( int( h, 16 ) for h in f[1:] )
+        self.assertLessEqual( total, samples )
+        cmd( self.dev, "PF X" )
+        self.assertTrue( cmd( self.dev, "PF" ).strip().endswith( " 0" ) )
+
+    def test_trace_status( self ):
+        out = cmd( self.dev, "FT S 2", "RM 100", "RM 101", "FT", "FT F", "FT" ).split()
+        self.assertEqual( out[2:5], ["1", "0C", "2"] )     # 2 records per call, depth 2
+        self.assertEqual( out[5:], ["0", "10", "2"] )
+
+    def test_trace_dump( self ):
+        """A dump with exit records gets through the library and tracetree.py."""
+        import tracetree
+        out = cmd( self.dev, "FT S", "RM 100", "DD 100", "FT D" )
+        header = [line for line in out.split( "\r\n" ) if line.startswith( "#" )]
+        self.assertEqual( len( header ), 1 )
+        records = tracetree.read_trace( out.splitlines() )
+        self.assertEqual( len( records ), int( header[0][1:3], 16 ) )
+        self.assertEqual( [r[0] for r in records].count( False ), 6 )  # 'FT S', 'RM', 'DD' exits
+        exec_node = tracetree.build_tree( records, lambda addr: "%04X" % addr ).children["0A3C"]
+        self.assertEqual( exec_node.calls, 3 )          # 'RM', 'DD', and 'FT D' in progress
+        self.assertEqual( len( exec_node.children ), 3 )
+        self.assertTrue( exec_node.open )
+
+    def test_live_view( self ):
+        cmd( self.dev, "WM 140 11", "WM 141 22" )
+        link = Link( self.dev )
+        try:
+            link.send( b"LV 140 12 0A\r" )
+            frame = link.expect( b"\r\n" ) + b"\r\n" + link.expect( b"\r\n" )
+            recs = re.findall( rb"([0-9A-F]{2})([0-9A-F]{2})", frame.replace( b"\r\n", b"" ).replace( b"+", b"" ) )
+            self.assertEqual( frame.count( b"+" ), 2 )      # 16 records per line
+            self.assertEqual( [int( o, 16 ) for o, _ in recs], list( range( 0x12 ) ) )
+            self.assertEqual( bytes( int( v, 16 ) for _, v in recs[:2] ), b"\x11\x22" )
+            link.read( 0.1 )
+            self.assertEqual( link.buf, b"" )               # unchanged:  nothing sent
+            link.send( b"RM 140\r" )                        # not a command while viewing
+            link.send( b"\x1b" )
+            self.assertEqual( link.expect( b"\r\n-" ), b"" )
+        finally:
+            link.close()
+
+    def test_gdb_stub( self ):
+        cmd( self.dev, "WM 150 DE", "WM 151 AD" )
+        link = Link( self.dev )
+        try:
+            link.send( gdb_packet( b"?" ) )
+            link.expect( b"+" + gdb_packet( b"S05" ) )
+            link.send( b"+" + gdb_packet( b"m800150,2" ) )
+            link.expect( b"+" + gdb_packet( b"dead" ) )
+            link.send( b"+" + gdb_packet( b"M800152,2:beef" ) )
+            link.expect( b"+" + gdb_packet( b"OK" ) )
+            link.send( b"+" + gdb_packet( b"M100,1:00" ) )  # flash
+            link.expect( b"+" + gdb_packet( b"E03" ) )
+            link.send( b"+$g#00" )                          # bad checksum
+            link.expect( b"-" )
+            link.send( gdb_packet( b"g" ) )
+            self.assertRegex( link.expect( b"#" ), rb"^\+\$[0-9a-f]{78}$" )   # 39 bytes
+            link.send( b"+" + gdb_packet( b"c" ) + b"\x03" )
+            link.expect( b"+" + gdb_packet( b"S02" ) )
+            link.send( b"+" + gdb_packet( b"D" ) )
+            link.expect( b"+" + gdb_packet( b"OK" ) + b"\r\n-" )
+        finally:
+            link.close()
+        self.assertEqual( read_data( self.dev, 0x152, 2 ), b"\xbe\xef" )
+        self.assertEqual( cli( self.dev, "vn" )[0], 0 )
+
+
+class CrashRecordTest( unittest.TestCase ):
+
+    def test_crash_record( self ):
+        sim = Sim( "-c" )
+        try:
+            fields = cmd( sim.link, "CM" ).split()
+            self.assertEqual( len( fields ), 11 )
+            self.assertEqual( fields[0], "01" )             # watchdog timeout
+            self.assertEqual( cmd( sim.link, "WS" ).split()[0], "08" )
+            cmd( sim.link, "CM C" )
+            self.assertEqual( cmd( sim.link, "CM" ).strip(), "00" )
+        finally:
+            sim.close()
+
+
+class DaemonTest( unittest.TestCase ):
+
+    @classmethod
+    def setUpClass( cls ):
+        cls.sim = Sim()
+        cls.sock = cls.sim.daemon()
+
+    @classmethod
+    def tearDownClass( cls ):
+        cls.sim.close()
+
+    def test_clients( self ):
+        self.assertEqual( cli( self.sock, "wm", "160", "A5" )[0], 0 )
+        procs = [subprocess.Popen( [tool( "avrmon-cli" ), "-d", self.sock, "rm", "160", "161"],
+                                   stdout=subprocess.PIPE ) for _ in range( 4 )]
+        for proc in procs:
+            out, _ = proc.communicate( timeout=20 )
+            self.assertEqual( proc.returncode, 0 )
+            self.assertEqual( out.split()[1], b"A5" )
+        self.assertRegex( cli( self.sock, "vn" )[1], r"^\d+\.\d+\.\d+\n$" )
+
+    def test_dumps( self ):
+        packed = cmd( self.sock, "ZC 0 400" )
+        res = subprocess.run( [tool( "avrunpack" )], input=packed.encode(), stdout=subprocess.PIPE )
+        image = ihex_parse( cmd( self.sock, "XC 0 400" ) )
+        self.assertEqual( res.stdout, bytes( image[i] for i in range( 0x400 ) ) )
+
+    def stat( self, name ):
+        return int( re.search( r"(?m)^%s (\d+)" % name, cmd( self.sock, "%S" ) ).group( 1 ) )
+
+    def test_refused( self ):
+        for line in ("LV 100", "WD 100", "IM 1", "$g#67", "+"):
+            self.assertEqual( cli( self.sock, "cmd", line )[0], 1, line )
+        self.assertEqual( cli( self.sock, "vn" )[0], 0 )
+
+    def test_refused_interrupt( self ):
+        """Ctrl-C (GDB interrupt) at the start of a line is refused, not forwarded."""
+        import socket
+        with socket.socket( socket.AF_UNIX, socket.SOCK_STREAM ) as sock:
+            sock.connect( self.sock )
+            sock.settimeout( 5 )
+            sock.sendall( b"\x03VN\rVN\r" )
+            buf = b""
+            while buf.count( b"\r\n" ) < 2 or len( buf ) < buf.rindex( b"\r\n" ) + 3:
+                buf += sock.recv( 256 )
+        self.assertTrue( buf.startswith( b"\r\n!" ), buf )
+        self.assertRegex( buf[3:], rb"^V[0-9.]+\r\n-$" )
+
+    def test_cache( self ):
+        cmd( self.sock, "LS" )
+        hits = self.stat( "cache_hits" )
+        cmd( self.sock, "LS" )
+        self.assertEqual( self.stat( "cache_hits" ), hits + 1 )
+        cmd( self.sock, "VN" )                          # not cached
+        self.assertEqual( self.stat( "cache_hits" ), hits + 1 )
+        self.assertEqual( cli( self.sock, "cmd", "QQ" )[0], 1 )
+        cmd( self.sock, "LS" )                          # '!' cleared the cache
+        self.assertEqual( self.stat( "cache_hits" ), hits + 1 )
+        cmd( self.sock, "LS" )
+        self.assertEqual( self.stat( "cache_hits" ), hits + 2 )
+
+    def test_stats( self ):
+        out = cmd( self.sock, "%S" )
+        self.assertRegex( out, r"(?m)^requests \d+" )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+#
+#   tracetree.py  --  Rebuild call trees from an AVR monitor function trace ('FT D')
+#
+#   Usage:   tracetree.py [-n nm] [-f] firmware.elf [dumpfile]
+#
+#       -n nm        nm program (default avr-nm, or $AVR_NM)
+#       -f           also list a flat profile, by exclusive time
+#       dumpfile     captured 'FT D' response (default stdin), e.g.
+#                        avrmon-cli cmd "FT D" | tracetree.py Trace/avrmon.elf
+#
+#   Calls are merged by call path;  for each path the number of calls and the total
+#   inclusive time (function and callees) and exclusive time (function only) are
+#   shown, in microseconds.  Calls still in progress at the end of the trace are
+#   marked '*' and timed to the last record;  exits with no entry in the trace
+#   (calls made before the start of the buffer) are ignored.
+#
+
+import os
+import sys
+from collections import defaultdict
+
+from profmap import read_symbols
+
+
+def usage():
+    sys.stderr.write( "usage: tracetree.py [-n nm] [-f] firmware.elf [dumpfile]\n" )
+    sys.exit( 2 )
+
+
+def read_trace( lines ):
+    """Parse 'FT D' output; return a list of (is_entry, address, time_usec)."""
+    header = None
+    records = []
+    last = None
+    base = 0
+    for line in lines:
+        line = line.strip()
+        if line.startswith( "#" ):
+            f = line[1:].split()
+            header = dict( count=int( f[0], 16 ), period=int( f[1], 16 ), per_usec=int( f[2], 16 ) )
+        elif header is not None and line[:1] in (">", "<"):
+            addr, stamp = line[1:].split()
+            periods = int( stamp[:2], 16 ) + base
+            counts = periods * header["period"] + int( stamp[2:], 16 )
+            if last is not None and counts < last:      # timestamp MS byte wrapped
+                base += 256
+                counts += 256 * header["period"]
+            last = counts
+            records.append( (line[0] == ">", int( addr, 16 ), counts / header["per_usec"]) )
+    if header is None:
+        sys.stderr.write( "tracetree: no 'FT D' header line found\n" )
+        sys.exit( 1 )
+    return records
+
+
+class Node:
+    def __init__( self, name ):
+        self.name = name
+        self.calls = 0
+        self.incl = 0.0
+        self.excl = 0.0
+        self.open = False
+        self.children = {}
+
+    def child( self, name ):
+        if name not in self.children:
+            self.children[name] = Node( name )
+        return self.children[name]
+
+
+def build_tree( records, names ):
+    root = Node( "" )
+    stack = []          # [node, entry time, time in callees]
+    for is_entry, addr, t in records:
+        name = names( addr )
+        if is_entry:
+            parent = stack[-1][0] if stack else root
+            stack.append( [parent.child( name ), t, 0.0] )
+            continue
+        if not any( frame[0].name == name for frame in stack ):
+            continue        # entry not in the trace
+        while stack:
+            node, t_in, t_callees = stack.pop()
+            node.calls += 1
+            node.incl += t - t_in
+            node.excl += t - t_in - t_callees
+            if stack:
+                stack[-1][2] += t - t_in
+            if node.name == name:
+                break
+
+    t_end = records[-1][2] if records else 0.0
+    while stack:            # calls in progress
+        node, t_in, t_callees = stack.pop()
+        node.calls += 1
+        node.open = True
+        node.incl += t_end - t_in
+        node.excl += t_end - t_in - t_callees
+        if stack:
+            stack[-1][2] += t_end - t_in
+    return root
+
+
+def print_tree( node, depth=0 ):
+    for child in sorted( node.children.values(), key=lambda n: -n.incl ):
+        print( "%6d %10.1f %10.1f  %s%s%s" % (child.calls, child.incl, child.excl,
+               "  " * depth, child.name, " *" if child.open else "") )
+        print_tree( child, depth + 1 )
+
+
+def flatten( node, totals ):
+    for child in node.children.values():
+        entry = totals[child.name]
+        entry[0] += child.calls
+        entry[1] += child.excl
+        flatten( child, totals )
+
+
+def main( argv ):
+    nm = os.environ.get( "AVR_NM", "avr-nm" )
+    flat = False
+    args = []
+    i = 0
+    while i < len( argv ):
+        if argv[i] == "-n" and i + 1 < len( argv ):
+            nm = argv[i + 1];  i += 1
+        elif argv[i] == "-f":
+            flat = True
+        elif argv[i].startswith( "-" ):
+            usage()
+        else:
+            args.append( argv[i] )
+        i += 1
+    if len( args ) not in (1, 2):
+        usage()
+
+    functions = read_symbols( nm, args[0] )
+
+    def names( addr ):
+        for start, end, name in functions:
+            if start == addr:
+                return name
+        return "%06X" % addr
+
+    if len( args ) == 2:
+        with open( args[1] ) as f:
+            records = read_trace( f )
+    else:
+        records = read_trace( sys.stdin )
+
+    root = build_tree( records, names )
+    print( " calls  incl(us)   excl(us)  function" )
+    print_tree( root )
+
+    if flat:
+        totals = defaultdict( lambda: [0, 0.0] )
+        flatten( root, totals )
+        print()
+        print( " calls  excl(us)  function" )
+        for name, (calls, excl) in sorted( totals.items(), key=lambda item: -item[1][1] ):
+            print( "%6d %9.1f  %s" % (calls, excl, name) )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit( main( sys.argv[1:] ) )
@@ -0,0 +1,106 @@
+/*____________________________________________________________________________*\
+|
+|  File:        unpack.c
+|  Compiler:    GCC (Linux host)
+|
+|  Host-side unpacker for the monitor's packed memory dump command ('Zs').
+|  See avrmon/src/pack.h for the stream format.
+\*____________________________________________________________________________*/
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unpack.h"
+
+
+long  unpack_stream( const uint8_t *pbIn, size_t nIn, uint8_t *pbOut, size_t nOutMax )
+{
+	size_t  nIdx = 0;
+	size_t  nOut = 0;
+	size_t  nLen, nDist;
+	uint8_t bT;
+
+	while ( nIdx < nIn )
+	{
+		bT = pbIn[nIdx++];
+
+		if ( bT < PACK_T_RUN )      // Literal block
+		{
+			nLen = (size_t) bT + 1;
+			if ( nIdx + nLen > nIn || nOut + nLen > nOutMax )  return -1;
+			while ( nLen-- )  pbOut[nOut++] = pbIn[nIdx++];
+		}
+		else if ( bT < PACK_T_COPY )    // Run or long run
+		{
+			if ( bT == PACK_T_LONG_RUN )
+			{
+				if ( nIdx + 2 > nIn )  return -1;
+				nLen = ((size_t) pbIn[nIdx] << 8) | pbIn[nIdx + 1];
+				nIdx += 2;
+			}
+			else  nLen = (size_t) (bT - PACK_T_RUN) + PACK_MIN_MATCH;
+			if ( nIdx >= nIn || nOut + nLen > nOutMax )  return -1;
+			while ( nLen-- )  pbOut[nOut++] = pbIn[nIdx];
+			nIdx++ ;
+		}
+		else    // Copy from history (may overlap)
+		{
+			nLen = (size_t) (bT - PACK_T_COPY) + PACK_MIN_MATCH;
+			if ( nIdx >= nIn )  return -1;
+			nDist = (size_t) pbIn[nIdx++] + 1;
+			if ( nDist > nOut || nOut + nLen > nOutMax )  return -1;
+			while ( nLen-- )
+			{
+				pbOut[nOut] = pbOut[nOut - nDist];
+				nOut++ ;
+			}
+		}
+	}
+	return  (long) nOut;
+}
+
+
+static  int  hexval( char c )
+{
+	if ( c >= '0' && c <= '9' )  return  c - '0';
+	if ( c >= 'A' && c <= 'F' )  return  c - 'A' + 10;
+	if ( c >= 'a' && c <= 'f' )  return  c - 'a' + 10;
+	return  -1;
+}
+
+
+long  unpack_response( const char *pszText, uint8_t *pbOut, size_t nOutMax )
+{
+	const char *pc = pszText;
+	uint8_t    *pbPacked;
+	size_t      nPacked = 0;
+	long        lRawCount = -1;
+	long        lResult;
+	int         hi, lo;
+
+	pbPacked = calloc( strlen( pszText ) / 2 + 1, 1 );
+	if ( pbPacked == NULL )  return -1;
+
+	while ( *pc != '\0' )
+	{
+		if ( *pc == '#' )       // Statistics line: "#rrrr ppppp nnn%"
+		{
+			lRawCount = strtol( pc + 1, NULL, 16 );
+			break;
+		}
+		if ( isspace( (unsigned char) *pc ) )  { pc++;  continue; }
+		hi = hexval( pc[0] );
+		lo = ( hi < 0 ) ? -1 : hexval( pc[1] );
+		if ( lo < 0 )  { free( pbPacked );  return -1; }
+		pbPacked[nPacked++] = (uint8_t) ((hi << 4) | lo);
+		pc += 2;
+	}
+
+	lResult = unpack_stream( pbPacked, nPacked, pbOut, nOutMax );
+	free( pbPacked );
+
+	if ( lRawCount < 0 || lResult != lRawCount )  return -1;
+	return  lResult;
+}
+
+// end
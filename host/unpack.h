@@ -0,0 +1,32 @@
+/*
+*   unpack.h  --  Host-side unpacker for the monitor's packed memory dump ('Zs')
+*
+*   The stream format is defined in avrmon/src/pack.h; keep in step!
+*/
+#ifndef  _UNPACK_H_
+#define  _UNPACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define  PACK_MIN_MATCH         3
+#define  PACK_T_RUN          0x80
+#define  PACK_T_LONG_RUN     0xBF
+#define  PACK_T_COPY         0xC0
+
+/*
+|  Unpack a packed byte stream.
+|  Returns the number of bytes written to pbOut, or -1 if the stream is corrupt
+|  or would overflow the output buffer (nOutMax bytes).
+*/
+long  unpack_stream( const uint8_t *pbIn, size_t nIn, uint8_t *pbOut, size_t nOutMax );
+
+/*
+|  Unpack the text response of a 'Zs' command: lines of hex ASCII followed by the
+|  statistics line "#rrrr ppppp nnn%".  The raw count in the statistics line is
+|  checked against the unpacked length.
+|  Returns the number of bytes unpacked, or -1 on error.
+*/
+long  unpack_response( const char *pszText, uint8_t *pbOut, size_t nOutMax );
+
+#endif  /* _UNPACK_H_ */